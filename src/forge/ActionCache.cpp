@@ -0,0 +1,915 @@
+//
+// ActionCache.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "ActionCache.hpp"
+#include "ContentHash.hpp"
+#include "Context.hpp"
+#include "Target.hpp"
+#include "Forge.hpp"
+#include "System.hpp"
+#include "Job.hpp"
+#include "Scheduler.hpp"
+#include <assert/assert.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <algorithm>
+#include <functional>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(BUILD_OS_WINDOWS)
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+using std::map;
+using std::find;
+using std::vector;
+using std::string;
+using std::make_pair;
+using namespace sweet;
+using namespace sweet::forge;
+
+static const char* STREAM_FILENAMES [Action::STREAM_COUNT] =
+{
+    "dependencies",
+    "stdout",
+    "stderr"
+};
+
+/**
+// Get the names of the files in an entry in the order that they're packed.
+//
+// @param filenames
+//  The contents of the entry's `filenames` file, one filename written by 
+//  the command per line.
+//
+// @return
+//  The names of the files in the entry: `filenames`, one numbered file for 
+//  each filename written, and the captured output of each stream.
+*/
+static vector<string> entry_files( const std::string& filenames )
+{
+    vector<string> names( 1, string("filenames") );
+    int outputs = int(std::count( filenames.begin(), filenames.end(), '\n' ));
+    for ( int i = 0; i < outputs; ++i )
+    {
+        char stored [32];
+        snprintf( stored, sizeof(stored), "%d", i );
+        names.push_back( stored );
+    }
+    names.insert( names.end(), STREAM_FILENAMES, STREAM_FILENAMES + Action::STREAM_COUNT );
+    return names;
+}
+
+/**
+// Does a line hold a non-negative decimal number?
+*/
+static bool number( const std::string& contents, std::string::size_type start, std::string::size_type finish )
+{
+    return finish > start && finish - start < 20 && contents.find_first_not_of( "0123456789", start ) == finish;
+}
+
+Action::Action( Target* target, uint64_t key )
+: target_( target ),
+  key_( key ),
+  entry_(),
+  staging_(),
+  streams_(),
+  exit_code_( 0 ),
+  pending_( 0 )
+{
+    SWEET_ASSERT( target_ );
+}
+
+Target* Action::target() const
+{
+    return target_;
+}
+
+uint64_t Action::key() const
+{
+    return key_;
+}
+
+void Action::set_entry( const std::string& entry )
+{
+    entry_ = entry;
+}
+
+const std::string& Action::entry() const
+{
+    return entry_;
+}
+
+void Action::set_staging( const std::string& staging )
+{
+    staging_ = staging;
+}
+
+const std::string& Action::staging() const
+{
+    return staging_;
+}
+
+/**
+// Capture output written by the command.
+//
+// @param stream
+//  The pipe that the output was written to.
+//
+// @param output
+//  One or more lines of output separated by newlines.
+*/
+void Action::append( int stream, const std::string& output )
+{
+    SWEET_ASSERT( stream >= 0 && stream < STREAM_COUNT );
+    if ( !streams_[stream].empty() )
+    {
+        streams_[stream].push_back( '\n' );
+    }
+    streams_[stream].append( output );
+}
+
+const std::string& Action::stream( int stream ) const
+{
+    SWEET_ASSERT( stream >= 0 && stream < STREAM_COUNT );
+    return streams_[stream];
+}
+
+void Action::set_exit_code( int exit_code )
+{
+    exit_code_ = exit_code;
+}
+
+int Action::exit_code() const
+{
+    return exit_code_;
+}
+
+/**
+// Note another pipe or process that must finish before this Action can be
+// stored.
+*/
+void Action::add_pending()
+{
+    ++pending_;
+}
+
+/**
+// Note that a pipe or process has finished.
+//
+// @return
+//  True if every pipe and process has finished otherwise false.
+*/
+bool Action::finish()
+{
+    SWEET_ASSERT( pending_ > 0 );
+    --pending_;
+    return pending_ == 0;
+}
+
+/**
+// Constructor.
+//
+// @param forge
+//  The Forge that this ActionCache is part of.
+*/
+ActionCache::ActionCache( Forge* forge )
+: forge_( forge ),
+  directory_(),
+  digests_(),
+  remote_(),
+  actions_(),
+  staged_( 0 )
+{
+    SWEET_ASSERT( forge_ );
+}
+
+ActionCache::~ActionCache()
+{
+    for ( map<Context*, Action*>::const_iterator i = actions_.begin(); i != actions_.end(); ++i )
+    {
+        delete i->second;
+    }
+}
+
+/**
+// Set the directory that entries are stored in.
+//
+// @param directory
+//  The directory to store entries in or the empty string to disable
+//  caching.
+*/
+void ActionCache::set_directory( const std::string& directory )
+{
+    directory_ = directory;
+}
+
+/**
+// Get the directory that entries are stored in.
+//
+// @return
+//  The directory or the empty string if caching is disabled.
+*/
+const std::string& ActionCache::directory() const
+{
+    return directory_;
+}
+
+/**
+// Set the URL of the remote cache that entries are also read from and
+// written to.
+//
+// @param url
+//  The URL of the remote cache or the empty string to disable the remote
+//  cache.
+//
+// @return
+//  True if the URL was set otherwise false if it isn't a valid URL.
+*/
+bool ActionCache::set_url( const std::string& url )
+{
+    return remote_.set_url( url );
+}
+
+/**
+// Get the URL of the remote cache.
+//
+// @return
+//  The URL or the empty string if the remote cache is disabled.
+*/
+const std::string& ActionCache::url() const
+{
+    return remote_.url();
+}
+
+/**
+// Is the remote cache enabled?
+//
+// Entries are always restored from and stored to the local directory so
+// the remote cache is only used when caching is enabled.
+//
+// @return
+//  True if caching and the remote cache are enabled otherwise false.
+*/
+bool ActionCache::remote() const
+{
+    return enabled() && remote_.enabled();
+}
+
+/**
+// Is caching enabled?
+//
+// @return
+//  True if caching is enabled otherwise false.
+*/
+bool ActionCache::enabled() const
+{
+    return !directory_.empty();
+}
+
+/**
+// Begin an execute call that may be restored from or stored to the cache.
+//
+// @param command
+//  The command being executed.
+//
+// @param command_line
+//  The command line of the command being executed.
+//
+// @param dependencies
+//  True if a dependencies filter has been passed to capture the files that
+//  the command reads otherwise false.
+//
+// @param context
+//  The Context that is executing the command.
+//
+// @return
+//  The Action with its entry set if it was found in the cache or null if
+//  caching is disabled or the command can't be cached.
+*/
+Action* ActionCache::begin( const std::string& command, const std::string& command_line, bool dependencies, Context* context )
+{
+    SWEET_ASSERT( context );
+
+    Job* job = context->job();
+    bool cacheable =
+        enabled() &&
+        job &&
+        !job->target()->filenames().empty() &&
+        (!dependencies || !forge_->forge_hooks_library().empty()) &&
+        actions_.find( context ) == actions_.end()
+    ;
+    if ( !cacheable )
+    {
+        return nullptr;
+    }
+
+    Target* target = job->target();
+    uint64_t key = ContentHash::hash( command.data(), command.size() );
+    key = ContentHash::combine( key, ContentHash::hash(command_line.data(), command_line.size()) );
+    key = ContentHash::combine( key, target->hash() );
+    int i = 0;
+    Target* dependency = target->explicit_dependency( i );
+    while ( dependency )
+    {
+        const vector<string>& filenames = dependency->filenames();
+        for ( vector<string>::const_iterator filename = filenames.begin(); filename != filenames.end(); ++filename )
+        {
+            key = ContentHash::combine( key, digest(*filename) );
+        }
+        ++i;
+        dependency = target->explicit_dependency( i );
+    }
+
+    Action* action = new Action( target, key );
+    actions_.insert( make_pair(context, action) );
+    lookup( action );
+    return action;
+}
+
+/**
+// Look up the entry for \e action in the local directory.
+//
+// @param action
+//  The Action to look up, its entry is set if one is found.
+*/
+void ActionCache::lookup( Action* action )
+{
+    SWEET_ASSERT( action );
+    const vector<vector<string>> sets = manifest( action->key() );
+    for ( vector<vector<string>>::const_iterator set = sets.begin(); set != sets.end() && action->entry().empty(); ++set )
+    {
+        string entry = path( entry_key(action->key(), *set, true), "" );
+        if ( forge_->system()->exists(entry + "/filenames") )
+        {
+            action->set_entry( entry );
+        }
+    }
+}
+
+/**
+// Download the entry for \e key from the remote cache into the local 
+// directory.
+//
+// Called from a thread in the ThreadPool so that the Scheduler isn't stalled
+// waiting for the remote cache.  The manifest for \e key is fetched and the
+// first set of files that has an entry matching the local files is 
+// downloaded, unpacked, and added to the local manifest so that a later 
+// `lookup()` finds it.
+//
+// @param key
+//  The key of the Action to download the entry for.
+*/
+void ActionCache::download( uint64_t key )
+{
+    string contents;
+    if ( !remote_.get(name(key, ".manifest"), &contents) )
+    {
+        return;
+    }
+
+    const vector<vector<string>> sets = parse_manifest( contents );
+    for ( vector<vector<string>>::const_iterator set = sets.begin(); set != sets.end(); ++set )
+    {
+        uint64_t entry_key = ActionCache::entry_key( key, *set, false );
+        string entry = path( entry_key, "" );
+        string blob;
+        if ( forge_->system()->exists(entry + "/filenames") || (remote_.get(name(entry_key, ".entry"), &blob) && unpack(blob, entry)) )
+        {
+            update_manifest( key, *set );
+            return;
+        }
+    }
+}
+
+/**
+// Restore the files written and output printed by a command from the
+// cache entry found for \e action.
+//
+// Files are cloned from the cache entry where the file system supports it
+// and copied otherwise.  Files aren't hard linked as tools commonly rewrite
+// their outputs in place which would corrupt the cache entry.
+//
+// @param action
+//  The Action to restore.
+//
+// @return
+//  True if the Action was restored otherwise false if it must be executed.
+*/
+bool ActionCache::restore( Action* action )
+{
+    SWEET_ASSERT( action );
+    SWEET_ASSERT( !action->entry().empty() );
+
+    const string& entry = action->entry();
+    string contents;
+    if ( !read_file(entry + "/filenames", &contents) )
+    {
+        return false;
+    }
+
+    // Only restore the files that the Target is bound to so that an entry,
+    // possibly downloaded from a remote cache, never writes elsewhere.
+    const vector<string>& filenames = action->target()->filenames();
+    string expected;
+    for ( vector<string>::const_iterator filename = filenames.begin(); filename != filenames.end(); ++filename )
+    {
+        expected.append( *filename );
+        expected.push_back( '\n' );
+    }
+    if ( contents != expected )
+    {
+        return false;
+    }
+
+    System* system = forge_->system();
+    for ( int i = 0; i < int(filenames.size()); ++i )
+    {
+        char stored [32];
+        snprintf( stored, sizeof(stored), "/%d", i );
+        if ( !system->clone(entry + stored, filenames[i]) )
+        {
+            return false;
+        }
+    }
+
+    for ( int stream = 0; stream < Action::STREAM_COUNT; ++stream )
+    {
+        string output;
+        if ( read_file(entry + "/" + STREAM_FILENAMES[stream], &output) )
+        {
+            action->append( stream, output );
+        }
+    }
+    return true;
+}
+
+/**
+// Note that the command executed by \e context has exited.
+//
+// The files written by a command that succeeded are copied to a staging
+// directory straight away, before the Context is resumed and possibly
+// executes another command that writes to the same files.
+//
+// @param context
+//  The Context that executed the command.
+//
+// @param exit_code
+//  The exit code of the command.
+*/
+void ActionCache::exited( Context* context, int exit_code )
+{
+    map<Context*, Action*>::iterator i = actions_.find( context );
+    if ( i != actions_.end() )
+    {
+        Action* action = i->second;
+        actions_.erase( i );
+        action->set_exit_code( exit_code );
+        if ( exit_code == 0 && action->entry().empty() )
+        {
+            stage( action );
+        }
+        finished( action );
+    }
+}
+
+/**
+// Note that a pipe or process of \e action has finished and store the
+// Action once every pipe and process has finished.
+//
+// @param action
+//  The Action to note a pipe or process finishing for.
+*/
+void ActionCache::finished( Action* action )
+{
+    SWEET_ASSERT( action );
+    if ( action->finish() )
+    {
+        if ( !action->staging().empty() )
+        {
+            store( action );
+        }
+        delete action;
+    }
+}
+
+void ActionCache::stage( Action* action )
+{
+    SWEET_ASSERT( action );
+
+    string staging = staging_path();
+    try
+    {
+        System* system = forge_->system();
+        system->mkdir( staging );
+        string filenames;
+        const vector<string>& outputs = action->target()->filenames();
+        for ( int i = 0; i < int(outputs.size()); ++i )
+        {
+            char stored [32];
+            snprintf( stored, sizeof(stored), "/%d", i );
+            if ( !system->clone(outputs[i], staging + stored) )
+            {
+                system->rmdir( staging );
+                return;
+            }
+            filenames.append( outputs[i] );
+            filenames.push_back( '\n' );
+        }
+        if ( write_file(staging + "/filenames", filenames) )
+        {
+            action->set_staging( staging );
+        }
+    }
+
+    catch ( const std::exception& )
+    {
+        boost::system::error_code error;
+        boost::filesystem::remove_all( staging, error );
+    }
+}
+
+void ActionCache::store( Action* action )
+{
+    SWEET_ASSERT( action );
+
+    // Key the entry by the files that the command read, as captured in the
+    // Target's implicit dependencies, now that all of its output has been
+    // filtered.
+    vector<string> filenames;
+    const Target* target = action->target();
+    int i = 0;
+    Target* dependency = target->implicit_dependency( i );
+    while ( dependency )
+    {
+        const vector<string>& dependency_filenames = dependency->filenames();
+        filenames.insert( filenames.end(), dependency_filenames.begin(), dependency_filenames.end() );
+        ++i;
+        dependency = target->implicit_dependency( i );
+    }
+
+    const string& staging = action->staging();
+    uint64_t key = entry_key( action->key(), filenames, true );
+    string entry = path( key, "" );
+    bool stored = true;
+    for ( int stream = 0; stream < Action::STREAM_COUNT && stored; ++stream )
+    {
+        stored = write_file( staging + "/" + STREAM_FILENAMES[stream], action->stream(stream) );
+    }
+
+    boost::system::error_code error;
+    if ( stored && !boost::filesystem::exists(entry, error) )
+    {
+        boost::filesystem::rename( staging, entry, error );
+        stored = !error;
+    }
+    boost::filesystem::remove_all( staging, error );
+
+    if ( stored )
+    {
+        update_manifest( action->key(), filenames );
+        if ( remote_.enabled() )
+        {
+            forge_->scheduler()->transfer( 
+                std::bind(&ActionCache::upload, this, action->key(), key, filenames),
+                std::function<void ()>()
+            );
+        }
+    }
+}
+
+/**
+// Upload a stored entry and add its set of files to the manifest in the
+// remote cache.
+//
+// Called from a thread in the ThreadPool.  The remote manifest is read, 
+// merged, and written back so concurrent uploads of the same key can lose 
+// a set which only costs a later miss.
+*/
+void ActionCache::upload( uint64_t key, uint64_t entry, const std::vector<std::string>& filenames )
+{
+    string blob;
+    if ( !pack(path(entry, ""), &blob) || !remote_.put(name(entry, ".entry"), blob) )
+    {
+        return;
+    }
+
+    string contents;
+    vector<vector<string>> sets;
+    if ( remote_.get(name(key, ".manifest"), &contents) )
+    {
+        sets = parse_manifest( contents );
+    }
+    if ( find(sets.begin(), sets.end(), filenames) == sets.end() )
+    {
+        sets.push_back( filenames );
+        remote_.put( name(key, ".manifest"), format_manifest(sets) );
+    }
+}
+
+/**
+// Pack the files in an entry directory into a single blob.
+//
+// Each file is written as its name and size on separate lines followed by
+// its contents.
+*/
+bool ActionCache::pack( const std::string& entry, std::string* blob )
+{
+    SWEET_ASSERT( blob );
+    string filenames;
+    if ( !read_file(entry + "/filenames", &filenames) )
+    {
+        return false;
+    }
+
+    vector<string> names = entry_files( filenames );
+    for ( vector<string>::const_iterator name = names.begin(); name != names.end(); ++name )
+    {
+        string contents;
+        if ( !read_file(entry + "/" + *name, &contents) )
+        {
+            return false;
+        }
+        char size [32];
+        snprintf( size, sizeof(size), "\n%llu\n", (unsigned long long) contents.size() );
+        blob->append( *name );
+        blob->append( size );
+        blob->append( contents );
+    }
+    return true;
+}
+
+/**
+// Unpack a blob created by `pack()` into an entry directory.
+//
+// The blob must hold exactly the files that `pack()` writes, in the same 
+// order, with sizes that fit within the blob.  The files are written to a
+// staging directory that is renamed into place so that a partially 
+// unpacked, truncated, or otherwise invalid entry is never visible.
+//
+// @param blob
+//  The blob to unpack.
+//
+// @param entry
+//  The entry directory to unpack the blob into.
+//
+// @return
+//  True if the blob was valid and unpacked otherwise false.
+*/
+bool ActionCache::unpack( const std::string& blob, const std::string& entry )
+{
+    string staging = staging_path();
+    boost::system::error_code error;
+    boost::filesystem::create_directory( staging, error );
+    bool unpacked = !error;
+    vector<string> names( 1, string("filenames") );
+    string::size_type index = 0;
+    string::size_type position = 0;
+    while ( index < names.size() && unpacked )
+    {
+        string::size_type name_end = blob.find( '\n', position );
+        string::size_type size_end = name_end != string::npos ? blob.find( '\n', name_end + 1 ) : string::npos;
+        unpacked = 
+            size_end != string::npos &&
+            blob.compare( position, name_end - position, names[index] ) == 0 &&
+            number( blob, name_end + 1, size_end )
+        ;
+        if ( unpacked )
+        {
+            string::size_type size = string::size_type( strtoull(blob.c_str() + name_end + 1, nullptr, 10) );
+            position = size_end + 1;
+            unpacked = size <= blob.size() - position;
+            if ( unpacked )
+            {
+                string contents = blob.substr( position, size );
+                unpacked = write_file( staging + "/" + names[index], contents );
+                if ( index == 0 )
+                {
+                    names = entry_files( contents );
+                }
+                position += size;
+                ++index;
+            }
+        }
+    }
+    unpacked = unpacked && position == blob.size();
+
+    if ( unpacked )
+    {
+        boost::filesystem::rename( staging, entry, error );
+        unpacked = !error;
+    }
+    boost::filesystem::remove_all( staging, error );
+    return unpacked;
+}
+
+void ActionCache::update_manifest( uint64_t key, const std::vector<std::string>& filenames )
+{
+    vector<vector<string>> sets = manifest( key );
+    if ( find(sets.begin(), sets.end(), filenames) == sets.end() )
+    {
+        sets.push_back( filenames );
+        string staging = staging_path();
+        if ( write_file(staging, format_manifest(sets)) )
+        {
+            boost::system::error_code error;
+            boost::filesystem::rename( staging, path(key, ".manifest"), error );
+            if ( error )
+            {
+                boost::filesystem::remove( staging, error );
+            }
+        }
+    }
+}
+
+std::vector<std::vector<std::string>> ActionCache::manifest( uint64_t key ) const
+{
+    string contents;
+    if ( !read_file(path(key, ".manifest"), &contents) )
+    {
+        return vector<vector<string>>();
+    }
+    return parse_manifest( contents );
+}
+
+/**
+// Parse the sets of files listed in a manifest.
+//
+// Each set is written as the number of files in the set followed by the
+// files, all on separate lines.  Parsing stops at the first set with an
+// invalid count or fewer files than its count so that only complete sets
+// from a truncated or corrupted manifest are returned.
+//
+// @param contents
+//  The contents of the manifest.
+//
+// @return
+//  The complete sets of files listed in the manifest.
+*/
+std::vector<std::vector<std::string>> ActionCache::parse_manifest( const std::string& contents )
+{
+    vector<vector<string>> sets;
+    string::size_type start = 0;
+    string::size_type finish = contents.find( '\n' );
+    while ( finish != string::npos && number(contents, start, finish) )
+    {
+        unsigned long long count = strtoull( contents.c_str() + start, nullptr, 10 );
+        start = finish + 1;
+        vector<string> set;
+        for ( unsigned long long i = 0; i < count; ++i )
+        {
+            finish = contents.find( '\n', start );
+            if ( finish == string::npos )
+            {
+                return sets;
+            }
+            set.push_back( contents.substr(start, finish - start) );
+            start = finish + 1;
+        }
+        sets.push_back( set );
+        finish = contents.find( '\n', start );
+    }
+    return sets;
+}
+
+std::string ActionCache::format_manifest( const std::vector<std::vector<std::string>>& sets )
+{
+    string contents;
+    for ( vector<vector<string>>::const_iterator set = sets.begin(); set != sets.end(); ++set )
+    {
+        char count [32];
+        snprintf( count, sizeof(count), "%d\n", int(set->size()) );
+        contents.append( count );
+        for ( vector<string>::const_iterator filename = set->begin(); filename != set->end(); ++filename )
+        {
+            contents.append( *filename );
+            contents.push_back( '\n' );
+        }
+    }
+    return contents;
+}
+
+/**
+// Calculate the key of the entry for the files in a set of a manifest.
+//
+// @param key
+//  The key of the Action.
+//
+// @param filenames
+//  The files read by the command.
+//
+// @param remembered
+//  True to use and remember digests for the run (only from the main thread)
+//  or false to always calculate digests (from threads in the ThreadPool).
+//
+// @return
+//  The key of the entry.
+*/
+uint64_t ActionCache::entry_key( uint64_t key, const std::vector<std::string>& filenames, bool remembered )
+{
+    key = ContentHash::combine( key, uint64_t(filenames.size()) );
+    for ( vector<string>::const_iterator filename = filenames.begin(); filename != filenames.end(); ++filename )
+    {
+        uint64_t digest = 0;
+        if ( remembered )
+        {
+            digest = ActionCache::digest( *filename );
+        }
+        else
+        {
+            forge_->system()->digest( *filename, &digest );
+        }
+        key = ContentHash::combine( key, digest );
+    }
+    return key;
+}
+
+/**
+// Calculate the digest of a file.
+//
+// Digests are remembered for the run and only calculated again when the
+// last write time of the file changes.
+//
+// @param filename
+//  The file to calculate the digest of.
+//
+// @return
+//  The digest or 0 if the file doesn't exist or can't be read.
+*/
+uint64_t ActionCache::digest( const std::string& filename )
+{
+    System* system = forge_->system();
+    int64_t last_write_time = 0;
+    if ( !system->stat(filename, &last_write_time) )
+    {
+        return 0;
+    }
+
+    map<string, Digest>::iterator i = digests_.find( filename );
+    if ( i != digests_.end() && i->second.last_write_time == last_write_time )
+    {
+        return i->second.digest;
+    }
+
+    Digest digest = { last_write_time, 0 };
+    system->digest( filename, &digest.digest );
+    digests_[filename] = digest;
+    return digest.digest;
+}
+
+std::string ActionCache::path( uint64_t key, const char* extension ) const
+{
+    return directory_ + "/" + name( key, extension );
+}
+
+std::string ActionCache::name( uint64_t key, const char* extension )
+{
+    SWEET_ASSERT( extension );
+    char name [64];
+    snprintf( name, sizeof(name), "%016llx%s", (unsigned long long) key, extension );
+    return string( name );
+}
+
+std::string ActionCache::staging_path()
+{
+    char name [64];
+    snprintf( name, sizeof(name), "/staging-%d-%d", int(getpid()), int(staged_++) );
+    return directory_ + name;
+}
+
+bool ActionCache::read_file( const std::string& filename, std::string* contents )
+{
+    SWEET_ASSERT( contents );
+    FILE* file = fopen( filename.c_str(), "rb" );
+    if ( !file )
+    {
+        return false;
+    }
+    char buffer [8192];
+    size_t size = fread( buffer, 1, sizeof(buffer), file );
+    while ( size > 0 )
+    {
+        contents->append( buffer, size );
+        size = fread( buffer, 1, sizeof(buffer), file );
+    }
+    bool read = ferror( file ) == 0;
+    fclose( file );
+    return read;
+}
+
+bool ActionCache::write_file( const std::string& filename, const std::string& contents )
+{
+    FILE* file = fopen( filename.c_str(), "wb" );
+    if ( !file )
+    {
+        return false;
+    }
+    bool written = fwrite( contents.data(), 1, contents.size(), file ) == contents.size();
+    written = fclose( file ) == 0 && written;
+    return written;
+}
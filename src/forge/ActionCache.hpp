@@ -0,0 +1,140 @@
+#ifndef FORGE_ACTIONCACHE_HPP_INCLUDED
+#define FORGE_ACTIONCACHE_HPP_INCLUDED
+
+#include "RemoteCache.hpp"
+#include <map>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <stdint.h>
+
+namespace sweet
+{
+
+namespace forge
+{
+
+class Context;
+class Target;
+class Forge;
+
+/**
+// An execute call that is looked up in and stored to an ActionCache.
+//
+// The output that the command writes to the dependencies, stdout, and stderr
+// pipes is captured so that it can be stored with the files that the command
+// writes and replayed through the same filters when the Action is restored
+// from the cache.
+*/
+class Action
+{
+public:
+    enum Stream
+    {
+        STREAM_DEPENDENCIES,
+        STREAM_STDOUT,
+        STREAM_STDERR,
+        STREAM_COUNT
+    };
+
+private:
+    Target* target_; ///< The Target that the command is executed to build.
+    uint64_t key_; ///< The key calculated from the command, settings hash, and explicit inputs.
+    std::string entry_; ///< The directory of the cache entry found for this Action or empty on a miss.
+    std::string staging_; ///< The directory that the files written by the command are copied to before they're stored or empty if they haven't been.
+    std::string streams_ [STREAM_COUNT]; ///< The output captured from each pipe.
+    int exit_code_; ///< The exit code of the command.
+    int pending_; ///< The number of pipes and processes that haven't finished.
+
+public:
+    Action( Target* target, uint64_t key );
+    Target* target() const;
+    uint64_t key() const;
+    void set_entry( const std::string& entry );
+    const std::string& entry() const;
+    void set_staging( const std::string& staging );
+    const std::string& staging() const;
+    void append( int stream, const std::string& output );
+    const std::string& stream( int stream ) const;
+    void set_exit_code( int exit_code );
+    int exit_code() const;
+    void add_pending();
+    bool finish();
+};
+
+/**
+// Cache the files written by commands and the output that they print in a
+// local directory keyed by the command and the contents of its inputs.
+//
+// The key of an Action combines the command, the command line, the settings
+// hash of the Target being built, and the digests of the files bound to the
+// Target's explicit dependencies.  Implicit dependencies aren't known until
+// the command has run so each key has a manifest listing the sets of files
+// read by the command when it was stored.  Each set is digested in turn and
+// combined with the key to find the entry holding the files written and the
+// output printed by the command that read those files.
+//
+// Only commands run to build a Target, with the build hooks library
+// reporting the files that they read when a dependencies filter is passed,
+// are cached.  Entries are written to a staging directory and renamed into
+// place so that concurrent or interrupted builds never see partial entries.
+//
+// When a remote cache is set local misses are looked up in the remote cache
+// and stored entries are uploaded to it.  Transfers run in the ThreadPool
+// so that the Scheduler keeps dispatching results while they're in flight.
+*/
+class ActionCache
+{
+    struct Digest
+    {
+        int64_t last_write_time; ///< The last write time of the file when it was digested.
+        uint64_t digest; ///< The digest of the file's contents.
+    };
+
+    Forge* forge_; ///< The Forge that this ActionCache is part of.
+    std::string directory_; ///< The directory that entries are stored in or empty if caching is disabled.
+    std::map<std::string, Digest> digests_; ///< The digests of files calculated in this run.
+    RemoteCache remote_; ///< The remote cache that entries are also read from and written to.
+    std::map<Context*, Action*> actions_; ///< The Actions currently executing keyed by the Context that executed them.
+    std::atomic<int> staged_; ///< The number of staging directories and files created in this run (to generate unique names).
+
+public:
+    ActionCache( Forge* forge );
+    ~ActionCache();
+    void set_directory( const std::string& directory );
+    const std::string& directory() const;
+    bool enabled() const;
+    bool set_url( const std::string& url );
+    const std::string& url() const;
+    bool remote() const;
+    Action* begin( const std::string& command, const std::string& command_line, bool dependencies, Context* context );
+    void lookup( Action* action );
+    void download( uint64_t key );
+    bool restore( Action* action );
+    void exited( Context* context, int exit_code );
+    void finished( Action* action );
+    bool unpack( const std::string& blob, const std::string& entry );
+    static bool pack( const std::string& entry, std::string* blob );
+    static std::vector<std::vector<std::string>> parse_manifest( const std::string& contents );
+    static std::string format_manifest( const std::vector<std::vector<std::string>>& sets );
+
+private:
+    void stage( Action* action );
+    void store( Action* action );
+    void upload( uint64_t key, uint64_t entry, const std::vector<std::string>& filenames );
+    void update_manifest( uint64_t key, const std::vector<std::string>& filenames );
+    std::vector<std::vector<std::string>> manifest( uint64_t key ) const;
+    uint64_t entry_key( uint64_t key, const std::vector<std::string>& filenames, bool remembered );
+    uint64_t digest( const std::string& filename );
+    std::string path( uint64_t key, const char* extension ) const;
+    std::string staging_path();
+    static std::string name( uint64_t key, const char* extension );
+    static bool read_file( const std::string& filename, std::string* contents );
+    static bool write_file( const std::string& filename, const std::string& contents );
+};
+
+}
+
+}
+
+#endif
@@ -0,0 +1,104 @@
+//
+// Arena.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "Arena.hpp"
+#include <assert/assert.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <new>
+
+using std::vector;
+using std::mutex;
+using std::lock_guard;
+using namespace sweet::forge;
+
+/**
+// Constructor.
+//
+// @param size
+//  The size of the objects to allocate in bytes.
+//
+// @param objects_per_block
+//  The number of objects to allocate space for each time that the Arena 
+//  runs out of space.
+*/
+Arena::Arena( size_t size, size_t objects_per_block )
+: mutex_(),
+  size_( 0 ),
+  objects_per_block_( objects_per_block ),
+  blocks_(),
+  free_objects_( nullptr ),
+  next_object_( nullptr ),
+  end_( nullptr )
+{
+    SWEET_ASSERT( size > 0 );
+    SWEET_ASSERT( objects_per_block_ > 0 );
+    const size_t ALIGNMENT = alignof(std::max_align_t);
+    size_ = (std::max(size, sizeof(void*)) + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+}
+
+Arena::~Arena()
+{
+    for ( vector<char*>::const_iterator i = blocks_.begin(); i != blocks_.end(); ++i )
+    {
+        ::operator delete( *i );
+    }
+}
+
+/**
+// Get the size of the objects allocated by this Arena.
+//
+// @return
+//  The size of the objects allocated by this Arena in bytes.
+*/
+size_t Arena::size() const
+{
+    return size_;
+}
+
+/**
+// Allocate an object.
+//
+// @return
+//  The uninitialized memory for the object.
+*/
+void* Arena::allocate()
+{
+    lock_guard<mutex> lock( mutex_ );
+    if ( free_objects_ )
+    {
+        void* object = free_objects_;
+        free_objects_ = *reinterpret_cast<void**>( object );
+        return object;
+    }
+
+    if ( next_object_ == end_ )
+    {
+        char* block = static_cast<char*>( ::operator new(size_ * objects_per_block_) );
+        blocks_.push_back( block );
+        next_object_ = block;
+        end_ = block + size_ * objects_per_block_;
+    }
+
+    void* object = next_object_;
+    next_object_ += size_;
+    return object;
+}
+
+/**
+// Free an object previously allocated by this Arena.
+//
+// @param object
+//  The object to free (ignored if null).
+*/
+void Arena::deallocate( void* object )
+{
+    if ( object )
+    {
+        lock_guard<mutex> lock( mutex_ );
+        *reinterpret_cast<void**>( object ) = free_objects_;
+        free_objects_ = object;
+    }
+}
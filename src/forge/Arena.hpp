@@ -0,0 +1,46 @@
+#ifndef FORGE_ARENA_HPP_INCLUDED
+#define FORGE_ARENA_HPP_INCLUDED
+
+#include <mutex>
+#include <vector>
+#include <stddef.h>
+
+namespace sweet
+{
+
+namespace forge
+{
+
+/**
+// Allocate fixed size objects from large blocks of memory.
+//
+// Objects are carved out of blocks that each hold many objects and freed 
+// objects are kept on a free list for reuse rather than being returned to
+// the heap.  This avoids the per allocation overhead of the heap for 
+// objects, like Targets, that are allocated in very large numbers and keeps 
+// objects that are allocated together close together in memory.  Blocks 
+// are only released when the Arena is destroyed.
+*/
+class Arena
+{
+    std::mutex mutex_; ///< Locks access to the blocks and free list from multiple threads.
+    size_t size_; ///< The size of each object in bytes (rounded up to keep objects aligned).
+    size_t objects_per_block_; ///< The number of objects in each block.
+    std::vector<char*> blocks_; ///< The blocks allocated by this Arena.
+    void* free_objects_; ///< The first object in the list of freed objects or null if no objects are free.
+    char* next_object_; ///< The next object never allocated in the most recently allocated block.
+    char* end_; ///< One past the last object in the most recently allocated block.
+
+    public:
+        Arena( size_t size, size_t objects_per_block );
+        ~Arena();
+        size_t size() const;
+        void* allocate();
+        void deallocate( void* object );
+};
+
+}
+
+}
+
+#endif
@@ -0,0 +1,235 @@
+//
+// ContentHash.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "ContentHash.hpp"
+#include <assert/assert.hpp>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FORGE_CONTENT_HASH_SSE2
+#endif
+
+using namespace sweet::forge;
+
+static const uint64_t PRIME32_1 = 0x9e3779b1ULL;
+static const uint64_t PRIME64_1 = 0x9e3779b185ebca87ULL;
+static const uint64_t PRIME64_2 = 0xc2b2ae3d27d4eb4fULL;
+
+static const uint64_t INITIAL_ACCUMULATORS [] = 
+{
+    0x00000000c2b2ae3dULL,
+    0x9e3779b185ebca87ULL,
+    0xc2b2ae3d27d4eb4fULL,
+    0x165667b19e3779f9ULL,
+    0x85ebca77c2b2ae63ULL,
+    0x0000000085ebca77ULL,
+    0x27d4eb2f165667c5ULL,
+    0x000000009e3779b1ULL
+};
+
+static const uint64_t STRIPE_KEYS [] = 
+{
+    0xe220a8397b1dcdafULL,
+    0x6e789e6aa1b965f4ULL,
+    0x06c45d188009454fULL,
+    0xf88bb8a8724c81ecULL,
+    0x1b39896a51a8749bULL,
+    0x53cb9f0c747ea2eaULL,
+    0x2c829abe1f4532e1ULL,
+    0xc584133ac916ab3cULL
+};
+
+static const uint64_t SCRAMBLE_KEYS [] = 
+{
+    0x3ee5789041c98ac3ULL,
+    0xf3b8488c368cb0a6ULL,
+    0x657eecdd3cb13d09ULL,
+    0xc2d326e0055bdef6ULL,
+    0x8621a03fe0bbdb7bULL,
+    0x8e1f7555983aa92fULL,
+    0xb54e0f1600cc4d19ULL,
+    0x84bb3f97971d80abULL
+};
+
+ContentHash::ContentHash()
+: buffered_( 0 ),
+  stripes_( 0 ),
+  size_( 0 )
+{
+    memcpy( accumulators_, INITIAL_ACCUMULATORS, sizeof(accumulators_) );
+    memset( buffer_, 0, sizeof(buffer_) );
+}
+
+/**
+// Add data to the digest.
+//
+// @param data
+//  The data to add.
+//
+// @param size
+//  The size of the data in bytes.
+*/
+void ContentHash::update( const void* data, size_t size )
+{
+    SWEET_ASSERT( data || size == 0 );
+    const unsigned char* input = static_cast<const unsigned char*>( data );
+    size_ += size;
+
+    if ( buffered_ > 0 )
+    {
+        size_t bytes = size < STRIPE_SIZE - buffered_ ? size : STRIPE_SIZE - buffered_;
+        memcpy( buffer_ + buffered_, input, bytes );
+        buffered_ += bytes;
+        input += bytes;
+        size -= bytes;
+        if ( buffered_ < STRIPE_SIZE )
+        {
+            return;
+        }
+        stripe( buffer_ );
+        buffered_ = 0;
+    }
+
+    while ( size >= STRIPE_SIZE )
+    {
+        stripe( input );
+        input += STRIPE_SIZE;
+        size -= STRIPE_SIZE;
+    }
+
+    memcpy( buffer_, input, size );
+    buffered_ = size;
+}
+
+/**
+// Finish calculating the digest.
+//
+// @return
+//  The digest of all of the data added.
+*/
+uint64_t ContentHash::finish()
+{
+    if ( buffered_ > 0 )
+    {
+        memset( buffer_ + buffered_, 0, STRIPE_SIZE - buffered_ );
+        stripe( buffer_ );
+        buffered_ = 0;
+    }
+
+    uint64_t digest = size_ * PRIME64_1;
+    for ( int i = 0; i < LANES; ++i )
+    {
+        digest = (digest ^ avalanche(accumulators_[i])) * PRIME64_2;
+    }
+    return avalanche( digest );
+}
+
+/**
+// Calculate the digest of a block of memory.
+//
+// @param data
+//  The data to calculate the digest of.
+//
+// @param size
+//  The size of the data in bytes.
+//
+// @return
+//  The digest.
+*/
+uint64_t ContentHash::hash( const void* data, size_t size )
+{
+    ContentHash content_hash;
+    content_hash.update( data, size );
+    return content_hash.finish();
+}
+
+/**
+// Combine a value into a digest.
+//
+// The result depends on the order that values are combined in.
+//
+// @param digest
+//  The digest to combine \e value into.
+//
+// @param value
+//  The value to combine.
+//
+// @return
+//  The combined digest.
+*/
+uint64_t ContentHash::combine( uint64_t digest, uint64_t value )
+{
+    return avalanche( digest ^ (value + PRIME64_1 + (digest << 6) + (digest >> 2)) );
+}
+
+void ContentHash::stripe( const unsigned char* data )
+{
+#if defined(FORGE_CONTENT_HASH_SSE2)
+    __m128i* accumulators = reinterpret_cast<__m128i*>( accumulators_ );
+    for ( int i = 0; i < LANES / 2; ++i )
+    {
+        __m128i value = _mm_loadu_si128( reinterpret_cast<const __m128i*>(data) + i );
+        __m128i key = _mm_loadu_si128( reinterpret_cast<const __m128i*>(STRIPE_KEYS) + i );
+        __m128i keyed_value = _mm_xor_si128( value, key );
+        __m128i product = _mm_mul_epu32( keyed_value, _mm_shuffle_epi32(keyed_value, _MM_SHUFFLE(0, 3, 0, 1)) );
+        __m128i swapped_value = _mm_shuffle_epi32( value, _MM_SHUFFLE(1, 0, 3, 2) );
+        __m128i accumulator = _mm_loadu_si128( accumulators + i );
+        _mm_storeu_si128( accumulators + i, _mm_add_epi64(accumulator, _mm_add_epi64(product, swapped_value)) );
+    }
+#else
+    for ( int i = 0; i < LANES; ++i )
+    {
+        uint64_t value = 0;
+        memcpy( &value, data + i * sizeof(uint64_t), sizeof(value) );
+        uint64_t keyed_value = value ^ STRIPE_KEYS[i];
+        accumulators_[i ^ 1] += value;
+        accumulators_[i] += (keyed_value & 0xffffffffULL) * (keyed_value >> 32);
+    }
+#endif
+
+    ++stripes_;
+    if ( stripes_ == STRIPES_PER_BLOCK )
+    {
+        scramble();
+        stripes_ = 0;
+    }
+}
+
+void ContentHash::scramble()
+{
+#if defined(FORGE_CONTENT_HASH_SSE2)
+    __m128i* accumulators = reinterpret_cast<__m128i*>( accumulators_ );
+    const __m128i prime = _mm_set1_epi32( int(PRIME32_1) );
+    for ( int i = 0; i < LANES / 2; ++i )
+    {
+        __m128i accumulator = _mm_loadu_si128( accumulators + i );
+        __m128i key = _mm_loadu_si128( reinterpret_cast<const __m128i*>(SCRAMBLE_KEYS) + i );
+        accumulator = _mm_xor_si128( accumulator, _mm_srli_epi64(accumulator, 47) );
+        accumulator = _mm_xor_si128( accumulator, key );
+        __m128i low = _mm_mul_epu32( accumulator, prime );
+        __m128i high = _mm_mul_epu32( _mm_srli_epi64(accumulator, 32), prime );
+        _mm_storeu_si128( accumulators + i, _mm_add_epi64(low, _mm_slli_epi64(high, 32)) );
+    }
+#else
+    for ( int i = 0; i < LANES; ++i )
+    {
+        uint64_t accumulator = accumulators_[i];
+        accumulator ^= accumulator >> 47;
+        accumulator ^= SCRAMBLE_KEYS[i];
+        accumulators_[i] = accumulator * PRIME32_1;
+    }
+#endif
+}
+
+uint64_t ContentHash::avalanche( uint64_t value )
+{
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    value ^= value >> 33;
+    return value;
+}
@@ -0,0 +1,55 @@
+#ifndef FORGE_CONTENTHASH_HPP_INCLUDED
+#define FORGE_CONTENTHASH_HPP_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace sweet
+{
+
+namespace forge
+{
+
+/**
+// Calculate a fast 64 bit non-cryptographic digest of the contents of files.
+//
+// The digest follows the structure of XXH3's long input loop: input is 
+// consumed in 64 byte stripes that are multiplied and accumulated into eight
+// independent 64 bit lanes that are periodically scrambled and finally 
+// avalanched together.  Lanes are processed two at a time with SSE2 when it
+// is available and one at a time otherwise with identical results.
+//
+// Digests are only compared against digests calculated by the same build of
+// forge on the same machine so the digest isn't compatible with XXH3 itself 
+// and isn't intended to be stable across versions.
+*/
+class ContentHash
+{
+    static const int LANES = 8;
+    static const int STRIPE_SIZE = 64;
+    static const int STRIPES_PER_BLOCK = 16;
+
+    uint64_t accumulators_ [LANES]; ///< The accumulator for each lane.
+    unsigned char buffer_ [STRIPE_SIZE]; ///< Input that doesn't yet fill a stripe.
+    size_t buffered_; ///< The number of bytes in the buffer.
+    int stripes_; ///< The number of stripes accumulated since the accumulators were last scrambled.
+    uint64_t size_; ///< The total number of bytes of input.
+
+    public:
+        ContentHash();
+        void update( const void* data, size_t size );
+        uint64_t finish();
+        static uint64_t hash( const void* data, size_t size );
+        static uint64_t combine( uint64_t digest, uint64_t value );
+
+    private:
+        void stripe( const unsigned char* data );
+        void scramble();
+        static uint64_t avalanche( uint64_t value );
+};
+
+}
+
+}
+
+#endif
@@ -29,6 +29,7 @@ Context::Context( Forge* forge )
   directories_(), 
   job_( NULL ),
   exit_code_( 0 ),
+  pool_weights_(),
   buildfile_calling_context_( nullptr )
 {
     lua_State* lua_state = forge->lua_state();
@@ -116,6 +117,17 @@ int Context::exit_code() const
     return exit_code_;
 }
 
+/**
+// Get the pools claimed by the next execute call from this Context.
+//
+// @return
+//  The index and weight of each pool claimed.
+*/
+const std::vector<std::pair<int, int> >& Context::pool_weights() const
+{
+    return pool_weights_;
+}
+
 /**
 // Prepend the working directory to \e path to create an absolute path.
 //
@@ -282,6 +294,17 @@ void Context::set_exit_code( int exit_code )
     exit_code_ = exit_code;
 }
 
+/**
+// Set the pools claimed by the next execute call from this Context.
+//
+// @param pool_weights
+//  The index and weight of each pool to claim (see `Executor::pool_index()`).
+*/
+void Context::set_pool_weights( const std::vector<std::pair<int, int> >& pool_weights )
+{
+    pool_weights_ = pool_weights;
+}
+
 void Context::set_buildfile_calling_context( Context* context )
 {
     buildfile_calling_context_ = context;
@@ -3,6 +3,7 @@
 
 #include <boost/filesystem/path.hpp>
 #include <vector>
+#include <utility>
 
 struct lua_State;
 
@@ -29,6 +30,7 @@ class Context
     std::vector<boost::filesystem::path> directories_; ///< The stack of working directories for this context (the element at the top is the current working directory).
     Job* job_; ///< The current Job for this context.
     int exit_code_; ///< The exit code from the Job that was most recently executed by this context.
+    std::vector<std::pair<int, int> > pool_weights_; ///< The index and weight of each pool claimed by the next execute call from this context.
     Context* buildfile_calling_context_; ///< The Context that made a `buildfile()` call and yielded
 
     public:
@@ -41,6 +43,7 @@ class Context
         Target* working_directory() const;
         Job* job() const;
         int exit_code() const;
+        const std::vector<std::pair<int, int> >& pool_weights() const;
         Context* buildfile_calling_context();
         boost::filesystem::path absolute( const boost::filesystem::path& path ) const;
         boost::filesystem::path relative( const boost::filesystem::path& path ) const;
@@ -53,6 +56,7 @@ class Context
         void set_current_buildfile( Target* buildfile );
         void set_job( Job* job );
         void set_exit_code( int exit_code );
+        void set_pool_weights( const std::vector<std::pair<int, int> >& pool_weights );
         void set_buildfile_calling_context( Context* context );
 };
 
@@ -9,6 +9,10 @@
 #include "Context.hpp"
 #include "Reader.hpp"
 #include "Scheduler.hpp"
+#include "ThreadPool.hpp"
+#include "Reactor.hpp"
+#include "Trace.hpp"
+#include "Statistics.hpp"
 #include <process/Process.hpp>
 #include <process/Environment.hpp>
 #include <error/Error.hpp>
@@ -31,21 +35,26 @@ using namespace sweet::forge;
 Executor::Executor( Forge* forge )
 : forge_( forge ),
   jobs_mutex_(),
-  jobs_empty_condition_(),
-  jobs_ready_condition_(),
   jobs_(),
+  pools_(),
+  active_pool_weights_(),
   forge_hooks_library_(),
+  spawn_server_( NULL ),
   maximum_parallel_jobs_( 1 ),
-  threads_(),
-  done_( false )
+  active_jobs_( 0 ),
+  throttle_( forge ),
+  jobserver_(),
+  token_waiter_( false ),
+  token_starved_( false )
 {
     SWEET_ASSERT( forge_ );
+    jobserver_.connect( ::getenv("MAKEFLAGS") );
     initialize_build_hooks_windows();
 }
 
 Executor::~Executor()
 {
-    stop();
+    SWEET_ASSERT( jobs_.empty() );
 }
 
 const std::string& Executor::forge_hooks_library() const
@@ -58,64 +67,273 @@ int Executor::maximum_parallel_jobs() const
     return maximum_parallel_jobs_;
 }
 
+Throttle* Executor::throttle()
+{
+    return &throttle_;
+}
+
+/**
+// Set whether or not this Executor serves a GNU make jobserver for the
+// processes that it starts.
+//
+// Serving is ignored when already connected to a jobserver inherited from
+// a parent make so that the parent's budget is shared instead.  The
+// jobserver holds tokens for the maximum number of parallel jobs and is 
+// recreated when the maximum number of parallel jobs changes.
+//
+// @param jobserver_enabled
+//  True to serve a jobserver or false to stop serving.
+*/
+void Executor::set_jobserver_enabled( bool jobserver_enabled )
+{
+    std::unique_lock<std::mutex> lock( jobs_mutex_ );
+    SWEET_ASSERT( active_jobs_ == 0 );
+    if ( jobserver_enabled && !jobserver_.enabled() )
+    {
+        jobserver_.serve( maximum_parallel_jobs_ );
+    }
+    else if ( !jobserver_enabled && jobserver_.serving() )
+    {
+        jobserver_.disconnect();
+    }
+}
+
+/**
+// Is this Executor taking tokens from a GNU make jobserver?
+//
+// @return
+//  True if connected to an inherited jobserver or serving one otherwise 
+//  false.
+*/
+bool Executor::jobserver_enabled() const
+{
+    std::unique_lock<std::mutex> lock( jobs_mutex_ );
+    return jobserver_.enabled();
+}
+
+/**
+// Is this Executor serving a GNU make jobserver?
+//
+// @return
+//  True if serving a jobserver otherwise false.
+*/
+bool Executor::jobserver_serving() const
+{
+    std::unique_lock<std::mutex> lock( jobs_mutex_ );
+    return jobserver_.serving();
+}
+
 void Executor::set_forge_hooks_library( const std::string& forge_hooks_library )
 {
     forge_hooks_library_ = forge_hooks_library;
 }
 
+void Executor::set_spawn_server( process::SpawnServer* spawn_server )
+{
+    spawn_server_ = spawn_server;
+}
+
+process::SpawnServer* Executor::spawn_server() const
+{
+    return spawn_server_;
+}
+
 void Executor::set_maximum_parallel_jobs( int maximum_parallel_jobs )
 {
-    stop();
+    std::unique_lock<std::mutex> lock( jobs_mutex_ );
     maximum_parallel_jobs_ = max( 1, maximum_parallel_jobs );
+    if ( jobserver_.serving() && active_jobs_ == 0 )
+    {
+        jobserver_.serve( maximum_parallel_jobs_ );
+    }
 }
 
-void Executor::execute( const std::string& command, const std::string& command_line, process::Environment* environment, Filter* dependencies_filter, Filter* stdout_filter, Filter* stderr_filter, Arguments* arguments, Context* context )
+/**
+// Declare a named pool or change the capacity of an existing one.
+//
+// @param name
+//  The name of the pool.
+//
+// @param capacity
+//  The total weight that execute calls may claim from the pool at once
+//  (clamped to at least 1).
+*/
+void Executor::set_pool( const std::string& name, int capacity )
 {
-    SWEET_ASSERT( !command.empty() );
-    SWEET_ASSERT( context );
+    std::unique_lock<std::mutex> lock( jobs_mutex_ );
+    pools_.set( name, capacity );
+    dispatch();
+}
 
-    start();
+/**
+// Get the capacity of a named pool.
+//
+// @param name
+//  The name of the pool.
+//
+// @return
+//  The capacity of the pool or 0 if no pool named \e name has been declared.
+*/
+int Executor::pool( const std::string& name ) const
+{
     std::unique_lock<std::mutex> lock( jobs_mutex_ );
-    jobs_.push_back( std::bind(&Executor::thread_execute, this, command, command_line, environment, dependencies_filter, stdout_filter, stderr_filter, arguments, context->working_directory(), context) );
-    jobs_ready_condition_.notify_all();
+    return pools_.capacity( name );
 }
 
-int Executor::thread_main( void* context )
+/**
+// Get the index of a named pool.
+//
+// Pools are never removed so an index remains valid for the lifetime of
+// this Executor.
+//
+// @param name
+//  The name of the pool.
+//
+// @return
+//  The index of the pool or -1 if no pool named \e name has been declared.
+*/
+int Executor::pool_index( const std::string& name ) const
 {
-    Executor* executor = reinterpret_cast<Executor*>( context );
-    SWEET_ASSERT( executor );
-    executor->thread_process();
-    return EXIT_SUCCESS;
+    std::unique_lock<std::mutex> lock( jobs_mutex_ );
+    return pools_.index( name );
 }
 
-void Executor::thread_process()
+void Executor::execute( const std::string& command, const std::string& command_line, process::Environment* environment, Filter* dependencies_filter, Filter* stdout_filter, Filter* stderr_filter, Arguments* arguments, Context* context )
 {
+    SWEET_ASSERT( !command.empty() );
+    SWEET_ASSERT( context );
+
     std::unique_lock<std::mutex> lock( jobs_mutex_ );
-    while ( !done_ )
+    environment = inject_jobserver( environment );
+
+    Job job;
+    job.function = std::bind( &Executor::thread_execute, this, command, command_line, environment, dependencies_filter, stdout_filter, stderr_filter, arguments, context->working_directory(), context );
+    job.context = context;
+    job.pool_weights = context->pool_weights();
+
+    jobs_.push_back( job );
+    dispatch();
+}
+
+/**
+// Push queued execute calls to the thread pool while there are fewer than 
+// the maximum number of parallel jobs, as limited by the Throttle, running.
+//
+// Calls are pushed to the blocking thread pool instead when the Reactor is
+// disabled as each call then blocks its thread waiting for its process.
+//
+// Calls are considered in the order that they were queued.  Calls that
+// claim pools without enough capacity are skipped so that they don't block
+// calls behind them that claim other pools, but they block the pools that
+// they claim so that later calls claiming the same pools don't overtake
+// them.
+//
+// Each call started while another is running holds a jobserver token when
+// a jobserver is enabled.  When no token is available dispatching stops
+// and a thread in the thread pool waits for a token to dispatch again.
+//
+// Assumes that `jobs_mutex_` is locked by the caller.
+*/
+void Executor::dispatch()
+{
+    ThreadPool* thread_pool = forge_->reactor()->enabled() ? forge_->thread_pool() : forge_->blocking_thread_pool();
+    int limit = throttle_.limit( active_jobs_, !jobs_.empty(), maximum_parallel_jobs_ );
+    token_starved_ = false;
+    pools_.begin_dispatch();
+    std::deque<Job>::iterator job = jobs_.begin();
+    while ( active_jobs_ < limit && job != jobs_.end() )
     {
-        if ( jobs_.empty() )
+        if ( !pools_.available(job->pool_weights) )
         {
-            jobs_empty_condition_.notify_all();
-            jobs_ready_condition_.wait( lock );
+            pools_.block( job->pool_weights );
+            ++job;
+            continue;
         }
 
-        if ( !jobs_.empty() )
+        if ( jobserver_.enabled() && !jobserver_.acquire_for_job(active_jobs_) )
         {
-            std::function<void()> function = jobs_.front();
-            jobs_.pop_front();
-            lock.unlock();
-            function();
-            lock.lock();
+            token_starved_ = true;
+            break;
         }
+
+        pools_.claim( job->pool_weights );
+        if ( !job->pool_weights.empty() )
+        {
+            active_pool_weights_[job->context].swap( job->pool_weights );
+        }
+        thread_pool->push( job->function );
+        job = jobs_.erase( job );
+        ++active_jobs_;
+    }
+
+    if ( token_starved_ && !token_waiter_ )
+    {
+        token_waiter_ = true;
+        thread_pool->push( std::bind(&Executor::thread_wait_for_token, this) );
     }
 }
 
+/**
+// Note that an execute call has finished, return the weights it claimed to
+// their pools, and dispatch the next queued calls.
+*/
+void Executor::finished( Context* context )
+{
+    std::unique_lock<std::mutex> lock( jobs_mutex_ );
+    SWEET_ASSERT( active_jobs_ > 0 );
+    --active_jobs_;
+    std::map<Context*, vector<std::pair<int, int> > >::iterator active = active_pool_weights_.find( context );
+    if ( active != active_pool_weights_.end() )
+    {
+        pools_.release( active->second );
+        active_pool_weights_.erase( active );
+    }
+    dispatch();
+
+    // Return tokens that are no longer needed now that fewer jobs are
+    // running.
+    jobserver_.release_for_jobs( active_jobs_ );
+}
+
+/**
+// Wait briefly for a jobserver token to become available and dispatch
+// queued execute calls again.
+//
+// Waits in the thread pool and returns after each attempt, rather than 
+// looping until a token is found, so that the calls that it dispatches 
+// aren't kept from running when the thread pool has few threads.  The
+// next dispatch pushes another wait if it still lacks a token.
+*/
+void Executor::thread_wait_for_token()
+{
+    jobserver_.wait( 100 );
+    std::unique_lock<std::mutex> lock( jobs_mutex_ );
+    token_waiter_ = false;
+    dispatch();
+}
+
+/**
+// Note that a process started by an execute call has exited.
+//
+// Called from the thread that waited for the process or from the Reactor's
+// thread when the Reactor is waiting for processes.
+*/
+void Executor::exited( int exit_code, Context* context, process::Environment* environment )
+{
+    forge_->trace()->end( "process", "process", uint64_t(uintptr_t(context)) );
+    finished( context );
+    forge_->scheduler()->push_execute_finished( exit_code, context, environment );
+}
+
 void Executor::thread_execute( const std::string& command, const std::string& command_line, process::Environment* environment, Filter* dependencies_filter, Filter* stdout_filter, Filter* stderr_filter, Arguments* arguments, Target* working_directory, Context* context )
 {
     SWEET_ASSERT( forge_ );
     
+    Trace* trace = forge_->trace();
+    trace->begin( "process", "process", command_line.c_str(), uint64_t(uintptr_t(context)) );
     try
     {
+        ScopedTrace spawn_trace( trace, "process", "spawn", command.c_str() );
         environment = inject_build_hooks_linux( environment, dependencies_filter != NULL );
         environment = inject_build_hooks_macosx( environment, dependencies_filter != NULL );
         if ( environment )
@@ -128,12 +346,14 @@ void Executor::thread_execute( const std::string& command, const std::string& co
         process.directory( working_directory->path().c_str() );
         process.environment( environment );
         process.start_suspended( true );
+        process.spawn_server( spawn_server_ );
 
         intptr_t read_dependencies_pipe = dependencies_filter && !forge_hooks_library_.empty() ? process.pipe( PIPE_USER_0 ) : -1;
         intptr_t write_dependencies_pipe = (intptr_t) process.write_pipe( 0 );
         intptr_t stdout_pipe = process.pipe( PIPE_STDOUT );
         intptr_t stderr_pipe = process.pipe( PIPE_STDERR );
         process.run( command_line.c_str() );
+        forge_->statistics()->add( Statistics::COUNTER_PROCESSES );
         inject_build_hooks_windows( &process, write_dependencies_pipe );
         process.resume();
 
@@ -144,70 +364,47 @@ void Executor::thread_execute( const std::string& command, const std::string& co
         }
         scheduler->read( stdout_pipe, stdout_filter, arguments, working_directory );
         scheduler->read( stderr_pipe, stderr_filter, arguments, working_directory );
-        process.wait();
-        scheduler->push_execute_finished( process.exit_code(), context, environment );
+        if ( forge_->reactor()->wait(&process, std::bind(&Executor::exited, this, std::placeholders::_1, context, environment)) )
+        {
+            return;
+        }
+        {
+            ScopedTrace wait_trace( trace, "process", "wait", command.c_str() );
+            process.wait();
+        }
+        exited( process.exit_code(), context, environment );
     }
 
     catch ( const std::exception& exception )
     {
+        trace->end( "process", "process", uint64_t(uintptr_t(context)) );
+        finished( context );
         Scheduler* scheduler = forge_->scheduler();
         scheduler->push_errorf( "%s", exception.what() );
         scheduler->push_execute_finished( EXIT_FAILURE, context, environment );
     }
 }
 
-void Executor::start()
-{
-    SWEET_ASSERT( maximum_parallel_jobs_ > 0 );
-
-    if ( threads_.empty() )
-    {
-        std::unique_lock<std::mutex> lock( jobs_mutex_ );
-        done_ = false;
-        threads_.reserve( maximum_parallel_jobs_ );
-        for ( int i = 0; i < maximum_parallel_jobs_; ++i )
-        {
-            unique_ptr<std::thread> thread( new std::thread(&Executor::thread_main, this) );
-            threads_.push_back( thread.release() );
-        }
-    }
-}
-
-void Executor::stop()
+/**
+// Pass the jobserver to a child process through `MAKEFLAGS`.
+//
+// The jobserver flags are merged into any `MAKEFLAGS` already set in 
+// \e environment so that the child sees a single `MAKEFLAGS`.
+//
+// Assumes that `jobs_mutex_` is locked by the caller.
+*/
+process::Environment* Executor::inject_jobserver( process::Environment* environment ) const
 {
-    if ( !threads_.empty() )
+    if ( jobserver_.enabled() )
     {
+        if ( !environment )
         {
-            std::unique_lock<std::mutex> lock( jobs_mutex_ );
-            if ( !jobs_.empty() )
-            {
-                jobs_empty_condition_.wait( lock );
-            }
-            done_ = true;
-            jobs_ready_condition_.notify_all();
-        }
-
-        for ( vector<std::thread*>::iterator i = threads_.begin(); i != threads_.end(); ++i )
-        {
-            try
-            {
-                std::thread* thread = *i;
-                SWEET_ASSERT( thread );
-                thread->join();
-            }
-
-            catch ( const std::exception& exception )
-            {
-                forge_->errorf( "Failed to join thread - %s", exception.what() );
-            }
-        }
-        
-        while ( !threads_.empty() )
-        {
-            delete threads_.back();
-            threads_.pop_back();
+            environment = new process::Environment;
         }
+        string makeflags = jobserver_.merge_makeflags( environment->find("MAKEFLAGS") );
+        environment->set( "MAKEFLAGS", makeflags.c_str() );
     }
+    return environment;
 }
 
 process::Environment* Executor::inject_build_hooks_linux( process::Environment* environment, bool dependencies_filter_exists ) const
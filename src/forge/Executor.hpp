@@ -3,11 +3,14 @@
 
 #include <vector>
 #include <deque>
+#include <map>
+#include <utility>
 #include <functional>
-#include <condition_variable>
 #include <mutex>
-#include <thread>
 #include <string>
+#include "Throttle.hpp"
+#include "Pools.hpp"
+#include "JobServer.hpp"
 
 namespace sweet
 {
@@ -17,6 +20,7 @@ namespace process
 
 class Environment;
 class Process;
+class SpawnServer;
 
 }
 
@@ -30,36 +34,73 @@ class Filter;
 class Forge;
 
 /**
-// A thread pool and queue of scan and execute calls to be executed in that
-// thread pool.
+// A queue of execute calls to be executed in the Forge's ThreadPool with at
+// most a maximum number of processes running in parallel.
+//
+// Execute calls may also claim a weight from any number of named pools
+// (e.g. a `link` pool that limits parallel links or a `memory_gb` pool that
+// limits the memory used by parallel commands).  Queued calls are
+// dispatched in order as soon as a slot is free and every pool they claim
+// has capacity for their weight.  A call whose weight exceeds a pool's
+// capacity runs when that pool is otherwise unused.  A call waiting for a
+// pool isn't overtaken by later calls that claim the same pool (see Pools).
+//
+// When its Throttle is enabled the number of processes run in parallel is
+// further limited to adapt to the load on the machine.
+//
+// When connected to a GNU make jobserver, inherited through `MAKEFLAGS` or
+// served by this Executor, each process beyond the first also waits for a
+// token from the jobserver and child processes are passed `MAKEFLAGS` so
+// that they share the same budget.
 */
 class Executor
 {
+    struct Job
+    {
+        std::function<void ()> function; ///< The call that runs the job in the thread pool.
+        Context* context; ///< The Context that made the execute call.
+        std::vector<std::pair<int, int> > pool_weights; ///< The index and weight of each pool claimed by the job.
+    };
+
     Forge* forge_; ///< The Forge that this Executor is part of.
-    std::mutex jobs_mutex_; ///< The mutex that ensures exclusive access to this Executor.
-    std::condition_variable jobs_empty_condition_; ///< The condition attribute that is used to notify threads that there are jobs ready to be processed.
-    std::condition_variable jobs_ready_condition_; ///< The condition attribute that is used to notify threads that there are jobs ready to be processed.
-    std::deque<std::function<void ()> > jobs_; ///< The functions to be executed in the thread pool.
+    mutable std::mutex jobs_mutex_; ///< The mutex that ensures exclusive access to this Executor.
+    std::deque<Job> jobs_; ///< The execute calls waiting for a free slot to run in the thread pool.
+    Pools pools_; ///< The named pools that execute calls may claim weights from.
+    std::map<Context*, std::vector<std::pair<int, int> > > active_pool_weights_; ///< The pools claimed by each execute call currently running.
     std::string forge_hooks_library_; ///< The full path to the build hooks library.
+    process::SpawnServer* spawn_server_; ///< The SpawnServer that processes are spawned through or null to spawn them directly.
     int maximum_parallel_jobs_; ///< The maximum number of parallel jobs to allow.
-    std::vector<std::thread*> threads_; ///< The thread pool of threads used to process Jobs.
-    bool done_; ///< Whether or not this Executor has finished processing (indicates to the threads in the thread pool that they should return).
+    int active_jobs_; ///< The number of execute calls currently running in the thread pool.
+    Throttle throttle_; ///< The throttle that adapts the number of parallel jobs to the load on the machine.
+    JobServer jobserver_; ///< The GNU make jobserver that parallel jobs take tokens from.
+    bool token_waiter_; ///< Whether or not a thread is waiting for a jobserver token to become available.
+    bool token_starved_; ///< Whether or not the last dispatch stopped for lack of a jobserver token.
 
     public:
         Executor( Forge* forge );
         ~Executor();
         const std::string& forge_hooks_library() const;
         int maximum_parallel_jobs() const;
+        Throttle* throttle();
+        void set_jobserver_enabled( bool jobserver_enabled );
+        bool jobserver_enabled() const;
+        bool jobserver_serving() const;
         void set_forge_hooks_library( const std::string& forge_hook_library );
+        void set_spawn_server( process::SpawnServer* spawn_server );
+        process::SpawnServer* spawn_server() const;
         void set_maximum_parallel_jobs( int maximum_parallel_jobs );
+        void set_pool( const std::string& name, int capacity );
+        int pool( const std::string& name ) const;
+        int pool_index( const std::string& name ) const;
         void execute( const std::string& command, const std::string& command_line, process::Environment* environment, Filter* dependencies_filter, Filter* stdout_filter, Filter* stderr_filter, Arguments* arguments, Context* context );
 
     private:
-        static int thread_main( void* context );
-        void thread_process();
+        void dispatch();
+        void finished( Context* context );
+        void thread_wait_for_token();
+        process::Environment* inject_jobserver( process::Environment* environment ) const;
+        void exited( int exit_code, Context* context, process::Environment* environment );
         void thread_execute( const std::string& command, const std::string& command_line, process::Environment* environment, Filter* dependencies_filter, Filter* stdout_filter, Filter* stderr_filter, Arguments* arguments, Target* working_directory, Context* context );
-        void start();
-        void stop();
         process::Environment* inject_build_hooks_linux( process::Environment* environment, bool dependencies_filter_exists ) const;
         process::Environment* inject_build_hooks_macosx( process::Environment* environment, bool dependencies_filter_exists ) const;
         void inject_build_hooks_windows( process::Process* process, intptr_t write_dependencies_pipe ) const;
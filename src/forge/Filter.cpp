@@ -11,22 +11,46 @@ using namespace sweet::forge;
 
 Filter::Filter()
 : lua_state_( nullptr ),
-  reference_( LUA_NOREF )
+  reference_( LUA_NOREF ),
+  batch_( false ),
+  target_( nullptr ),
+  directory_(),
+  filenames_( false ),
+  action_( nullptr ),
+  stream_( 0 )
 {
 }
 
 Filter::Filter( lua_State* lua_state, lua_State* calling_lua_state, int position )
 : lua_state_( lua_state ),
-  reference_( LUA_NOREF )
+  reference_( LUA_NOREF ),
+  batch_( false ),
+  target_( nullptr ),
+  directory_(),
+  filenames_( false ),
+  action_( nullptr ),
+  stream_( 0 )
 {
     SWEET_ASSERT( lua_state_ );
+    if ( lua_istable(calling_lua_state, position) )
+    {
+        lua_getfield( calling_lua_state, position, "batch" );
+        batch_ = lua_toboolean( calling_lua_state, -1 ) != 0;
+        lua_pop( calling_lua_state, 1 );
+    }
     lua_pushvalue( calling_lua_state, position );
     reference_ = luaL_ref( calling_lua_state, LUA_REGISTRYINDEX );
 }
 
 Filter::Filter( const Filter& value )
 : lua_state_( value.lua_state_ ),
-  reference_( LUA_NOREF )
+  reference_( LUA_NOREF ),
+  batch_( value.batch_ ),
+  target_( value.target_ ),
+  directory_( value.directory_ ),
+  filenames_( value.filenames_ ),
+  action_( value.action_ ),
+  stream_( value.stream_ )
 {
     if ( lua_state_ )
     {
@@ -56,6 +80,12 @@ Filter& Filter::operator=( const Filter& value )
         
         lua_state_ = lua_state;
         reference_ = reference;
+        batch_ = value.batch_;
+        target_ = value.target_;
+        directory_ = value.directory_;
+        filenames_ = value.filenames_;
+        action_ = value.action_;
+        stream_ = value.stream_;
     }
     return *this;
 }
@@ -74,3 +104,69 @@ int Filter::reference() const
 {
     return reference_;
 }
+
+bool Filter::batch() const
+{
+    return batch_;
+}
+
+/**
+// Filter lines written by the build hooks library natively.
+//
+// @param target
+//  The Target to add implicit dependencies (and filenames) to.
+//
+// @param directory
+//  The directory that files must be within to be added to \e target.
+//
+// @param filenames
+//  True to add files written as filenames of \e target and files read as
+//  implicit dependencies or false to add files read as implicit 
+//  dependencies only.
+*/
+void Filter::set_target( Target* target, const std::string& directory, bool filenames )
+{
+    target_ = target;
+    directory_ = directory;
+    filenames_ = filenames;
+}
+
+Target* Filter::target() const
+{
+    return target_;
+}
+
+const std::string& Filter::directory() const
+{
+    return directory_;
+}
+
+bool Filter::filenames() const
+{
+    return filenames_;
+}
+
+/**
+// Capture the output filtered by this Filter for an Action.
+//
+// @param action
+//  The Action to capture output for or null to stop capturing output.
+//
+// @param stream
+//  The stream of \e action to capture output to.
+*/
+void Filter::set_action( Action* action, int stream )
+{
+    action_ = action;
+    stream_ = stream;
+}
+
+Action* Filter::action() const
+{
+    return action_;
+}
+
+int Filter::stream() const
+{
+    return stream_;
+}
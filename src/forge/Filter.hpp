@@ -1,6 +1,8 @@
 #ifndef FORGE_FILTER_HPP_INCLUDED
 #define FORGE_FILTER_HPP_INCLUDED
 
+#include <string>
+
 struct lua_State;
 
 namespace sweet
@@ -9,14 +11,35 @@ namespace sweet
 namespace forge
 {
 
+class Target;
+class Action;
+
 /**
 // Hold a reference to a function in Lua so that it doesn't get garbage 
 // collected.
+//
+// A filter that is a callable table with a true `batch` field is called
+// once with a table of lines for each batch of output read from a child
+// process rather than once for each line.
+//
+// A filter with a Target filters the lines written by the build hooks 
+// library natively, adding the files read within a directory as implicit
+// dependencies of that Target, without calling the Lua function.
+//
+// A filter with an Action captures the output that it filters so that the
+// output can be stored in the ActionCache.  Filters without a Lua function
+// print the output that they're passed.
 */
 class Filter
 {
     lua_State* lua_state_;
     int reference_;
+    bool batch_;
+    Target* target_; ///< The Target to add dependencies to when filtering natively or null.
+    std::string directory_; ///< The directory that files must be within to be added when filtering natively.
+    bool filenames_; ///< Whether files written are added as filenames of the Target when filtering natively.
+    Action* action_; ///< The Action to capture output for or null.
+    int stream_; ///< The stream of the Action that output is captured to.
     
 public:
     Filter();
@@ -25,6 +48,14 @@ public:
     Filter& operator=( const Filter& value );
     ~Filter();
     int reference() const;
+    bool batch() const;
+    void set_target( Target* target, const std::string& directory, bool filenames );
+    Target* target() const;
+    const std::string& directory() const;
+    bool filenames() const;
+    void set_action( Action* action, int stream );
+    Action* action() const;
+    int stream() const;
 };
 
 }
@@ -8,8 +8,15 @@
 #include "System.hpp"
 #include "Scheduler.hpp"
 #include "Executor.hpp"
+#include "ActionCache.hpp"
 #include "Reader.hpp"
+#include "ThreadPool.hpp"
+#include "Reactor.hpp"
+#include "Watcher.hpp"
+#include "Trace.hpp"
+#include "Statistics.hpp"
 #include "Graph.hpp"
+#include "StatCache.hpp"
 #include "Toolset.hpp"
 #include "Target.hpp"
 #include "Context.hpp"
@@ -21,12 +28,23 @@
 #include <forge/forge_lua/LuaToolsetPrototype.hpp>
 #include <error/ErrorPolicy.hpp>
 #include <assert/assert.hpp>
+#include <algorithm>
 
 using std::string;
 using std::vector;
 using namespace sweet;
 using namespace sweet::forge;
 
+namespace
+{
+
+// The maximum number of parallel jobs when every job blocks threads in the
+// blocking ThreadPool because the Reactor is disabled (see 
+// Forge::set_maximum_parallel_jobs()).
+const int MAXIMUM_BLOCKING_JOBS = 64;
+
+}
+
 /**
 // Constructor.
 //
@@ -47,6 +65,13 @@ Forge::Forge( const std::string& initial_directory, error::ErrorPolicy& error_po
   graph_( NULL ),
   scheduler_( NULL ),
   executor_( NULL ),
+  action_cache_( NULL ),
+  thread_pool_( NULL ),
+  blocking_thread_pool_( NULL ),
+  reactor_( NULL ),
+  watcher_( NULL ),
+  trace_( NULL ),
+  statistics_( NULL ),
   root_directory_(),
   initial_directory_(),
   home_directory_(),
@@ -60,12 +85,19 @@ Forge::Forge( const std::string& initial_directory, error::ErrorPolicy& error_po
     home_directory_ = make_drive_uppercase( system_->home() );
     executable_directory_ = make_drive_uppercase( system_->executable() ).parent_path();
 
+    trace_ = new Trace;
+    statistics_ = new Statistics( this );
     lua_ = new Lua( this );
     system_ = new System;
     reader_ = new Reader( this );
     graph_ = new Graph( this );
     scheduler_ = new Scheduler( this );
     executor_ = new Executor( this );
+    action_cache_ = new ActionCache( this );
+    thread_pool_ = new ThreadPool( this, "worker" );
+    blocking_thread_pool_ = new ThreadPool( this, "blocking" );
+    reactor_ = new Reactor( this );
+    watcher_ = new Watcher( this );
 
 #if defined BUILD_OS_WINDOWS
     set_forge_hooks_library( executable("forge_hooks.dll").generic_string() );
@@ -87,12 +119,19 @@ Forge::Forge( const std::string& initial_directory, error::ErrorPolicy& error_po
 */
 Forge::~Forge()
 {
+    delete watcher_;
+    delete reactor_;
+    delete blocking_thread_pool_;
+    delete thread_pool_;
+    delete action_cache_;
     delete executor_;
     delete scheduler_;
     delete graph_;
     delete reader_;
     delete system_;
     delete lua_;
+    delete statistics_;
+    delete trace_;
 }
 
 /**
@@ -166,6 +205,91 @@ Executor* Forge::executor() const
     return executor_;
 }
 
+/**
+// Get the ActionCache for this Forge.
+//
+// @return
+//  The ActionCache.
+*/
+ActionCache* Forge::action_cache() const
+{
+    SWEET_ASSERT( action_cache_ );
+    return action_cache_;
+}
+
+/**
+// Get the ThreadPool for this Forge.
+//
+// @return
+//  The ThreadPool.
+*/
+ThreadPool* Forge::thread_pool() const
+{
+    SWEET_ASSERT( thread_pool_ );
+    return thread_pool_;
+}
+
+/**
+// Get the ThreadPool that blocks reading from pipes and waiting for 
+// processes for this Forge.
+//
+// @return
+//  The blocking ThreadPool.
+*/
+ThreadPool* Forge::blocking_thread_pool() const
+{
+    SWEET_ASSERT( blocking_thread_pool_ );
+    return blocking_thread_pool_;
+}
+
+/**
+// Get the Reactor for this Forge.
+//
+// @return
+//  The Reactor.
+*/
+Reactor* Forge::reactor() const
+{
+    SWEET_ASSERT( reactor_ );
+    return reactor_;
+}
+
+/**
+// Get the Watcher for this Forge.
+//
+// @return
+//  The Watcher.
+*/
+Watcher* Forge::watcher() const
+{
+    SWEET_ASSERT( watcher_ );
+    return watcher_;
+}
+
+/**
+// Get the Trace for this Forge.
+//
+// @return
+//  The Trace.
+*/
+Trace* Forge::trace() const
+{
+    SWEET_ASSERT( trace_ );
+    return trace_;
+}
+
+/**
+// Get the Statistics for this Forge.
+//
+// @return
+//  The Statistics.
+*/
+Statistics* Forge::statistics() const
+{
+    SWEET_ASSERT( statistics_ );
+    return statistics_;
+}
+
 /**
 // Get the currently active Context for this Forge.
 //
@@ -292,13 +416,30 @@ bool Forge::stack_trace_enabled() const
 /**
 // Set the maximum number of parallel jobs.
 //
+// The ThreadPool never has more threads than there are logical processors.
+// Each parallel job that can't be multiplexed by the Reactor instead blocks
+// one thread in the blocking ThreadPool to wait for its process and up to 
+// three more to read from the pipes connected to that process.  When the 
+// Reactor is disabled every job blocks threads this way and so the maximum 
+// number of parallel jobs is capped at MAXIMUM_BLOCKING_JOBS to bound those
+// threads.
+//
 // @param maximum_parallel_jobs
 //  The maximum number of parallel jobs.
 */
 void Forge::set_maximum_parallel_jobs( int maximum_parallel_jobs )
 {
     SWEET_ASSERT( executor_ );
+    SWEET_ASSERT( thread_pool_ );
+    SWEET_ASSERT( blocking_thread_pool_ );
+    SWEET_ASSERT( reactor_ );
+    if ( !reactor_->enabled() )
+    {
+        maximum_parallel_jobs = std::min( maximum_parallel_jobs, MAXIMUM_BLOCKING_JOBS );
+    }
     executor_->set_maximum_parallel_jobs( maximum_parallel_jobs );
+    thread_pool_->set_threads( std::min(executor_->maximum_parallel_jobs(), system_->number_of_logical_processors()) );
+    blocking_thread_pool_->set_threads( std::min(4 * executor_->maximum_parallel_jobs(), 4 * MAXIMUM_BLOCKING_JOBS) );
 }
 
 /**
@@ -313,6 +454,93 @@ int Forge::maximum_parallel_jobs() const
     return executor_->maximum_parallel_jobs();
 }
 
+/**
+// Declare a named pool that limits the execute calls that claim a weight
+// from it or change the capacity of an existing pool.
+//
+// @param name
+//  The name of the pool.
+//
+// @param capacity
+//  The total weight that execute calls may claim from the pool at once.
+*/
+void Forge::set_pool( const std::string& name, int capacity )
+{
+    SWEET_ASSERT( executor_ );
+    executor_->set_pool( name, capacity );
+}
+
+/**
+// Get the capacity of a named pool.
+//
+// @return
+//  The capacity of the pool or 0 if no pool named \e name has been 
+//  declared.
+*/
+int Forge::pool( const std::string& name ) const
+{
+    SWEET_ASSERT( executor_ );
+    return executor_->pool( name );
+}
+
+/**
+// Set whether or not the number of processes run in parallel adapts to the
+// CPU and memory pressure on the machine.
+//
+// @param adaptive_jobs_enabled
+//  True to adapt the number of parallel processes to the load on the 
+//  machine or false to always run up to the maximum number of parallel 
+//  jobs.
+*/
+void Forge::set_adaptive_jobs_enabled( bool adaptive_jobs_enabled )
+{
+    SWEET_ASSERT( executor_ );
+    executor_->throttle()->set_enabled( adaptive_jobs_enabled );
+}
+
+/**
+// Does the number of processes run in parallel adapt to the CPU and memory
+// pressure on the machine?
+//
+// @return
+//  True if the number of parallel processes adapts otherwise false.
+*/
+bool Forge::adaptive_jobs_enabled() const
+{
+    SWEET_ASSERT( executor_ );
+    return executor_->throttle()->enabled();
+}
+
+/**
+// Set whether or not processes started by this Forge take tokens from a 
+// GNU make jobserver that this Forge serves to the processes it starts.
+//
+// A jobserver inherited from a parent make through `MAKEFLAGS` is always
+// used and can't be disabled.
+//
+// @param jobserver_enabled
+//  True to serve a jobserver when not already running under one otherwise
+//  false.
+*/
+void Forge::set_jobserver_enabled( bool jobserver_enabled )
+{
+    SWEET_ASSERT( executor_ );
+    executor_->set_jobserver_enabled( jobserver_enabled );
+}
+
+/**
+// Do processes started by this Forge take tokens from a GNU make jobserver?
+//
+// @return
+//  True if processes share a jobserver, inherited or served, otherwise 
+//  false.
+*/
+bool Forge::jobserver_enabled() const
+{
+    SWEET_ASSERT( executor_ );
+    return executor_->jobserver_enabled();
+}
+
 /**
 // Set the path to the build hooks library.
 //
@@ -338,6 +566,217 @@ const std::string& Forge::forge_hooks_library() const
     return executor_->forge_hooks_library();
 }
 
+/**
+// Set the SpawnServer that processes are spawned through.
+//
+// The SpawnServer must be started before this Forge, or anything else that
+// starts threads, is created and must outlive this Forge.
+//
+// @param spawn_server
+//  The running SpawnServer to spawn processes through or null to spawn 
+//  processes directly.
+*/
+void Forge::set_spawn_server( process::SpawnServer* spawn_server )
+{
+    SWEET_ASSERT( executor_ );
+    executor_->set_spawn_server( spawn_server );
+}
+
+/**
+// Get the SpawnServer that processes are spawned through.
+//
+// @return
+//  The SpawnServer or null if processes are spawned directly.
+*/
+process::SpawnServer* Forge::spawn_server() const
+{
+    SWEET_ASSERT( executor_ );
+    return executor_->spawn_server();
+}
+
+/**
+// Set whether or not files in directories that are unchanged since the 
+// previous run are stat'd when binding.
+//
+// @param stat_cache_enabled
+//  True to reuse the last write times of files in unchanged directories or 
+//  false to stat every file.
+*/
+void Forge::set_stat_cache_enabled( bool stat_cache_enabled )
+{
+    SWEET_ASSERT( graph_ );
+    graph_->stat_cache()->set_enabled( stat_cache_enabled );
+}
+
+/**
+// Are the last write times of files in unchanged directories reused?
+//
+// @return
+//  True if the last write times of files in unchanged directories are reused
+//  otherwise false.
+*/
+bool Forge::stat_cache_enabled() const
+{
+    SWEET_ASSERT( graph_ );
+    return graph_->stat_cache()->enabled();
+}
+
+/**
+// Set whether or not Targets compare digests of the contents of their files
+// rather than timestamps when binding.
+//
+// @param content_digests_enabled
+//  True to compare digests of file contents or false to compare timestamps.
+*/
+void Forge::set_content_digests_enabled( bool content_digests_enabled )
+{
+    SWEET_ASSERT( graph_ );
+    graph_->set_content_digests( content_digests_enabled );
+}
+
+/**
+// Do Targets compare digests of the contents of their files when binding?
+//
+// @return
+//  True if digests of file contents are compared otherwise false.
+*/
+bool Forge::content_digests_enabled() const
+{
+    SWEET_ASSERT( graph_ );
+    return graph_->content_digests();
+}
+
+/**
+// Set the directory that the files written and output printed by commands
+// are cached in.
+//
+// @param action_cache_directory
+//  The directory to cache in or an empty string to disable caching.
+*/
+void Forge::set_action_cache_directory( const std::string& action_cache_directory )
+{
+    SWEET_ASSERT( action_cache_ );
+    action_cache_->set_directory( action_cache_directory );
+}
+
+/**
+// Get the directory that the files written and output printed by commands
+// are cached in.
+//
+// @return
+//  The directory or an empty string if caching is disabled.
+*/
+const std::string& Forge::action_cache_directory() const
+{
+    SWEET_ASSERT( action_cache_ );
+    return action_cache_->directory();
+}
+
+/**
+// Set the URL of the remote cache that the files written and output 
+// printed by commands are shared through.
+//
+// @param action_cache_url
+//  The URL of the remote cache or an empty string to disable the remote
+//  cache.
+//
+// @return
+//  True if the URL was set otherwise false if it isn't a valid URL.
+*/
+bool Forge::set_action_cache_url( const std::string& action_cache_url )
+{
+    SWEET_ASSERT( action_cache_ );
+    return action_cache_->set_url( action_cache_url );
+}
+
+/**
+// Get the URL of the remote cache that the files written and output 
+// printed by commands are shared through.
+//
+// @return
+//  The URL or an empty string if the remote cache is disabled.
+*/
+const std::string& Forge::action_cache_url() const
+{
+    SWEET_ASSERT( action_cache_ );
+    return action_cache_->url();
+}
+
+/**
+// Set the file that a Chrome trace of the build is written to.
+//
+// @param trace_filename
+//  The file to write the trace to when the command finishes or an empty 
+//  string to disable tracing.
+*/
+void Forge::set_trace_filename( const std::string& trace_filename )
+{
+    SWEET_ASSERT( trace_ );
+    trace_->set_filename( trace_filename );
+}
+
+/**
+// Get the file that a Chrome trace of the build is written to.
+//
+// @return
+//  The file or an empty string if tracing is disabled.
+*/
+const std::string& Forge::trace_filename() const
+{
+    SWEET_ASSERT( trace_ );
+    return trace_->filename();
+}
+
+/**
+// Set whether or not build statistics are printed when a command finishes.
+//
+// @param statistics_enabled
+//  True to print statistics or false to not print them.
+*/
+void Forge::set_statistics_enabled( bool statistics_enabled )
+{
+    SWEET_ASSERT( statistics_ );
+    statistics_->set_enabled( statistics_enabled );
+}
+
+/**
+// Are build statistics printed when a command finishes?
+//
+// @return
+//  True if statistics are printed otherwise false.
+*/
+bool Forge::statistics_enabled() const
+{
+    SWEET_ASSERT( statistics_ );
+    return statistics_->enabled();
+}
+
+/**
+// Set whether or not every file is stat'd when binding even when the stat 
+// cache is enabled.
+//
+// @param rescan
+//  True to force a full rescan of every file or false to let the stat cache
+//  skip files in unchanged directories.
+*/
+void Forge::set_rescan( bool rescan )
+{
+    SWEET_ASSERT( graph_ );
+    graph_->stat_cache()->set_rescan( rescan );
+}
+
+/**
+// Is every file stat'd when binding even when the stat cache is enabled?
+//
+// @return
+//  True if a full rescan has been forced otherwise false.
+*/
+bool Forge::rescan() const
+{
+    SWEET_ASSERT( graph_ );
+    return graph_->stat_cache()->rescan();
+}
+
 /**
 // Set the root directory to *root_directory*.
 //
@@ -398,6 +837,16 @@ void Forge::execute( const std::string& filename, const std::string& command )
     {
         scheduler_->command( path, command );
     }
+
+    if ( statistics_->enabled() )
+    {
+        statistics_->report();
+    }
+
+    if ( trace_->enabled() && !trace_->save() )
+    {
+        errorf( "Writing the trace to '%s' failed", trace_->filename().c_str() );
+    }
 }
 
 /**
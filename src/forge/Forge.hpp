@@ -17,6 +17,13 @@ class ErrorPolicy;
 
 }
 
+namespace process
+{
+
+class SpawnServer;
+
+}
+
 namespace forge
 {
 
@@ -24,6 +31,12 @@ class Context;
 class ForgeEventSink;
 class Reader;
 class Executor;
+class ActionCache;
+class ThreadPool;
+class Reactor;
+class Watcher;
+class Trace;
+class Statistics;
 class Scheduler;
 class System;
 class TargetPrototype;
@@ -46,6 +59,13 @@ class Forge
     Graph* graph_; ///< The dependency graph of targets used to determine which targets are outdated.
     Scheduler* scheduler_; ///< The scheduler that schedules environments to process jobs in the dependency graph.
     Executor* executor_; ///< The executor that schedules threads to process commands.
+    ActionCache* action_cache_; ///< The cache of files written and output printed by commands.
+    ThreadPool* thread_pool_; ///< The pool of threads shared by the executor and reader.
+    ThreadPool* blocking_thread_pool_; ///< The pool of threads that block reading from and waiting for child processes when the reactor can't.
+    Reactor* reactor_; ///< The reactor that multiplexes reading from and waiting for child processes.
+    Watcher* watcher_; ///< The watcher that waits for changes to files in watch mode.
+    Trace* trace_; ///< The trace that records spans of time spent in each phase of the build.
+    Statistics* statistics_; ///< The counters and phase timers that summarize the work done by the build.
     boost::filesystem::path root_directory_; ///< The full path to the root directory.
     boost::filesystem::path initial_directory_; ///< The full path to the initial directory.
     boost::filesystem::path home_directory_; ///< The full path to the user's home directory.
@@ -62,6 +82,13 @@ class Forge
         Graph* graph() const;
         Scheduler* scheduler() const;
         Executor* executor() const;
+        ActionCache* action_cache() const;
+        ThreadPool* thread_pool() const;
+        ThreadPool* blocking_thread_pool() const;
+        Reactor* reactor() const;
+        Watcher* watcher() const;
+        Trace* trace() const;
+        Statistics* statistics() const;
         Context* context() const;
         lua_State* lua_state() const;
 
@@ -80,8 +107,30 @@ class Forge
         bool stack_trace_enabled() const;
         void set_maximum_parallel_jobs( int maximum_parallel_jobs );
         int maximum_parallel_jobs() const;
+        void set_pool( const std::string& name, int capacity );
+        int pool( const std::string& name ) const;
+        void set_adaptive_jobs_enabled( bool adaptive_jobs_enabled );
+        bool adaptive_jobs_enabled() const;
+        void set_jobserver_enabled( bool jobserver_enabled );
+        bool jobserver_enabled() const;
         void set_forge_hooks_library( const std::string& forge_hooks_library );
         const std::string& forge_hooks_library() const;
+        void set_spawn_server( process::SpawnServer* spawn_server );
+        process::SpawnServer* spawn_server() const;
+        void set_stat_cache_enabled( bool stat_cache_enabled );
+        bool stat_cache_enabled() const;
+        void set_content_digests_enabled( bool content_digests_enabled );
+        bool content_digests_enabled() const;
+        void set_action_cache_directory( const std::string& action_cache_directory );
+        const std::string& action_cache_directory() const;
+        bool set_action_cache_url( const std::string& action_cache_url );
+        const std::string& action_cache_url() const;
+        void set_trace_filename( const std::string& trace_filename );
+        const std::string& trace_filename() const;
+        void set_statistics_enabled( bool statistics_enabled );
+        bool statistics_enabled() const;
+        void set_rescan( bool rescan );
+        bool rescan() const;
 
         void set_root_directory( const std::string& root_directory );
         void assign_global_variables( const std::vector<std::string>& assignments_and_commands );
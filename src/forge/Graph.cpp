@@ -11,23 +11,57 @@
 #include "Forge.hpp"
 #include "Scheduler.hpp"
 #include "System.hpp"
+#include "StatCache.hpp"
+#include "Watcher.hpp"
+#include "ThreadPool.hpp"
+#include "Trace.hpp"
+#include "Statistics.hpp"
 #include "path_functions.hpp"
 #include "GraphReader.hpp"
 #include "GraphWriter.hpp"
+#include "GraphJournal.hpp"
+#include "MappedGraph.hpp"
 #include <assert/assert.hpp>
 #include <memory>
+#include <algorithm>
 #include <fstream>
+#include <sstream>
+#include <iterator>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <set>
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
+#include <ctype.h>
+#include <stdio.h>
+#if defined(BUILD_OS_WINDOWS)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 using std::list;
+using std::map;
+using std::set;
 using std::vector;
 using std::string;
 using std::unique_ptr;
+using std::unordered_map;
+using std::make_pair;
 using std::transform;
 using namespace sweet;
 using namespace sweet::forge;
 
+static bool is_separator( char character )
+{
+#if defined(BUILD_OS_WINDOWS)
+    return character == '/' || character == '\\';
+#else
+    return character == '/';
+#endif
+}
+
 /**
 // Constructor.
 */
@@ -39,6 +73,13 @@ Graph::Graph()
   filename_(),
   root_target_( nullptr ),
   cache_target_( nullptr ),
+  stat_cache_(),
+  targets_by_path_(),
+  generation_( 0 ),
+  file_size_( 0 ),
+  journal_size_( 0 ),
+  compact_( false ),
+  content_digests_( false ),
   traversal_in_progress_( false ),
   visited_revision_( 0 ),
   successful_revision_( 0 )
@@ -59,12 +100,20 @@ Graph::Graph( Forge* forge )
   filename_(),
   root_target_(),
   cache_target_(),
+  stat_cache_(),
+  targets_by_path_(),
+  generation_( 0 ),
+  file_size_( 0 ),
+  journal_size_( 0 ),
+  compact_( false ),
+  content_digests_( false ),
   traversal_in_progress_( false ),
   visited_revision_( 0 ),
   successful_revision_( 0 )
 {
     SWEET_ASSERT( forge_ );
     root_target_.reset( new Target("$$root", this) );
+    stat_cache_.reset( new StatCache(forge) );
 }
 
 Graph::~Graph()
@@ -122,6 +171,43 @@ Target* Graph::cache_target() const
     return cache_target_;
 }
 
+/**
+// Get the StatCache that remembers the directories containing the files
+// that Targets in this Graph are bound to.
+//
+// @return
+//  The StatCache.
+*/
+StatCache* Graph::stat_cache() const
+{
+    SWEET_ASSERT( stat_cache_ );
+    return stat_cache_.get();
+}
+
+/**
+// Set whether or not Targets in this Graph compare digests of the contents 
+// of their files rather than timestamps to determine whether or not they 
+// are outdated.
+//
+// @param content_digests
+//  True to compare digests of file contents or false to compare timestamps.
+*/
+void Graph::set_content_digests( bool content_digests )
+{
+    content_digests_ = content_digests;
+}
+
+/**
+// Do Targets in this Graph compare digests of the contents of their files?
+//
+// @return
+//  True if digests of file contents are compared otherwise false.
+*/
+bool Graph::content_digests() const
+{
+    return content_digests_;
+}
+
 /**
 // Get the Forge that this Graph is part of.
 //
@@ -303,32 +389,7 @@ Target* Graph::target( const std::string& id )
 */
 Target* Graph::add_or_find_target( const std::string& id, Target* working_directory )
 {
-    boost::filesystem::path path( id );
-    Target* target = working_directory && path.is_relative() ? working_directory : root_target_.get();
-    SWEET_ASSERT( target );
-
-    boost::filesystem::path::const_iterator i = path.begin();
-
-    if ( path.has_root_name() )
-    {
-        string element = i->generic_string();
-        transform( element.begin(), element.end(), element.begin(), toupper );
-        target = find_or_create_target_by_element( target, element );
-        ++i;
-    }
-
-    if ( path.is_absolute() )
-    {
-        SWEET_ASSERT( i->generic_string() == "/" );
-        ++i;
-    }
-
-    while ( i != path.end() )
-    {
-        target = find_or_create_target_by_element( target, i->generic_string() );
-        ++i;
-    }
-    return target;
+    return find_target_by_path( id, working_directory, true );
 }
 
 /**
@@ -350,35 +411,7 @@ Target* Graph::add_or_find_target( const std::string& id, Target* working_direct
 */
 Target* Graph::find_target( const std::string& id, Target* working_directory )
 {
-    Target* target = NULL;
-    if ( !id.empty() )
-    {
-        boost::filesystem::path path( id );
-        target = working_directory && path.is_relative() ? working_directory : root_target_.get();
-        boost::filesystem::path::const_iterator i = path.begin();
-        SWEET_ASSERT( target );
-
-        if ( path.has_root_name() )
-        {
-            string element = i->generic_string();
-            transform( element.begin(), element.end(), element.begin(), toupper );
-            target = find_or_create_target_by_element( target, element );
-            ++i;
-        }
-
-        if ( path.is_absolute() )
-        {
-            SWEET_ASSERT( i->generic_string() == "/" );
-            ++i;
-        }
-
-        while ( i != path.end() && target )
-        {
-            target = find_target_by_element( target, i->generic_string() );
-            ++i;
-        }    
-    }
-    return target;
+    return !id.empty() ? find_target_by_path( id, working_directory, false ) : nullptr;
 }
 
 /**
@@ -453,6 +486,7 @@ Target* Graph::find_or_create_target_by_element( Target* target, const std::stri
             found_target = new_target.get();
             target->add_target( new_target.release(), target );
             found_target->set_working_directory( target );
+            forge_->statistics()->add( Statistics::COUNTER_TARGETS );
         }
     }
     return found_target;
@@ -508,10 +542,12 @@ struct ScopedVisit
 struct Bind
 {
     Forge* forge_;
+    vector<Target*> targets_;
     int failures_;
     
     Bind( Forge* forge )
     : forge_( forge ),
+      targets_(),
       failures_( 0 )
     {
         SWEET_ASSERT( forge_ );
@@ -549,10 +585,37 @@ struct Bind
                 dependency = target->any_dependency( i );
             }
 
-            target->bind();
+            targets_.push_back( target );
             target->set_successful( true );
         }
     }
+
+    // Stat the directories of the visited Targets for the StatCache, bind 
+    // the Targets to their files in parallel, and then bind them to their
+    // dependencies in postorder so that each Target's dependencies are 
+    // bound before it is.
+    void bind()
+    {
+        const int GRAIN = 64;
+        forge_->graph()->stat_cache()->stat_directories( targets_ );
+        ThreadPool* thread_pool = forge_->thread_pool();
+        thread_pool->parallel( int(targets_.size()), GRAIN, std::bind(&Bind::bind_to_files, this, std::placeholders::_1, std::placeholders::_2) );
+        for ( vector<Target*>::const_iterator i = targets_.begin(); i != targets_.end(); ++i )
+        {
+            Target* target = *i;
+            SWEET_ASSERT( target );
+            target->bind_to_dependencies();
+        }
+    }
+
+    void bind_to_files( int begin, int end )
+    {
+        SWEET_ASSERT( begin >= 0 && begin <= end && end <= int(targets_.size()) );
+        for ( int i = begin; i < end; ++i )
+        {
+            targets_[i]->bind_to_file();
+        }
+    }
 };
 
 /**
@@ -577,11 +640,229 @@ int Graph::bind( Target* target )
         return 0;
     }
 
+    ScopedTrace trace( forge_->trace(), "graph", "bind" );
+    ScopedPhase phase( forge_->statistics(), Statistics::PHASE_BIND );
     Bind bind( forge_ );
     bind.visit( target ? target : root_target_.get() );
+    bind.bind();
     return bind.failures_;
 }
 
+/**
+// Wait for files bound to Targets to change and unbind the Targets that 
+// depend on them.
+//
+// The Targets that are unbound are those that are bound to a changed file,
+// those that were outdated when they were last bound (and so are likely to
+// have been rebuilt since), and the Targets that depend on them.  Other 
+// Targets remain bound so that the next bind only stats the files that 
+// might have changed and the next postorder traversal only rebuilds the 
+// Targets that are affected by the changes.
+//
+// Files that change in place don't change their directories so every file
+// that is bound again is stat'd regardless of the StatCache.
+//
+// @param target
+//  The Target to watch the files of it and its dependencies from or null to
+//  watch from the root of the Graph.
+//
+// @return
+//  True if files bound to Targets changed or false if a buildfile changed, 
+//  and the buildfiles need to be loaded again, or watching failed.
+*/
+bool Graph::wait_for_changes( Target* target )
+{
+    struct Watch
+    {
+        Graph* graph_;
+        Watcher* watcher_;
+        map<string, vector<Target*>>* targets_by_filename_;
+
+        Watch( Graph* graph, Watcher* watcher, map<string, vector<Target*>>* targets_by_filename )
+        : graph_( graph ),
+          watcher_( watcher ),
+          targets_by_filename_( targets_by_filename )
+        {
+            SWEET_ASSERT( graph_ );
+            SWEET_ASSERT( watcher_ );
+            SWEET_ASSERT( targets_by_filename_ );
+            graph_->begin_traversal();
+        }
+
+        ~Watch()
+        {
+            graph_->end_traversal();
+        }
+
+        void visit( Target* target )
+        {
+            SWEET_ASSERT( target );
+
+            if ( !target->visited() )
+            {
+                ScopedVisit visit( target );
+
+                int i = 0;
+                Target* dependency = target->any_dependency( i );
+                while ( dependency )
+                {
+                    if ( !dependency->visiting() )
+                    {
+                        Watch::visit( dependency );
+                    }
+                    ++i;
+                    dependency = target->any_dependency( i );
+                }
+
+                const vector<string>& filenames = target->filenames();
+                for ( vector<string>::const_iterator filename = filenames.begin(); filename != filenames.end(); ++filename )
+                {
+                    if ( !filename->empty() )
+                    {
+                        watcher_->watch( *filename );
+                        (*targets_by_filename_)[*filename].push_back( target );
+                    }
+                }
+            }
+        }
+    };
+
+    struct Unbind
+    {
+        Graph* graph_;
+        const set<Target*>& changed_targets_;
+        set<Target*> unbound_targets_;
+
+        Unbind( Graph* graph, const set<Target*>& changed_targets )
+        : graph_( graph ),
+          changed_targets_( changed_targets ),
+          unbound_targets_()
+        {
+            SWEET_ASSERT( graph_ );
+            graph_->begin_traversal();
+        }
+
+        ~Unbind()
+        {
+            graph_->end_traversal();
+        }
+
+        bool visit( Target* target )
+        {
+            SWEET_ASSERT( target );
+
+            if ( target->visited() )
+            {
+                return unbound_targets_.find( target ) != unbound_targets_.end();
+            }
+
+            ScopedVisit visit( target );
+            bool unbind = target->outdated() || changed_targets_.find( target ) != changed_targets_.end();
+            int i = 0;
+            Target* dependency = target->any_dependency( i );
+            while ( dependency )
+            {
+                if ( !dependency->visiting() )
+                {
+                    unbind = Unbind::visit( dependency ) || unbind;
+                }
+                ++i;
+                dependency = target->any_dependency( i );
+            }
+
+            if ( unbind )
+            {
+                target->unbind();
+                unbound_targets_.insert( target );
+            }
+            return unbind;
+        }
+    };
+
+    SWEET_ASSERT( !target || target->graph() == this );
+
+    if ( traversal_in_progress() )
+    {
+        forge_->error( "Wait for changes called from within another bind or postorder traversal" );
+        return false;
+    }
+
+    Watcher* watcher = forge_->watcher();
+    if ( !watcher->start() )
+    {
+        forge_->error( "Waiting for changes isn't supported on this platform" );
+        return false;
+    }
+
+    map<string, vector<Target*>> targets_by_filename;
+    {
+        Watch watch( this, watcher, &targets_by_filename );
+        watch.visit( target ? target : root_target_.get() );
+        int i = 0;
+        Target* buildfile = cache_target_ ? cache_target_->explicit_dependency( i ) : nullptr;
+        while ( buildfile )
+        {
+            watch.visit( buildfile );
+            ++i;
+            buildfile = cache_target_->explicit_dependency( i );
+        }
+    }
+
+    // Changes made while the previous build was running have already been
+    // queued.  Ignore changes to the files of outdated Targets as those were
+    // most likely written by the build but keep changes to any other files.
+    set<Target*> changed_targets;
+    vector<string> filenames;
+    if ( !watcher->wait(&filenames, false) )
+    {
+        return false;
+    }
+    for ( vector<string>::const_iterator filename = filenames.begin(); filename != filenames.end(); ++filename )
+    {
+        map<string, vector<Target*>>::const_iterator targets = targets_by_filename.find( *filename );
+        if ( targets != targets_by_filename.end() )
+        {
+            for ( vector<Target*>::const_iterator changed_target = targets->second.begin(); changed_target != targets->second.end(); ++changed_target )
+            {
+                if ( !(*changed_target)->outdated() )
+                {
+                    changed_targets.insert( *changed_target );
+                }
+            }
+        }
+    }
+
+    while ( changed_targets.empty() )
+    {
+        if ( !watcher->wait(&filenames, true) )
+        {
+            return false;
+        }
+
+        for ( vector<string>::const_iterator filename = filenames.begin(); filename != filenames.end(); ++filename )
+        {
+            map<string, vector<Target*>>::const_iterator targets = targets_by_filename.find( *filename );
+            if ( targets != targets_by_filename.end() )
+            {
+                changed_targets.insert( targets->second.begin(), targets->second.end() );
+            }
+        }
+    }
+
+    for ( set<Target*>::const_iterator changed_target = changed_targets.begin(); changed_target != changed_targets.end(); ++changed_target )
+    {
+        if ( cache_target_ && cache_target_->is_explicit_dependency(*changed_target) )
+        {
+            return false;
+        }
+    }
+
+    stat_cache_->set_rescan( true );
+    Unbind unbind( this, changed_targets );
+    unbind.visit( target ? target : root_target_.get() );
+    return true;
+}
+
 /**
 // Swap this Graph with \e graph.
 //
@@ -591,6 +872,8 @@ int Graph::bind( Target* target )
 void Graph::swap( Graph& graph )
 {
     std::swap( root_target_, graph.root_target_ );
+    targets_by_path_.clear();
+    graph.targets_by_path_.clear();
 }
 
 /**
@@ -632,6 +915,8 @@ void Graph::clear()
     };
 
     RecursiveClear::clear( root_target_.get() );
+    targets_by_path_.clear();
+    compact_ = true;
 }
 
 /**
@@ -666,17 +951,50 @@ Target* Graph::load_binary( const std::string& filename )
     SWEET_ASSERT( boost::filesystem::path(filename).is_absolute() );
     SWEET_ASSERT( forge_ );
     
+    ScopedTrace trace( forge_->trace(), "graph", "load_binary", filename.c_str() );
+    ScopedPhase phase( forge_->statistics(), Statistics::PHASE_LOAD_BINARY );
     filename_ = filename;
     cache_target_ = NULL;
+    targets_by_path_.clear();
+    generation_ = 0;
+    file_size_ = 0;
+    journal_size_ = 0;
+    compact_ = false;
 
     if ( forge_->system()->exists(filename) )
     {
-        std::ifstream ifstream( filename, std::ios::binary );
-        GraphReader graph_reader( &ifstream, &forge_->error_policy() );
-        unique_ptr<Target> root_target = graph_reader.read( filename );
+        // Cache files written in the stream format are read with the 
+        // GraphReader so that they are migrated to the mapped format the 
+        // next time that the Graph is saved.
+        unique_ptr<Target> root_target;
+        MappedGraph mapped_graph( &forge_->error_policy() );
+        if ( mapped_graph.map(filename) && mapped_graph.version() >= GraphReader::OLDEST_VERSION && mapped_graph.version() <= GraphReader::VERSION )
+        {
+            std::ifstream ifstream( filename, std::ios::binary );
+            GraphReader graph_reader( &ifstream, &forge_->error_policy() );
+            root_target = graph_reader.read( filename );
+            if ( root_target && graph_reader.version() >= 35 )
+            {
+                stat_cache_->read( graph_reader );
+            }
+        }
+        else
+        {
+            root_target = mapped_graph.read( filename, stat_cache_.get() );
+            if ( root_target )
+            {
+                generation_ = mapped_graph.generation();
+                file_size_ = mapped_graph.size();
+            }
+        }
+
         if ( root_target )
         {
             root_target_.swap( root_target );
+            if ( generation_ != 0 && forge_->system()->exists(journal_filename()) )
+            {
+                replay_journal();
+            }
             recover();
             return cache_target_;
         }
@@ -688,16 +1006,50 @@ Target* Graph::load_binary( const std::string& filename )
 
 /**
 // Save this Graph to a binary file.
+//
+// Targets that have changed since this Graph was loaded or last saved are
+// appended to a journal next to the dependency graph file.  The dependency
+// graph file is rewritten in full, and the journal removed, when there is no
+// dependency graph file to append to, when Targets have been removed by
+// `Graph::clear()`, or when the journal grows larger than half the size of
+// the dependency graph file.
+//
+// The dependency graph file is written to a temporary file that is then 
+// renamed over the original so that a crash while saving leaves the 
+// previous save intact.  Journal segments are appended in place and a 
+// segment torn by a crash is discarded when the journal is next replayed.
 */
 void Graph::save_binary()
 {
     SWEET_ASSERT( forge_ );
+    ScopedTrace trace( forge_->trace(), "graph", "save_binary", filename_.c_str() );
+    ScopedPhase phase( forge_->statistics(), Statistics::PHASE_SAVE_BINARY );
 
     if ( !filename_.empty() )
     {
-        std::ofstream ofstream( filename_, std::ios::binary );
-        GraphWriter graph_writer( &ofstream );
-        graph_writer.write( root_target_.get() );
+        bool saved = generation_ != 0 && !compact_ && save_journal();
+        if ( !saved )
+        {
+            saved = compact();
+        }
+
+        if ( saved )
+        {
+            struct RecursiveClean
+            {
+                static void clean( Target* target )
+                {
+                    SWEET_ASSERT( target );
+                    target->set_dirty( false );
+                    const vector<Target*>& targets = target->targets();
+                    for ( vector<Target*>::const_iterator i = targets.begin(); i != targets.end(); ++i )
+                    {
+                        RecursiveClean::clean( *i );
+                    }
+                }
+            };
+            RecursiveClean::clean( root_target_.get() );
+        }
     }
     else
     {
@@ -790,7 +1142,7 @@ void Graph::print_dependencies( Target* target, const std::string& directory )
                 printf( "%s ", target->prototype()->id().c_str() );
             }
 
-            std::time_t timestamp = target->timestamp();
+            std::time_t timestamp = std::time_t(target->timestamp() / 1000000000LL);
             struct tm* time = ::localtime( &timestamp );
             printf( "'%s' %c%c%c%c%c%c %04d-%02d-%02d %02d:%02d:%02d %" PRIx64 " %s", 
                 id(target),
@@ -812,7 +1164,7 @@ void Graph::print_dependencies( Target* target, const std::string& directory )
 
             if ( !target->filenames().empty() )
             {
-                timestamp = target->last_write_time();
+                timestamp = std::time_t(target->last_write_time() / 1000000000LL);
                 time = ::localtime( &timestamp );
                 printf( "%04d-%02d-%02d %02d:%02d:%02d", 
                     time->tm_year + 1900, 
@@ -955,3 +1307,240 @@ void Graph::print_namespace( Target* target )
     recursive_printer.print( target ? target : root_target_.get(), 0 );
     printf( "\n\n" );
 }
+
+Target* Graph::find_target_by_path( const std::string& id, Target* working_directory, bool create )
+{
+    // Split off the root name, e.g. "C:" or "//server", and the root 
+    // directory that make a path absolute as `boost::filesystem::path` does
+    // but without allocating a path and a string for each element.
+    const char* begin = id.c_str();
+    const char* end = begin + id.size();
+    const char* root_name_end = begin;
+#if defined(BUILD_OS_WINDOWS)
+    if ( id.size() >= 2 && isalpha(uint8_t(begin[0])) && begin[1] == ':' )
+    {
+        root_name_end = begin + 2;
+    }
+    else
+#endif
+    if ( id.size() > 2 && is_separator(begin[0]) && is_separator(begin[1]) && !is_separator(begin[2]) )
+    {
+        root_name_end = begin + 2;
+        while ( root_name_end != end && !is_separator(*root_name_end) )
+        {
+            ++root_name_end;
+        }
+    }
+    bool root_directory = root_name_end != end && is_separator( *root_name_end );
+#if defined(BUILD_OS_WINDOWS)
+    bool absolute = root_name_end != begin && root_directory;
+#else
+    bool absolute = root_directory;
+#endif
+
+    Target* target = working_directory && !absolute ? working_directory : root_target_.get();
+    SWEET_ASSERT( target );
+    unordered_map<string, Target*>& targets_by_path = targets_by_path_[target];
+    unordered_map<string, Target*>::const_iterator found_target = targets_by_path.find( id );
+    if ( found_target != targets_by_path.end() )
+    {
+        return found_target->second;
+    }
+
+    if ( root_name_end != begin )
+    {
+        string element( begin, root_name_end );
+        transform( element.begin(), element.end(), element.begin(), toupper );
+        target = find_or_create_target_by_element( target, element );
+    }
+
+    const char* position = root_name_end;
+    while ( target && position != end )
+    {
+        while ( position != end && is_separator(*position) )
+        {
+            ++position;
+        }
+        const char* element = position;
+        while ( position != end && !is_separator(*position) )
+        {
+            ++position;
+        }
+
+        size_t length = position - element;
+        if ( length == 0 || (length == 1 && element[0] == '.') )
+        {
+            continue;
+        }
+        else if ( length == 2 && element[0] == '.' && element[1] == '.' )
+        {
+            SWEET_ASSERT( !create || target->parent() );
+            target = target->parent();
+        }
+        else
+        {
+            Target* child = target->find_target_by_id( element, length );
+            if ( !child && create )
+            {
+                child = find_or_create_target_by_element( target, string(element, length) );
+            }
+            target = child;
+        }
+    }
+
+    if ( target )
+    {
+        targets_by_path.insert( make_pair(id, target) );
+    }
+    return target;
+}
+
+std::string Graph::journal_filename() const
+{
+    return filename_ + ".journal";
+}
+
+void Graph::replay_journal()
+{
+    std::ifstream ifstream( journal_filename(), std::ios::binary );
+    string journal( (std::istreambuf_iterator<char>(ifstream)), std::istreambuf_iterator<char>() );
+    GraphJournal graph_journal( this, journal );
+    int segments = graph_journal.read( generation_, stat_cache_.get() );
+    if ( segments < 0 )
+    {
+        // The Targets replayed before the invalid record was found may have
+        // left the Graph inconsistent and the dependency graph file alone is
+        // out of date so discard both and start again from an empty Graph.
+        forge_->errorf( "The journal '%s' is not valid", journal_filename().c_str() );
+        root_target_.reset( new Target("$$root", this) );
+        targets_by_path_.clear();
+        stat_cache_->clear();
+        generation_ = 0;
+        file_size_ = 0;
+    }
+    journal_size_ = segments > 0 ? graph_journal.size() : 0;
+}
+
+bool Graph::save_journal()
+{
+    string segment;
+    GraphJournal graph_journal( &segment );
+    graph_journal.write( generation_, journal_size_ == 0, root_target_.get(), stat_cache_.get() );
+    if ( journal_size_ + segment.size() > file_size_ / 2 || !append(journal_filename(), journal_size_, segment) )
+    {
+        return false;
+    }
+    journal_size_ += segment.size();
+    return true;
+}
+
+bool Graph::compact()
+{
+    uint64_t generation = std::max( uint64_t(std::chrono::system_clock::now().time_since_epoch().count()), generation_ + 1 );
+    std::ostringstream ostringstream;
+    GraphWriter graph_writer( &ostringstream );
+    graph_writer.write( root_target_.get(), stat_cache_.get(), generation );
+    string contents = ostringstream.str();
+    if ( !replace(filename_, contents) )
+    {
+        return false;
+    }
+
+    // A journal left behind if removing it fails is ignored when the Graph
+    // is next loaded because it records the previous generation.
+    boost::system::error_code error;
+    boost::filesystem::remove( journal_filename(), error );
+    generation_ = generation;
+    file_size_ = contents.size();
+    journal_size_ = 0;
+    compact_ = false;
+    return true;
+}
+
+bool Graph::replace( const std::string& filename, const std::string& contents )
+{
+    string temporary_filename = filename + ".tmp";
+    FILE* file = fopen( temporary_filename.c_str(), "wb" );
+    bool written = file && fwrite( contents.data(), 1, contents.size(), file ) == contents.size() && fflush( file ) == 0;
+#if defined(BUILD_OS_WINDOWS)
+    written = written && _commit( _fileno(file) ) == 0;
+#else
+    written = written && fsync( fileno(file) ) == 0;
+#endif
+    written = file && fclose( file ) == 0 && written;
+
+    boost::system::error_code error;
+    if ( written )
+    {
+        boost::filesystem::rename( temporary_filename, filename, error );
+        written = !error;
+    }
+
+    if ( !written )
+    {
+        forge_->errorf( "Saving '%s' failed", filename.c_str() );
+        boost::filesystem::remove( temporary_filename, error );
+    }
+    return written;
+}
+
+/**
+// Append \e contents to the file \e filename.
+//
+// The file is opened for appending (with `O_APPEND`) and synced to disk 
+// before returning.  Any bytes past \e size, left by an earlier append that
+// was torn by a crash, are truncated first so that \e contents directly 
+// follows the last complete append.
+//
+// @param filename
+//  The name of the file to append to (created if it doesn't exist).
+//
+// @param size
+//  The size of the file up to the end of the last complete append.
+//
+// @param contents
+//  The contents to append.
+//
+// @return
+//  True if \e contents was appended otherwise false if the file is shorter
+//  than \e size or writing to it failed.
+*/
+bool Graph::append( const std::string& filename, size_t size, const std::string& contents )
+{
+    FILE* file = fopen( filename.c_str(), "ab" );
+    if ( !file )
+    {
+        forge_->errorf( "Saving '%s' failed", filename.c_str() );
+        return false;
+    }
+
+    long file_size = fseek( file, 0, SEEK_END ) == 0 ? ftell( file ) : -1;
+    if ( file_size < 0 || size_t(file_size) < size )
+    {
+        fclose( file );
+        return false;
+    }
+
+    bool written = true;
+    if ( size_t(file_size) > size )
+    {
+#if defined(BUILD_OS_WINDOWS)
+        written = _chsize_s( _fileno(file), size ) == 0;
+#else
+        written = ftruncate( fileno(file), off_t(size) ) == 0;
+#endif
+    }
+    written = written && fwrite( contents.data(), 1, contents.size(), file ) == contents.size() && fflush( file ) == 0;
+#if defined(BUILD_OS_WINDOWS)
+    written = written && _commit( _fileno(file) ) == 0;
+#else
+    written = written && fsync( fileno(file) ) == 0;
+#endif
+    written = fclose( file ) == 0 && written;
+
+    if ( !written )
+    {
+        forge_->errorf( "Saving '%s' failed", filename.c_str() );
+    }
+    return written;
+}
@@ -5,6 +5,9 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <unordered_map>
+#include <stddef.h>
+#include <stdint.h>
 
 namespace sweet
 {
@@ -18,6 +21,7 @@ class TargetPrototype;
 class Toolset;
 class Target;
 class Forge;
+class StatCache;
 
 /**
 // A dependency graph.
@@ -31,6 +35,13 @@ class Graph
     std::string filename_; ///< The filename that this Graph was most recently loaded from.
     std::unique_ptr<Target> root_target_; ///< The root Target for this Graph.
     Target* cache_target_; ///< The cache Target for this Graph.
+    std::unique_ptr<StatCache> stat_cache_; ///< The directories stat'd when binding Targets in this Graph.
+    std::unordered_map<const Target*, std::unordered_map<std::string, Target*>> targets_by_path_; ///< The Targets found by path keyed by the Target that each path starts from.
+    uint64_t generation_; ///< The generation of the dependency graph file that the journal applies to or 0 if there is no file to append a journal to.
+    size_t file_size_; ///< The size of the dependency graph file in bytes.
+    size_t journal_size_; ///< The size of the journal in bytes or 0 if there is no journal to append to.
+    bool compact_; ///< Whether or not the next save rewrites the dependency graph file rather than appending to the journal.
+    bool content_digests_; ///< Whether or not Targets compare digests of file contents rather than timestamps when binding.
     bool traversal_in_progress_; ///< True when a traversal is in progress otherwise false.
     int visited_revision_; ///< The current visit revision.
     int successful_revision_; ///< The current success revision.
@@ -43,6 +54,9 @@ class Graph
         const std::vector<Toolset*> toolsets() const;
         Target* root_target() const;
         Target* cache_target() const;
+        StatCache* stat_cache() const;
+        void set_content_digests( bool content_digests );
+        bool content_digests() const;
         Forge* forge() const;
 
         void begin_traversal();
@@ -62,6 +76,7 @@ class Graph
                 
         int buildfile( const std::string& filename );
         int bind( Target* target = NULL );        
+        bool wait_for_changes( Target* target = NULL );
         void swap( Graph& graph );
         void clear();
         void recover();
@@ -69,6 +84,15 @@ class Graph
         void save_binary();
         void print_dependencies( Target* target, const std::string& directory );
         void print_namespace( Target* target );
+
+    private:
+        Target* find_target_by_path( const std::string& id, Target* working_directory, bool create );
+        std::string journal_filename() const;
+        void replay_journal();
+        bool save_journal();
+        bool compact();
+        bool replace( const std::string& filename, const std::string& contents );
+        bool append( const std::string& filename, size_t size, const std::string& contents );
 };
 
 }
@@ -0,0 +1,394 @@
+//
+// GraphJournal.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "GraphJournal.hpp"
+#include "Graph.hpp"
+#include "Target.hpp"
+#include "StatCache.hpp"
+#include "ContentHash.hpp"
+#include <assert/assert.hpp>
+#include <string.h>
+
+using std::string;
+using std::vector;
+using namespace sweet::forge;
+
+static const char FORMAT [] = "Sweet Build Journal";
+
+GraphJournal::GraphJournal( Graph* graph, const std::string& input )
+: graph_( graph ),
+  input_( &input ),
+  position_( 0 ),
+  end_( input.size() ),
+  size_( 0 ),
+  error_( false ),
+  output_( nullptr )
+{
+    SWEET_ASSERT( graph_ );
+}
+
+GraphJournal::GraphJournal( std::string* output )
+: graph_( nullptr ),
+  input_( nullptr ),
+  position_( 0 ),
+  end_( 0 ),
+  size_( 0 ),
+  error_( false ),
+  output_( output )
+{
+    SWEET_ASSERT( output_ );
+}
+
+/**
+// Replay the segments in the journal.
+//
+// A header or trailing segment that runs past the end of the journal, or a
+// trailing segment whose checksum doesn't match, was torn by a crash while
+// it was being appended and is discarded along with anything after it.  
+// The size of the journal up to that point is returned by `size()` so that
+// the next segment can be appended in its place.
+//
+// @param generation
+//  The generation of the dependency graph file that has been loaded.
+//
+// @param stat_cache
+//  The StatCache to read directories into.
+//
+// @return
+//  The number of segments replayed, 0 if the journal applies to a different
+//  generation of the dependency graph file or its header is torn, or -1 if 
+//  the journal isn't valid.
+*/
+int GraphJournal::read( uint64_t generation, StatCache* stat_cache )
+{
+    SWEET_ASSERT( input_ );
+    SWEET_ASSERT( stat_cache );
+
+    string format;
+    uint32_t version = 0;
+    uint64_t journal_generation = 0;
+    value( &format );
+    value( &version );
+    value( &journal_generation );
+    if ( error_ )
+    {
+        return 0;
+    }
+
+    if ( format != FORMAT || version != uint32_t(VERSION) )
+    {
+        return -1;
+    }
+
+    if ( journal_generation != generation )
+    {
+        return 0;
+    }
+
+    int segments = 0;
+    size_ = position_;
+    while ( position_ < input_->size() )
+    {
+        uint32_t length = 0;
+        uint64_t checksum = 0;
+        value( &length );
+        value( &checksum );
+        if ( error_ || length > input_->size() - position_ )
+        {
+            error_ = false;
+            return segments;
+        }
+
+        if ( ContentHash::hash(input_->data() + position_, length) != checksum )
+        {
+            return position_ + length == input_->size() ? segments : -1;
+        }
+
+        end_ = position_ + length;
+        stat_cache->read( *this );
+        uint32_t targets = 0;
+        value( &targets );
+        for ( uint32_t i = 0; i < targets && !error_; ++i )
+        {
+            replay();
+        }
+        if ( error_ || position_ != end_ )
+        {
+            return -1;
+        }
+        end_ = input_->size();
+        size_ = position_;
+        ++segments;
+    }
+    return segments;
+}
+
+/**
+// Append a segment holding the dirty Targets and the StatCache directories.
+//
+// @param generation
+//  The generation of the dependency graph file that the journal applies to.
+//
+// @param header
+//  True to write the header before the segment when starting a new journal
+//  otherwise false when appending to an existing journal.
+//
+// @param root_target
+//  The root Target of the dependency graph to write dirty Targets from.
+//
+// @param stat_cache
+//  The StatCache to write directories from.
+*/
+void GraphJournal::write( uint64_t generation, bool header, Target* root_target, StatCache* stat_cache )
+{
+    SWEET_ASSERT( output_ );
+    SWEET_ASSERT( root_target );
+    SWEET_ASSERT( stat_cache );
+
+    if ( header )
+    {
+        value( string(FORMAT) );
+        value( uint32_t(VERSION) );
+        value( generation );
+    }
+
+    size_t frame = output_->size();
+    value( uint32_t(0) );
+    value( uint64_t(0) );
+    size_t start = output_->size();
+    stat_cache->write( *this );
+    value( dirty_targets(root_target) );
+    write_dirty_targets( root_target );
+
+    // Fill in the length and checksum of the segment now that it's known.
+    uint32_t length = uint32_t(output_->size() - start);
+    uint64_t checksum = ContentHash::hash( output_->data() + start, length );
+    memcpy( &(*output_)[frame], &length, sizeof(length) );
+    memcpy( &(*output_)[frame + sizeof(length)], &checksum, sizeof(checksum) );
+}
+
+/**
+// Append a target record.
+//
+// The Target and its implicit dependencies are written as the identifiers
+// on the path from the root Target to them.
+*/
+void GraphJournal::target( const Target* target, int64_t last_write_time, uint64_t hash, uint64_t digest, uint64_t inputs_digest, int duration, bool built, const std::vector<std::string>& filenames, const std::vector<Target*>& dependencies )
+{
+    path( target );
+    value( last_write_time );
+    value( hash );
+    value( digest );
+    value( inputs_digest );
+    value( uint32_t(duration) );
+    value( uint32_t(built ? 1 : 0) );
+    value( uint32_t(filenames.size()) );
+    for ( vector<string>::const_iterator filename = filenames.begin(); filename != filenames.end(); ++filename )
+    {
+        value( *filename );
+    }
+    value( uint32_t(dependencies.size()) );
+    for ( vector<Target*>::const_iterator dependency = dependencies.begin(); dependency != dependencies.end(); ++dependency )
+    {
+        path( *dependency );
+    }
+}
+
+void GraphJournal::value( uint32_t value )
+{
+    bytes( static_cast<const void*>(&value), sizeof(value) );
+}
+
+void GraphJournal::value( int64_t value )
+{
+    bytes( static_cast<const void*>(&value), sizeof(value) );
+}
+
+void GraphJournal::value( uint64_t value )
+{
+    bytes( static_cast<const void*>(&value), sizeof(value) );
+}
+
+void GraphJournal::value( const std::string& value )
+{
+    GraphJournal::value( uint32_t(value.size()) );
+    bytes( static_cast<const void*>(value.data()), value.size() );
+}
+
+void GraphJournal::value( uint32_t* value )
+{
+    SWEET_ASSERT( value );
+    bytes( static_cast<void*>(value), sizeof(*value) );
+}
+
+void GraphJournal::value( int64_t* value )
+{
+    SWEET_ASSERT( value );
+    bytes( static_cast<void*>(value), sizeof(*value) );
+}
+
+void GraphJournal::value( uint64_t* value )
+{
+    SWEET_ASSERT( value );
+    bytes( static_cast<void*>(value), sizeof(*value) );
+}
+
+void GraphJournal::value( std::string* value )
+{
+    SWEET_ASSERT( value );
+    SWEET_ASSERT( input_ );
+    uint32_t size = 0;
+    GraphJournal::value( &size );
+    if ( error_ || size > end_ - position_ )
+    {
+        error_ = true;
+        value->clear();
+        return;
+    }
+    value->assign( input_->data() + position_, size );
+    position_ += size;
+}
+
+/**
+// Has reading run past the end of the journal?
+//
+// @return
+//  True if reading has run past the end of the journal otherwise false.
+*/
+bool GraphJournal::error() const
+{
+    return error_;
+}
+
+/**
+// Get the size of the journal up to the end of the last complete segment.
+//
+// @return
+//  The size in bytes of the header and the segments replayed by `read()`.
+*/
+size_t GraphJournal::size() const
+{
+    return size_;
+}
+
+uint32_t GraphJournal::dirty_targets( const Target* target ) const
+{
+    SWEET_ASSERT( target );
+    uint32_t dirty_targets = target->dirty() ? 1 : 0;
+    const vector<Target*>& targets = target->targets();
+    for ( vector<Target*>::const_iterator i = targets.begin(); i != targets.end(); ++i )
+    {
+        dirty_targets += GraphJournal::dirty_targets( *i );
+    }
+    return dirty_targets;
+}
+
+void GraphJournal::write_dirty_targets( Target* target )
+{
+    SWEET_ASSERT( target );
+    if ( target->dirty() )
+    {
+        target->write( *this );
+    }
+    const vector<Target*>& targets = target->targets();
+    for ( vector<Target*>::const_iterator i = targets.begin(); i != targets.end(); ++i )
+    {
+        write_dirty_targets( *i );
+    }
+}
+
+void GraphJournal::path( const Target* target )
+{
+    SWEET_ASSERT( target );
+    vector<const Target*> targets;
+    while ( target->parent() )
+    {
+        targets.push_back( target );
+        target = target->parent();
+    }
+    value( uint32_t(targets.size()) );
+    for ( vector<const Target*>::const_reverse_iterator i = targets.rbegin(); i != targets.rend(); ++i )
+    {
+        value( (*i)->id() );
+    }
+}
+
+Target* GraphJournal::path()
+{
+    SWEET_ASSERT( graph_ );
+    uint32_t elements = 0;
+    value( &elements );
+    Target* target = graph_->root_target();
+    for ( uint32_t i = 0; i < elements && !error_; ++i )
+    {
+        string id;
+        value( &id );
+        if ( error_ || id.empty() || id == "." || id == ".." )
+        {
+            error_ = true;
+            return nullptr;
+        }
+        target = graph_->find_or_create_target_by_element( target, id );
+    }
+    return !error_ ? target : nullptr;
+}
+
+void GraphJournal::replay()
+{
+    Target* target = path();
+    int64_t last_write_time = 0;
+    uint64_t hash = 0;
+    uint64_t digest = 0;
+    uint64_t inputs_digest = 0;
+    uint32_t duration = 0;
+    uint32_t built = 0;
+    value( &last_write_time );
+    value( &hash );
+    value( &digest );
+    value( &inputs_digest );
+    value( &duration );
+    value( &built );
+
+    uint32_t size = 0;
+    value( &size );
+    vector<string> filenames;
+    for ( uint32_t i = 0; i < size && !error_; ++i )
+    {
+        filenames.push_back( string() );
+        value( &filenames.back() );
+    }
+
+    value( &size );
+    vector<Target*> dependencies;
+    for ( uint32_t i = 0; i < size && !error_; ++i )
+    {
+        dependencies.push_back( path() );
+    }
+
+    if ( !error_ )
+    {
+        SWEET_ASSERT( target );
+        target->replay( last_write_time, hash, digest, inputs_digest, int(duration), built != 0, filenames, dependencies );
+    }
+}
+
+void GraphJournal::bytes( const void* data, size_t size )
+{
+    SWEET_ASSERT( output_ );
+    output_->append( static_cast<const char*>(data), size );
+}
+
+void GraphJournal::bytes( void* data, size_t size )
+{
+    SWEET_ASSERT( input_ );
+    if ( error_ || size > end_ - position_ )
+    {
+        error_ = true;
+        memset( data, 0, size );
+        return;
+    }
+    memcpy( data, input_->data() + position_, size );
+    position_ += size;
+}
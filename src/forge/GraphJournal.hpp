@@ -0,0 +1,81 @@
+#ifndef FORGE_GRAPHJOURNAL_HPP_INCLUDED
+#define FORGE_GRAPHJOURNAL_HPP_INCLUDED
+
+#include <vector>
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace sweet
+{
+
+namespace forge
+{
+
+class Target;
+class Graph;
+class StatCache;
+
+/**
+// Append the Targets that have changed since a dependency graph was saved
+// to a journal and replay them when the dependency graph is loaded.
+//
+// Each save appends a segment holding the dirty Targets and the directories
+// from the StatCache.  Targets are identified by the identifiers on the path
+// from the root Target to them so that the journal doesn't depend on the
+// layout of the dependency graph file that it applies to.  The directories
+// in a segment replace the directories from earlier segments.
+//
+// Each segment is preceded by its length and a checksum of its contents so
+// that a segment torn by a crash while it was being appended is recognized
+// and discarded when the journal is read, leaving the segments before it.
+//
+// The journal records the generation of the dependency graph file that it
+// applies to.  A journal left over from an earlier generation, for example
+// after a crash while the dependency graph file was being compacted, is
+// ignored.
+*/
+class GraphJournal
+{
+    Graph* graph_; ///< The Graph that Targets are replayed into or null if writing.
+    const std::string* input_; ///< The journal to read from or null if writing.
+    size_t position_; ///< The position of the next value to read from the input.
+    size_t end_; ///< The end of the header or segment being read from the input.
+    size_t size_; ///< The size of the header and the complete segments read from the input.
+    bool error_; ///< Whether or not reading has run past the end of the input.
+    std::string* output_; ///< The journal to append to or null if reading.
+
+public:
+    static const int VERSION = 3;
+
+    GraphJournal( Graph* graph, const std::string& input );
+    GraphJournal( std::string* output );
+    int read( uint64_t generation, StatCache* stat_cache );
+    void write( uint64_t generation, bool header, Target* root_target, StatCache* stat_cache );
+    void target( const Target* target, int64_t last_write_time, uint64_t hash, uint64_t digest, uint64_t inputs_digest, int duration, bool built, const std::vector<std::string>& filenames, const std::vector<Target*>& dependencies );
+    void value( uint32_t value );
+    void value( int64_t value );
+    void value( uint64_t value );
+    void value( const std::string& value );
+    void value( uint32_t* value );
+    void value( int64_t* value );
+    void value( uint64_t* value );
+    void value( std::string* value );
+    bool error() const;
+    size_t size() const;
+
+private:
+    uint32_t dirty_targets( const Target* target ) const;
+    void write_dirty_targets( Target* target );
+    void path( const Target* target );
+    Target* path();
+    void replay();
+    void bytes( const void* data, size_t size );
+    void bytes( void* data, size_t size );
+};
+
+}
+
+}
+
+#endif
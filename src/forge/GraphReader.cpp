@@ -21,12 +21,25 @@ using namespace sweet::forge;
 GraphReader::GraphReader( std::istream* istream, error::ErrorPolicy* error_policy  )
 : istream_( istream ),
   error_policy_( error_policy ),
-  address_by_old_address_()
+  address_by_old_address_(),
+  version_( 0 )
 {
     SWEET_ASSERT( istream_ );
     SWEET_ASSERT( error_policy_ );
 }
 
+/**
+// Get the version of the stream being read.
+//
+// @return
+//  The version read from the header of the stream or 0 if no header has 
+//  been read yet.
+*/
+int GraphReader::version() const
+{
+    return version_;
+}
+
 void* GraphReader::find_address_by_old_address( const void* old_address ) const
 {
     map<const void*, void*>::const_iterator i = address_by_old_address_.find( old_address );
@@ -44,14 +57,14 @@ std::unique_ptr<Target> GraphReader::read( const std::string& filename )
         return unique_ptr<Target>();
     }
 
-    const int VERSION = 32;
     int version = 0;
     value( &version );
-    if ( version != VERSION )
+    if ( version < OLDEST_VERSION || version > VERSION )
     {
-        error_policy_->print( "The file '%s' is version %d not version %d as expected", filename.c_str(), version, VERSION );
+        error_policy_->print( "The file '%s' is version %d not version %d to %d as expected", filename.c_str(), version, OLDEST_VERSION, VERSION );
         return unique_ptr<Target>();
     }
+    version_ = version;
 
     unique_ptr<Target> root_target;
     root_target.reset( new Target );
@@ -82,7 +95,7 @@ void GraphReader::value( uint64_t* value )
     istream_->read( reinterpret_cast<char*>(value), sizeof(*value) );
 }
 
-void GraphReader::value( std::time_t* value )
+void GraphReader::value( int64_t* value )
 {
     istream_->read( reinterpret_cast<char*>(value), sizeof(*value) );
 }
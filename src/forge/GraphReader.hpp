@@ -24,21 +24,34 @@ namespace forge
 
 class Target;
 
+/**
+// Read a dependency graph written in the stream format used before version
+// 36 so that existing cache files can be migrated (see MappedGraph).
+//
+// Any stream version from OLDEST_VERSION to VERSION is accepted; fields that
+// were added after the version being read are left at their defaults (see
+// Target::read() and version()).
+*/
 class GraphReader
 {
     std::istream* istream_;
     error::ErrorPolicy* error_policy_;
     std::map<const void*, void*> address_by_old_address_;
+    int version_; ///< The version of the stream being read.
 
 public:
+    static const int OLDEST_VERSION = 32;
+    static const int VERSION = 35;
+
     GraphReader( std::istream* ostream, error::ErrorPolicy* error_policy );
+    int version() const;
     void* find_address_by_old_address( const void* old_address ) const;
     std::unique_ptr<Target> read( const std::string& filename );
     void object_address( void* address );
     void value( bool* value );
     void value( int* value );
     void value( uint64_t* value );
-    void value( std::time_t* value );
+    void value( int64_t* value );
     void value( std::string* value );
     void value( char* value, size_t size );
     void value( std::vector<std::string>* values );
@@ -5,95 +5,186 @@
 
 #include "GraphWriter.hpp"
 #include "Target.hpp"
+#include "StatCache.hpp"
 #include <assert/assert.hpp>
+#include <string.h>
 
 using std::string;
 using std::vector;
+using std::unordered_map;
+using std::make_pair;
 using namespace sweet::forge;
 
 GraphWriter::GraphWriter( std::ostream* ostream )
-: ostream_( ostream )
+: ostream_( ostream ),
+  targets_(),
+  index_by_target_(),
+  index_by_string_(),
+  strings_(),
+  string_data_(),
+  target_records_(),
+  filenames_(),
+  references_(),
+  directories_()
 {
     SWEET_ASSERT( ostream_ );
 }
 
-void GraphWriter::write( Target* root_target )
+/**
+// Write a dependency graph.
+//
+// Targets are numbered in preorder from \e root_target so that the root 
+// Target is always the first target record.  Each Target then appends its
+// record (see Target::write()) and the StatCache appends its directories 
+// before all of the sections are written out.
+//
+// @param root_target
+//  The root Target of the dependency graph to write.
+//
+// @param stat_cache
+//  The StatCache to write directories from or null to write no directories.
+//
+// @param generation
+//  The generation that identifies the journal that applies to the written
+//  dependency graph (see GraphJournal).
+*/
+void GraphWriter::write( Target* root_target, StatCache* stat_cache, uint64_t generation )
 {
     SWEET_ASSERT( root_target );
+
+    index( root_target );
+    target_records_.reserve( targets_.size() );
+    for ( vector<Target*>::const_iterator i = targets_.begin(); i != targets_.end(); ++i )
+    {
+        Target* target = *i;
+        SWEET_ASSERT( target );
+        target->write( *this );
+    }
+
+    if ( stat_cache )
+    {
+        stat_cache->write( *this );
+    }
+
     const char FORMAT [] = "Sweet Build Graph";
-    value( &FORMAT[0], sizeof(FORMAT) );
-    const int VERSION = 32;
-    value( VERSION );
-    root_target->write( *this );
-}
+    const int VERSION = MappedGraph::VERSION;
+    MappedGraph::Header header;
+    memset( &header, 0, sizeof(header) );
+    memcpy( header.format, FORMAT, sizeof(FORMAT) );
+    memcpy( header.version, &VERSION, sizeof(VERSION) );
+    header.targets = uint32_t(target_records_.size());
+    header.strings = uint32_t(strings_.size());
+    header.string_bytes = uint32_t(string_data_.size());
+    header.filenames = uint32_t(filenames_.size());
+    header.references = uint32_t(references_.size());
+    header.directories = uint32_t(directories_.size());
+    header.generation = generation;
 
-void GraphWriter::object_address( const void* address )
-{
-    ostream_->write( reinterpret_cast<const char*>(&address), sizeof(address) );
+    ostream_->write( reinterpret_cast<const char*>(&header), sizeof(header) );
+    section( strings_.data(), strings_.size() * sizeof(MappedGraph::String) );
+    section( string_data_.data(), string_data_.size() );
+    section( target_records_.data(), target_records_.size() * sizeof(MappedGraph::TargetRecord) );
+    section( filenames_.data(), filenames_.size() * sizeof(uint32_t) );
+    section( references_.data(), references_.size() * sizeof(uint32_t) );
+    section( directories_.data(), directories_.size() * sizeof(MappedGraph::Directory) );
 }
 
-void GraphWriter::value( bool value )
+/**
+// Append a target record.
+//
+// Children and implicit dependencies are written as the indices assigned to
+// them by GraphWriter::write().  Implicit dependencies on Targets that 
+// aren't part of the graph being written are dropped.
+*/
+void GraphWriter::target( const std::string& id, int64_t last_write_time, uint64_t hash, uint64_t digest, uint64_t inputs_digest, int duration, bool built, const std::vector<std::string>& filenames, const std::vector<Target*>& targets, const std::vector<Target*>& dependencies )
 {
-    ostream_->write( reinterpret_cast<const char*>(&value), sizeof(value) );
-}
+    MappedGraph::TargetRecord record;
+    memset( &record, 0, sizeof(record) );
+    record.last_write_time = last_write_time;
+    record.hash = hash;
+    record.digest = digest;
+    record.inputs_digest = inputs_digest;
+    record.id = intern( id );
+    record.duration = duration;
+    record.built = built ? 1 : 0;
 
-void GraphWriter::value( int value )
-{
-    ostream_->write( reinterpret_cast<const char*>(&value), sizeof(value) );
-}
+    record.first_filename = uint32_t(filenames_.size());
+    for ( vector<string>::const_iterator filename = filenames.begin(); filename != filenames.end(); ++filename )
+    {
+        filenames_.push_back( intern(*filename) );
+    }
+    record.filenames = uint32_t(filenames_.size()) - record.first_filename;
 
-void GraphWriter::value( uint64_t value )
-{
-    ostream_->write( reinterpret_cast<const char*>(&value), sizeof(value) );
-}
+    record.first_target = uint32_t(references_.size());
+    for ( vector<Target*>::const_iterator target = targets.begin(); target != targets.end(); ++target )
+    {
+        unordered_map<const Target*, uint32_t>::const_iterator index = index_by_target_.find( *target );
+        SWEET_ASSERT( index != index_by_target_.end() );
+        references_.push_back( index->second );
+    }
+    record.targets = uint32_t(references_.size()) - record.first_target;
 
-void GraphWriter::value( std::time_t value )
-{
-    ostream_->write( reinterpret_cast<const char*>(&value), sizeof(value) );
-}
+    record.first_dependency = uint32_t(references_.size());
+    for ( vector<Target*>::const_iterator dependency = dependencies.begin(); dependency != dependencies.end(); ++dependency )
+    {
+        unordered_map<const Target*, uint32_t>::const_iterator index = index_by_target_.find( *dependency );
+        if ( index != index_by_target_.end() )
+        {
+            references_.push_back( index->second );
+        }
+    }
+    record.dependencies = uint32_t(references_.size()) - record.first_dependency;
 
-void GraphWriter::value( const std::string& value )
-{
-    size_t size = value.size();
-    ostream_->write( reinterpret_cast<const char*>(&size), sizeof(size) );
-    ostream_->write( reinterpret_cast<const char*>(value.c_str()), size );
+    target_records_.push_back( record );
 }
 
-void GraphWriter::value( const char* value, size_t size )
+/**
+// Append a directory record.
+*/
+void GraphWriter::directory( const std::string& path, int64_t last_write_time, uint64_t inode, int64_t size )
 {
-    ostream_->write( value, size );
+    MappedGraph::Directory directory;
+    memset( &directory, 0, sizeof(directory) );
+    directory.last_write_time = last_write_time;
+    directory.inode = inode;
+    directory.size = size;
+    directory.path = intern( path );
+    directories_.push_back( directory );
 }
 
-void GraphWriter::value( const std::vector<std::string>& values )
+void GraphWriter::index( Target* target )
 {
-    size_t length = values.size();
-    ostream_->write( reinterpret_cast<const char*>(&length), sizeof(length) );
-    for ( vector<string>::const_iterator i = values.begin(); i != values.end(); ++i )
+    SWEET_ASSERT( target );
+    index_by_target_.insert( make_pair(target, uint32_t(targets_.size())) );
+    targets_.push_back( target );
+    const vector<Target*>& targets = target->targets();
+    for ( vector<Target*>::const_iterator i = targets.begin(); i != targets.end(); ++i )
     {
-        value( *i );
+        index( *i );
     }
 }
 
-void GraphWriter::value( const std::vector<Target*>& values )
+uint32_t GraphWriter::intern( const std::string& value )
 {
-    size_t length = values.size();
-    ostream_->write( reinterpret_cast<const char*>(&length), sizeof(length) );
-    for ( vector<Target*>::const_iterator i = values.begin(); i != values.end(); ++i )
+    unordered_map<std::string, uint32_t>::const_iterator i = index_by_string_.find( value );
+    if ( i != index_by_string_.end() )
     {
-        Target* target = *i;
-        SWEET_ASSERT( target );
-        target->write( *this );
+        return i->second;
     }
+
+    MappedGraph::String string;
+    string.offset = uint32_t(string_data_.size());
+    string.size = uint32_t(value.size());
+    string_data_.append( value );
+    uint32_t index = uint32_t(strings_.size());
+    strings_.push_back( string );
+    index_by_string_.insert( make_pair(value, index) );
+    return index;
 }
 
-void GraphWriter::refer( const std::vector<Target*>& values )
+void GraphWriter::section( const void* data, size_t size )
 {
-    size_t length = values.size();
-    ostream_->write( reinterpret_cast<const char*>(&length), sizeof(length) );
-    for ( vector<Target*>::const_iterator i = values.begin(); i != values.end(); ++i )
-    {
-        Target* target = *i;
-        SWEET_ASSERT( target );
-        ostream_->write( reinterpret_cast<const char*>(&target), sizeof(target) );
-    }
+    const char PADDING [8] = { 0 };
+    ostream_->write( reinterpret_cast<const char*>(data), size );
+    ostream_->write( PADDING, MappedGraph::padded(size) - size );
 }
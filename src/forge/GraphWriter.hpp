@@ -1,11 +1,11 @@
 #ifndef FORGE_GRAPHWRITER_HPP_INCLUDED
 #define FORGE_GRAPHWRITER_HPP_INCLUDED
 
+#include "MappedGraph.hpp"
+#include <unordered_map>
 #include <vector>
 #include <string>
 #include <ostream>
-#include <memory>
-#include <ctime>
 #include <stdint.h>
 
 namespace sweet
@@ -15,24 +15,34 @@ namespace forge
 {
 
 class Target;
+class StatCache;
 
+/**
+// Write a dependency graph in the format read by MappedGraph.
+*/
 class GraphWriter
 {
-    std::ostream* ostream_;
+    std::ostream* ostream_; ///< The stream to write to.
+    std::vector<Target*> targets_; ///< The Targets to write in index order.
+    std::unordered_map<const Target*, uint32_t> index_by_target_; ///< The index of each Target to write.
+    std::unordered_map<std::string, uint32_t> index_by_string_; ///< The index of each string in the string table.
+    std::vector<MappedGraph::String> strings_; ///< The string table.
+    std::string string_data_; ///< The string data.
+    std::vector<MappedGraph::TargetRecord> target_records_; ///< The target records.
+    std::vector<uint32_t> filenames_; ///< The string indices of filenames.
+    std::vector<uint32_t> references_; ///< The target indices of children and implicit dependencies.
+    std::vector<MappedGraph::Directory> directories_; ///< The directory records.
 
 public:
     GraphWriter( std::ostream* ostream );
-    void write( Target* root_target );
-    void object_address( const void* address );
-    void value( bool value );
-    void value( int value );
-    void value( uint64_t value );
-    void value( std::time_t value );
-    void value( const std::string& value );
-    void value( const char* value, size_t size );
-    void value( const std::vector<std::string>& values );
-    void value( const std::vector<Target*>& values );
-    void refer( const std::vector<Target*>& references );
+    void write( Target* root_target, StatCache* stat_cache, uint64_t generation );
+    void target( const std::string& id, int64_t last_write_time, uint64_t hash, uint64_t digest, uint64_t inputs_digest, int duration, bool built, const std::vector<std::string>& filenames, const std::vector<Target*>& targets, const std::vector<Target*>& dependencies );
+    void directory( const std::string& path, int64_t last_write_time, uint64_t inode, int64_t size );
+
+private:
+    void index( Target* target );
+    uint32_t intern( const std::string& value );
+    void section( const void* data, size_t size );
 };
 
 }
@@ -6,17 +6,38 @@
 #include "Job.hpp"
 #include "Target.hpp"
 #include <assert/assert.hpp>
+#include <algorithm>
 
+using std::max;
+using std::vector;
+using std::chrono::steady_clock;
+using std::chrono::milliseconds;
+using std::chrono::duration_cast;
 using namespace sweet;
 using namespace sweet::forge;
 
-Job::Job( Target* target, int height )
+Job::Job( Target* target, int height, bool visit )
 : target_( target ),
   height_( height ),
-  state_( JOB_WAITING )
+  visit_( visit ),
+  weight_( 0 ),
+  critical_path_( 0 ),
+  dependencies_( 0 ),
+  dependents_(),
+  state_( JOB_WAITING ),
+  started_()
 {
     SWEET_ASSERT( target_ );
     SWEET_ASSERT( height_ >= 0 );
+
+    // Outdated Targets are weighted by the time taken to build them the last
+    // time that they were built plus one so that Targets that have never 
+    // been built still count.  Targets that are up to date have no weight as
+    // visiting them does no work.
+    if ( visit_ && target_->outdated() )
+    {
+        weight_ = target_->duration() + 1;
+    }
 }
 
 Target* Job::target() const
@@ -37,19 +58,151 @@ int Job::height() const
     return height_;
 }
 
+/**
+// Does this Job visit its Target?
+//
+// Jobs for Targets that aren't referenced by script or that don't have a 
+// working directory don't visit their Target.  They still take part in the
+// traversal so that Jobs that depend on them, possibly indirectly, wait for 
+// the Jobs that they depend on to complete.
+//
+// @return
+//  True if this Job visits its Target otherwise false.
+*/
+bool Job::visit() const
+{
+    return visit_;
+}
+
+/**
+// Get the weight of this Job.
+//
+// @return
+//  The expected time, in milliseconds, to process this Job.
+*/
+int Job::weight() const
+{
+    return weight_;
+}
+
+/**
+// Get the critical path length of this Job.
+//
+// @return
+//  The total weight of the heaviest path from this Job to the root of the
+//  traversal including this Job.
+*/
+int Job::critical_path() const
+{
+    return critical_path_;
+}
+
+/**
+// Get the time taken to process this Job.
+//
+// @return
+//  The wall-clock time, in milliseconds, since this Job started processing.
+*/
+int Job::duration() const
+{
+    SWEET_ASSERT( state_ != JOB_WAITING );
+    return int( duration_cast<milliseconds>(steady_clock::now() - started_).count() );
+}
+
+/**
+// Is this Job ready to be processed?
+//
+// @return
+//  True if all of the Jobs that this Job depends on have completed.
+*/
+bool Job::ready() const
+{
+    return dependencies_ == 0;
+}
+
+const std::vector<Job*>& Job::dependents() const
+{
+    return dependents_;
+}
+
 JobState Job::state() const
 {
     SWEET_ASSERT( state_ >= JOB_WAITING && state_ <= JOB_COMPLETE );
     return state_;
 }
 
+/**
+// Does this Job have a lower priority than another Job?
+//
+// Jobs on heavier critical paths are processed before Jobs on lighter 
+// critical paths so that long chains of work, e.g. a slow link that gates
+// the final executable, start as early as possible.  Between Jobs with 
+// equal critical paths lower Jobs are processed before higher Jobs.
+//
+// @param job
+//  The Job to compare with.
+//
+// @return
+//  True if this Job should be processed after \e job otherwise false.
+*/
 bool Job::operator<( const Job& job ) const
 {
-    return height_ < job.height_;
+    return critical_path_ < job.critical_path_ || (critical_path_ == job.critical_path_ && height_ > job.height_);
+}
+
+/**
+// Add a dependency from this Job to another Job.
+//
+// @param job
+//  The Job that must complete before this Job is processed.
+*/
+void Job::add_dependency( Job* job )
+{
+    SWEET_ASSERT( job );
+    SWEET_ASSERT( job != this );
+    job->dependents_.push_back( this );
+    ++dependencies_;
+}
+
+/**
+// Note the completion of one of the Jobs that this Job depends on.
+//
+// @return
+//  True if this Job became ready as a result otherwise false.
+*/
+bool Job::complete_dependency()
+{
+    SWEET_ASSERT( dependencies_ > 0 );
+    --dependencies_;
+    return dependencies_ == 0;
+}
+
+/**
+// Calculate the critical path length of this Job.
+//
+// Assumes that the critical path lengths of all of the Jobs that depend on
+// this Job have already been calculated as is the case when Jobs are 
+// visited in the reverse of the order that they were created in during a 
+// postorder traversal.
+*/
+void Job::calculate_critical_path()
+{
+    int critical_path = 0;
+    for ( vector<Job*>::const_iterator i = dependents_.begin(); i != dependents_.end(); ++i )
+    {
+        const Job* dependent = *i;
+        SWEET_ASSERT( dependent );
+        critical_path = max( critical_path, dependent->critical_path_ );
+    }
+    critical_path_ = critical_path + weight_;
 }
 
 void Job::set_state( JobState state )
 {
     SWEET_ASSERT( state >= JOB_WAITING && state <= JOB_COMPLETE );
     state_ = state;
+    if ( state_ == JOB_PROCESSING )
+    {
+        started_ = steady_clock::now();
+    }
 }
@@ -2,6 +2,8 @@
 #define FORGE_JOB_HPP_INCLUDED
 
 #include <string>
+#include <vector>
+#include <chrono>
 
 namespace sweet
 {
@@ -29,17 +31,32 @@ class Job
 {
     Target* target_; ///< The Target that this Job is for.
     int height_; ///< The height of this Job in its Graph.
+    bool visit_; ///< Whether or not this Job visits its Target or only orders the Jobs that depend on it.
+    int weight_; ///< The expected time, in milliseconds, to process this Job.
+    int critical_path_; ///< The total weight of the heaviest path from this Job to the root of the traversal.
+    int dependencies_; ///< The number of Jobs that this Job depends on that haven't completed.
+    std::vector<Job*> dependents_; ///< The Jobs that depend on this Job.
     JobState state_; ///< The JobState of this Job.
+    std::chrono::steady_clock::time_point started_; ///< The time that processing of this Job started.
 
     public:
-        Job( Target* target, int height );
+        Job( Target* target, int height, bool visit );
 
         Target* target() const;
         Target* working_directory() const;
         int height() const;
+        bool visit() const;
+        int weight() const;
+        int critical_path() const;
+        int duration() const;
+        bool ready() const;
+        const std::vector<Job*>& dependents() const;
         JobState state() const;
         bool operator<( const Job& job ) const;
 
+        void add_dependency( Job* job );
+        bool complete_dependency();
+        void calculate_critical_path();
         void set_state( JobState state );        
 };
 
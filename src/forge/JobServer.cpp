@@ -0,0 +1,463 @@
+//
+// JobServer.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "JobServer.hpp"
+#include <assert/assert.hpp>
+#include <algorithm>
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(BUILD_OS_WINDOWS)
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
+#endif
+
+#ifndef O_CLOEXEC
+#define O_CLOEXEC 0
+#endif
+
+using std::string;
+using std::max;
+using namespace sweet;
+using namespace sweet::forge;
+
+namespace
+{
+
+bool jobserver_flag( const string& flag )
+{
+    return
+        (flag.compare(0, 2, "-j") == 0 && flag.find_first_not_of("0123456789", 2) == string::npos) ||
+        flag.compare(0, 17, "--jobserver-auth=") == 0 ||
+        flag.compare(0, 16, "--jobserver-fds=") == 0
+    ;
+}
+
+/**
+// Append the jobserver flags, or the other flags, in a `MAKEFLAGS` value.
+//
+// @param makeflags
+//  The `MAKEFLAGS` value to append flags from.
+//
+// @param jobserver
+//  True to append only jobserver flags or false to append only other flags.
+//
+// @param flags
+//  The string to append the flags to, separated by spaces.
+//
+// @param variables
+//  The string to set to the variable definitions that follow `--` in
+//  \e makeflags or null to ignore them.
+*/
+void append_flags( const string& makeflags, bool jobserver, string* flags, string* variables )
+{
+    SWEET_ASSERT( flags );
+    string::size_type start = makeflags.find_first_not_of( ' ' );
+    while ( start != string::npos )
+    {
+        string::size_type finish = makeflags.find( ' ', start );
+        string flag = makeflags.substr( start, finish != string::npos ? finish - start : string::npos );
+        if ( flag == "--" )
+        {
+            if ( variables )
+            {
+                *variables = makeflags.substr( start );
+            }
+            break;
+        }
+        if ( jobserver_flag(flag) == jobserver )
+        {
+            if ( !flags->empty() )
+            {
+                flags->push_back( ' ' );
+            }
+            flags->append( flag );
+        }
+        start = makeflags.find_first_not_of( ' ', finish );
+    }
+}
+
+}
+
+JobServer::JobServer()
+: read_fd_( -1 ),
+  write_fd_( -1 ),
+  owned_write_fd_( false ),
+  fifo_(),
+  makeflags_(),
+  tokens_()
+{
+}
+
+JobServer::~JobServer()
+{
+    disconnect();
+}
+
+/**
+// Connect to the jobserver named in a `MAKEFLAGS` value.
+//
+// Pipe jobservers (`--jobserver-auth=R,W`) are only supported where the
+// read end of the pipe can be reopened through `/proc/self/fd` so that
+// tokens can be read without blocking and without changing the flags
+// shared with other clients.
+//
+// @param makeflags
+//  The value of `MAKEFLAGS` or null if it isn't set.
+//
+// @return
+//  True if a jobserver was found and connected to otherwise false.
+*/
+bool JobServer::connect( const char* makeflags )
+{
+    disconnect();
+
+#if !defined(BUILD_OS_WINDOWS)
+    if ( !makeflags )
+    {
+        return false;
+    }
+
+    // Use the last option as make does when options are repeated.
+    string flags( makeflags );
+    string::size_type position = flags.rfind( "--jobserver-auth=" );
+    string::size_type start = position != string::npos ? position + strlen( "--jobserver-auth=" ) : string::npos;
+    if ( position == string::npos )
+    {
+        position = flags.rfind( "--jobserver-fds=" );
+        start = position != string::npos ? position + strlen( "--jobserver-fds=" ) : string::npos;
+    }
+    if ( position == string::npos )
+    {
+        return false;
+    }
+    string::size_type finish = flags.find( ' ', start );
+    string auth = flags.substr( start, finish != string::npos ? finish - start : string::npos );
+
+    if ( auth.compare(0, 5, "fifo:") == 0 )
+    {
+        if ( !open_fifo(auth.substr(5)) )
+        {
+            return false;
+        }
+        makeflags_ = flags;
+        return true;
+    }
+
+    int read_fd = -1;
+    int write_fd = -1;
+    if ( sscanf(auth.c_str(), "%d,%d", &read_fd, &write_fd) != 2 || read_fd < 0 || write_fd < 0 ||
+        ::fcntl(read_fd, F_GETFD) == -1 || ::fcntl(write_fd, F_GETFD) == -1 )
+    {
+        return false;
+    }
+
+    char path [64];
+    snprintf( path, sizeof(path), "/proc/self/fd/%d", read_fd );
+    read_fd_ = ::open( path, O_RDONLY | O_NONBLOCK | O_CLOEXEC );
+    if ( read_fd_ < 0 )
+    {
+        return false;
+    }
+    write_fd_ = write_fd;
+    owned_write_fd_ = false;
+    makeflags_ = flags;
+    return true;
+#else
+    (void) makeflags;
+    return false;
+#endif
+}
+
+/**
+// Serve a jobserver for child processes and connect to it.
+//
+// @param jobs
+//  The number of jobs that may run in parallel (the fifo is filled with
+//  one token less than this).
+//
+// @return
+//  True if the jobserver was created otherwise false.
+*/
+bool JobServer::serve( int jobs )
+{
+    disconnect();
+
+#if !defined(BUILD_OS_WINDOWS)
+    static std::atomic<int> fifos( 0 );
+    const char* temporary_directory = ::getenv( "TMPDIR" );
+    char name [128];
+    snprintf( name, sizeof(name), "/forge-jobserver-%d-%d", int(::getpid()), fifos++ );
+    string path = string( temporary_directory && *temporary_directory ? temporary_directory : "/tmp" ) + name;
+    if ( ::mkfifo(path.c_str(), 0600) != 0 )
+    {
+        return false;
+    }
+    fifo_ = path;
+
+    if ( !open_fifo(path) )
+    {
+        disconnect();
+        return false;
+    }
+
+    for ( int i = 1; i < jobs; ++i )
+    {
+        char token = '+';
+        if ( ::write(write_fd_, &token, 1) != 1 )
+        {
+            disconnect();
+            return false;
+        }
+    }
+
+    char makeflags [64];
+    snprintf( makeflags, sizeof(makeflags), " -j%d --jobserver-auth=fifo:", jobs );
+    makeflags_ = string( makeflags ) + path;
+    return true;
+#else
+    (void) jobs;
+    return false;
+#endif
+}
+
+/**
+// Return any tokens held, close the jobserver, and remove the fifo if this
+// JobServer created it.
+*/
+void JobServer::disconnect()
+{
+#if !defined(BUILD_OS_WINDOWS)
+    while ( !tokens_.empty() )
+    {
+        release();
+    }
+    if ( read_fd_ >= 0 )
+    {
+        ::close( read_fd_ );
+    }
+    if ( owned_write_fd_ && write_fd_ >= 0 && write_fd_ != read_fd_ )
+    {
+        ::close( write_fd_ );
+    }
+    if ( !fifo_.empty() )
+    {
+        ::unlink( fifo_.c_str() );
+    }
+#endif
+    read_fd_ = -1;
+    write_fd_ = -1;
+    owned_write_fd_ = false;
+    fifo_.clear();
+    makeflags_.clear();
+    tokens_.clear();
+}
+
+/**
+// Is this JobServer connected to a jobserver?
+//
+// @return
+//  True if connected otherwise false.
+*/
+bool JobServer::enabled() const
+{
+    return read_fd_ >= 0;
+}
+
+/**
+// Is this JobServer serving a jobserver that it created?
+//
+// @return
+//  True if serving otherwise false.
+*/
+bool JobServer::serving() const
+{
+    return !fifo_.empty();
+}
+
+/**
+// Get the `MAKEFLAGS` to pass to child processes so that they share this
+// jobserver.
+//
+// @return
+//  The `MAKEFLAGS` or the empty string if this JobServer is disabled.
+*/
+const std::string& JobServer::makeflags() const
+{
+    return makeflags_;
+}
+
+/**
+// Merge the jobserver flags of this JobServer into a `MAKEFLAGS` value.
+//
+// Any `-j`, `--jobserver-auth=`, and `--jobserver-fds=` flags in 
+// \e makeflags are replaced by those of this JobServer.  Other flags and
+// variable definitions are kept.
+//
+// @param makeflags
+//  The `MAKEFLAGS` value already in a child's environment or null if there
+//  isn't one.
+//
+// @return
+//  The `MAKEFLAGS` to pass to the child.
+*/
+std::string JobServer::merge_makeflags( const char* makeflags ) const
+{
+    string flags;
+    string variables;
+    append_flags( makeflags ? makeflags : "", false, &flags, &variables );
+    append_flags( makeflags_, true, &flags, NULL );
+    if ( !variables.empty() )
+    {
+        flags.push_back( ' ' );
+        flags.append( variables );
+    }
+    return flags;
+}
+
+/**
+// Get the number of tokens currently held.
+//
+// @return
+//  The number of tokens held.
+*/
+int JobServer::tokens() const
+{
+    return int(tokens_.size());
+}
+
+/**
+// Read a token from the jobserver without blocking.
+//
+// @return
+//  True if a token was read otherwise false.
+*/
+bool JobServer::acquire()
+{
+#if !defined(BUILD_OS_WINDOWS)
+    if ( read_fd_ >= 0 )
+    {
+        char token = 0;
+        ssize_t bytes = ::read( read_fd_, &token, 1 );
+        while ( bytes < 0 && errno == EINTR )
+        {
+            bytes = ::read( read_fd_, &token, 1 );
+        }
+        if ( bytes == 1 )
+        {
+            tokens_.push_back( token );
+            return true;
+        }
+    }
+#endif
+    return false;
+}
+
+/**
+// Write the most recently acquired token back to the jobserver.
+*/
+void JobServer::release()
+{
+    SWEET_ASSERT( !tokens_.empty() );
+#if !defined(BUILD_OS_WINDOWS)
+    if ( !tokens_.empty() )
+    {
+        char token = tokens_.back();
+        tokens_.pop_back();
+        ssize_t bytes = ::write( write_fd_, &token, 1 );
+        while ( bytes < 0 && errno == EINTR )
+        {
+            bytes = ::write( write_fd_, &token, 1 );
+        }
+    }
+#endif
+}
+
+/**
+// Acquire the token, if any, needed to start another job.
+//
+// The first running job needs no token and each job after that needs one
+// so a token is only read when \e active_jobs is more than the number of
+// tokens already held.
+//
+// @param active_jobs
+//  The number of jobs already running.
+//
+// @return
+//  True if the job may start otherwise false.
+*/
+bool JobServer::acquire_for_job( int active_jobs )
+{
+    SWEET_ASSERT( active_jobs >= 0 );
+    return active_jobs <= tokens() || acquire();
+}
+
+/**
+// Return the tokens that are no longer needed by the jobs still running.
+//
+// @param active_jobs
+//  The number of jobs still running.
+*/
+void JobServer::release_for_jobs( int active_jobs )
+{
+    SWEET_ASSERT( active_jobs >= 0 );
+    while ( tokens() > max(0, active_jobs - 1) )
+    {
+        release();
+    }
+}
+
+/**
+// Wait for a token to become available.
+//
+// @param milliseconds
+//  The maximum time to wait in milliseconds.
+//
+// @return
+//  True if a token may be available otherwise false.
+*/
+bool JobServer::wait( int milliseconds ) const
+{
+#if !defined(BUILD_OS_WINDOWS)
+    if ( read_fd_ >= 0 )
+    {
+        struct pollfd descriptor;
+        descriptor.fd = read_fd_;
+        descriptor.events = POLLIN;
+        descriptor.revents = 0;
+        return ::poll( &descriptor, 1, milliseconds ) > 0;
+    }
+#else
+    (void) milliseconds;
+#endif
+    return false;
+}
+
+bool JobServer::open_fifo( const std::string& path )
+{
+#if !defined(BUILD_OS_WINDOWS)
+    // Open the fifo for reading and writing so that opening doesn't block
+    // waiting for a writer and reads return EAGAIN, rather than end of
+    // file, when there are no tokens.
+    int fd = ::open( path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC );
+    if ( fd < 0 )
+    {
+        return false;
+    }
+    read_fd_ = fd;
+    write_fd_ = fd;
+    owned_write_fd_ = true;
+    return true;
+#else
+    (void) path;
+    return false;
+#endif
+}
@@ -0,0 +1,71 @@
+#ifndef FORGE_JOBSERVER_HPP_INCLUDED
+#define FORGE_JOBSERVER_HPP_INCLUDED
+
+#include <string>
+#include <vector>
+
+namespace sweet
+{
+
+namespace forge
+{
+
+/**
+// A client of, or server for, the GNU make jobserver protocol.
+//
+// A jobserver shares a budget of parallel jobs between cooperating build
+// tools through a pipe or named fifo that holds one single byte token for
+// each job beyond the first.  Each tool runs its first job for free and
+// must read a token before starting each additional job and write the same
+// token back when that job finishes.
+//
+// As a client this JobServer shares the budget of a jobserver named in the
+// `--jobserver-auth` (or older `--jobserver-fds`) option in the `MAKEFLAGS`
+// inherited from a parent make.  As a server it creates a named fifo holding
+// one token less than the number of parallel jobs and connects to it as a
+// client so that its own jobs and the jobs of the children that it spawns
+// (recursive makes, `cmake --build`, `-flto=jobserver` links) share one
+// budget.
+//
+// The first job that a tool runs needs no token so a tool running N jobs
+// holds N - 1 tokens (see `JobServer::acquire_for_job()` and 
+// `JobServer::release_for_jobs()`).
+//
+// Tokens are always read without blocking.  Only POSIX jobservers are
+// supported; on Windows this JobServer is always disabled.
+*/
+class JobServer
+{
+    int read_fd_; ///< The file descriptor that tokens are read from or -1 if disabled.
+    int write_fd_; ///< The file descriptor that tokens are written back to or -1 if disabled.
+    bool owned_write_fd_; ///< Whether or not the write file descriptor was opened (and must be closed) by this JobServer.
+    std::string fifo_; ///< The path to the fifo created when serving or empty if not serving.
+    std::string makeflags_; ///< The `MAKEFLAGS` to pass to child processes or empty if disabled.
+    std::vector<char> tokens_; ///< The tokens currently held.
+
+public:
+    JobServer();
+    ~JobServer();
+    bool connect( const char* makeflags );
+    bool serve( int jobs );
+    void disconnect();
+    bool enabled() const;
+    bool serving() const;
+    const std::string& makeflags() const;
+    std::string merge_makeflags( const char* makeflags ) const;
+    int tokens() const;
+    bool acquire();
+    void release();
+    bool acquire_for_job( int active_jobs );
+    void release_for_jobs( int active_jobs );
+    bool wait( int milliseconds ) const;
+
+private:
+    bool open_fifo( const std::string& path );
+};
+
+}
+
+}
+
+#endif
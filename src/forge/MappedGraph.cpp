@@ -0,0 +1,454 @@
+//
+// MappedGraph.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "MappedGraph.hpp"
+#include "Target.hpp"
+#include "StatCache.hpp"
+#include <error/ErrorPolicy.hpp>
+#include <assert/assert.hpp>
+#include <string.h>
+
+#if defined(BUILD_OS_WINDOWS)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using std::vector;
+using std::string;
+using std::unique_ptr;
+using namespace sweet;
+using namespace sweet::forge;
+
+static const char FORMAT [] = "Sweet Build Graph";
+
+MappedGraph::MappedGraph( error::ErrorPolicy* error_policy )
+: error_policy_( error_policy ),
+  address_( nullptr ),
+  size_( 0 ),
+  file_( 0 ),
+  mapping_( 0 ),
+  header_( nullptr ),
+  strings_( nullptr ),
+  string_data_( nullptr ),
+  targets_( nullptr ),
+  filenames_( nullptr ),
+  references_( nullptr ),
+  directories_( nullptr )
+{
+    SWEET_ASSERT( error_policy_ );
+}
+
+MappedGraph::~MappedGraph()
+{
+    unmap();
+}
+
+/**
+// Map a dependency graph cache file into memory.
+//
+// @param filename
+//  The name of the file to map.
+//
+// @return
+//  True if the file was mapped otherwise false.
+*/
+bool MappedGraph::map( const std::string& filename )
+{
+    unmap();
+
+#if defined(BUILD_OS_WINDOWS)
+    HANDLE file = ::CreateFileA( filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+    if ( file == INVALID_HANDLE_VALUE )
+    {
+        return false;
+    }
+    file_ = (intptr_t) file;
+
+    LARGE_INTEGER size;
+    if ( !::GetFileSizeEx(file, &size) || size.QuadPart == 0 )
+    {
+        unmap();
+        return false;
+    }
+    size_ = size_t(size.QuadPart);
+
+    HANDLE mapping = ::CreateFileMappingA( file, NULL, PAGE_READONLY, 0, 0, NULL );
+    if ( mapping == NULL )
+    {
+        unmap();
+        return false;
+    }
+    mapping_ = (intptr_t) mapping;
+
+    address_ = ::MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+    if ( !address_ )
+    {
+        unmap();
+        return false;
+    }
+#else
+    int fd = ::open( filename.c_str(), O_RDONLY | O_CLOEXEC );
+    if ( fd < 0 )
+    {
+        return false;
+    }
+
+    struct stat status;
+    if ( ::fstat(fd, &status) != 0 || status.st_size == 0 )
+    {
+        ::close( fd );
+        return false;
+    }
+
+    void* address = ::mmap( nullptr, size_t(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0 );
+    ::close( fd );
+    if ( address == MAP_FAILED )
+    {
+        return false;
+    }
+    address_ = address;
+    size_ = size_t(status.st_size);
+#endif
+
+    header_ = reinterpret_cast<const Header*>( address_ );
+    return true;
+}
+
+/**
+// Get the version of the mapped file.
+//
+// @return
+//  The version of the mapped file or -1 if no file is mapped or the mapped
+//  file isn't a dependency graph cache file.
+*/
+int MappedGraph::version() const
+{
+    if ( !address_ || size_ < sizeof(FORMAT) + sizeof(int) || strncmp(header_->format, FORMAT, sizeof(FORMAT)) != 0 )
+    {
+        return -1;
+    }
+    int version = 0;
+    memcpy( &version, header_->version, sizeof(version) );
+    return version;
+}
+
+/**
+// Get the generation of the mapped file.
+//
+// @return
+//  The generation that identifies the journal that applies to the mapped 
+//  file.
+*/
+uint64_t MappedGraph::generation() const
+{
+    SWEET_ASSERT( header_ );
+    return header_->generation;
+}
+
+/**
+// Get the size of the mapped file.
+//
+// @return
+//  The size of the mapped file in bytes.
+*/
+size_t MappedGraph::size() const
+{
+    return size_;
+}
+
+/**
+// Read the Targets and StatCache directories from the mapped file.
+//
+// @param filename
+//  The name of the mapped file (for error reporting).
+//
+// @param stat_cache
+//  The StatCache to read directories into or null to skip them.
+//
+// @return
+//  The root Target or null if the mapped file isn't a valid dependency graph
+//  cache file.
+*/
+std::unique_ptr<Target> MappedGraph::read( const std::string& filename, StatCache* stat_cache )
+{
+    int version = MappedGraph::version();
+    if ( version < 0 )
+    {
+        error_policy_->print( "The file '%s' is not a valid dependency graph", filename.c_str() );
+        return unique_ptr<Target>();
+    }
+
+    if ( version != VERSION )
+    {
+        error_policy_->print( "The file '%s' is version %d not version %d as expected", filename.c_str(), version, VERSION );
+        return unique_ptr<Target>();
+    }
+
+    if ( !locate() )
+    {
+        error_policy_->print( "The file '%s' is not a valid dependency graph", filename.c_str() );
+        return unique_ptr<Target>();
+    }
+
+    vector<Target*> targets( header_->targets );
+    for ( vector<Target*>::iterator i = targets.begin(); i != targets.end(); ++i )
+    {
+        *i = new Target;
+    }
+    for ( int i = 0; i < int(targets.size()); ++i )
+    {
+        targets[i]->read( *this, i, targets );
+    }
+
+    if ( stat_cache )
+    {
+        stat_cache->read( *this );
+    }
+    return unique_ptr<Target>( targets.front() );
+}
+
+/**
+// Get a target record.
+//
+// @param index
+//  The index of the target record to get.
+//
+// @return
+//  The target record.
+*/
+const MappedGraph::TargetRecord& MappedGraph::target( int index ) const
+{
+    SWEET_ASSERT( targets_ );
+    SWEET_ASSERT( index >= 0 && uint32_t(index) < header_->targets );
+    return targets_[index];
+}
+
+/**
+// Get a string from the string table.
+//
+// @param index
+//  The index of the string to get.
+//
+// @return
+//  The string.
+*/
+std::string MappedGraph::string( uint32_t index ) const
+{
+    SWEET_ASSERT( strings_ );
+    SWEET_ASSERT( index < header_->strings );
+    const String& string = strings_[index];
+    return std::string( string_data_ + string.offset, string.size );
+}
+
+/**
+// Get the string index of a filename.
+//
+// @param index
+//  The offset of the filename in the filenames.
+//
+// @return
+//  The index of the filename in the string table.
+*/
+uint32_t MappedGraph::filename( uint32_t index ) const
+{
+    SWEET_ASSERT( filenames_ );
+    SWEET_ASSERT( index < header_->filenames );
+    return filenames_[index];
+}
+
+/**
+// Get the target index of a child or implicit dependency.
+//
+// @param index
+//  The offset of the reference in the references.
+//
+// @return
+//  The index of the referenced target record.
+*/
+uint32_t MappedGraph::reference( uint32_t index ) const
+{
+    SWEET_ASSERT( references_ );
+    SWEET_ASSERT( index < header_->references );
+    return references_[index];
+}
+
+/**
+// Get a directory record.
+//
+// @param index
+//  The index of the directory record to get.
+//
+// @return
+//  The directory record.
+*/
+const MappedGraph::Directory& MappedGraph::directory( int index ) const
+{
+    SWEET_ASSERT( directories_ );
+    SWEET_ASSERT( index >= 0 && uint32_t(index) < header_->directories );
+    return directories_[index];
+}
+
+/**
+// Get the number of directory records.
+//
+// @return
+//  The number of directory records.
+*/
+int MappedGraph::directories() const
+{
+    SWEET_ASSERT( header_ );
+    return int(header_->directories);
+}
+
+/**
+// Round a size up to keep the section that follows it 8 byte aligned.
+//
+// @param size
+//  The size to round up.
+//
+// @return
+//  The size rounded up to the next multiple of 8.
+*/
+size_t MappedGraph::padded( size_t size )
+{
+    return (size + 7) & ~size_t(7);
+}
+
+bool MappedGraph::locate()
+{
+    if ( size_ < sizeof(Header) )
+    {
+        return false;
+    }
+
+    const char* base = reinterpret_cast<const char*>( address_ );
+    size_t offset = sizeof(Header);
+    strings_ = reinterpret_cast<const String*>( base + offset );
+    offset += padded( size_t(header_->strings) * sizeof(String) );
+    string_data_ = base + offset;
+    offset += padded( header_->string_bytes );
+    targets_ = reinterpret_cast<const TargetRecord*>( base + offset );
+    offset += size_t(header_->targets) * sizeof(TargetRecord);
+    filenames_ = reinterpret_cast<const uint32_t*>( base + offset );
+    offset += padded( size_t(header_->filenames) * sizeof(uint32_t) );
+    references_ = reinterpret_cast<const uint32_t*>( base + offset );
+    offset += padded( size_t(header_->references) * sizeof(uint32_t) );
+    directories_ = reinterpret_cast<const Directory*>( base + offset );
+    offset += size_t(header_->directories) * sizeof(Directory);
+    if ( offset > size_ || header_->targets == 0 )
+    {
+        return false;
+    }
+
+    for ( uint32_t i = 0; i < header_->strings; ++i )
+    {
+        if ( uint64_t(strings_[i].offset) + strings_[i].size > header_->string_bytes )
+        {
+            return false;
+        }
+    }
+
+    for ( uint32_t i = 0; i < header_->filenames; ++i )
+    {
+        if ( filenames_[i] >= header_->strings )
+        {
+            return false;
+        }
+    }
+
+    for ( uint32_t i = 0; i < header_->references; ++i )
+    {
+        if ( references_[i] >= header_->targets )
+        {
+            return false;
+        }
+    }
+
+    for ( uint32_t i = 0; i < header_->directories; ++i )
+    {
+        if ( directories_[i].path >= header_->strings )
+        {
+            return false;
+        }
+    }
+
+    // Every target other than the root must be the child of exactly one
+    // target and reachable from the root so that the targets form a tree
+    // that is owned by the root target.
+    vector<uint32_t> parents( header_->targets, 0 );
+    for ( uint32_t i = 0; i < header_->targets; ++i )
+    {
+        const TargetRecord& target = targets_[i];
+        if ( target.id >= header_->strings ||
+            uint64_t(target.first_filename) + target.filenames > header_->filenames ||
+            uint64_t(target.first_target) + target.targets > header_->references ||
+            uint64_t(target.first_dependency) + target.dependencies > header_->references )
+        {
+            return false;
+        }
+
+        for ( uint32_t j = target.first_target; j < target.first_target + target.targets; ++j )
+        {
+            uint32_t child = references_[j];
+            if ( child == 0 || parents[child] != 0 )
+            {
+                return false;
+            }
+            parents[child] = i + 1;
+        }
+    }
+
+    uint32_t reachable = 1;
+    vector<uint32_t> stack( 1, 0 );
+    while ( !stack.empty() )
+    {
+        const TargetRecord& target = targets_[stack.back()];
+        stack.pop_back();
+        for ( uint32_t j = target.first_target; j < target.first_target + target.targets; ++j )
+        {
+            stack.push_back( references_[j] );
+            ++reachable;
+        }
+    }
+    return reachable == header_->targets;
+}
+
+void MappedGraph::unmap()
+{
+#if defined(BUILD_OS_WINDOWS)
+    if ( address_ )
+    {
+        ::UnmapViewOfFile( address_ );
+    }
+    if ( mapping_ )
+    {
+        ::CloseHandle( (HANDLE) mapping_ );
+        mapping_ = 0;
+    }
+    if ( file_ )
+    {
+        ::CloseHandle( (HANDLE) file_ );
+        file_ = 0;
+    }
+#else
+    if ( address_ )
+    {
+        ::munmap( address_, size_ );
+    }
+#endif
+    address_ = nullptr;
+    size_ = 0;
+    header_ = nullptr;
+    strings_ = nullptr;
+    string_data_ = nullptr;
+    targets_ = nullptr;
+    filenames_ = nullptr;
+    references_ = nullptr;
+    directories_ = nullptr;
+}
@@ -0,0 +1,130 @@
+#ifndef FORGE_MAPPEDGRAPH_HPP_INCLUDED
+#define FORGE_MAPPEDGRAPH_HPP_INCLUDED
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace sweet
+{
+
+namespace error
+{
+
+class ErrorPolicy;
+
+}
+
+namespace forge
+{
+
+class Target;
+class StatCache;
+
+/**
+// A dependency graph cache file mapped into memory.
+//
+// The file is laid out as a header followed by a deduplicated string table,
+// an array of fixed size target records, and arrays of string and target
+// indices that the target records refer to by offset.  Targets refer to
+// their children and implicit dependencies by their index in the array of
+// target records so no addresses need to be fixed up when the file is read.
+// The root target is always the first target record.
+//
+// Files written in the stream format used before version 36 are read with
+// GraphReader instead (see MappedGraph::version()).
+*/
+class MappedGraph
+{
+    public:
+        static const int VERSION = 38;
+
+        struct Header
+        {
+            char format [18]; ///< The null terminated string "Sweet Build Graph".
+            char version [4]; ///< The version as an unaligned int at the same offset as in the stream format.
+            char padding [2]; ///< Padding to align the counts that follow.
+            uint32_t targets; ///< The number of target records.
+            uint32_t strings; ///< The number of entries in the string table.
+            uint32_t string_bytes; ///< The number of bytes of string data (before padding).
+            uint32_t filenames; ///< The number of string indices for filenames.
+            uint32_t references; ///< The number of target indices for children and implicit dependencies.
+            uint32_t directories; ///< The number of directory records for the StatCache.
+            uint64_t generation; ///< Identifies the journal that applies to this file (see GraphJournal).
+        };
+
+        struct String
+        {
+            uint32_t offset; ///< The offset of the string in the string data.
+            uint32_t size; ///< The size of the string in bytes.
+        };
+
+        struct TargetRecord
+        {
+            int64_t last_write_time; ///< The last write time of the Target.
+            uint64_t hash; ///< The hash of the Target when it was last built.
+            uint64_t digest; ///< The digest of the contents of the Target's files.
+            uint64_t inputs_digest; ///< The digest of the Target's dependencies when it was last built.
+            uint32_t id; ///< The index of the Target's identifier in the string table.
+            int32_t duration; ///< The duration of the Target's most recent build in milliseconds.
+            uint32_t first_filename; ///< The offset of the Target's first filename in the filenames.
+            uint32_t filenames; ///< The number of filenames.
+            uint32_t first_target; ///< The offset of the Target's first child in the references.
+            uint32_t targets; ///< The number of children.
+            uint32_t first_dependency; ///< The offset of the Target's first implicit dependency in the references.
+            uint32_t dependencies; ///< The number of implicit dependencies.
+            uint8_t built; ///< Non-zero if the Target has been built.
+            uint8_t padding [7]; ///< Padding to align the next record.
+        };
+
+        struct Directory
+        {
+            int64_t last_write_time; ///< The last write time of the directory.
+            uint64_t inode; ///< The inode of the directory.
+            int64_t size; ///< The size of the directory.
+            uint32_t path; ///< The index of the directory's path in the string table.
+            uint32_t padding; ///< Padding to align the next record.
+        };
+
+    private:
+        error::ErrorPolicy* error_policy_; ///< The ErrorPolicy to report errors to.
+        void* address_; ///< The address that the file is mapped at.
+        size_t size_; ///< The size of the mapped file in bytes.
+        intptr_t file_; ///< The handle to the open file (Windows only).
+        intptr_t mapping_; ///< The handle to the file mapping (Windows only).
+        const Header* header_; ///< The header.
+        const String* strings_; ///< The string table.
+        const char* string_data_; ///< The string data.
+        const TargetRecord* targets_; ///< The target records.
+        const uint32_t* filenames_; ///< The string indices of filenames.
+        const uint32_t* references_; ///< The target indices of children and implicit dependencies.
+        const Directory* directories_; ///< The directory records.
+
+    public:
+        MappedGraph( error::ErrorPolicy* error_policy );
+        ~MappedGraph();
+        bool map( const std::string& filename );
+        int version() const;
+        uint64_t generation() const;
+        size_t size() const;
+        std::unique_ptr<Target> read( const std::string& filename, StatCache* stat_cache );
+        const TargetRecord& target( int index ) const;
+        std::string string( uint32_t index ) const;
+        uint32_t filename( uint32_t index ) const;
+        uint32_t reference( uint32_t index ) const;
+        const Directory& directory( int index ) const;
+        int directories() const;
+        static size_t padded( size_t size );
+
+    private:
+        bool locate();
+        void unmap();
+};
+
+}
+
+}
+
+#endif
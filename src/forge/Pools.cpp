@@ -0,0 +1,182 @@
+//
+// Pools.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "Pools.hpp"
+#include <assert/assert.hpp>
+#include <algorithm>
+
+using std::max;
+using std::vector;
+using std::pair;
+using namespace sweet;
+using namespace sweet::forge;
+
+Pools::Pools()
+: pools_()
+{
+}
+
+/**
+// Declare a named pool or change the capacity of an existing one.
+//
+// @param name
+//  The name of the pool.
+//
+// @param capacity
+//  The total weight that execute calls may claim from the pool at once
+//  (clamped to at least 1).
+*/
+void Pools::set( const std::string& name, int capacity )
+{
+    int index = Pools::index( name );
+    if ( index < 0 )
+    {
+        Pool pool;
+        pool.name = name;
+        pool.capacity = 1;
+        pool.used = 0;
+        pool.blocked = false;
+        pools_.push_back( pool );
+        index = int(pools_.size()) - 1;
+    }
+    pools_[index].capacity = max( 1, capacity );
+}
+
+/**
+// Get the capacity of a named pool.
+//
+// @param name
+//  The name of the pool.
+//
+// @return
+//  The capacity of the pool or 0 if no pool named \e name has been declared.
+*/
+int Pools::capacity( const std::string& name ) const
+{
+    int index = Pools::index( name );
+    return index >= 0 ? pools_[index].capacity : 0;
+}
+
+/**
+// Get the index of a named pool.
+//
+// Pools are never removed so an index remains valid for the lifetime of
+// these Pools.
+//
+// @param name
+//  The name of the pool.
+//
+// @return
+//  The index of the pool or -1 if no pool named \e name has been declared.
+*/
+int Pools::index( const std::string& name ) const
+{
+    for ( int i = 0; i < int(pools_.size()); ++i )
+    {
+        if ( pools_[i].name == name )
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+// Get the weight currently claimed from a pool.
+//
+// @param index
+//  The index of the pool.
+//
+// @return
+//  The weight claimed from the pool by the calls that are running.
+*/
+int Pools::used( int index ) const
+{
+    SWEET_ASSERT( index >= 0 && index < int(pools_.size()) );
+    return pools_[index].used;
+}
+
+/**
+// Start a dispatch pass by unblocking every pool.
+*/
+void Pools::begin_dispatch()
+{
+    for ( vector<Pool>::iterator pool = pools_.begin(); pool != pools_.end(); ++pool )
+    {
+        pool->blocked = false;
+    }
+}
+
+/**
+// Can a call claim its weights from the pools now?
+//
+// @param pool_weights
+//  The index and weight of each pool claimed by the call.
+//
+// @return
+//  True if no pool is blocked by an earlier call in this dispatch pass and
+//  every pool is unused or has capacity for its weight otherwise false.
+*/
+bool Pools::available( const std::vector<std::pair<int, int> >& pool_weights ) const
+{
+    for ( vector<pair<int, int> >::const_iterator pool_weight = pool_weights.begin(); pool_weight != pool_weights.end(); ++pool_weight )
+    {
+        SWEET_ASSERT( pool_weight->first >= 0 && pool_weight->first < int(pools_.size()) );
+        const Pool& pool = pools_[pool_weight->first];
+        if ( pool.blocked || (pool.used > 0 && pool.used + pool_weight->second > pool.capacity) )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+// Block the pools claimed by a call that can't run yet for the rest of
+// this dispatch pass.
+//
+// @param pool_weights
+//  The index and weight of each pool claimed by the call.
+*/
+void Pools::block( const std::vector<std::pair<int, int> >& pool_weights )
+{
+    for ( vector<pair<int, int> >::const_iterator pool_weight = pool_weights.begin(); pool_weight != pool_weights.end(); ++pool_weight )
+    {
+        SWEET_ASSERT( pool_weight->first >= 0 && pool_weight->first < int(pools_.size()) );
+        pools_[pool_weight->first].blocked = true;
+    }
+}
+
+/**
+// Claim the weights of a call that is starting.
+//
+// @param pool_weights
+//  The index and weight of each pool claimed by the call.
+*/
+void Pools::claim( const std::vector<std::pair<int, int> >& pool_weights )
+{
+    for ( vector<pair<int, int> >::const_iterator pool_weight = pool_weights.begin(); pool_weight != pool_weights.end(); ++pool_weight )
+    {
+        SWEET_ASSERT( pool_weight->first >= 0 && pool_weight->first < int(pools_.size()) );
+        pools_[pool_weight->first].used += pool_weight->second;
+    }
+}
+
+/**
+// Return the weights claimed by a call that has finished.
+//
+// @param pool_weights
+//  The index and weight of each pool claimed by the call.
+*/
+void Pools::release( const std::vector<std::pair<int, int> >& pool_weights )
+{
+    for ( vector<pair<int, int> >::const_iterator pool_weight = pool_weights.begin(); pool_weight != pool_weights.end(); ++pool_weight )
+    {
+        SWEET_ASSERT( pool_weight->first >= 0 && pool_weight->first < int(pools_.size()) );
+        Pool& pool = pools_[pool_weight->first];
+        pool.used -= pool_weight->second;
+        SWEET_ASSERT( pool.used >= 0 );
+    }
+}
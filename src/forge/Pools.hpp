@@ -0,0 +1,60 @@
+#ifndef FORGE_POOLS_HPP_INCLUDED
+#define FORGE_POOLS_HPP_INCLUDED
+
+#include <vector>
+#include <string>
+#include <utility>
+
+namespace sweet
+{
+
+namespace forge
+{
+
+/**
+// Named pools that limit the total weight claimed by the execute calls
+// running at once.
+//
+// An execute call claims a weight from each of the pools named by its
+// target (see Executor).  A call can claim its weights when every pool has
+// capacity for them; a pool that isn't in use always has capacity so that a
+// call that claims more than a pool's capacity still runs, alone.
+//
+// Queued calls are considered in order in each dispatch pass.  A call that
+// doesn't fit blocks the pools that it claims for the rest of the pass so
+// that later calls claiming the same pools can't overtake it and keep a
+// heavy call waiting indefinitely while lighter calls keep a pool nearly
+// full.  Calls that claim none of the blocked pools are still dispatched.
+//
+// Not thread safe; the Executor serializes access.
+*/
+class Pools
+{
+    struct Pool
+    {
+        std::string name; ///< The name of the pool.
+        int capacity; ///< The total weight that may be claimed from the pool at once.
+        int used; ///< The weight currently claimed from the pool.
+        bool blocked; ///< Whether or not an earlier call in this dispatch pass is waiting for this pool.
+    };
+
+    std::vector<Pool> pools_; ///< The pools in the order that they were declared.
+
+public:
+    Pools();
+    void set( const std::string& name, int capacity );
+    int capacity( const std::string& name ) const;
+    int index( const std::string& name ) const;
+    int used( int index ) const;
+    void begin_dispatch();
+    bool available( const std::vector<std::pair<int, int> >& pool_weights ) const;
+    void block( const std::vector<std::pair<int, int> >& pool_weights );
+    void claim( const std::vector<std::pair<int, int> >& pool_weights );
+    void release( const std::vector<std::pair<int, int> >& pool_weights );
+};
+
+}
+
+}
+
+#endif
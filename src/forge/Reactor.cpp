@@ -0,0 +1,462 @@
+//
+// Reactor.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "Reactor.hpp"
+#include "Scheduler.hpp"
+#include "Forge.hpp"
+#include "Trace.hpp"
+#include "Statistics.hpp"
+#include <process/Process.hpp>
+#include <process/SpawnServer.hpp>
+#include <error/Error.hpp>
+#include <assert/assert.hpp>
+#include <string>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(BUILD_OS_LINUX)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+#endif
+
+using std::string;
+using namespace sweet;
+using namespace sweet::forge;
+
+/**
+// A pipe to read lines of output from or a child process to wait for.
+*/
+struct Reactor::Source
+{
+    int fd; ///< The read end of the pipe, the pidfd for the process, or the exit file descriptor from a SpawnServer.
+    intptr_t process; ///< The identifier of the process to wait for or 0 if this Source is a pipe.
+    bool spawned; ///< Whether or not the process was spawned through a SpawnServer and its exit code is read from `fd`.
+    Filter* filter; ///< The Filter to pass lines read from the pipe to.
+    Arguments* arguments; ///< The Arguments to pass to the Filter.
+    Target* working_directory; ///< The working directory to run the Filter in.
+    std::function<void (int)> exited; ///< The function to call with the exit code when the process exits.
+    size_t size; ///< The number of bytes of an incomplete line in the buffer.
+    char buffer [8192]; ///< The buffer that lines are split in.
+};
+
+Reactor::Reactor( Forge* forge )
+: forge_( forge ),
+  epoll_fd_( -1 ),
+  wake_fd_( -1 ),
+  thread_( nullptr ),
+  sources_( 0 ),
+  enabled_( false )
+{
+    SWEET_ASSERT( forge_ );
+    start();
+}
+
+Reactor::~Reactor()
+{
+    stop();
+}
+
+/**
+// Is this Reactor able to read and wait for child processes?
+//
+// @return
+//  True if child processes are multiplexed by this Reactor or false if the
+//  Reader and Executor should block threads in the blocking ThreadPool 
+//  instead.
+*/
+bool Reactor::enabled() const
+{
+    return enabled_;
+}
+
+/**
+// Read lines from a pipe and pass them to a Filter.
+//
+// @param fd_or_handle
+//  The read end of the pipe to read from (closed when the write end of the
+//  pipe is closed and all output has been read).
+//
+// @return
+//  True if this Reactor is reading from the pipe or false if the caller
+//  must read from it instead.
+*/
+bool Reactor::read( intptr_t fd_or_handle, Filter* filter, Arguments* arguments, Target* working_directory )
+{
+    SWEET_ASSERT( enabled_ );
+
+#if defined(BUILD_OS_LINUX)
+    int fd = (int) fd_or_handle;
+    SWEET_ASSERT( fd >= 0 );
+    int flags = fcntl( fd, F_GETFL );
+    fcntl( fd, F_SETFL, flags | O_NONBLOCK );
+
+    Source* source = new Source;
+    source->fd = fd;
+    source->process = 0;
+    source->spawned = false;
+    source->filter = filter;
+    source->arguments = arguments;
+    source->working_directory = working_directory;
+    source->size = 0;
+    if ( !add(source, fd) )
+    {
+        fcntl( fd, F_SETFL, flags );
+        return false;
+    }
+    return true;
+#else
+    (void) fd_or_handle;
+    (void) filter;
+    (void) arguments;
+    (void) working_directory;
+    return false;
+#endif
+}
+
+/**
+// Wait for a child process to exit without blocking the calling thread.
+//
+// @param process
+//  The running Process to wait for.  The Process is detached when this
+//  Reactor takes responsibility for reaping it.
+//
+// @param exited
+//  The function to call, from the reactor thread, with the exit code of
+//  the process when it exits.
+//
+// @return
+//  True if this Reactor is waiting for the process or false if the caller
+//  must wait for it instead.
+*/
+bool Reactor::wait( process::Process* process, const std::function<void (int)>& exited )
+{
+    SWEET_ASSERT( process );
+
+#if defined(BUILD_OS_LINUX)
+    if ( enabled_ )
+    {
+        // Processes spawned through a SpawnServer are children of the
+        // server so wait for their exit codes to be written to their exit 
+        // file descriptors rather than reaping them here.
+        intptr_t pid = (intptr_t) process->process();
+        int exit_fd = (int) process->exit_fd();
+        int pidfd = exit_fd >= 0 ? exit_fd : (int) syscall( SYS_pidfd_open, (pid_t) pid, 0 );
+        if ( pidfd >= 0 )
+        {
+            Source* source = new Source;
+            source->fd = pidfd;
+            source->process = pid;
+            source->spawned = exit_fd >= 0;
+            source->filter = nullptr;
+            source->arguments = nullptr;
+            source->working_directory = nullptr;
+            source->exited = exited;
+            source->size = 0;
+            if ( add(source, pidfd) )
+            {
+                process->detach();
+                return true;
+            }
+
+            // The exit file descriptor is still owned by the Process that 
+            // the caller falls back to waiting for.
+            if ( exit_fd < 0 )
+            {
+                ::close( pidfd );
+            }
+        }
+    }
+#else
+    (void) exited;
+#endif
+    return false;
+}
+
+int Reactor::thread_main( Reactor* reactor )
+{
+    SWEET_ASSERT( reactor );
+    reactor->forge_->trace()->set_thread_name( "reactor" );
+    reactor->thread_process();
+    return EXIT_SUCCESS;
+}
+
+void Reactor::thread_process()
+{
+#if defined(BUILD_OS_LINUX)
+    const int MAXIMUM_EVENTS = 64;
+    struct epoll_event events [MAXIMUM_EVENTS];
+    for ( ;; )
+    {
+        int count = epoll_wait( epoll_fd_, events, MAXIMUM_EVENTS, -1 );
+        if ( count < 0 && errno == EINTR )
+        {
+            continue;
+        }
+
+        for ( int i = 0; i < count; ++i )
+        {
+            Source* source = reinterpret_cast<Source*>( events[i].data.ptr );
+            if ( !source )
+            {
+                return;
+            }
+
+            bool finished = source->process != 0 ? wait_process( source ) : read_pipe( source );
+            if ( finished )
+            {
+                remove( source );
+            }
+        }
+    }
+#endif
+}
+
+/**
+// Read available output from a pipe and pass the complete lines to the
+// Scheduler.
+//
+// Lines longer than the buffer are split at the buffer size as they are
+// when read by the Reader.
+//
+// @return
+//  True if the write end of the pipe has been closed and all output has
+//  been read otherwise false.
+*/
+bool Reactor::read_pipe( Source* source )
+{
+#if defined(BUILD_OS_LINUX)
+    SWEET_ASSERT( source );
+    ScopedTrace trace( forge_->trace(), "reader", "read" );
+    char* buffer = source->buffer;
+    char* end = buffer + sizeof(source->buffer) - 1;
+    char* pos = buffer + source->size;
+
+    ssize_t bytes = ::read( source->fd, pos, end - pos );
+    while ( bytes < 0 && errno == EINTR )
+    {
+        bytes = ::read( source->fd, pos, end - pos );
+    }
+    if ( bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) )
+    {
+        return false;
+    }
+
+    Scheduler* scheduler = forge_->scheduler();
+    if ( bytes <= 0 )
+    {
+        if ( bytes < 0 )
+        {
+            char message [1024];
+            scheduler->push_errorf( "Reading from a child process failed - %s", error::Error::format(errno, message, sizeof(message)) );
+        }
+        if ( source->size > 0 )
+        {
+            scheduler->push_output( string(buffer, pos), source->filter, source->arguments, source->working_directory );
+        }
+        scheduler->push_read_finished( source->filter, source->arguments );
+        return true;
+    }
+
+    forge_->statistics()->add( Statistics::COUNTER_BYTES_READ, uint64_t(bytes) );
+
+    // Pass all of the complete lines in the buffer to the Scheduler as one
+    // batch leaving any incomplete line at the end in the buffer.
+    char* start = buffer;
+    char* finish = pos + bytes;
+    char* newline = finish;
+    while ( newline > start && newline[-1] != '\n' )
+    {
+        --newline;
+    }
+    if ( newline > start )
+    {
+        scheduler->push_output( string(start, newline - 1), source->filter, source->arguments, source->working_directory );
+        start = newline;
+    }
+
+    if ( start > buffer )
+    {
+        memmove( buffer, start, finish - start );
+    }
+    else if ( finish >= end )
+    {
+        scheduler->push_output( string(start, finish), source->filter, source->arguments, source->working_directory );
+        start = finish;
+    }
+    source->size = finish - start;
+#else
+    (void) source;
+#endif
+    return false;
+}
+
+/**
+// Reap a child process whose pidfd has become readable or read the exit
+// code of a process spawned through a SpawnServer.
+//
+// @return
+//  True if the process has exited and been reaped otherwise false.
+*/
+bool Reactor::wait_process( Source* source )
+{
+#if defined(BUILD_OS_LINUX)
+    SWEET_ASSERT( source );
+    int exit_code = 0;
+    if ( source->spawned )
+    {
+        if ( !process::SpawnServer::exit_code(source->fd, &exit_code) )
+        {
+            forge_->scheduler()->push_errorf( "Waiting for a process failed - the spawn server exited" );
+            exit_code = EXIT_FAILURE;
+        }
+        source->exited( exit_code );
+        return true;
+    }
+
+    pid_t result = waitpid( (pid_t) source->process, &exit_code, WNOHANG );
+    while ( result < 0 && errno == EINTR )
+    {
+        result = waitpid( (pid_t) source->process, &exit_code, WNOHANG );
+    }
+    if ( result == 0 )
+    {
+        return false;
+    }
+    if ( result != (pid_t) source->process )
+    {
+        char message [1024];
+        forge_->scheduler()->push_errorf( "Waiting for a process failed - %s", error::Error::format(errno, message, sizeof(message)) );
+        exit_code = EXIT_FAILURE;
+    }
+    source->exited( exit_code );
+    return true;
+#else
+    (void) source;
+    return false;
+#endif
+}
+
+/**
+// Register a Source with the epoll instance.
+//
+// @return
+//  True if the Source was registered otherwise false, for example when 
+//  `epoll_ctl()` fails with ENOSPC or ENOMEM, in which case the Source is
+//  deleted but its file descriptor is left open for the caller to fall back
+//  to blocking on.
+*/
+bool Reactor::add( Source* source, int fd )
+{
+#if defined(BUILD_OS_LINUX)
+    SWEET_ASSERT( source );
+    struct epoll_event event;
+    memset( &event, 0, sizeof(event) );
+    event.events = EPOLLIN;
+    event.data.ptr = source;
+    ++sources_;
+    int result = epoll_ctl( epoll_fd_, EPOLL_CTL_ADD, fd, &event );
+    if ( result != 0 )
+    {
+        --sources_;
+        delete source;
+        return false;
+    }
+    return true;
+#else
+    (void) source;
+    (void) fd;
+    return false;
+#endif
+}
+
+void Reactor::remove( Source* source )
+{
+#if defined(BUILD_OS_LINUX)
+    SWEET_ASSERT( source );
+    epoll_ctl( epoll_fd_, EPOLL_CTL_DEL, source->fd, nullptr );
+    ::close( source->fd );
+    delete source;
+    --sources_;
+#else
+    (void) source;
+#endif
+}
+
+void Reactor::start()
+{
+#if defined(BUILD_OS_LINUX)
+    int pidfd = (int) syscall( SYS_pidfd_open, getpid(), 0 );
+    if ( pidfd < 0 )
+    {
+        return;
+    }
+    ::close( pidfd );
+
+    epoll_fd_ = epoll_create1( EPOLL_CLOEXEC );
+    wake_fd_ = eventfd( 0, EFD_CLOEXEC );
+    if ( epoll_fd_ >= 0 && wake_fd_ >= 0 )
+    {
+        struct epoll_event event;
+        memset( &event, 0, sizeof(event) );
+        event.events = EPOLLIN;
+        event.data.ptr = nullptr;
+        if ( epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event) == 0 )
+        {
+            thread_ = new std::thread( &Reactor::thread_main, this );
+            enabled_ = true;
+        }
+    }
+#endif
+}
+
+void Reactor::stop()
+{
+#if defined(BUILD_OS_LINUX)
+    if ( thread_ )
+    {
+        SWEET_ASSERT( sources_ == 0 );
+        uint64_t value = 1;
+        ssize_t written = ::write( wake_fd_, &value, sizeof(value) );
+        SWEET_ASSERT( written == sizeof(value) );
+        (void) written;
+
+        try
+        {
+            thread_->join();
+        }
+
+        catch ( const std::exception& exception )
+        {
+            forge_->errorf( "Failed to join thread - %s", exception.what() );
+        }
+
+        delete thread_;
+        thread_ = nullptr;
+    }
+
+    if ( wake_fd_ >= 0 )
+    {
+        ::close( wake_fd_ );
+        wake_fd_ = -1;
+    }
+
+    if ( epoll_fd_ >= 0 )
+    {
+        ::close( epoll_fd_ );
+        epoll_fd_ = -1;
+    }
+    enabled_ = false;
+#endif
+}
@@ -0,0 +1,72 @@
+#ifndef FORGE_REACTOR_HPP_INCLUDED
+#define FORGE_REACTOR_HPP_INCLUDED
+
+#include <functional>
+#include <atomic>
+#include <thread>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace sweet
+{
+
+namespace process
+{
+
+class Process;
+
+}
+
+namespace forge
+{
+
+class Target;
+class Filter;
+class Arguments;
+class Forge;
+
+/**
+// Multiplex reading the output of and waiting for child processes in a
+// single thread.
+//
+// On Linux every pipe to a child process and a pidfd for each child process
+// are registered with one epoll instance.  Output is split into lines in a
+// bounded buffer per pipe and passed to the Scheduler and child processes
+// that exit are reaped and reported to a callback.  On other platforms, or
+// on Linux kernels without pidfd support, this Reactor is disabled and the
+// Reader and Executor block threads in the blocking ThreadPool instead.
+*/
+class Reactor
+{
+    struct Source;
+
+    Forge* forge_; ///< The Forge that this Reactor is part of.
+    int epoll_fd_; ///< The epoll instance that pipes and pidfds are registered with.
+    int wake_fd_; ///< The eventfd used to wake the reactor thread to stop.
+    std::thread* thread_; ///< The reactor thread.
+    std::atomic<int> sources_; ///< The number of pipes and processes registered and not yet finished.
+    bool enabled_; ///< Whether or not this platform supports epoll and pidfds.
+
+    public:
+        Reactor( Forge* forge );
+        ~Reactor();
+        bool enabled() const;
+        bool read( intptr_t fd_or_handle, Filter* filter, Arguments* arguments, Target* working_directory );
+        bool wait( process::Process* process, const std::function<void (int)>& exited );
+
+    private:
+        static int thread_main( Reactor* reactor );
+        void thread_process();
+        bool read_pipe( Source* source );
+        bool wait_process( Source* source );
+        bool add( Source* source, int fd );
+        void remove( Source* source );
+        void start();
+        void stop();
+};
+
+}
+
+}
+
+#endif
@@ -6,10 +6,14 @@
 #include "Reader.hpp"
 #include "Scheduler.hpp"
 #include "Forge.hpp"
+#include "ThreadPool.hpp"
+#include "Reactor.hpp"
+#include "Trace.hpp"
+#include "Statistics.hpp"
 #include <error/Error.hpp>
 #include <assert/assert.hpp>
 #include <stdlib.h>
-#include <memory>
+#include <functional>
 
 #if defined(BUILD_OS_WINDOWS)
 #include <windows.h>
@@ -20,100 +24,62 @@
 #include <errno.h>
 #endif
 
-using std::find;
 using std::string;
-using std::vector;
-using std::unique_ptr;
 using namespace sweet;
 using namespace sweet::forge;
 
 Reader::Reader( Forge* forge )
-: forge_( forge ),
-  jobs_mutex_(),
-  jobs_empty_condition_(),
-  jobs_ready_condition_(),
-  jobs_(),
-  threads_(),
-  active_jobs_( 0 ),
-  done_( false )
+: forge_( forge )
 {
+    SWEET_ASSERT( forge_ );
 }
 
 Reader::~Reader()
 {
-    stop();
 }
 
 void Reader::read( intptr_t fd_or_handle, Filter* filter, Arguments* arguments, Target* working_directory )
 {
-    std::unique_lock<std::mutex> lock( jobs_mutex_ );
-    jobs_.push_back( std::bind(&Reader::thread_read, this, fd_or_handle, filter, arguments, working_directory) );
-    ++active_jobs_;
-    while ( active_jobs_ > int(threads_.size()) )
+    Reactor* reactor = forge_->reactor();
+    if ( reactor->enabled() && reactor->read(fd_or_handle, filter, arguments, working_directory) )
     {
-        unique_ptr<std::thread> thread( new std::thread(&Reader::thread_main, this) );
-        threads_.push_back( thread.release() );
-    }
-    jobs_ready_condition_.notify_all();
-}
-
-int Reader::thread_main( void* context )
-{
-    Reader* reader = reinterpret_cast<Reader*>( context );
-    SWEET_ASSERT( reader );
-    reader->thread_process();
-    return EXIT_SUCCESS;
-}
-
-void Reader::thread_process()
-{
-    std::unique_lock<std::mutex> lock( jobs_mutex_ );
-    while ( !done_ )
-    {
-        if ( !jobs_.empty() )
-        {
-            std::function<void()> function = jobs_.front();
-            jobs_.pop_front();
-            lock.unlock();
-            function();
-            lock.lock();
-            --active_jobs_;
-        }
-
-        if ( jobs_.empty() )
-        {
-            jobs_empty_condition_.notify_all();
-            jobs_ready_condition_.wait( lock );
-        }
+        return;
     }
+    forge_->blocking_thread_pool()->push( std::bind(&Reader::thread_read, this, fd_or_handle, filter, arguments, working_directory) );
 }
 
 void Reader::thread_read( intptr_t fd_or_handle, Filter* filter, Arguments* arguments, Target* working_directory )
 {
     SWEET_ASSERT( forge_ );
     
-    char buffer [1024];
+    ScopedTrace trace( forge_->trace(), "reader", "read" );
+    char buffer [8192];
     char* pos = buffer;
     char* end = buffer + sizeof(buffer) - 1;
 
+    uint64_t bytes_read = 0;
     size_t read = Reader::read( fd_or_handle, pos, end - pos );
     while ( read > 0 )
     {
+        bytes_read += read;
         char* start = buffer;
         char* finish = pos + read;
 
-        pos = find( start, finish, '\n' );
-        while ( pos != finish )
+        // Pass all of the complete lines read to the Scheduler as one batch.
+        char* newline = finish;
+        while ( newline > start && newline[-1] != '\n' )
         {
-            *pos = 0;
-            forge_->scheduler()->push_output( string(start, pos), filter, arguments, working_directory );
-            start = pos + 1;
-            pos = std::find( start, finish, '\n' );
+            --newline;
+        }
+        if ( newline > start )
+        {
+            forge_->scheduler()->push_output( string(start, newline - 1), filter, arguments, working_directory );
+            start = newline;
         }
 
         if ( start > buffer )
         {
-            memcpy( buffer, start, finish - start );
+            memmove( buffer, start, finish - start );
         }
         else if ( finish >= end )
         {
@@ -134,46 +100,10 @@ void Reader::thread_read( intptr_t fd_or_handle, Filter* filter, Arguments* argu
     }
 
     Reader::close( fd_or_handle );
+    forge_->statistics()->add( Statistics::COUNTER_BYTES_READ, bytes_read );
     forge_->scheduler()->push_read_finished( filter, arguments );
 }
 
-void Reader::stop()
-{
-    if ( !threads_.empty() )
-    {
-        {
-            std::unique_lock<std::mutex> lock( jobs_mutex_ );
-            if ( !jobs_.empty() )
-            {
-                jobs_empty_condition_.wait( lock );
-            }
-            done_ = true;
-            jobs_ready_condition_.notify_all();
-        }
-
-        for ( vector<std::thread*>::iterator i = threads_.begin(); i != threads_.end(); ++i )
-        {
-            try
-            {
-                std::thread* thread = *i;
-                SWEET_ASSERT( thread );
-                thread->join();
-            }
-
-            catch ( const std::exception& exception )
-            {
-                forge_->errorf( 0, "Failed to join thread - %s", exception.what() );
-            }
-        }
-        
-        while ( !threads_.empty() )
-        {
-            delete threads_.back();
-            threads_.pop_back();
-        }
-    }
-}
-
 /**
 // Read up to \e length bytes from the pipe specifed by \e fd_or_handle.
 //
@@ -0,0 +1,368 @@
+//
+// RemoteCache.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "RemoteCache.hpp"
+#include <assert/assert.hpp>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#if defined(BUILD_OS_WINDOWS)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET Socket;
+static const Socket NO_SOCKET = INVALID_SOCKET;
+#define close_socket closesocket
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+typedef int Socket;
+static const Socket NO_SOCKET = -1;
+#define close_socket ::close
+#endif
+
+#if defined(MSG_NOSIGNAL)
+static const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+static const int SEND_FLAGS = 0;
+#endif
+
+using std::string;
+using namespace sweet;
+using namespace sweet::forge;
+
+static const int TIMEOUT_SECONDS = 30;
+
+/**
+// Connect \e socket to \e address waiting at most TIMEOUT_SECONDS for the
+// connection to be made.
+//
+// The socket is made non-blocking for the duration of the connect and then
+// polled for the connection to complete so that an unreachable server 
+// fails within the timeout rather than the operating system's much longer
+// connect timeout.
+//
+// @return
+//  True if \e socket connected otherwise false.
+*/
+static bool connect_with_timeout( Socket socket, const struct sockaddr* address, socklen_t address_length )
+{
+#if defined(BUILD_OS_WINDOWS)
+    u_long non_blocking = 1;
+    if ( ::ioctlsocket(socket, FIONBIO, &non_blocking) != 0 )
+    {
+        return false;
+    }
+    bool connected = ::connect( socket, address, address_length ) == 0;
+    if ( !connected && ::WSAGetLastError() == WSAEWOULDBLOCK )
+    {
+        WSAPOLLFD poll_fd;
+        memset( &poll_fd, 0, sizeof(poll_fd) );
+        poll_fd.fd = socket;
+        poll_fd.events = POLLOUT;
+        int error = 0;
+        int error_length = sizeof(error);
+        connected = 
+            ::WSAPoll( &poll_fd, 1, TIMEOUT_SECONDS * 1000 ) == 1 &&
+            ::getsockopt( socket, SOL_SOCKET, SO_ERROR, (char*) &error, &error_length ) == 0 &&
+            error == 0
+        ;
+    }
+    non_blocking = 0;
+    return ::ioctlsocket( socket, FIONBIO, &non_blocking ) == 0 && connected;
+#else
+    int flags = ::fcntl( socket, F_GETFL, 0 );
+    if ( flags < 0 || ::fcntl(socket, F_SETFL, flags | O_NONBLOCK) != 0 )
+    {
+        return false;
+    }
+    bool connected = ::connect( socket, address, address_length ) == 0;
+    if ( !connected && errno == EINPROGRESS )
+    {
+        struct pollfd poll_fd;
+        memset( &poll_fd, 0, sizeof(poll_fd) );
+        poll_fd.fd = socket;
+        poll_fd.events = POLLOUT;
+        int polled = ::poll( &poll_fd, 1, TIMEOUT_SECONDS * 1000 );
+        while ( polled < 0 && errno == EINTR )
+        {
+            polled = ::poll( &poll_fd, 1, TIMEOUT_SECONDS * 1000 );
+        }
+        int error = 0;
+        socklen_t error_length = sizeof(error);
+        connected = 
+            polled == 1 &&
+            ::getsockopt( socket, SOL_SOCKET, SO_ERROR, &error, &error_length ) == 0 &&
+            error == 0
+        ;
+    }
+    return ::fcntl( socket, F_SETFL, flags ) == 0 && connected;
+#endif
+}
+
+RemoteCache::RemoteCache()
+: url_(),
+  host_(),
+  port_(),
+  prefix_(),
+  unreachable_( false )
+{
+#if defined(BUILD_OS_WINDOWS)
+    WSADATA data;
+    ::WSAStartup( MAKEWORD(2, 2), &data );
+#endif
+}
+
+RemoteCache::~RemoteCache()
+{
+#if defined(BUILD_OS_WINDOWS)
+    ::WSACleanup();
+#endif
+}
+
+/**
+// Set the URL of the remote cache.
+//
+// @param url
+//  The URL of the remote cache of the form `http://host[:port][/path]` or
+//  the empty string to disable the remote cache.
+//
+// @return
+//  True if the URL was set otherwise false if it isn't a valid URL (in
+//  which case the remote cache is disabled).
+*/
+bool RemoteCache::set_url( const std::string& url )
+{
+    url_.clear();
+    host_.clear();
+    port_.clear();
+    prefix_.clear();
+    unreachable_ = false;
+    if ( url.empty() )
+    {
+        return true;
+    }
+
+    const char SCHEME [] = "http://";
+    const size_t SCHEME_LENGTH = sizeof(SCHEME) - 1;
+    if ( url.compare(0, SCHEME_LENGTH, SCHEME) != 0 )
+    {
+        return false;
+    }
+
+    string::size_type slash = url.find( '/', SCHEME_LENGTH );
+    string authority = url.substr( SCHEME_LENGTH, slash != string::npos ? slash - SCHEME_LENGTH : string::npos );
+    string::size_type colon = authority.rfind( ':' );
+    string host = authority.substr( 0, colon );
+    string port = colon != string::npos ? authority.substr( colon + 1 ) : string( "80" );
+    if ( host.empty() || port.empty() || port.find_first_not_of("0123456789") != string::npos )
+    {
+        return false;
+    }
+
+    url_ = url;
+    host_ = host;
+    port_ = port;
+    prefix_ = slash != string::npos ? url.substr( slash ) : string();
+    while ( !prefix_.empty() && prefix_[prefix_.size() - 1] == '/' )
+    {
+        prefix_.erase( prefix_.size() - 1 );
+    }
+    return true;
+}
+
+/**
+// Get the URL of the remote cache.
+//
+// @return
+//  The URL or the empty string if the remote cache is disabled.
+*/
+const std::string& RemoteCache::url() const
+{
+    return url_;
+}
+
+/**
+// Is the remote cache enabled?
+//
+// @return
+//  True if the remote cache is enabled otherwise false.
+*/
+bool RemoteCache::enabled() const
+{
+    return !url_.empty();
+}
+
+/**
+// Get a blob from the remote cache.
+//
+// @param name
+//  The name of the blob to get.
+//
+// @param contents
+//  A string to return the contents of the blob in (assumed not null).
+//
+// @return
+//  True if the blob was found otherwise false.
+*/
+bool RemoteCache::get( const std::string& name, std::string* contents ) const
+{
+    SWEET_ASSERT( contents );
+    int status = 0;
+    return request( "GET", name, string(), &status, contents ) && status == 200;
+}
+
+/**
+// Put a blob into the remote cache.
+//
+// @param name
+//  The name of the blob to put.
+//
+// @param contents
+//  The contents of the blob.
+//
+// @return
+//  True if the blob was stored otherwise false.
+*/
+bool RemoteCache::put( const std::string& name, const std::string& contents ) const
+{
+    int status = 0;
+    string response;
+    return request( "PUT", name, contents, &status, &response ) && status >= 200 && status < 300;
+}
+
+bool RemoteCache::request( const char* method, const std::string& name, const std::string& body, int* status, std::string* response ) const
+{
+    SWEET_ASSERT( method );
+    SWEET_ASSERT( status );
+    SWEET_ASSERT( response );
+
+    if ( !enabled() || unreachable_ )
+    {
+        return false;
+    }
+
+    struct addrinfo hints;
+    memset( &hints, 0, sizeof(hints) );
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* addresses = nullptr;
+    if ( ::getaddrinfo(host_.c_str(), port_.c_str(), &hints, &addresses) != 0 )
+    {
+        unreachable_ = true;
+        return false;
+    }
+
+    Socket socket = NO_SOCKET;
+    for ( struct addrinfo* address = addresses; address && socket == NO_SOCKET; address = address->ai_next )
+    {
+        socket = ::socket( address->ai_family, address->ai_socktype, address->ai_protocol );
+        if ( socket != NO_SOCKET && !connect_with_timeout(socket, address->ai_addr, socklen_t(address->ai_addrlen)) )
+        {
+            close_socket( socket );
+            socket = NO_SOCKET;
+        }
+    }
+    ::freeaddrinfo( addresses );
+    if ( socket == NO_SOCKET )
+    {
+        unreachable_ = true;
+        return false;
+    }
+
+    // Time out sends and receives so that an unresponsive server turns into
+    // cache misses rather than stalling the build.
+#if defined(BUILD_OS_WINDOWS)
+    DWORD timeout = TIMEOUT_SECONDS * 1000;
+#else
+    struct timeval timeout = { TIMEOUT_SECONDS, 0 };
+#endif
+    ::setsockopt( socket, SOL_SOCKET, SO_RCVTIMEO, (const char*) &timeout, sizeof(timeout) );
+    ::setsockopt( socket, SOL_SOCKET, SO_SNDTIMEO, (const char*) &timeout, sizeof(timeout) );
+    int no_delay = 1;
+    ::setsockopt( socket, IPPROTO_TCP, TCP_NODELAY, (const char*) &no_delay, sizeof(no_delay) );
+#if defined(SO_NOSIGPIPE)
+    int no_sigpipe = 1;
+    ::setsockopt( socket, SOL_SOCKET, SO_NOSIGPIPE, (const char*) &no_sigpipe, sizeof(no_sigpipe) );
+#endif
+
+    char content_length [64];
+    snprintf( content_length, sizeof(content_length), "Content-Length: %llu\r\n", (unsigned long long) body.size() );
+    string message = string( method ) + " " + prefix_ + "/" + name + " HTTP/1.1\r\n";
+    message += "Host: " + host_ + "\r\n";
+    message += content_length;
+    message += "Connection: close\r\n\r\n";
+    message += body;
+
+    bool sent = true;
+    size_t position = 0;
+    while ( position < message.size() && sent )
+    {
+        int written = int(::send( socket, message.data() + position, int(message.size() - position), SEND_FLAGS ));
+        sent = written > 0;
+        position += sent ? size_t(written) : 0;
+    }
+
+    string received;
+    if ( sent )
+    {
+        char buffer [64 * 1024];
+        int size = int(::recv( socket, buffer, sizeof(buffer), 0 ));
+        while ( size > 0 )
+        {
+            received.append( buffer, size );
+            size = int(::recv( socket, buffer, sizeof(buffer), 0 ));
+        }
+        sent = size == 0;
+    }
+    close_socket( socket );
+
+    // Parse the status line and headers and then return the body, trimmed to
+    // the Content-Length header if there is one.
+    string::size_type headers_end = received.find( "\r\n\r\n" );
+    if ( !sent || received.compare(0, 5, "HTTP/") != 0 || headers_end == string::npos )
+    {
+        return false;
+    }
+
+    string::size_type space = received.find( ' ' );
+    *status = space < headers_end ? atoi( received.c_str() + space + 1 ) : 0;
+    string::size_type body_start = headers_end + 4;
+    string::size_type body_size = received.size() - body_start;
+    string::size_type line = received.find( "\r\n" );
+    while ( line < headers_end )
+    {
+        const char CONTENT_LENGTH [] = "content-length:";
+        const size_t CONTENT_LENGTH_SIZE = sizeof(CONTENT_LENGTH) - 1;
+        line += 2;
+        bool content_length = line + CONTENT_LENGTH_SIZE < headers_end;
+        for ( size_t i = 0; i < CONTENT_LENGTH_SIZE && content_length; ++i )
+        {
+            content_length = tolower( received[line + i] ) == CONTENT_LENGTH[i];
+        }
+        if ( content_length )
+        {
+            string::size_type size = string::size_type( strtoull(received.c_str() + line + CONTENT_LENGTH_SIZE, nullptr, 10) );
+            if ( size > body_size )
+            {
+                return false;
+            }
+            body_size = size;
+        }
+        line = received.find( "\r\n", line );
+    }
+
+    response->assign( received, body_start, body_size );
+    return true;
+}
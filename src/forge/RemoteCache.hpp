@@ -0,0 +1,52 @@
+#ifndef FORGE_REMOTECACHE_HPP_INCLUDED
+#define FORGE_REMOTECACHE_HPP_INCLUDED
+
+#include <string>
+#include <atomic>
+
+namespace sweet
+{
+
+namespace forge
+{
+
+/**
+// Get and put named blobs in a remote cache over HTTP.
+//
+// The protocol is plain HTTP/1.1 GET and PUT of `<url>/<name>` so that any
+// server that stores and serves files (including the `forge_cache`
+// reference server) can act as a remote cache.  Each request opens its own
+// connection so that requests made from several threads at once proceed
+// independently.  Requests that fail for any reason are treated as misses
+// and once a connection to the server can't be made the remote cache is
+// skipped for the rest of the run so that an unreachable server doesn't
+// delay every command by a connection timeout.
+//
+// Only the `http` scheme is supported.
+*/
+class RemoteCache
+{
+    std::string url_; ///< The URL of the remote cache or empty if the remote cache is disabled.
+    std::string host_; ///< The host parsed from the URL.
+    std::string port_; ///< The port parsed from the URL.
+    std::string prefix_; ///< The path parsed from the URL that names are appended to.
+    mutable std::atomic<bool> unreachable_; ///< Whether or not a connection to the remote cache has failed.
+
+public:
+    RemoteCache();
+    ~RemoteCache();
+    bool set_url( const std::string& url );
+    const std::string& url() const;
+    bool enabled() const;
+    bool get( const std::string& name, std::string* contents ) const;
+    bool put( const std::string& name, const std::string& contents ) const;
+
+private:
+    bool request( const char* method, const std::string& name, const std::string& body, int* status, std::string* response ) const;
+};
+
+}
+
+}
+
+#endif
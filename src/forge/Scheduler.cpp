@@ -10,20 +10,25 @@
 #include "Job.hpp"
 #include "Context.hpp"
 #include "Executor.hpp"
+#include "ThreadPool.hpp"
+#include "Trace.hpp"
+#include "Statistics.hpp"
+#include "ActionCache.hpp"
 #include "Reader.hpp"
 #include "Filter.hpp"
 #include "Arguments.hpp"
+#include "path_functions.hpp"
 #include <process/Environment.hpp>
 #include <luaxx/luaxx.hpp>
 #include <error/ErrorPolicy.hpp>
-#include <list>
+#include <deque>
 #include <string>
 #include <memory>
 #include <algorithm>
 #include <lua.hpp>
+#include <ctype.h>
 
 using std::sort;
-using std::list;
 using std::vector;
 using std::string;
 using std::unique_ptr;
@@ -38,8 +43,12 @@ Scheduler::Scheduler( Forge* forge )
   results_mutex_(),
   results_condition_(),
   results_(),
+  buildfiles_stack_(),
+  ready_jobs_(),
+  postorder_jobs_( 0 ),
   execute_jobs_( 0 ),
   read_jobs_( 0 ),
+  transfer_jobs_( 0 ),
   buildfile_calls_( 0 ),
   failures_( 0 )
 {
@@ -50,6 +59,9 @@ void Scheduler::load( const boost::filesystem::path& path )
 {
     SWEET_ASSERT( path.is_absolute() );
 
+    ScopedTrace trace( forge_->trace(), "buildfile", "load", path.generic_string().c_str() );
+    ScopedPhase phase( forge_->statistics(), Statistics::PHASE_LOAD );
+    forge_->statistics()->add( Statistics::COUNTER_BUILDFILES );
     Context* context = allocate_context( forge_->graph()->target(path.parent_path().generic_string()) );
     process_begin( context );
     lua_State* lua_state = context->lua_state();
@@ -83,6 +95,9 @@ int Scheduler::buildfile( const boost::filesystem::path& path )
     SWEET_ASSERT( path.is_absolute() );
     SWEET_ASSERT( !active_contexts_.empty() );
 
+    ScopedTrace trace( forge_->trace(), "buildfile", "buildfile", path.generic_string().c_str() );
+    ScopedPhase phase( forge_->statistics(), Statistics::PHASE_LOAD );
+    forge_->statistics()->add( Statistics::COUNTER_BUILDFILES );
     Target* buildfile = forge_->graph()->target( path.generic_string() );
     Target* working_directory = buildfile->parent();
     SWEET_ASSERT( forge_->graph()->target(path.parent_path().generic_string()) == working_directory );
@@ -122,6 +137,8 @@ void Scheduler::postorder_visit( int function, Job* job )
 
     if ( job->target()->buildable() )
     {
+        Trace* trace = forge_->trace();
+        ScopedTrace scoped_trace( trace, "postorder", "visit", trace->enabled() ? job->target()->path().c_str() : nullptr );
         Context* context = allocate_context( job->working_directory(), job );
         process_begin( context );
 
@@ -143,7 +160,7 @@ void Scheduler::postorder_visit( int function, Job* job )
     {
         forge_->error( job->target()->failed_dependencies().c_str() );
         job->target()->set_successful( false );
-        job->set_state( JOB_COMPLETE );
+        complete_job( job );
     }    
 }
 
@@ -151,6 +168,9 @@ void Scheduler::execute_finished( int exit_code, Context* context, process::Envi
 {
     SWEET_ASSERT( context );
 
+    ScopedTrace trace( forge_->trace(), "lua", "resume" );
+    forge_->action_cache()->exited( context, exit_code );
+
     process_begin( context );
     lua_State* lua_state = context->lua_state();
     lua_pushinteger( lua_state, exit_code );
@@ -167,6 +187,10 @@ void Scheduler::read_finished( Filter* filter, Arguments* arguments )
     // Delete filters and arguments on the main thread to avoid accessing the
     // Lua virtual machine from multiple threads as happens if the filter or 
     // arguments are deleted in the worker threads provided by the Executor.  
+    if ( filter && filter->action() )
+    {
+        forge_->action_cache()->finished( filter->action() );
+    }
     delete filter;
     delete arguments;
 }
@@ -185,16 +209,51 @@ void Scheduler::buildfile_finished( Context* context, bool success )
     }
 }
 
+/**
+// Pass a batch of lines of output from a child process to a filter.
+//
+// Native filters are handled by `Scheduler::dependencies()`.  Batch filters
+// are called once with a table of the lines.  Other filters are called once
+// for each line.  Output without a filter, or with a filter that only
+// captures output for the ActionCache, is printed.
+//
+// @param output
+//  One or more lines of output separated by newlines.
+*/
 void Scheduler::output( const std::string& output, Filter* filter, Arguments* arguments, Target* working_directory )
 {
     SWEET_ASSERT( forge_ );
-    if ( filter )
+    ScopedTrace trace( forge_->trace(), "lua", "filter" );
+    ScopedPhase phase( forge_->statistics(), Statistics::PHASE_FILTER );
+    forge_->statistics()->add( Statistics::COUNTER_LINES, 1 + std::count(output.begin(), output.end(), '\n') );
+    if ( filter && filter->action() )
+    {
+        filter->action()->append( filter->stream(), output );
+    }
+
+    if ( filter && filter->target() )
+    {
+        dependencies( output, filter, working_directory );
+    }
+    else if ( filter && filter->reference() != LUA_NOREF && filter->batch() )
     {
         Context* context = allocate_context( working_directory );
         process_begin( context );
         lua_State* lua_state = context->lua_state();
         lua_rawgeti( lua_state, LUA_REGISTRYINDEX, filter->reference() );
-        lua_pushlstring( lua_state, output.c_str(), output.size() );
+        lua_newtable( lua_state );
+        int index = 1;
+        string::size_type start = 0;
+        string::size_type finish = output.find( '\n' );
+        while ( finish != string::npos )
+        {
+            lua_pushlstring( lua_state, output.c_str() + start, finish - start );
+            lua_rawseti( lua_state, -2, index++ );
+            start = finish + 1;
+            finish = output.find( '\n', start );
+        }
+        lua_pushlstring( lua_state, output.c_str() + start, output.size() - start );
+        lua_rawseti( lua_state, -2, index );
         int parameters = 1;
         if ( arguments )
         {
@@ -203,18 +262,170 @@ void Scheduler::output( const std::string& output, Filter* filter, Arguments* ar
         resume( lua_state, parameters );
         process_end( context );
     }
+    else if ( filter && filter->reference() != LUA_NOREF )
+    {
+        string::size_type start = 0;
+        string::size_type finish = 0;
+        do
+        {
+            finish = output.find( '\n', start );
+            string::size_type length = finish != string::npos ? finish - start : output.size() - start;
+            Context* context = allocate_context( working_directory );
+            process_begin( context );
+            lua_State* lua_state = context->lua_state();
+            lua_rawgeti( lua_state, LUA_REGISTRYINDEX, filter->reference() );
+            lua_pushlstring( lua_state, output.c_str() + start, length );
+            int parameters = 1;
+            if ( arguments )
+            {
+                parameters += arguments->push_arguments( lua_state );
+            }
+            resume( lua_state, parameters );
+            process_end( context );
+            start = finish + 1;
+        }
+        while ( finish != string::npos );
+    }
     else
     {    
         forge_->output( output.c_str() );
     }
 }
 
+/**
+// Filter lines written by the build hooks library without calling into Lua.
+//
+// Lines of the form "== read 'path'" add the file at path as an implicit
+// dependency of the filter's Target and, for filters that add filenames, 
+// lines of the form "== write 'path'" add path as a filename of that 
+// Target.  Files outside of the filter's directory are ignored.  Lines that
+// don't start with "==" are printed.
+//
+// @param output
+//  One or more lines of output separated by newlines.
+*/
+void Scheduler::dependencies( const std::string& output, Filter* filter, Target* working_directory )
+{
+    SWEET_ASSERT( forge_ );
+    SWEET_ASSERT( filter );
+    SWEET_ASSERT( filter->target() );
+    SWEET_ASSERT( working_directory );
+
+    Target* target = filter->target();
+    Graph* graph = forge_->graph();
+    string::size_type start = 0;
+    string::size_type finish = 0;
+    do
+    {
+        finish = output.find( '\n', start );
+        string::size_type end = finish != string::npos ? finish : output.size();
+        if ( output.compare(start, 2, "==") != 0 )
+        {
+            forge_->output( output.substr(start, end - start).c_str() );
+        }
+        else if ( output.compare(start, 3, "== ") == 0 )
+        {
+            string::size_type operation = start + 3;
+            string::size_type operation_end = operation;
+            while ( operation_end < end && isalpha((unsigned char) output[operation_end]) )
+            {
+                ++operation_end;
+            }
+
+            string::size_type path = operation_end + 2;
+            string::size_type path_end = output.find( '\'', path );
+            bool matched = 
+                operation_end > operation &&
+                output.compare( operation_end, 2, " '" ) == 0 &&
+                path_end < end
+            ;
+            if ( matched )
+            {
+                bool read = output.compare( operation, operation_end - operation, "read" ) == 0;
+                bool write = output.compare( operation, operation_end - operation, "write" ) == 0;
+                if ( read || filter->filenames() )
+                {
+                    string filename = output.substr( path, path_end - path );
+                    boost::filesystem::path absolute_path = forge::absolute( filename, working_directory->path() );
+                    bool within_directory = forge::relative( absolute_path, filter->directory() ).generic_string().find( ".." ) == string::npos;
+                    if ( within_directory && write )
+                    {
+                        target->add_filename( filename );
+                    }
+                    else if ( within_directory )
+                    {
+                        Target* source_file = graph->add_or_find_target( absolute_path.generic_string(), working_directory );
+                        if ( !source_file->working_directory() )
+                        {
+                            source_file->set_working_directory( working_directory );
+                        }
+                        if ( source_file->filenames().empty() || source_file->filename(0).empty() )
+                        {
+                            source_file->set_filename( source_file->path(), 0 );
+                        }
+                        source_file->set_cleanable( false );
+                        target->add_implicit_dependency( source_file );
+                    }
+                }
+            }
+        }
+        start = end + 1;
+    }
+    while ( finish != string::npos );
+}
+
 void Scheduler::error( const std::string& what )
 {
     SWEET_ASSERT( forge_ );
     forge_->error( what.c_str() );
 }
 
+void Scheduler::thread_transfer( std::function<void ()> transfer, std::function<void ()> finished )
+{
+    transfer();
+    push_transfer_finished( finished );
+}
+
+/**
+// Replay the output of a command restored from the ActionCache.
+//
+// The captured output is passed through the same filters, and the same 
+// results are queued, as if the command had been executed so that 
+// implicit dependencies and exit codes are handled identically.
+*/
+void Scheduler::restore( Action* action, process::Environment* environment, Filter* dependencies_filter, Filter* stdout_filter, Filter* stderr_filter, Arguments* arguments, Context* context )
+{
+    SWEET_ASSERT( action );
+    SWEET_ASSERT( context );
+
+    Filter* filters [Action::STREAM_COUNT] = { dependencies_filter, stdout_filter, stderr_filter };
+    action->add_pending();
+    for ( int stream = 0; stream < Action::STREAM_COUNT; ++stream )
+    {
+        // Executor only reads the dependencies pipe when there's a filter to
+        // pass its output to; the stdout and stderr pipes are always read.
+        if ( stream != Action::STREAM_DEPENDENCIES || filters[stream] )
+        {
+            {
+                std::unique_lock<std::mutex> lock( results_mutex_ );
+                ++read_jobs_;
+            }
+            const string& output = action->stream( stream );
+            if ( !output.empty() )
+            {
+                push_output( output, filters[stream], arguments, context->working_directory() );
+            }
+            push_read_finished( filters[stream], arguments );
+        }
+    }
+
+    {
+        std::unique_lock<std::mutex> lock( results_mutex_ );
+        ++execute_jobs_;
+    }
+    push_execute_finished( 0, context, environment );
+}
+
 void Scheduler::push_output( const std::string& output, Filter* filter, Arguments* arguments, Target* working_directory )
 {
     std::unique_lock<std::mutex> lock( results_mutex_ );
@@ -251,9 +462,70 @@ void Scheduler::push_read_finished( Filter* filter, Arguments* arguments )
     results_condition_.notify_all();
 }
 
+void Scheduler::push_transfer_finished( const std::function<void ()>& finished )
+{
+    std::unique_lock<std::mutex> lock( results_mutex_ );
+    --transfer_jobs_;
+    if ( finished )
+    {
+        results_.push_back( finished );
+    }
+    results_condition_.notify_all();
+}
+
 void Scheduler::execute( const std::string& command, const std::string& command_line, process::Environment* environment, Filter* dependencies_filter, Filter* stdout_filter, Filter* stderr_filter, Arguments* arguments, Context* context )
 {
     SWEET_ASSERT( !command.empty() );
+    SWEET_ASSERT( context );
+
+    // Look up local misses in the remote action cache on the ThreadPool and
+    // continue once the entry, if any, has been downloaded.
+    ActionCache* action_cache = forge_->action_cache();
+    Action* action = action_cache->begin( command, command_line, dependencies_filter != nullptr, context );
+    if ( action && action->entry().empty() && action_cache->remote() )
+    {
+        transfer( 
+            std::bind(&ActionCache::download, action_cache, action->key()),
+            std::bind(&Scheduler::execute_action, this, action, command, command_line, environment, dependencies_filter, stdout_filter, stderr_filter, arguments, context)
+        );
+        return;
+    }
+    execute_action( action, command, command_line, environment, dependencies_filter, stdout_filter, stderr_filter, arguments, context );
+}
+
+void Scheduler::execute_action( Action* action, const std::string& command, const std::string& command_line, process::Environment* environment, Filter* dependencies_filter, Filter* stdout_filter, Filter* stderr_filter, Arguments* arguments, Context* context )
+{
+    if ( action && action->entry().empty() && forge_->action_cache()->remote() )
+    {
+        forge_->action_cache()->lookup( action );
+    }
+
+    if ( action && !action->entry().empty() )
+    {
+        if ( forge_->action_cache()->restore(action) )
+        {
+            restore( action, environment, dependencies_filter, stdout_filter, stderr_filter, arguments, context );
+            return;
+        }
+        action->set_entry( string() );
+    }
+
+    if ( action )
+    {
+        stdout_filter = stdout_filter ? stdout_filter : new Filter;
+        stderr_filter = stderr_filter ? stderr_filter : new Filter;
+        if ( dependencies_filter )
+        {
+            dependencies_filter->set_action( action, Action::STREAM_DEPENDENCIES );
+            action->add_pending();
+        }
+        stdout_filter->set_action( action, Action::STREAM_STDOUT );
+        stderr_filter->set_action( action, Action::STREAM_STDERR );
+        action->add_pending();
+        action->add_pending();
+        action->add_pending();
+    }
+
     std::unique_lock<std::mutex> lock( results_mutex_ );
     forge_->executor()->execute( command, command_line, environment, dependencies_filter, stdout_filter, stderr_filter, arguments, context );
     ++execute_jobs_;
@@ -266,6 +538,26 @@ void Scheduler::read( intptr_t fd_or_handle, Filter* filter, Arguments* argument
     ++read_jobs_;
 }
 
+/**
+// Transfer to or from the remote action cache in the ThreadPool.
+//
+// @param transfer
+//  The function that makes the transfer (called from a thread in the
+//  ThreadPool).
+//
+// @param finished
+//  The function to call from the main thread once the transfer has finished
+//  or an empty function to ignore the transfer finishing.
+*/
+void Scheduler::transfer( const std::function<void ()>& transfer, const std::function<void ()>& finished )
+{
+    {
+        std::unique_lock<std::mutex> lock( results_mutex_ );
+        ++transfer_jobs_;
+    }
+    forge_->thread_pool()->push( std::bind(&Scheduler::thread_transfer, this, transfer, finished) );
+}
+
 void Scheduler::wait()
 {
     while ( dispatch_results() )
@@ -298,7 +590,7 @@ int Scheduler::postorder( Target* target, int function )
     struct Postorder
     {
         Forge* forge_;
-        list<Job> jobs_;
+        std::deque<Job> jobs_;
         int failures_;
         
         Postorder( Forge* forge )
@@ -314,46 +606,10 @@ int Scheduler::postorder( Target* target, int function )
         {
             forge_->graph()->end_traversal();
         }
-    
-        void remove_complete_jobs()
-        {
-            list<Job>::iterator job = jobs_.begin();
-            while ( job != jobs_.end() )
-            {
-                if ( job->state() == JOB_COMPLETE )
-                {
-                    job = jobs_.erase( job );
-                }
-                else
-                {
-                    ++job;
-                }
-            }
-        }
-
-        Job* pull_job()
-        {
-            int height = INT_MAX;
-            list<Job>::iterator job = jobs_.begin();
-
-            while ( job != jobs_.end() && (job->state() != JOB_WAITING || job->height() > height) )
-            {
-                height = std::min( height, job->height() );
-                ++job;
-            }
 
-            if ( job != jobs_.end() )
-            {
-                SWEET_ASSERT( job->state() == JOB_WAITING );
-                job->set_state( JOB_PROCESSING );
-            }
-
-            return job != jobs_.end() ? &(*job) : NULL;
-        }
-        
-        bool empty() const
+        std::deque<Job>& jobs()
         {
-            return jobs_.empty();
+            return jobs_;
         }
 
         int failures() const
@@ -361,6 +617,14 @@ int Scheduler::postorder( Target* target, int function )
             return failures_;
         }
 
+        void calculate_critical_paths()
+        {
+            for ( std::deque<Job>::reverse_iterator job = jobs_.rbegin(); job != jobs_.rend(); ++job )
+            {
+                job->calculate_critical_path();
+            }
+        }
+
         void visit( Target* target )
         {
             SWEET_ASSERT( target );
@@ -370,6 +634,7 @@ int Scheduler::postorder( Target* target, int function )
                 ScopedVisit visit( target );
 
                 int height = 0;
+                vector<Job*> dependencies;
                 int i = 0;
                 Target* dependency = target->any_dependency( i );
                 while ( dependency )
@@ -378,6 +643,7 @@ int Scheduler::postorder( Target* target, int function )
                     {
                         Postorder::visit( dependency );
                         height = std::max( height, dependency->postorder_height() + 1 );
+                        dependencies.push_back( dependency->postorder_job() );
                     }
                     else
                     {
@@ -390,14 +656,22 @@ int Scheduler::postorder( Target* target, int function )
                     dependency = target->any_dependency( i );
                 }
 
-                if ( target->referenced_by_script() && target->working_directory() )
+                // Targets that aren't visited still get a Job so that the 
+                // Jobs that depend on them wait for the Jobs that they depend
+                // on to complete.  Their postorder height is recorded as 
+                // normal so that dependent heights remain those of the full
+                // graph.
+                bool visit_target = target->referenced_by_script() && target->working_directory();
+                jobs_.push_back( Job(target, height, visit_target) );
+                Job* job = &jobs_.back();
+                for ( vector<Job*>::const_iterator j = dependencies.begin(); j != dependencies.end(); ++j )
                 {
-                    target->set_postorder_height( height );
-                    jobs_.push_back( Job(target, height) );
+                    job->add_dependency( *j );
                 }
-                else
+                target->set_postorder_job( job );
+                target->set_postorder_height( height );
+                if ( !visit_target )
                 {
-                    target->set_postorder_height( -1 );
                     target->set_successful( true );
                 }
             }
@@ -411,21 +685,42 @@ int Scheduler::postorder( Target* target, int function )
         return 0;
     }
     
+    ScopedTrace trace( forge_->trace(), "postorder", "postorder" );
+    ScopedPhase phase( forge_->statistics(), Statistics::PHASE_POSTORDER );
     Postorder postorder( forge_ );
     postorder.visit( target ? target : graph->root_target() );
     failures_ = postorder.failures();
     if ( failures_ == 0 )
     {
-        postorder.remove_complete_jobs();
-        while ( !postorder.empty() )
+        postorder.calculate_critical_paths();
+
+        // Collect the Jobs that are initially ready before pushing any of 
+        // them because pushing a Job that doesn't visit its Target completes
+        // it immediately and may make Jobs later in the postorder ready, and
+        // pushed, before this loop reaches them.
+        std::deque<Job>& jobs = postorder.jobs();
+        ready_jobs_.clear();
+        postorder_jobs_ = int(jobs.size());
+        vector<Job*> initially_ready_jobs;
+        for ( std::deque<Job>::iterator job = jobs.begin(); job != jobs.end(); ++job )
+        {
+            if ( job->ready() )
+            {
+                initially_ready_jobs.push_back( &(*job) );
+            }
+        }
+        for ( vector<Job*>::const_iterator job = initially_ready_jobs.begin(); job != initially_ready_jobs.end(); ++job )
+        {
+            push_ready_job( *job );
+        }
+
+        while ( postorder_jobs_ > 0 )
         {
-            postorder.remove_complete_jobs();
-            Job* job = postorder.pull_job();
+            Job* job = pull_ready_job();
             while ( job )
             {
                 postorder_visit( function, job );
-                postorder.remove_complete_jobs();
-                job = postorder.pull_job();
+                job = pull_ready_job();
             }
             dispatch_results();
         }
@@ -456,7 +751,7 @@ void Scheduler::free_context( Context* context )
     Job* job = context->job();
     if ( job )
     {
-        job->set_state( JOB_COMPLETE );
+        complete_job( job );
     }
 
     delete context;
@@ -469,8 +764,8 @@ void Scheduler::destroy_context( Context* context )
     Job* job = context->job();
     if ( job )
     {
-        job->set_state( JOB_COMPLETE );
         job->target()->set_successful( false );
+        complete_job( job );
     }
 
     delete context;
@@ -481,7 +776,7 @@ bool Scheduler::dispatch_results()
     std::unique_lock<std::mutex> lock( results_mutex_ );
     if ( results_.empty() )
     {
-        if ( execute_jobs_ > 0 || read_jobs_ > 0 )
+        if ( execute_jobs_ > 0 || read_jobs_ > 0 || transfer_jobs_ > 0 )
         {
             results_condition_.wait( lock );            
         }
@@ -496,7 +791,109 @@ bool Scheduler::dispatch_results()
         lock.lock();
     }
     
-    return execute_jobs_ > 0 || read_jobs_ > 0;
+    return execute_jobs_ > 0 || read_jobs_ > 0 || transfer_jobs_ > 0;
+}
+
+/**
+// Queue a Job whose dependencies have all completed.
+//
+// Jobs that don't visit their Target are completed immediately, possibly
+// making the Jobs that depend on them ready in turn.
+//
+// @param job
+//  The Job to queue.
+*/
+void Scheduler::push_ready_job( Job* job )
+{
+    SWEET_ASSERT( job );
+    SWEET_ASSERT( job->ready() );
+    SWEET_ASSERT( job->state() == JOB_WAITING );
+
+    // Decide whether or not the Target is outdated again now that its 
+    // dependencies have been visited so that Targets whose dependencies were
+    // rebuilt without changing are cut off from being rebuilt.
+    if ( forge_->graph()->content_digests() )
+    {
+        job->target()->rebind_to_dependencies();
+    }
+
+    if ( job->visit() )
+    {
+        ready_jobs_.push_back( job );
+        std::push_heap( ready_jobs_.begin(), ready_jobs_.end(), &Scheduler::lower_priority );
+    }
+    else
+    {
+        job->set_state( JOB_PROCESSING );
+        complete_job( job );
+    }
+}
+
+/**
+// Pull the highest priority Job that is ready to be processed.
+//
+// @return
+//  The Job to process next or null if there are no Jobs ready.
+*/
+Job* Scheduler::pull_ready_job()
+{
+    if ( ready_jobs_.empty() )
+    {
+        return NULL;
+    }
+
+    std::pop_heap( ready_jobs_.begin(), ready_jobs_.end(), &Scheduler::lower_priority );
+    Job* job = ready_jobs_.back();
+    ready_jobs_.pop_back();
+    SWEET_ASSERT( job->state() == JOB_WAITING );
+    job->set_state( JOB_PROCESSING );
+    return job;
+}
+
+/**
+// Complete a Job and queue any Jobs that depended on it and are now ready.
+//
+// @param job
+//  The Job to complete.
+*/
+void Scheduler::complete_job( Job* job )
+{
+    SWEET_ASSERT( job );
+    SWEET_ASSERT( job->state() == JOB_PROCESSING );
+    SWEET_ASSERT( postorder_jobs_ > 0 );
+
+    // Record the time taken to build Targets that were outdated and built 
+    // successfully by this visit so that the Jobs on the heaviest paths can 
+    // be prioritized the next time they are built.
+    Target* target = job->target();
+    if ( job->visit() && target->outdated() && target->built() )
+    {
+        target->set_duration( job->duration() );
+        if ( forge_->graph()->content_digests() )
+        {
+            target->update_digests();
+        }
+    }
+
+    job->set_state( JOB_COMPLETE );
+    --postorder_jobs_;
+
+    const vector<Job*>& dependents = job->dependents();
+    for ( vector<Job*>::const_iterator i = dependents.begin(); i != dependents.end(); ++i )
+    {
+        Job* dependent = *i;
+        if ( dependent->complete_dependency() )
+        {
+            push_ready_job( dependent );
+        }
+    }
+}
+
+bool Scheduler::lower_priority( const Job* lhs, const Job* rhs )
+{
+    SWEET_ASSERT( lhs );
+    SWEET_ASSERT( rhs );
+    return *lhs < *rhs;
 }
 
 void Scheduler::process_begin( Context* context )
@@ -640,6 +1037,7 @@ void Scheduler::resume( lua_State* lua_state, int parameters )
     SWEET_ASSERT( lua_state );
     SWEET_ASSERT( parameters >= 0 );
 
+    forge_->statistics()->add( Statistics::COUNTER_RESUMES );
     int result = lua_resume( lua_state, nullptr, parameters );
     switch ( result )
     {
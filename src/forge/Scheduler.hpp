@@ -27,6 +27,7 @@ class Job;
 class Context;
 class Arguments;
 class Filter;
+class Action;
 class Target;
 class Forge;
 
@@ -43,8 +44,11 @@ class Scheduler
     std::condition_variable results_condition_; ///< The Condition that is used to wait for results.
     std::deque<std::function<void()> > results_; ///< The functions to be executed as a result of jobs processing in the thread pool.
     std::vector<Target*> buildfiles_stack_; ///< The stack of currently processing buildfiles.
+    std::vector<Job*> ready_jobs_; ///< The heap of Jobs whose dependencies have completed in the current postorder traversal.
+    int postorder_jobs_; ///< The number of Jobs in the current postorder traversal that haven't completed.
     int execute_jobs_; ///< The number of outstanding execute jobs.
     int read_jobs_; ///< The number of outstanding read jobs.
+    int transfer_jobs_; ///< The number of outstanding transfers to and from the remote action cache.
     int buildfile_calls_; ///< The number of outstanding calls made to load buildfiles.
     int failures_; ///< The number of failures in the most recent postorder traversal.
 
@@ -61,15 +65,18 @@ class Scheduler
         void read_finished( Filter* filter, Arguments* arguments );
         void buildfile_finished( Context* context, bool success );
         void output( const std::string& output, Filter* filter, Arguments* arguments, Target* working_directory );
+        void dependencies( const std::string& output, Filter* filter, Target* working_directory );
         void error( const std::string& what );
 
         void push_output( const std::string& output, Filter* filter, Arguments* arguments, Target* working_directory );
         void push_errorf( const char* format, ... );
         void push_execute_finished( int exit_code, Context* context, process::Environment* environment );
         void push_read_finished( Filter* filter, Arguments* arguments );
+        void push_transfer_finished( const std::function<void ()>& finished );
 
         void execute( const std::string& command, const std::string& command_line, process::Environment* environment, Filter* dependencies_filter, Filter* stdout_filter, Filter* stderr_filter, Arguments* arguments, Context* context );
         void read( intptr_t fd_or_handle, Filter* filter, Arguments* arguments, Target* working_directory );
+        void transfer( const std::function<void ()>& transfer, const std::function<void ()>& finished );
         void wait();
         
         int postorder( Target* target, int function );        
@@ -78,6 +85,13 @@ class Scheduler
 
     private:
         bool dispatch_results();
+        void push_ready_job( Job* job );
+        Job* pull_ready_job();
+        void complete_job( Job* job );
+        void execute_action( Action* action, const std::string& command, const std::string& command_line, process::Environment* environment, Filter* dependencies_filter, Filter* stdout_filter, Filter* stderr_filter, Arguments* arguments, Context* context );
+        void thread_transfer( std::function<void ()> transfer, std::function<void ()> finished );
+        void restore( Action* action, process::Environment* environment, Filter* dependencies_filter, Filter* stdout_filter, Filter* stderr_filter, Arguments* arguments, Context* context );
+        static bool lower_priority( const Job* lhs, const Job* rhs );
         void process_begin( Context* context );
         int process_end( Context* context );
         Context* allocate_context( Target* working_directory, Job* job = NULL );
@@ -0,0 +1,486 @@
+//
+// StatCache.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "StatCache.hpp"
+#include "GraphReader.hpp"
+#include "GraphWriter.hpp"
+#include "MappedGraph.hpp"
+#include "GraphJournal.hpp"
+#include "System.hpp"
+#include "Target.hpp"
+#include "ThreadPool.hpp"
+#include "Forge.hpp"
+#include <assert/assert.hpp>
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+using std::map;
+using std::vector;
+using std::pair;
+using std::string;
+using std::lock_guard;
+using std::mutex;
+using std::make_pair;
+using namespace sweet;
+using namespace sweet::forge;
+
+namespace
+{
+
+/**
+// The directory part of a filename identified by the filename and the 
+// length of its directory so that directories can be compared without 
+// copying them out of their filenames.
+*/
+struct DirectoryOf
+{
+    const string* filename; ///< The filename.
+    string::size_type length; ///< The length of the directory part of the filename.
+
+    static bool find( const string& filename, DirectoryOf* directory )
+    {
+        SWEET_ASSERT( directory );
+        string::size_type position = filename.find_last_of( "/\\" );
+        directory->filename = &filename;
+        directory->length = position != string::npos ? position : 0;
+        return directory->length > 0;
+    }
+
+    int compare( const string& path ) const
+    {
+        return filename->compare( 0, length, path );
+    }
+
+    bool operator<( const DirectoryOf& other ) const
+    {
+        return filename->compare( 0, length, *other.filename, 0, other.length ) < 0;
+    }
+
+    bool operator==( const DirectoryOf& other ) const
+    {
+        return filename->compare( 0, length, *other.filename, 0, other.length ) == 0;
+    }
+};
+
+bool bind_directory_less( const pair<string, bool>& bind_directory, const DirectoryOf& directory )
+{
+    return directory.compare( bind_directory.first ) > 0;
+}
+
+}
+
+/**
+// Constructor.
+//
+// @param forge
+//  The Forge that this StatCache is part of.
+*/
+StatCache::StatCache( Forge* forge )
+: forge_( forge ),
+  mutex_(),
+  previous_directories_(),
+  directories_(),
+  enabled_( false ),
+  rescan_( false )
+{
+    SWEET_ASSERT( forge_ );
+}
+
+/**
+// Set whether or not Targets bound to files in unchanged directories skip
+// stat'ing those files.
+//
+// @param enabled
+//  True to skip stat'ing files in unchanged directories or false to stat
+//  every file.
+*/
+void StatCache::set_enabled( bool enabled )
+{
+    enabled_ = enabled;
+}
+
+/**
+// Do Targets bound to files in unchanged directories skip stat'ing those
+// files?
+//
+// @return
+//  True if files in unchanged directories aren't stat'd otherwise false.
+*/
+bool StatCache::enabled() const
+{
+    return enabled_;
+}
+
+/**
+// Set whether or not to stat every file even when this StatCache is enabled.
+//
+// The directories are still stat'd and saved so that the next run without a
+// rescan starts from an up to date cache.
+//
+// @param rescan
+//  True to stat every file or false to skip stat'ing files in unchanged
+//  directories when this StatCache is enabled.
+*/
+void StatCache::set_rescan( bool rescan )
+{
+    rescan_ = rescan;
+}
+
+/**
+// Is every file stat'd even when this StatCache is enabled?
+//
+// @return
+//  True if every file is stat'd otherwise false.
+*/
+bool StatCache::rescan() const
+{
+    return rescan_;
+}
+
+/**
+// Stat the directories containing the files of Targets about to be bound.
+//
+// Each distinct directory containing the file of a Target that is bound to
+// a single file that existed in the previous run and that isn't already 
+// stat'd in the current run is stat'd in parallel.  The directories are 
+// then recorded, sorted by path, for lock-free lookups from 
+// `StatCache::unchanged()` during the bind pass that follows.
+//
+// Must not be called while Targets are being bound.
+//
+// @param targets
+//  The Targets about to be bound.
+*/
+void StatCache::stat_directories( const std::vector<Target*>& targets )
+{
+    bind_directories_.clear();
+    if ( !enabled_ )
+    {
+        return;
+    }
+
+    vector<DirectoryOf> distinct_directories;
+    distinct_directories.reserve( targets.size() );
+    for ( vector<Target*>::const_iterator i = targets.begin(); i != targets.end(); ++i )
+    {
+        const Target* target = *i;
+        SWEET_ASSERT( target );
+        DirectoryOf directory;
+        if ( !target->bound_to_file() && target->filenames().size() == 1 && target->last_write_time() != 0 && DirectoryOf::find(target->filenames().front(), &directory) )
+        {
+            distinct_directories.push_back( directory );
+        }
+    }
+    std::sort( distinct_directories.begin(), distinct_directories.end() );
+    distinct_directories.erase( std::unique(distinct_directories.begin(), distinct_directories.end()), distinct_directories.end() );
+
+    vector<string> paths;
+    paths.reserve( distinct_directories.size() );
+    for ( vector<DirectoryOf>::const_iterator i = distinct_directories.begin(); i != distinct_directories.end(); ++i )
+    {
+        paths.push_back( i->filename->substr(0, i->length) );
+    }
+
+    vector<string> unstated_paths;
+    {
+        lock_guard<mutex> lock( mutex_ );
+        for ( vector<string>::const_iterator path = paths.begin(); path != paths.end(); ++path )
+        {
+            if ( directories_.find(*path) == directories_.end() )
+            {
+                unstated_paths.push_back( *path );
+            }
+        }
+    }
+
+    const int GRAIN = 16;
+    vector<Directory> directories( unstated_paths.size() );
+    forge_->thread_pool()->parallel( int(unstated_paths.size()), GRAIN, std::bind(&StatCache::stat_range, this, &unstated_paths, &directories, std::placeholders::_1, std::placeholders::_2) );
+
+    lock_guard<mutex> lock( mutex_ );
+    for ( size_t i = 0; i < unstated_paths.size(); ++i )
+    {
+        directories_.insert( make_pair(unstated_paths[i], directories[i]) );
+    }
+    bind_directories_.reserve( paths.size() );
+    for ( vector<string>::const_iterator path = paths.begin(); path != paths.end(); ++path )
+    {
+        map<string, Directory>::const_iterator current = directories_.find( *path );
+        SWEET_ASSERT( current != directories_.end() );
+        bind_directories_.push_back( make_pair(*path, unchanged(*path, current->second)) );
+    }
+}
+
+/**
+// Is the directory containing a file unchanged since the previous run?
+//
+// Directories stat'd by `StatCache::stat_directories()` before the current
+// bind pass are looked up without locking.  Other directories are stat'd 
+// the first time that they are seen in the current run, before any of the
+// files that they contain are stat'd, so that changes made while binding 
+// are picked up in the next run.
+//
+// @param filename
+//  The absolute path to the file to check the directory of.
+//
+// @return
+//  True if this StatCache is enabled, a full rescan hasn't been requested,
+//  and the directory containing \e filename has the same last write time,
+//  inode, and size as it did in the previous run otherwise false.
+*/
+bool StatCache::unchanged( const std::string& filename )
+{
+    if ( !enabled_ )
+    {
+        return false;
+    }
+
+    DirectoryOf directory;
+    if ( !DirectoryOf::find(filename, &directory) )
+    {
+        return false;
+    }
+
+    vector<pair<string, bool> >::const_iterator bind_directory = std::lower_bound( bind_directories_.begin(), bind_directories_.end(), directory, &bind_directory_less );
+    if ( bind_directory != bind_directories_.end() && directory.compare(bind_directory->first) == 0 )
+    {
+        return !rescan_ && bind_directory->second;
+    }
+
+    string path = filename.substr( 0, directory.length );
+    lock_guard<mutex> lock( mutex_ );
+    const Directory* current = find_or_stat( path );
+    return !rescan_ && unchanged( path, *current );
+}
+
+/**
+// Prevent the directory containing a file from being skipped in the next
+// run.
+//
+// Must not be called while Targets are being bound in parallel as it
+// updates the directories looked up without locking by 
+// `StatCache::unchanged()`.
+//
+// @param filename
+//  The absolute path to the file that is expected to change.
+*/
+void StatCache::invalidate( const std::string& filename )
+{
+    if ( !enabled_ )
+    {
+        return;
+    }
+
+    DirectoryOf directory_of;
+    if ( DirectoryOf::find(filename, &directory_of) )
+    {
+        string path = filename.substr( 0, directory_of.length );
+        lock_guard<mutex> lock( mutex_ );
+        Directory& directory = directories_[path];
+        directory.valid = false;
+        vector<pair<string, bool> >::iterator bind_directory = std::lower_bound( bind_directories_.begin(), bind_directories_.end(), directory_of, &bind_directory_less );
+        if ( bind_directory != bind_directories_.end() && bind_directory->first == path )
+        {
+            bind_directory->second = false;
+        }
+    }
+}
+
+/**
+// Forget the directories from the previous and current runs.
+*/
+void StatCache::clear()
+{
+    lock_guard<mutex> lock( mutex_ );
+    previous_directories_.clear();
+    directories_.clear();
+    bind_directories_.clear();
+}
+
+/**
+// Read the directories saved by the previous run from \e reader.
+//
+// @param reader
+//  The GraphReader to deserialize the directories from.
+*/
+void StatCache::read( GraphReader& reader )
+{
+    lock_guard<mutex> lock( mutex_ );
+    previous_directories_.clear();
+    int directories = 0;
+    reader.value( &directories );
+    for ( int i = 0; i < directories; ++i )
+    {
+        string path;
+        Directory directory;
+        reader.value( &path );
+        reader.value( &directory.last_write_time );
+        reader.value( &directory.inode );
+        reader.value( &directory.size );
+        directory.valid = true;
+        previous_directories_.insert( make_pair(path, directory) );
+    }
+}
+
+/**
+// Read the directories saved by the previous run from \e mapped_graph.
+//
+// @param mapped_graph
+//  The MappedGraph to read the directories from.
+*/
+void StatCache::read( const MappedGraph& mapped_graph )
+{
+    lock_guard<mutex> lock( mutex_ );
+    previous_directories_.clear();
+    for ( int i = 0; i < mapped_graph.directories(); ++i )
+    {
+        const MappedGraph::Directory& record = mapped_graph.directory( i );
+        Directory directory;
+        directory.last_write_time = record.last_write_time;
+        directory.inode = record.inode;
+        directory.size = record.size;
+        directory.valid = true;
+        previous_directories_.insert( make_pair(mapped_graph.string(record.path), directory) );
+    }
+}
+
+/**
+// Read the directories saved by the previous run from a segment of 
+// \e journal.
+//
+// @param journal
+//  The GraphJournal to read the directories from.
+*/
+void StatCache::read( GraphJournal& journal )
+{
+    lock_guard<mutex> lock( mutex_ );
+    previous_directories_.clear();
+    uint32_t directories = 0;
+    journal.value( &directories );
+    for ( uint32_t i = 0; i < directories && !journal.error(); ++i )
+    {
+        string path;
+        Directory directory;
+        journal.value( &path );
+        journal.value( &directory.last_write_time );
+        journal.value( &directory.inode );
+        journal.value( &directory.size );
+        directory.valid = true;
+        previous_directories_.insert( make_pair(path, directory) );
+    }
+}
+
+/**
+// Write the directories stat'd in the current run to \e writer.
+//
+// Each directory is stat'd again and only written if it hasn't changed
+// since it was first stat'd in this run and it hasn't been invalidated by
+// an outdated Target.
+//
+// @param writer
+//  The GraphWriter to serialize the directories to.
+*/
+void StatCache::write( GraphWriter& writer )
+{
+    lock_guard<mutex> lock( mutex_ );
+    vector<map<string, Directory>::const_iterator> directories = unchanged_directories();
+    for ( vector<map<string, Directory>::const_iterator>::const_iterator i = directories.begin(); i != directories.end(); ++i )
+    {
+        const Directory& directory = (*i)->second;
+        writer.directory( (*i)->first, directory.last_write_time, directory.inode, directory.size );
+    }
+}
+
+/**
+// Write the directories stat'd in the current run to \e journal.
+//
+// The directories are written in the same way as for 
+// `StatCache::write(GraphWriter&)` and replace the directories written to 
+// the journal by any earlier saves.
+//
+// @param journal
+//  The GraphJournal to append the directories to.
+*/
+void StatCache::write( GraphJournal& journal )
+{
+    lock_guard<mutex> lock( mutex_ );
+    vector<map<string, Directory>::const_iterator> directories = unchanged_directories();
+    journal.value( uint32_t(directories.size()) );
+    for ( vector<map<string, Directory>::const_iterator>::const_iterator i = directories.begin(); i != directories.end(); ++i )
+    {
+        const Directory& directory = (*i)->second;
+        journal.value( (*i)->first );
+        journal.value( directory.last_write_time );
+        journal.value( directory.inode );
+        journal.value( directory.size );
+    }
+}
+
+vector<map<string, StatCache::Directory>::const_iterator> StatCache::unchanged_directories() const
+{
+    vector<map<string, Directory>::const_iterator> unchanged_directories;
+    for ( map<string, Directory>::const_iterator i = directories_.begin(); i != directories_.end(); ++i )
+    {
+        const Directory& directory = i->second;
+        Directory current;
+        if ( directory.valid && stat(i->first, &current) &&
+            current.last_write_time == directory.last_write_time &&
+            current.inode == directory.inode &&
+            current.size == directory.size )
+        {
+            unchanged_directories.push_back( i );
+        }
+    }
+    return unchanged_directories;
+}
+
+StatCache::Directory* StatCache::find_or_stat( const std::string& path )
+{
+    map<string, Directory>::iterator i = directories_.find( path );
+    if ( i == directories_.end() )
+    {
+        Directory directory;
+        directory.valid = stat( path, &directory );
+        i = directories_.insert( make_pair(path, directory) ).first;
+    }
+    return &i->second;
+}
+
+bool StatCache::unchanged( const std::string& path, const Directory& current ) const
+{
+    if ( !current.valid )
+    {
+        return false;
+    }
+
+    map<string, Directory>::const_iterator previous = previous_directories_.find( path );
+    return
+        previous != previous_directories_.end() &&
+        previous->second.last_write_time == current.last_write_time &&
+        previous->second.inode == current.inode &&
+        previous->second.size == current.size
+    ;
+}
+
+void StatCache::stat_range( const std::vector<std::string>* paths, std::vector<Directory>* directories, int begin, int end ) const
+{
+    SWEET_ASSERT( paths && directories );
+    SWEET_ASSERT( begin >= 0 && begin <= end && end <= int(paths->size()) );
+    for ( int i = begin; i < end; ++i )
+    {
+        Directory& directory = (*directories)[i];
+        directory.valid = stat( (*paths)[i], &directory );
+    }
+}
+
+bool StatCache::stat( const std::string& path, Directory* directory ) const
+{
+    SWEET_ASSERT( directory );
+    directory->last_write_time = 0;
+    directory->inode = 0;
+    directory->size = 0;
+    return forge_->system()->stat( path, &directory->last_write_time, &directory->inode, &directory->size );
+}
@@ -0,0 +1,90 @@
+#ifndef FORGE_STATCACHE_HPP_INCLUDED
+#define FORGE_STATCACHE_HPP_INCLUDED
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace sweet
+{
+
+namespace forge
+{
+
+class GraphReader;
+class GraphWriter;
+class GraphJournal;
+class MappedGraph;
+class Target;
+class Forge;
+
+/**
+// Remember the last write time, inode, and size of the directories that
+// contain the files that Targets are bound to.
+//
+// Adding, removing, or renaming a file in a directory changes the last write
+// time of that directory.  When enabled, Targets bound to a file in a
+// directory whose last write time, inode, and size are unchanged since the
+// previous run reuse the last write time stored in the cache rather than
+// calling `stat()` on the file.
+//
+// Modifying a file in place doesn't change the last write time of its
+// directory so the cache is disabled by default and is only suitable for
+// source trees that are edited by tools that replace files by renaming over
+// them.  Directories containing files that are outdated in the current run
+// are never cached as they are likely to be written to by the build.
+//
+// The directories of the Targets about to be bound are stat'd in parallel
+// by `StatCache::stat_directories()` before a bind pass so that the
+// Targets bound in parallel during the pass check their directories 
+// without locking.
+*/
+class StatCache
+{
+    struct Directory
+    {
+        int64_t last_write_time; ///< The last write time of the directory (in nanoseconds since the epoch).
+        uint64_t inode; ///< The inode or file index of the directory.
+        int64_t size; ///< The size of the directory.
+        bool valid; ///< Whether or not the directory may be skipped in the next run.
+    };
+
+    Forge* forge_; ///< The Forge that this StatCache is part of.
+    std::mutex mutex_; ///< Locks access to the current directories from multiple threads binding Targets.
+    std::map<std::string, Directory> previous_directories_; ///< The directories from the previous run.
+    std::map<std::string, Directory> directories_; ///< The directories stat'd in the current run.
+    std::vector<std::pair<std::string, bool> > bind_directories_; ///< The directories stat'd before the current bind pass, sorted by path, and whether each is unchanged.
+    bool enabled_; ///< Whether or not unchanged directories skip stat'ing their files.
+    bool rescan_; ///< Whether or not every file is stat'd regardless of whether the cache is enabled.
+
+    public:
+        StatCache( Forge* forge );
+        void set_enabled( bool enabled );
+        bool enabled() const;
+        void set_rescan( bool rescan );
+        bool rescan() const;
+        void stat_directories( const std::vector<Target*>& targets );
+        bool unchanged( const std::string& filename );
+        void invalidate( const std::string& filename );
+        void clear();
+        void read( GraphReader& reader );
+        void read( const MappedGraph& mapped_graph );
+        void read( GraphJournal& journal );
+        void write( GraphWriter& writer );
+        void write( GraphJournal& journal );
+
+    private:
+        std::vector<std::map<std::string, Directory>::const_iterator> unchanged_directories() const;
+        Directory* find_or_stat( const std::string& directory );
+        bool unchanged( const std::string& path, const Directory& current ) const;
+        void stat_range( const std::vector<std::string>* paths, std::vector<Directory>* directories, int begin, int end ) const;
+        bool stat( const std::string& directory, Directory* stamp ) const;
+};
+
+}
+
+}
+
+#endif
@@ -0,0 +1,244 @@
+//
+// Statistics.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "Statistics.hpp"
+#include "Forge.hpp"
+#include "System.hpp"
+#include <assert/assert.hpp>
+
+using namespace sweet;
+using namespace sweet::forge;
+
+Statistics::Statistics( Forge* forge )
+: forge_( forge ),
+  enabled_( false ),
+  origin_( std::chrono::steady_clock::now() )
+{
+    SWEET_ASSERT( forge_ );
+    for ( int i = 0; i < COUNTER_COUNT; ++i )
+    {
+        counters_[i].store( 0, std::memory_order_relaxed );
+    }
+    for ( int i = 0; i < PHASE_COUNT; ++i )
+    {
+        phase_times_[i] = 0;
+        phase_starts_[i] = 0;
+        phase_depths_[i] = 0;
+    }
+}
+
+/**
+// Set whether or not a report is printed when a command finishes.
+//
+// @param enabled
+//  True to print a report otherwise false.
+*/
+void Statistics::set_enabled( bool enabled )
+{
+    enabled_ = enabled;
+}
+
+/**
+// Is a report printed when a command finishes?
+//
+// @return
+//  True if a report is printed otherwise false.
+*/
+bool Statistics::enabled() const
+{
+    return enabled_;
+}
+
+/**
+// Add to a counter.
+//
+// May be called from any thread.
+//
+// @param counter
+//  The counter to add to.
+//
+// @param value
+//  The value to add.
+*/
+void Statistics::add( Counter counter, uint64_t value )
+{
+    SWEET_ASSERT( counter >= 0 && counter < COUNTER_COUNT );
+    counters_[counter].fetch_add( value, std::memory_order_relaxed );
+}
+
+/**
+// Get the value of a counter.
+//
+// @param counter
+//  The counter to get the value of.
+//
+// @return
+//  The value of the counter.
+*/
+uint64_t Statistics::counter( Counter counter ) const
+{
+    SWEET_ASSERT( counter >= 0 && counter < COUNTER_COUNT );
+    return counters_[counter].load( std::memory_order_relaxed );
+}
+
+/**
+// Get the number of files stat'd.
+//
+// @return
+//  The number of calls made to `System::stat()`.
+*/
+uint64_t Statistics::stats() const
+{
+    return forge_->system()->stats();
+}
+
+/**
+// Enter a phase on the main thread.
+//
+// Nested entries into the same phase are only timed once.
+*/
+void Statistics::begin( Phase phase )
+{
+    SWEET_ASSERT( phase >= 0 && phase < PHASE_COUNT );
+    if ( phase_depths_[phase]++ == 0 )
+    {
+        phase_starts_[phase] = now();
+    }
+}
+
+/**
+// Leave a phase on the main thread.
+*/
+void Statistics::end( Phase phase )
+{
+    SWEET_ASSERT( phase >= 0 && phase < PHASE_COUNT );
+    SWEET_ASSERT( phase_depths_[phase] > 0 );
+    if ( --phase_depths_[phase] == 0 )
+    {
+        phase_times_[phase] += now() - phase_starts_[phase];
+    }
+}
+
+/**
+// Get the time spent in a phase.
+//
+// @return
+//  The time spent in \e phase in microseconds including the time spent
+//  in a phase that is in progress.
+*/
+int64_t Statistics::phase( Phase phase ) const
+{
+    SWEET_ASSERT( phase >= 0 && phase < PHASE_COUNT );
+    int64_t time = phase_times_[phase];
+    if ( phase_depths_[phase] > 0 )
+    {
+        time += now() - phase_starts_[phase];
+    }
+    return time;
+}
+
+/**
+// Get the time elapsed since this Statistics was created.
+//
+// @return
+//  The elapsed time in microseconds.
+*/
+int64_t Statistics::elapsed() const
+{
+    return now();
+}
+
+/**
+// Print the counters and phase times.
+*/
+void Statistics::report() const
+{
+    forge_->outputf( "forge: statistics after %.3fs", double(elapsed()) / 1000000.0 );
+    for ( int i = 0; i < COUNTER_COUNT; ++i )
+    {
+        Counter counter = Counter(i);
+        forge_->outputf( "  %-16s %12llu", counter_name(counter), (unsigned long long) Statistics::counter(counter) );
+    }
+    forge_->outputf( "  %-16s %12llu", "stats", (unsigned long long) stats() );
+    for ( int i = 0; i < PHASE_COUNT; ++i )
+    {
+        Phase phase = Phase(i);
+        forge_->outputf( "  %-16s %12.3fms", phase_name(phase), double(Statistics::phase(phase)) / 1000.0 );
+    }
+}
+
+/**
+// Get the name of a counter.
+//
+// @return
+//  The name of \e counter as it appears in reports and in the table
+//  returned by `stats()` in Lua.
+*/
+const char* Statistics::counter_name( Counter counter )
+{
+    static const char* NAMES [COUNTER_COUNT] =
+    {
+        "buildfiles",
+        "targets",
+        "processes",
+        "lines",
+        "resumes",
+        "bytes_read",
+        "jobs_decreased",
+        "jobs_increased"
+    };
+    SWEET_ASSERT( counter >= 0 && counter < COUNTER_COUNT );
+    return NAMES[counter];
+}
+
+/**
+// Get the name of a phase.
+//
+// @return
+//  The name of \e phase as it appears in reports and in the table returned
+//  by `stats()` in Lua.
+*/
+const char* Statistics::phase_name( Phase phase )
+{
+    static const char* NAMES [PHASE_COUNT] =
+    {
+        "load",
+        "load_binary",
+        "bind",
+        "postorder",
+        "filter",
+        "save_binary"
+    };
+    SWEET_ASSERT( phase >= 0 && phase < PHASE_COUNT );
+    return NAMES[phase];
+}
+
+int64_t Statistics::now() const
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>( steady_clock::now() - origin_ ).count();
+}
+
+/**
+// Constructor.
+//
+// @param statistics
+//  The Statistics to accumulate time into (assumed not null).
+//
+// @param phase
+//  The phase to time.
+*/
+ScopedPhase::ScopedPhase( Statistics* statistics, Statistics::Phase phase )
+: statistics_( statistics ),
+  phase_( phase )
+{
+    SWEET_ASSERT( statistics_ );
+    statistics_->begin( phase_ );
+}
+
+ScopedPhase::~ScopedPhase()
+{
+    statistics_->end( phase_ );
+}
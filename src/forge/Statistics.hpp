@@ -0,0 +1,100 @@
+#ifndef FORGE_STATISTICS_HPP_INCLUDED
+#define FORGE_STATISTICS_HPP_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+
+namespace sweet
+{
+
+namespace forge
+{
+
+class Forge;
+
+/**
+// Count the work done by a build and time each of its phases.
+//
+// Counters are always maintained and may be incremented from any thread
+// at the cost of a single relaxed atomic add.  Phases are timed on the main
+// thread only with a monotonic wall clock and, because phases nest (e.g.
+// filtering output happens during a postorder traversal), each phase's
+// time includes the time of any phases nested within it.
+//
+// The number of files stat'd is counted by the System and is reported here
+// alongside the other counters.
+*/
+class Statistics
+{
+public:
+    enum Counter
+    {
+        COUNTER_BUILDFILES, ///< The number of buildfiles loaded.
+        COUNTER_TARGETS, ///< The number of targets created.
+        COUNTER_PROCESSES, ///< The number of processes spawned.
+        COUNTER_LINES, ///< The number of lines of process output filtered.
+        COUNTER_RESUMES, ///< The number of times a Lua coroutine was resumed.
+        COUNTER_BYTES_READ, ///< The number of bytes read from process output pipes.
+        COUNTER_JOBS_DECREASED, ///< The number of times the Throttle reduced the number of parallel processes.
+        COUNTER_JOBS_INCREASED, ///< The number of times the Throttle raised the number of parallel processes.
+        COUNTER_COUNT
+    };
+
+    enum Phase
+    {
+        PHASE_LOAD, ///< Loading and executing buildfiles.
+        PHASE_LOAD_BINARY, ///< Loading the dependency graph from its cache file.
+        PHASE_BIND, ///< Binding targets to files.
+        PHASE_POSTORDER, ///< Postorder traversals including waiting for processes.
+        PHASE_FILTER, ///< Filtering the output of processes.
+        PHASE_SAVE_BINARY, ///< Saving the dependency graph to its cache file.
+        PHASE_COUNT
+    };
+
+private:
+    Forge* forge_; ///< The Forge that this Statistics is part of.
+    bool enabled_; ///< Whether or not a report is printed when a command finishes.
+    std::chrono::steady_clock::time_point origin_; ///< The time that this Statistics was created.
+    std::atomic<uint64_t> counters_ [COUNTER_COUNT]; ///< The value of each counter.
+    int64_t phase_times_ [PHASE_COUNT]; ///< The total time spent in each phase in microseconds.
+    int64_t phase_starts_ [PHASE_COUNT]; ///< The time that the outermost entry into each phase started.
+    int phase_depths_ [PHASE_COUNT]; ///< The number of nested entries into each phase.
+
+public:
+    Statistics( Forge* forge );
+    void set_enabled( bool enabled );
+    bool enabled() const;
+    void add( Counter counter, uint64_t value = 1 );
+    uint64_t counter( Counter counter ) const;
+    uint64_t stats() const;
+    void begin( Phase phase );
+    void end( Phase phase );
+    int64_t phase( Phase phase ) const;
+    int64_t elapsed() const;
+    void report() const;
+    static const char* counter_name( Counter counter );
+    static const char* phase_name( Phase phase );
+
+private:
+    int64_t now() const;
+};
+
+/**
+// Time a phase on the main thread for the lifetime of a ScopedPhase.
+*/
+class ScopedPhase
+{
+    Statistics* statistics_; ///< The Statistics to accumulate time into.
+    Statistics::Phase phase_; ///< The phase being timed.
+
+public:
+    ScopedPhase( Statistics* statistics, Statistics::Phase phase );
+    ~ScopedPhase();
+};
+
+}
+
+}
+
+#endif
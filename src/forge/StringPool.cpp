@@ -0,0 +1,32 @@
+//
+// StringPool.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "StringPool.hpp"
+
+using std::string;
+using std::mutex;
+using std::lock_guard;
+using namespace sweet::forge;
+
+StringPool::StringPool()
+: mutex_(),
+  strings_()
+{
+}
+
+/**
+// Get the shared copy of a string.
+//
+// @param value
+//  The string to get the shared copy of.
+//
+// @return
+//  The shared copy of \e value.
+*/
+const std::string* StringPool::intern( const std::string& value )
+{
+    lock_guard<mutex> lock( mutex_ );
+    return &*strings_.insert( value ).first;
+}
@@ -0,0 +1,34 @@
+#ifndef FORGE_STRINGPOOL_HPP_INCLUDED
+#define FORGE_STRINGPOOL_HPP_INCLUDED
+
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+namespace sweet
+{
+
+namespace forge
+{
+
+/**
+// Share a single copy of each distinct string.
+//
+// Strings are never removed from the pool so the addresses returned from 
+// `StringPool::intern()` remain valid for the lifetime of the pool.
+*/
+class StringPool
+{
+    std::mutex mutex_; ///< Locks access to the strings from multiple threads.
+    std::unordered_set<std::string> strings_; ///< The strings in this pool.
+
+    public:
+        StringPool();
+        const std::string* intern( const std::string& value );
+};
+
+}
+
+}
+
+#endif
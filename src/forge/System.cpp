@@ -4,7 +4,9 @@
 //
 
 #include "System.hpp"
+#include "ContentHash.hpp"
 #include <assert/assert.hpp>
+#include <stdio.h>
 
 #if defined(BUILD_OS_WINDOWS)
 #include <windows.h>
@@ -13,10 +15,16 @@
 #include <time.h>
 #include <mach-o/dyld.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <sys/sysctl.h>
+#include <sys/clonefile.h>
 #elif defined(BUILD_OS_LINUX)
 #include <unistd.h>
+#include <fcntl.h>
 #include <linux/limits.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
 #include <sys/sysinfo.h>
 #endif
 
@@ -28,9 +36,9 @@ using namespace sweet::forge;
 // Constructor.
 */
 System::System()
-: initial_tick_count_( 0.0f )
+: initial_time_( std::chrono::steady_clock::now() ),
+  stats_( 0 )
 {
-    initial_tick_count_ = ticks();
 }
 
 /**
@@ -103,6 +111,177 @@ std::time_t System::last_write_time( const std::string& path ) const
     return boost::filesystem::last_write_time( path );
 }
 
+/**
+// Get whether a file system entry exists and its last write time with a
+// single call to the operating system.
+//
+// @param path
+//  The path to the file system entry to check.
+//
+// @param last_write_time
+//  A variable to receive the last write time of \e path in nanoseconds 
+//  since the epoch (January 1st, 1970, 00:00 GMT) if it exists.
+//
+// @return
+//  True if \e path exists otherwise false.
+*/
+bool System::stat( const std::string& path, int64_t* last_write_time ) const
+{
+    SWEET_ASSERT( last_write_time );
+    stats_.fetch_add( 1, std::memory_order_relaxed );
+
+#if defined(BUILD_OS_WINDOWS)
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if ( !::GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &data) )
+    {
+        return false;
+    }
+    // Convert 100 nanosecond intervals since January 1st, 1601 to 
+    // nanoseconds since January 1st, 1970.
+    const int64_t EPOCH_DIFFERENCE = 116444736000000000LL;
+    int64_t intervals = (int64_t(data.ftLastWriteTime.dwHighDateTime) << 32) | int64_t(data.ftLastWriteTime.dwLowDateTime);
+    *last_write_time = (intervals - EPOCH_DIFFERENCE) * 100;
+    return true;
+
+#elif defined(BUILD_OS_MACOS)
+    struct stat status;
+    if ( ::stat(path.c_str(), &status) != 0 )
+    {
+        return false;
+    }
+    *last_write_time = int64_t(status.st_mtimespec.tv_sec) * 1000000000LL + int64_t(status.st_mtimespec.tv_nsec);
+    return true;
+
+#elif defined(BUILD_OS_LINUX)
+    struct stat status;
+    if ( ::stat(path.c_str(), &status) != 0 )
+    {
+        return false;
+    }
+    *last_write_time = int64_t(status.st_mtim.tv_sec) * 1000000000LL + int64_t(status.st_mtim.tv_nsec);
+    return true;
+#endif
+}
+
+/**
+// Get whether a file system entry exists and its last write time, inode, and
+// size with a single call to the operating system.
+//
+// On Windows the inode is always zero as getting the file index requires
+// opening the file system entry.
+//
+// @param path
+//  The path to the file system entry to check.
+//
+// @param last_write_time
+//  A variable to receive the last write time of \e path in nanoseconds 
+//  since the epoch (January 1st, 1970, 00:00 GMT) if it exists.
+//
+// @param inode
+//  A variable to receive the inode of \e path if it exists.
+//
+// @param size
+//  A variable to receive the size of \e path if it exists.
+//
+// @return
+//  True if \e path exists otherwise false.
+*/
+bool System::stat( const std::string& path, int64_t* last_write_time, uint64_t* inode, int64_t* size ) const
+{
+    SWEET_ASSERT( last_write_time );
+    SWEET_ASSERT( inode );
+    SWEET_ASSERT( size );
+    stats_.fetch_add( 1, std::memory_order_relaxed );
+
+#if defined(BUILD_OS_WINDOWS)
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if ( !::GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &data) )
+    {
+        return false;
+    }
+    const int64_t EPOCH_DIFFERENCE = 116444736000000000LL;
+    int64_t intervals = (int64_t(data.ftLastWriteTime.dwHighDateTime) << 32) | int64_t(data.ftLastWriteTime.dwLowDateTime);
+    *last_write_time = (intervals - EPOCH_DIFFERENCE) * 100;
+    *inode = 0;
+    *size = (int64_t(data.nFileSizeHigh) << 32) | int64_t(data.nFileSizeLow);
+    return true;
+
+#elif defined(BUILD_OS_MACOS)
+    struct stat status;
+    if ( ::stat(path.c_str(), &status) != 0 )
+    {
+        return false;
+    }
+    *last_write_time = int64_t(status.st_mtimespec.tv_sec) * 1000000000LL + int64_t(status.st_mtimespec.tv_nsec);
+    *inode = uint64_t(status.st_ino);
+    *size = int64_t(status.st_size);
+    return true;
+
+#elif defined(BUILD_OS_LINUX)
+    struct stat status;
+    if ( ::stat(path.c_str(), &status) != 0 )
+    {
+        return false;
+    }
+    *last_write_time = int64_t(status.st_mtim.tv_sec) * 1000000000LL + int64_t(status.st_mtim.tv_nsec);
+    *inode = uint64_t(status.st_ino);
+    *size = int64_t(status.st_size);
+    return true;
+#endif
+}
+
+/**
+// Calculate the digest of the contents of a file.
+//
+// @param path
+//  The path to the file to calculate the digest of.
+//
+// @param digest
+//  A variable to receive the digest of the contents of \e path if it exists
+//  and can be read.
+//
+// @return
+//  True if \e path exists and was read otherwise false.
+*/
+bool System::digest( const std::string& path, uint64_t* digest ) const
+{
+    SWEET_ASSERT( digest );
+
+    FILE* file = fopen( path.c_str(), "rb" );
+    if ( !file )
+    {
+        return false;
+    }
+
+    ContentHash content_hash;
+    char buffer [64 * 1024];
+    size_t size = fread( buffer, 1, sizeof(buffer), file );
+    while ( size > 0 )
+    {
+        content_hash.update( buffer, size );
+        size = fread( buffer, 1, sizeof(buffer), file );
+    }
+    bool read = ferror( file ) == 0;
+    fclose( file );
+
+    if ( read )
+    {
+        *digest = content_hash.finish();
+    }
+    return read;
+}
+
+/**
+// Get the number of files stat'd.
+//
+// @return
+//  The number of calls made to `stat()` since this System was created.
+*/
+uint64_t System::stats() const
+{
+    return stats_.load( std::memory_order_relaxed );
+}
+
 /**
 // List the files in a directory.
 //
@@ -255,6 +434,78 @@ void System::cp( const std::string& from, const std::string& to ) const
     boost::filesystem::copy_file( from, to );
 }
 
+/**
+// Copy a file sharing its storage with the original where the file system
+// supports it.
+//
+// Files are cloned with `ioctl(FICLONE)` on Linux and `clonefile()` on macOS 
+// and copied otherwise.  Any existing file at \e to is removed first so that
+// files hard linked to it aren't written through.
+//
+// @param from
+//  The file to copy.
+//
+// @param to
+//  The path to copy the file to.
+//
+// @return
+//  True if the file was copied otherwise false.
+*/
+bool System::clone( const std::string& from, const std::string& to ) const
+{
+    boost::system::error_code error;
+    boost::filesystem::remove( to, error );
+
+#if defined(BUILD_OS_LINUX)
+    int source = ::open( from.c_str(), O_RDONLY | O_CLOEXEC );
+    if ( source < 0 )
+    {
+        return false;
+    }
+
+    struct stat status;
+    int destination = ::fstat( source, &status ) == 0 ? ::open( to.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, status.st_mode & 07777 ) : -1;
+    if ( destination < 0 )
+    {
+        ::close( source );
+        return false;
+    }
+
+    bool copied = false;
+#if defined(FICLONE)
+    copied = ::ioctl( destination, FICLONE, source ) == 0;
+#endif
+    if ( !copied )
+    {
+        char buffer [64 * 1024];
+        ssize_t size = ::read( source, buffer, sizeof(buffer) );
+        copied = size >= 0;
+        while ( size > 0 && copied )
+        {
+            copied = ::write( destination, buffer, size_t(size) ) == size;
+            size = ::read( source, buffer, sizeof(buffer) );
+            copied = copied && size >= 0;
+        }
+    }
+    copied = ::fchmod( destination, status.st_mode & 07777 ) == 0 && copied;
+    copied = ::close( destination ) == 0 && copied;
+    ::close( source );
+    return copied;
+
+#elif defined(BUILD_OS_MACOS)
+    if ( ::clonefile(from.c_str(), to.c_str(), 0) == 0 )
+    {
+        return true;
+    }
+    boost::filesystem::copy_file( from, to, error );
+    return !error;
+
+#else
+    boost::filesystem::copy_file( from, to, error );
+    return !error;
+#endif
+}
+
 /**
 // Remove a file or directory.
 //
@@ -348,20 +599,16 @@ void System::sleep( float milliseconds ) const
 }
 
 /**
-// Get the number of milliseconds elapsed since the start of the system.
+// Get the number of milliseconds elapsed since this System was created.
+//
+// Measured with a monotonic wall clock so that time spent waiting for child
+// processes is included and changes to the system time are ignored.
 //
 // @return
-//  The number of milliseconds elapsed since the system was started.
+//  The number of milliseconds elapsed since this System was created.
 */
 float System::ticks() const
-{    
-#if defined(BUILD_OS_WINDOWS)
-    return static_cast<float>( ::GetTickCount() ) - initial_tick_count_;
-#elif defined(BUILD_OS_MACOS)
-    return static_cast<float>( (clock() - initial_tick_count_) * 1000 / CLOCKS_PER_SEC );
-#elif defined(BUILD_OS_LINUX)
-    return static_cast<float>( (clock() - initial_tick_count_) * 1000 / CLOCKS_PER_SEC );
-#else
-#error "System::ticks() is not implemented for this platform"
-#endif
+{
+    using namespace std::chrono;
+    return duration<float, std::milli>( steady_clock::now() - initial_time_ ).count();
 }
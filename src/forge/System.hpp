@@ -4,7 +4,10 @@
 #include <boost/filesystem/operations.hpp>
 #include <boost/filesystem/convenience.hpp>
 #include <string>
+#include <atomic>
+#include <chrono>
 #include <ctime>
+#include <stdint.h>
 
 namespace sweet
 {
@@ -17,7 +20,8 @@ namespace forge
 */
 class System
 {
-    float initial_tick_count_; ///< The tick count when this System object was created.
+    std::chrono::steady_clock::time_point initial_time_; ///< The time when this System object was created.
+    mutable std::atomic<uint64_t> stats_; ///< The number of calls made to stat().
 
     public:
         System();
@@ -27,6 +31,10 @@ class System
         bool is_directory( const std::string& path ) const;
         bool is_regular( const std::string& path ) const;
         std::time_t last_write_time( const std::string& path ) const;
+        bool stat( const std::string& path, int64_t* last_write_time ) const;
+        bool stat( const std::string& path, int64_t* last_write_time, uint64_t* inode, int64_t* size ) const;
+        bool digest( const std::string& path, uint64_t* digest ) const;
+        uint64_t stats() const;
         boost::filesystem::directory_iterator ls( const std::string& path ) const;
         boost::filesystem::recursive_directory_iterator find( const std::string& path ) const;
         std::string executable() const;
@@ -34,6 +42,7 @@ class System
         void mkdir( const std::string& path ) const;
         void rmdir( const std::string& path ) const;
         void cp( const std::string& from, const std::string& to ) const;
+        bool clone( const std::string& from, const std::string& to ) const;
         void rm( const std::string& path ) const;
         const char* operating_system() const;
         const char* getenv( const char* name ) const;
@@ -8,34 +8,62 @@
 #include "Graph.hpp"
 #include "GraphWriter.hpp"
 #include "GraphReader.hpp"
+#include "GraphJournal.hpp"
+#include "MappedGraph.hpp"
 #include "Forge.hpp"
 #include "System.hpp"
+#include "StatCache.hpp"
+#include "Arena.hpp"
+#include "StringPool.hpp"
+#include "ContentHash.hpp"
 #include <assert/assert.hpp>
 #include <algorithm>
+#include <limits>
+#include <string.h>
 
 using std::min;
 using std::max;
 using std::swap;
 using std::remove;
 using std::vector;
+using std::unordered_map;
+using std::make_pair;
 using std::string;
-using std::time_t;
 using namespace sweet;
 using namespace sweet::forge;
 
+static Arena& arena()
+{
+    static Arena arena( sizeof(Target), 1024 );
+    return arena;
+}
+
+static const std::string* intern( const std::string& id )
+{
+    static StringPool string_pool;
+    return string_pool.intern( id );
+}
+
+static size_t hash_id( const char* id, size_t length )
+{
+    // 64 bit FNV-1a.
+    uint64_t hash = 14695981039346656037ULL;
+    for ( size_t i = 0; i < length; ++i )
+    {
+        hash = (hash ^ uint8_t(id[i])) * 1099511628211ULL;
+    }
+    return size_t(hash ^ (hash >> 32));
+}
+
 /**
 // Constructor.
 */
 Target::Target()
-: id_(),
-  path_(),
-  branch_(),
-  graph_( NULL ),
-  prototype_( NULL ),
-  timestamp_( 0 ),
-  last_write_time_( 0 ),
-  hash_( 0 ),
-  pending_hash_( 0 ),
+: timestamp_( 0 ),
+  visited_revision_( 0 ),
+  successful_revision_( 0 ),
+  postorder_height_( -1 ),
+  visiting_( false ),
   outdated_( false ),
   changed_( false ),
   bound_to_file_( false ),
@@ -43,18 +71,29 @@ Target::Target()
   referenced_by_script_( false ),
   cleanable_( false ),
   built_( false ),
-  working_directory_( NULL ),
+  dirty_( false ),
+  postorder_job_( NULL ),
   parent_( NULL ),
-  targets_(),
   dependencies_(),
   implicit_dependencies_(),
   ordering_dependencies_(),
-  filenames_(),
-  visiting_( false ),
-  visited_revision_( 0 ),
-  successful_revision_( 0 ),
-  postorder_height_( -1 ),
-  anonymous_( 0 )
+  id_( intern( string() ) ),
+  path_(),
+  graph_( NULL ),
+  prototype_( NULL ),
+  last_write_time_( 0 ),
+  hash_( 0 ),
+  pending_hash_( 0 ),
+  digest_( 0 ),
+  inputs_digest_( 0 ),
+  duration_( 0 ),
+  anonymous_( 0 ),
+  working_directory_( NULL ),
+  targets_(),
+  targets_by_id_(),
+  indexed_targets_( 0 ),
+  dependency_kinds_(),
+  filenames_()
 {
 }
 
@@ -68,15 +107,11 @@ Target::Target()
 //  The Graph that this Target is part of.
 */
 Target::Target( const std::string& id, Graph* graph )
-: id_( id ),
-  path_(),
-  branch_(),
-  graph_( graph ),
-  prototype_( NULL ),
-  timestamp_( 0 ),
-  last_write_time_( 0 ),
-  hash_( 0 ),
-  pending_hash_( 0 ),
+: timestamp_( 0 ),
+  visited_revision_( 0 ),
+  successful_revision_( 0 ),
+  postorder_height_( -1 ),
+  visiting_( false ),
   outdated_( false ),
   changed_( false ),
   bound_to_file_( false ),
@@ -84,20 +119,31 @@ Target::Target( const std::string& id, Graph* graph )
   referenced_by_script_( false ),
   cleanable_( false ),
   built_( false ),
-  working_directory_( NULL ),
+  dirty_( true ),
+  postorder_job_( NULL ),
   parent_( NULL ),
-  targets_(),
   dependencies_(),
   implicit_dependencies_(),
   ordering_dependencies_(),
-  filenames_(),
-  visiting_( false ),
-  visited_revision_( 0 ),
-  successful_revision_( 0 ),
-  postorder_height_( -1 ),
-  anonymous_( 0 )
+  id_( intern( id ) ),
+  path_(),
+  graph_( graph ),
+  prototype_( NULL ),
+  last_write_time_( 0 ),
+  hash_( 0 ),
+  pending_hash_( 0 ),
+  digest_( 0 ),
+  inputs_digest_( 0 ),
+  duration_( 0 ),
+  anonymous_( 0 ),
+  working_directory_( NULL ),
+  targets_(),
+  targets_by_id_(),
+  indexed_targets_( 0 ),
+  dependency_kinds_(),
+  filenames_()
 {
-    SWEET_ASSERT( !id_.empty() );
+    SWEET_ASSERT( !id_->empty() );
     SWEET_ASSERT( graph_ );
 }
 
@@ -115,6 +161,37 @@ Target::~Target()
     }
 }
 
+/**
+// Allocate memory for a Target.
+//
+// Targets are allocated from an Arena shared by all Graphs to avoid the 
+// overhead of allocating each of the very large number of Targets in a 
+// Graph from the heap individually.
+//
+// @param size
+//  The size of the Target to allocate (always `sizeof(Target)`).
+//
+// @return
+//  The memory for the Target.
+*/
+void* Target::operator new( size_t size )
+{
+    SWEET_ASSERT( size <= arena().size() );
+    (void) size;
+    return arena().allocate();
+}
+
+/**
+// Free memory allocated for a Target.
+//
+// @param object
+//  The memory to free (ignored if null).
+*/
+void Target::operator delete( void* object )
+{
+    arena().deallocate( object );
+}
+
 /**
 // Recover this Target after it has been loaded from an Archive.
 //
@@ -146,7 +223,8 @@ void Target::recover( Graph* graph )
 */
 const std::string& Target::id() const
 {
-    return id_;
+    SWEET_ASSERT( id_ );
+    return *id_;
 }
 
 /**
@@ -157,12 +235,12 @@ const std::string& Target::id() const
 */
 const std::string& Target::path() const
 {
-    if ( path_.empty() )
+    if ( !path_ )
     {
-        path_ = branch() + id();
+        path_.reset( new string(branch() + id()) );
     }
 
-    return path_;
+    return *path_;
 }
 
 /**
@@ -171,49 +249,47 @@ const std::string& Target::path() const
 // @return
 //  The branch path that this target is in.
 */
-const std::string& Target::branch() const
+std::string Target::branch() const
 {
-    if ( branch_.empty() )
+    string branch;
+    vector<Target*> targets_to_root;
+
+    Target* parent = Target::parent();
+    while ( parent )
     {
-        vector<Target*> targets_to_root;
+        targets_to_root.push_back( parent );
+        parent = parent->parent();
+    }
 
-        Target* parent = Target::parent();
-        while ( parent )
-        {
-            targets_to_root.push_back( parent );
-            parent = parent->parent();
-        }
+    if ( !targets_to_root.empty() )
+    {
+        vector<Target*>::const_reverse_iterator i = targets_to_root.rbegin();
+        ++i;
 
-        if ( !targets_to_root.empty() )
+        if ( i != targets_to_root.rend() )
         {
-            vector<Target*>::const_reverse_iterator i = targets_to_root.rbegin();
-            ++i;
-
-            if ( i != targets_to_root.rend() )
-            {
-                const char DRIVE = ':';
-                if ( (*i)->id().find(DRIVE) != std::string::npos )
-                {
-                    Target* target = *i;
-                    SWEET_ASSERT( target );
-                    branch_ += target->id();
-                    ++i;
-                }
-            }
-            branch_ += "/";
-
-            while ( i != targets_to_root.rend() )
+            const char DRIVE = ':';
+            if ( (*i)->id().find(DRIVE) != std::string::npos )
             {
                 Target* target = *i;
-                SWEET_ASSERT( target != 0 );
-                branch_ += target->id();
-                branch_ += "/";
+                SWEET_ASSERT( target );
+                branch += target->id();
                 ++i;
             }
         }
+        branch += "/";
+
+        while ( i != targets_to_root.rend() )
+        {
+            Target* target = *i;
+            SWEET_ASSERT( target != 0 );
+            branch += target->id();
+            branch += "/";
+            ++i;
+        }
     }
 
-    return branch_;
+    return branch;
 }
 
 /**
@@ -227,7 +303,7 @@ const std::string& Target::branch() const
 */
 bool Target::anonymous() const
 {
-    return id_.size() > 2 && id_[0] == '$' && id_[1] == '$';
+    return id_->size() > 2 && (*id_)[0] == '$' && (*id_)[1] == '$';
 }
 
 /**
@@ -241,6 +317,21 @@ uint64_t Target::hash() const
     return hash_;
 }
 
+/**
+// Get the digest of the contents of the files that this Target is bound to.
+//
+// Targets that aren't bound to any files take the digest of their 
+// dependencies so that changes propagate through them.
+//
+// @return
+//  The digest or 0 if content digests are disabled, no digest has been 
+//  calculated, or any of this Target's files don't exist.
+*/
+uint64_t Target::digest() const
+{
+    return digest_;
+}
+
 /**
 // Get the Graph that this Target is part of.
 //
@@ -305,29 +396,55 @@ void Target::bind()
 // outdated if they are older than this Target.  Additionally if the last 
 // write time of the file or directory is different to the last write time 
 // already stored in this Target then this Target is marked as having changed.
+//
+// If the StatCache is enabled and this Target is bound to a single file in a
+// directory that hasn't changed since the previous run then the last write
+// time stored in this Target is reused without stat'ing the file.
+//
+// If content digests are enabled then the contents of the files are hashed 
+// again only when their last write time has changed (or this Target is bound 
+// to more than one file) so that files that are touched without changing 
+// don't outdate the Targets that depend on them.
 */
 void Target::bind_to_file()
 {
     if ( !bound_to_file_ )
     {
-        if ( !filenames_.empty() )
+        // Reuse the last write time from the previous run when this Target
+        // is bound to a single file that existed then and whose directory
+        // hasn't changed since.
+        StatCache* stat_cache = graph_->stat_cache();
+        if ( filenames_.size() == 1 && last_write_time_ != 0 && stat_cache->unchanged(filenames_.front()) )
+        {
+            changed_ = false;
+            timestamp_ = last_write_time_;
+            outdated_ = hash_ != pending_hash_;
+            dirty_ = dirty_ || hash_ != pending_hash_;
+            hash_ = pending_hash_;
+            if ( graph_->content_digests() && digest_ == 0 )
+            {
+                digest_ = content_digest();
+                dirty_ = true;
+            }
+        }
+        else if ( !filenames_.empty() )
         {
-            time_t latest_last_write_time = 0;
-            time_t earliest_last_write_time = std::numeric_limits<time_t>::max();
+            int64_t latest_last_write_time = 0;
+            int64_t earliest_last_write_time = std::numeric_limits<int64_t>::max();
             bool outdated = false;
 
+            System* system = graph_->forge()->system();
             for ( vector<string>::const_iterator filename = filenames_.begin(); filename != filenames_.end(); ++filename )
             {
-                System* system = graph_->forge()->system();
-                if ( system->exists(*filename) )
+                int64_t last_write_time = 0;
+                if ( system->stat(*filename, &last_write_time) )
                 {
-                    time_t last_write_time = system->last_write_time( *filename );
                     latest_last_write_time = max( last_write_time, latest_last_write_time );
                     earliest_last_write_time = min( last_write_time, earliest_last_write_time );
                 }
                 else
                 {
-                    latest_last_write_time = std::numeric_limits<time_t>::max();
+                    latest_last_write_time = std::numeric_limits<int64_t>::max();
                     earliest_last_write_time = 0;
                     outdated = true;
                 }
@@ -337,7 +454,14 @@ void Target::bind_to_file()
             timestamp_ = latest_last_write_time;
             last_write_time_ = earliest_last_write_time;
             outdated_ = outdated || hash_ != pending_hash_;
+            dirty_ = dirty_ || changed_ || hash_ != pending_hash_;
             hash_ = pending_hash_;
+            if ( graph_->content_digests() && (changed_ || digest_ == 0 || filenames_.size() > 1) )
+            {
+                uint64_t digest = !outdated ? content_digest() : 0;
+                dirty_ = dirty_ || digest != digest_;
+                digest_ = digest;
+            }
         }
         else
         {
@@ -345,6 +469,7 @@ void Target::bind_to_file()
             timestamp_ = 0;
             last_write_time_ = 0;
             outdated_ = !built_ || hash_ != pending_hash_;
+            dirty_ = dirty_ || changed_ || hash_ != pending_hash_;
             hash_ = pending_hash_;
         }
         
@@ -366,12 +491,18 @@ void Target::bind_to_file()
 //
 // Cleanable Targets that haven't been built are always outdated whether they
 // are bound to files or not.
+//
+// If content digests are enabled and this Target is bound to one or more 
+// files then it is outdated if the digests of its dependencies differ from 
+// those recorded when it was last built rather than when any of them have a 
+// later timestamp.  Targets built before content digests were enabled fall 
+// back to comparing timestamps until they are next built.
 */
 void Target::bind_to_dependencies()
 {
     if ( !bound_to_dependencies_ )
     {
-        time_t timestamp = timestamp_;
+        int64_t timestamp = timestamp_;
         bool outdated = outdated_;
 
         int i = 0;
@@ -386,17 +517,148 @@ void Target::bind_to_dependencies()
 
         if ( !filenames_.empty() )
         {
-            outdated = outdated_ || timestamp > last_write_time();
+            if ( graph_->content_digests() && inputs_digest_ != 0 )
+            {
+                outdated = outdated || dependencies_digest() != inputs_digest_;
+            }
+            else
+            {
+                outdated = outdated_ || timestamp > last_write_time();
+                if ( graph_->content_digests() && !outdated )
+                {
+                    inputs_digest_ = dependencies_digest();
+                    dirty_ = true;
+                }
+            }
+        }
+        else if ( graph_->content_digests() )
+        {
+            uint64_t digest = dependencies_digest();
+            dirty_ = dirty_ || digest != digest_;
+            digest_ = digest;
         }
 
         outdated = outdated || (cleanable_ && !built_);
 
+        // Outdated Targets are likely to write to their files so make sure
+        // that the directories containing them are stat'd in the next run.
+        if ( outdated )
+        {
+            StatCache* stat_cache = graph_->stat_cache();
+            for ( vector<string>::const_iterator filename = filenames_.begin(); filename != filenames_.end(); ++filename )
+            {
+                stat_cache->invalidate( *filename );
+            }
+        }
+
         set_outdated( outdated );
         set_timestamp( timestamp );
         bound_to_dependencies_ = true;
     }
 }
 
+/**
+// Unbind this Target so that it is bound to its file and dependencies again
+// the next time that it is bound.
+*/
+void Target::unbind()
+{
+    bound_to_file_ = false;
+    bound_to_dependencies_ = false;
+}
+
+/**
+// Update the digests of this Target after it has been built.
+//
+// The files that this Target is bound to are hashed again if the build has
+// written to them and the digest of its dependencies, including any implicit
+// dependencies added by the build, is recorded to compare against in the 
+// next run.  A build that rewrites its files with identical contents leaves
+// the digest unchanged so that the Targets that depend on this Target are
+// cut off from rebuilding when they are rebound (see 
+// Target::rebind_to_dependencies()).
+*/
+void Target::update_digests()
+{
+    SWEET_ASSERT( graph_ );
+
+    if ( !filenames_.empty() )
+    {
+        int64_t earliest_last_write_time = std::numeric_limits<int64_t>::max();
+        bool unchanged = true;
+        System* system = graph_->forge()->system();
+        for ( vector<string>::const_iterator filename = filenames_.begin(); filename != filenames_.end(); ++filename )
+        {
+            int64_t last_write_time = 0;
+            system->stat( *filename, &last_write_time );
+            unchanged = unchanged && last_write_time != 0 && last_write_time <= last_write_time_;
+            earliest_last_write_time = min( last_write_time, earliest_last_write_time );
+        }
+        last_write_time_ = earliest_last_write_time;
+        if ( !unchanged || digest_ == 0 )
+        {
+            digest_ = last_write_time_ != 0 ? content_digest() : 0;
+        }
+    }
+
+    for ( vector<Target*>::const_iterator i = implicit_dependencies_.begin(); i != implicit_dependencies_.end(); ++i )
+    {
+        Target* dependency = *i;
+        SWEET_ASSERT( dependency );
+        if ( !dependency->bound_to_file() )
+        {
+            dependency->bind_to_file();
+        }
+    }
+
+    if ( filenames_.empty() )
+    {
+        digest_ = dependencies_digest();
+    }
+    inputs_digest_ = dependencies_digest();
+    dirty_ = true;
+}
+
+/**
+// Decide again whether or not this Target is outdated now that all of the 
+// Targets that it depends on have been visited.
+//
+// When content digests are enabled Targets are bound as outdated whenever
+// any of their dependencies are outdated as the dependencies may change when
+// they are rebuilt.  Once the dependencies have been visited their digests
+// are up to date and a Target whose dependencies' digests still match those
+// recorded when it was last built is no longer outdated.  Targets are only
+// ever changed from outdated to not outdated by rebinding.
+//
+// Targets that aren't bound to any files take the digest of their 
+// dependencies again here so that Targets that aren't visited still pass
+// changes on to the Targets that depend on them.
+*/
+void Target::rebind_to_dependencies()
+{
+    SWEET_ASSERT( graph_ );
+
+    if ( graph_->content_digests() )
+    {
+        if ( filenames_.empty() )
+        {
+            uint64_t digest = dependencies_digest();
+            dirty_ = dirty_ || digest != digest_;
+            digest_ = digest;
+        }
+
+        if ( outdated_ && inputs_digest_ != 0 )
+        {
+            bool outdated = 
+                (cleanable_ && !built_) || 
+                (!filenames_.empty() && digest_ == 0) ||
+                dependencies_digest() != inputs_digest_
+            ;
+            set_outdated( outdated );
+        }
+    }
+}
+
 /**
 // Set the settings hash for this Target.
 //
@@ -467,6 +729,7 @@ bool Target::cleanable() const
 */
 void Target::set_built( bool built )
 {
+    dirty_ = dirty_ || built_ != built;
     built_ = built;
 }
 
@@ -481,6 +744,64 @@ bool Target::built() const
     return built_;
 }
 
+/**
+// Set the time taken to build this Target.
+//
+// The duration is saved with the Graph and used to prioritize the Jobs on
+// the longest paths through the Graph when this Target is next built.
+//
+// @param duration
+//  The wall-clock time, in milliseconds, taken to build this Target.
+*/
+void Target::set_duration( int duration )
+{
+    SWEET_ASSERT( duration >= 0 );
+    dirty_ = dirty_ || duration_ != duration;
+    duration_ = duration;
+}
+
+/**
+// Get the time taken the last time this Target was built.
+//
+// @return
+//  The wall-clock time, in milliseconds, taken the last time this Target 
+//  was built or 0 if this Target has never been built.
+*/
+int Target::duration() const
+{
+    return duration_;
+}
+
+/**
+// Set whether or not this Target has changed since its Graph was last 
+// saved.
+//
+// @param dirty
+//  True to mark this Target as changed so that it is written the next time
+//  its Graph is saved or false to mark it as saved.
+*/
+void Target::set_dirty( bool dirty )
+{
+    dirty_ = dirty;
+}
+
+/**
+// Has this Target changed since its Graph was last saved?
+//
+// The last write time, hash, duration, built flag, filenames, and implicit
+// dependencies of a Target are saved with its Graph.  Changing any of them
+// marks the Target as dirty so that it is appended to the journal the next
+// time that the Graph is saved.
+//
+// @return
+//  True if this Target has changed since its Graph was last saved otherwise
+//  false.
+*/
+bool Target::dirty() const
+{
+    return dirty_;
+}
+
 /**
 // Set the timestamp for this Target.
 //
@@ -490,9 +811,10 @@ bool Target::built() const
 // considered to be outdated and in need of update.
 //
 // @param timestamp
-//  The value to set the timestamp of this Target to.
+//  The value to set the timestamp of this Target to (in nanoseconds since
+//  the epoch).
 */
-void Target::set_timestamp( std::time_t timestamp )
+void Target::set_timestamp( int64_t timestamp )
 {
     timestamp_ = timestamp;
 }
@@ -508,7 +830,7 @@ void Target::set_timestamp( std::time_t timestamp )
 // @return
 //  The timestamp.
 */
-std::time_t Target::timestamp() const
+int64_t Target::timestamp() const
 {
     return timestamp_;
 }
@@ -524,7 +846,7 @@ std::time_t Target::timestamp() const
 // @return
 //  The last write time of the file that this Target is bound to.
 */
-std::time_t Target::last_write_time() const
+int64_t Target::last_write_time() const
 {
     return last_write_time_;
 }
@@ -584,6 +906,7 @@ bool Target::bound_to_file() const
 void Target::add_filename( const std::string& filename )
 {
     filenames_.push_back( filename );
+    dirty_ = true;
 }
 
 /**
@@ -605,7 +928,9 @@ void Target::set_filename( const std::string& filename, int index )
     if ( index >= int(filenames_.size()) )
     {
         filenames_.insert( filenames_.end(), index - filenames_.size() + 1, string() );
+        dirty_ = true;
     }
+    dirty_ = dirty_ || filenames_[index] != filename;
     filenames_[index] = filename;
 }
 
@@ -616,7 +941,11 @@ void Target::clear_filenames( int start, int finish )
 {
     vector<string>::iterator begin = filenames_.begin() + max( start, 0 );
     vector<string>::iterator end = filenames_.begin() + min( finish, int(filenames_.size()) );
-    filenames_.erase( begin, end );
+    if ( begin < end )
+    {
+        filenames_.erase( begin, end );
+        dirty_ = true;
+    }
 }
 
 /**
@@ -757,6 +1086,8 @@ void Target::destroy_anonymous_targets()
         }
     }
     targets_.erase( remove(targets_.begin(), targets_.end(), (Target*) NULL), targets_.end() );
+    targets_by_id_.clear();
+    indexed_targets_ = 0;
 }
 
 /**
@@ -770,12 +1101,55 @@ void Target::destroy_anonymous_targets()
 */
 Target* Target::find_target_by_id( const std::string& id ) const
 {
-    vector<Target*>::const_iterator i = targets_.begin();
-    while ( i != targets_.end() && (*i)->id() != id )
+    return find_target_by_id( id.c_str(), id.size() );
+}
+
+/**
+// Find a Target by id.
+//
+// Targets with only a few children search them linearly.  Targets with more
+// children, typically directories containing many source or generated files,
+// find them through an open addressing hash table of their children that is
+// built on demand.
+//
+// @param id
+//  The identifier of the Target to find (not necessarily null terminated).
+//
+// @param length
+//  The length of the identifier in bytes.
+//
+// @return
+//  The Target or null if no matching Target could be found.
+*/
+Target* Target::find_target_by_id( const char* id, size_t length ) const
+{
+    SWEET_ASSERT( id || length == 0 );
+
+    const size_t LINEAR_SEARCH_TARGETS = 8;
+    if ( targets_.size() <= LINEAR_SEARCH_TARGETS )
     {
-        ++i;
+        for ( vector<Target*>::const_iterator i = targets_.begin(); i != targets_.end(); ++i )
+        {
+            const string& target_id = (*i)->id();
+            if ( target_id.size() == length && memcmp(target_id.data(), id, length) == 0 )
+            {
+                return *i;
+            }
+        }
+        return NULL;
+    }
+
+    index_targets();
+    size_t mask = targets_by_id_.size() - 1;
+    for ( size_t i = hash_id(id, length) & mask; targets_by_id_[i]; i = (i + 1) & mask )
+    {
+        const string& target_id = targets_by_id_[i]->id();
+        if ( target_id.size() == length && memcmp(target_id.data(), id, length) == 0 )
+        {
+            return targets_by_id_[i];
+        }
     }
-    return i != targets_.end() ? *i : NULL;
+    return NULL;
 }
 
 /**
@@ -823,6 +1197,7 @@ void Target::add_explicit_dependency( Target* target )
         SWEET_ASSERT( target->graph() == graph() );
         remove_dependency( target );
         dependencies_.push_back( target );
+        index_dependency( target, DEPENDENCY_EXPLICIT );
         bound_to_dependencies_ = false;
     }
 }
@@ -836,6 +1211,7 @@ void Target::add_explicit_dependency( Target* target )
 void Target::clear_explicit_dependencies()
 {
     dependencies_.clear();
+    reset_dependency_index();
     bound_to_dependencies_ = false;
 }
 
@@ -852,18 +1228,24 @@ void Target::clear_explicit_dependencies()
 */
 void Target::add_implicit_dependency( Target* target )
 {
+    int kind = target ? dependency_kind( target ) : DEPENDENCY_NONE;
     bool able_to_add_implicit_dependency =
         target &&
         target != this &&
         !target->anonymous() &&
-        !is_explicit_dependency( target ) &&
-        !is_implicit_dependency( target )
+        kind != DEPENDENCY_EXPLICIT &&
+        kind != DEPENDENCY_IMPLICIT
     ;
     if ( able_to_add_implicit_dependency )
     {
-        remove_dependency( target );
+        if ( kind == DEPENDENCY_ORDERING )
+        {
+            remove_dependency( target );
+        }
         implicit_dependencies_.push_back( target );
+        index_dependency( target, DEPENDENCY_IMPLICIT );
         bound_to_dependencies_ = false;
+        dirty_ = true;
     }
 }
 
@@ -882,11 +1264,12 @@ void Target::remove_implicit_dependency( Target* target )
     if ( target && target != this )
     {
         SWEET_ASSERT( target->graph() == graph() );
-        vector<Target*>::iterator i = find( implicit_dependencies_.begin(), implicit_dependencies_.end(), target );
-        if ( i != implicit_dependencies_.end() )
+        if ( dependency_kind(target) == DEPENDENCY_IMPLICIT )
         {
-            implicit_dependencies_.erase( i );
+            implicit_dependencies_.erase( find(implicit_dependencies_.begin(), implicit_dependencies_.end(), target) );
+            index_dependency( target, DEPENDENCY_NONE );
             bound_to_dependencies_ = false;
+            dirty_ = true;
         }
     }
 }
@@ -899,7 +1282,9 @@ void Target::remove_implicit_dependency( Target* target )
 */
 void Target::clear_implicit_dependencies()
 {
+    dirty_ = dirty_ || !implicit_dependencies_.empty();
     implicit_dependencies_.clear();
+    reset_dependency_index();
     bound_to_dependencies_ = false;
 }
 
@@ -918,8 +1303,8 @@ void Target::add_ordering_dependency( Target* target )
     ;
     if ( able_to_add_ordering_dependency )
     {
-        remove_dependency( target );
         ordering_dependencies_.push_back( target );
+        index_dependency( target, DEPENDENCY_ORDERING );
     }
 }
 
@@ -929,6 +1314,7 @@ void Target::add_ordering_dependency( Target* target )
 void Target::clear_ordering_dependencies()
 {
     ordering_dependencies_.clear();
+    reset_dependency_index();
 }
 
 /**
@@ -952,29 +1338,26 @@ void Target::remove_dependency( Target* target )
     if ( target && target != this )
     {
         SWEET_ASSERT( target->graph() == graph() );
-        vector<Target*>::iterator i = find( dependencies_.begin(), dependencies_.end(), target );
-        if ( i != dependencies_.end() )
-        {
-            dependencies_.erase( i );
-            bound_to_dependencies_ = false;
-        }
-        else 
+        switch ( dependency_kind(target) )
         {
-            i = find( implicit_dependencies_.begin(), implicit_dependencies_.end(), target );
-            if ( i != implicit_dependencies_.end() )
-            {
-                implicit_dependencies_.erase( i );
+            case DEPENDENCY_EXPLICIT:
+                dependencies_.erase( find(dependencies_.begin(), dependencies_.end(), target) );
                 bound_to_dependencies_ = false;
-            }
-            else 
-            {
-                i = find( ordering_dependencies_.begin(), ordering_dependencies_.end(), target );
-                if ( i != ordering_dependencies_.end() )
-                {
-                    ordering_dependencies_.erase( i );
-                }
-            }
+                break;
+
+            case DEPENDENCY_IMPLICIT:
+                implicit_dependencies_.erase( find(implicit_dependencies_.begin(), implicit_dependencies_.end(), target) );
+                bound_to_dependencies_ = false;
+                break;
+
+            case DEPENDENCY_ORDERING:
+                ordering_dependencies_.erase( find(ordering_dependencies_.begin(), ordering_dependencies_.end(), target) );
+                break;
+
+            default:
+                return;
         }
+        index_dependency( target, DEPENDENCY_NONE );
     }
 }
 
@@ -989,7 +1372,7 @@ void Target::remove_dependency( Target* target )
 */
 bool Target::is_explicit_dependency( Target* target ) const
 {
-    return find( dependencies_.begin(), dependencies_.end(), target ) != dependencies_.end();
+    return dependency_kind( target ) == DEPENDENCY_EXPLICIT;
 }
 
 /**
@@ -1003,7 +1386,7 @@ bool Target::is_explicit_dependency( Target* target ) const
 */
 bool Target::is_implicit_dependency( Target* target ) const
 {
-    return find( implicit_dependencies_.begin(), implicit_dependencies_.end(), target ) != implicit_dependencies_.end();
+    return dependency_kind( target ) == DEPENDENCY_IMPLICIT;
 }
 
 /**
@@ -1017,7 +1400,7 @@ bool Target::is_implicit_dependency( Target* target ) const
 */
 bool Target::is_ordering_dependency( Target* target ) const
 {
-    return find( ordering_dependencies_.begin(), ordering_dependencies_.end(), target ) != ordering_dependencies_.end();
+    return dependency_kind( target ) == DEPENDENCY_ORDERING;
 }
 
 /**
@@ -1032,11 +1415,7 @@ bool Target::is_ordering_dependency( Target* target ) const
 */
 bool Target::is_dependency( Target* target ) const
 {
-    return 
-        is_explicit_dependency( target ) ||
-        is_implicit_dependency( target ) ||
-        is_ordering_dependency( target )
-    ;
+    return dependency_kind( target ) != DEPENDENCY_NONE;
 }
 
 /**
@@ -1414,6 +1793,31 @@ int Target::postorder_height() const
     return postorder_height_;
 }
 
+/**
+// Set the Job for this Target in the current postorder traversal.
+//
+// @param job
+//  The Job to set for this Target.
+*/
+void Target::set_postorder_job( Job* job )
+{
+    postorder_job_ = job;
+}
+
+/**
+// Get the Job for this Target in the current postorder traversal.
+//
+// Only valid for Targets that have been visited in the postorder traversal
+// that is currently in progress.
+//
+// @return
+//  The Job for this Target.
+*/
+Job* Target::postorder_job() const
+{
+    return postorder_job_;
+}
+
 /**
 // Get the next anonymous index from this Target.
 //
@@ -1436,34 +1840,102 @@ int Target::next_anonymous_index()
 */
 void Target::write( GraphWriter& writer )
 {
-    writer.object_address( this );
-    writer.value( id_ );
-    writer.value( last_write_time_ );
-    writer.value( hash_ );
-    writer.value( built_ );
-    writer.value( filenames_ );
-    writer.value( targets_ );
-    writer.refer( implicit_dependencies_ );    
+    writer.target( *id_, last_write_time_, hash_, digest_, inputs_digest_, duration_, built_, filenames_, targets_, implicit_dependencies_ );
+}
+
+/**
+// Append this Target to \e journal.
+//
+// @param journal
+//  The GraphJournal to append this Target to.
+*/
+void Target::write( GraphJournal& journal )
+{
+    journal.target( this, last_write_time_, hash_, digest_, inputs_digest_, duration_, built_, filenames_, implicit_dependencies_ );
 }
 
 /**
 // Read this Target from \e reader.
 //
+// Version 32 streams store last write times as seconds in a `time_t` and
+// have no duration; version 33 streams store seconds with a duration.  Times
+// read from them are converted to nanoseconds, which only costs an extra 
+// save when the converted time doesn't match the file's current one.
+//
 // @param reader 
 //  The GraphReader to deserialize this Target from.
 */
 void Target::read( GraphReader& reader )
 {
     reader.object_address( this );
-    reader.value( &id_ );
-    reader.value( &last_write_time_ );
+    string id;
+    reader.value( &id );
+    id_ = intern( id );
+    if ( reader.version() >= 34 )
+    {
+        reader.value( &last_write_time_ );
+    }
+    else
+    {
+        std::time_t last_write_time = 0;
+        reader.value( reinterpret_cast<char*>(&last_write_time), sizeof(last_write_time) );
+        last_write_time_ = int64_t(last_write_time) * 1000000000LL;
+    }
     reader.value( &hash_ );
+    if ( reader.version() >= 33 )
+    {
+        reader.value( &duration_ );
+    }
     reader.value( &built_ );
     reader.value( &filenames_ );
     reader.value( &targets_ );
     reader.refer( &implicit_dependencies_ );    
 }
 
+/**
+// Read this Target from its record in \e mapped_graph.
+//
+// @param mapped_graph
+//  The MappedGraph to read this Target's record from.
+//
+// @param index
+//  The index of this Target's record.
+//
+// @param targets
+//  The Targets created for every record in \e mapped_graph indexed by 
+//  record so that children and implicit dependencies can be looked up.
+*/
+void Target::read( const MappedGraph& mapped_graph, int index, const std::vector<Target*>& targets )
+{
+    const MappedGraph::TargetRecord& record = mapped_graph.target( index );
+    id_ = intern( mapped_graph.string(record.id) );
+    last_write_time_ = record.last_write_time;
+    hash_ = record.hash;
+    digest_ = record.digest;
+    inputs_digest_ = record.inputs_digest;
+    duration_ = record.duration;
+    built_ = record.built != 0;
+
+    filenames_.reserve( record.filenames );
+    for ( uint32_t i = record.first_filename; i < record.first_filename + record.filenames; ++i )
+    {
+        filenames_.push_back( mapped_graph.string(mapped_graph.filename(i)) );
+    }
+
+    targets_.reserve( record.targets );
+    for ( uint32_t i = record.first_target; i < record.first_target + record.targets; ++i )
+    {
+        targets_.push_back( targets[mapped_graph.reference(i)] );
+    }
+
+    implicit_dependencies_.reserve( record.dependencies );
+    for ( uint32_t i = record.first_dependency; i < record.first_dependency + record.dependencies; ++i )
+    {
+        implicit_dependencies_.push_back( targets[mapped_graph.reference(i)] );
+    }
+    reset_dependency_index();
+}
+
 /**
 // Resolve this Target's implicit dependencies to their new addresses.
 //
@@ -1481,6 +1953,7 @@ void Target::resolve( const GraphReader& reader )
         *i = reinterpret_cast<Target*>( reader.find_address_by_old_address(*i) );
     }
     implicit_dependencies_.erase( remove(implicit_dependencies_.begin(), implicit_dependencies_.end(), nullptr), implicit_dependencies_.end() );
+    reset_dependency_index();
 
     for ( vector<Target*>::const_iterator i = targets_.begin(); i != targets_.end(); ++i )
     {
@@ -1489,3 +1962,190 @@ void Target::resolve( const GraphReader& reader )
         target->resolve( reader );
     }
 }
+
+/**
+// Replay the state of this Target saved in a journal.
+//
+// The Target is marked as clean as its state is already saved in the 
+// journal that it was replayed from.
+*/
+void Target::replay( int64_t last_write_time, uint64_t hash, uint64_t digest, uint64_t inputs_digest, int duration, bool built, const std::vector<std::string>& filenames, const std::vector<Target*>& implicit_dependencies )
+{
+    last_write_time_ = last_write_time;
+    hash_ = hash;
+    digest_ = digest;
+    inputs_digest_ = inputs_digest;
+    duration_ = duration;
+    built_ = built;
+    filenames_ = filenames;
+    implicit_dependencies_ = implicit_dependencies;
+    reset_dependency_index();
+    dirty_ = false;
+}
+
+/**
+// Calculate the digest of the contents of the files that this Target is 
+// bound to.
+//
+// Files that can't be read, for example directories, contribute their last
+// write time in place of their contents.
+//
+// @return
+//  The digest or 0 if any of the files don't exist.
+*/
+uint64_t Target::content_digest() const
+{
+    uint64_t digest = uint64_t(filenames_.size());
+    System* system = graph_->forge()->system();
+    for ( vector<string>::const_iterator filename = filenames_.begin(); filename != filenames_.end(); ++filename )
+    {
+        uint64_t file_digest = 0;
+        if ( !system->digest(*filename, &file_digest) )
+        {
+            int64_t last_write_time = 0;
+            if ( !system->stat(*filename, &last_write_time) )
+            {
+                return 0;
+            }
+            file_digest = uint64_t(last_write_time);
+        }
+        digest = ContentHash::combine( digest, file_digest );
+    }
+    return digest;
+}
+
+/**
+// Calculate the digest of this Target's settings hash and the digests of its
+// binding dependencies.
+//
+// @return
+//  The digest.
+*/
+uint64_t Target::dependencies_digest() const
+{
+    uint64_t digest = hash_;
+    int i = 0;
+    Target* target = binding_dependency( i );
+    while ( target )
+    {
+        digest = ContentHash::combine( digest, target->digest() );
+        ++i;
+        target = binding_dependency( i );
+    }
+    return digest;
+}
+
+/**
+// Add any children not yet in the hash table of children to it.
+//
+// The hash table is kept at most half full so that probe sequences stay 
+// short and is rebuilt at twice the size whenever adding the children 
+// would fill it beyond that.  Children are only ever appended between calls
+// so the children not yet indexed are always at the end of `targets_`.
+*/
+void Target::index_targets() const
+{
+    if ( targets_.size() * 2 > targets_by_id_.size() )
+    {
+        size_t size = 16;
+        while ( size < targets_.size() * 2 )
+        {
+            size *= 2;
+        }
+        targets_by_id_.assign( size, nullptr );
+        indexed_targets_ = 0;
+    }
+
+    size_t mask = targets_by_id_.size() - 1;
+    while ( indexed_targets_ < targets_.size() )
+    {
+        Target* target = targets_[indexed_targets_];
+        SWEET_ASSERT( target );
+        size_t i = hash_id( target->id().data(), target->id().size() ) & mask;
+        while ( targets_by_id_[i] )
+        {
+            i = (i + 1) & mask;
+        }
+        targets_by_id_[i] = target;
+        ++indexed_targets_;
+    }
+}
+
+/**
+// Get the kind of dependency that a Target is of this Target.
+//
+// Targets with only a few dependencies search them linearly.  Targets with
+// more dependencies, typically objects that include thousands of headers, 
+// look their dependencies up in a hash table that is built on demand and 
+// kept up to date as dependencies are added and removed so that adding, 
+// removing, and checking for dependencies take constant time.
+//
+// @param target
+//  The Target to get the kind of dependency of.
+//
+// @return
+//  The kind of dependency that \e target is of this Target or 
+//  DEPENDENCY_NONE if it isn't a dependency of this Target.
+*/
+int Target::dependency_kind( const Target* target ) const
+{
+    if ( !dependency_kinds_ )
+    {
+        const size_t LINEAR_SEARCH_DEPENDENCIES = 16;
+        size_t dependencies = dependencies_.size() + implicit_dependencies_.size() + ordering_dependencies_.size();
+        if ( dependencies <= LINEAR_SEARCH_DEPENDENCIES )
+        {
+            if ( find(dependencies_.begin(), dependencies_.end(), target) != dependencies_.end() )
+            {
+                return DEPENDENCY_EXPLICIT;
+            }
+            if ( find(implicit_dependencies_.begin(), implicit_dependencies_.end(), target) != implicit_dependencies_.end() )
+            {
+                return DEPENDENCY_IMPLICIT;
+            }
+            if ( find(ordering_dependencies_.begin(), ordering_dependencies_.end(), target) != ordering_dependencies_.end() )
+            {
+                return DEPENDENCY_ORDERING;
+            }
+            return DEPENDENCY_NONE;
+        }
+
+        dependency_kinds_.reset( new unordered_map<const Target*, int>() );
+        dependency_kinds_->reserve( dependencies );
+        for ( vector<Target*>::const_iterator i = dependencies_.begin(); i != dependencies_.end(); ++i )
+        {
+            dependency_kinds_->insert( make_pair(*i, int(DEPENDENCY_EXPLICIT)) );
+        }
+        for ( vector<Target*>::const_iterator i = implicit_dependencies_.begin(); i != implicit_dependencies_.end(); ++i )
+        {
+            dependency_kinds_->insert( make_pair(*i, int(DEPENDENCY_IMPLICIT)) );
+        }
+        for ( vector<Target*>::const_iterator i = ordering_dependencies_.begin(); i != ordering_dependencies_.end(); ++i )
+        {
+            dependency_kinds_->insert( make_pair(*i, int(DEPENDENCY_ORDERING)) );
+        }
+    }
+
+    unordered_map<const Target*, int>::const_iterator i = dependency_kinds_->find( target );
+    return i != dependency_kinds_->end() ? i->second : int(DEPENDENCY_NONE);
+}
+
+void Target::index_dependency( const Target* target, int kind )
+{
+    if ( dependency_kinds_ )
+    {
+        if ( kind != DEPENDENCY_NONE )
+        {
+            (*dependency_kinds_)[target] = kind;
+        }
+        else
+        {
+            dependency_kinds_->erase( target );
+        }
+    }
+}
+
+void Target::reset_dependency_index()
+{
+    dependency_kinds_.reset();
+}
@@ -4,6 +4,9 @@
 #include <ctime>
 #include <string>
 #include <vector>
+#include <memory>
+#include <unordered_map>
+#include <stddef.h>
 #include <stdint.h>
 
 namespace sweet
@@ -13,25 +16,32 @@ namespace forge
 {
 
 class GraphWriter;
+class GraphJournal;
 class GraphReader;
+class MappedGraph;
 class TargetPrototype;
 class Graph;
 class Forge;
+class Job;
 
 /**
 // A Target.
 */
 class Target
 {
-    std::string id_; ///< The identifier of this Target.
-    mutable std::string path_; ///< The full path to this Target in the Target namespace.
-    mutable std::string branch_; ///< The branch path to this Target in the Target namespace.
-    Graph* graph_; ///< The Graph that this Target is part of.
-    TargetPrototype* prototype_; ///< The TargetPrototype for this Target or null if this Target has no TargetPrototype.
-    std::time_t timestamp_; ///< The timestamp for this Target.
-    std::time_t last_write_time_; ///< The last write time of the file that this Target is bound to.
-    uint64_t hash_; ///< The hash for this Target the last time that it was built.
-    uint64_t pending_hash_; ///< The hash for this Target when it was created in the current run.
+    enum DependencyKind
+    {
+        DEPENDENCY_NONE,
+        DEPENDENCY_EXPLICIT,
+        DEPENDENCY_IMPLICIT,
+        DEPENDENCY_ORDERING
+    };
+
+    int64_t timestamp_; ///< The timestamp for this Target (in nanoseconds since the epoch).
+    int visited_revision_; ///< The visited revision the last time this Target was visited.
+    int successful_revision_; ///< The successful revision the last time this Target was successfully visited.
+    int postorder_height_; ///< The height of this Target in the current or most recent dependency graph traversal.
+    bool visiting_; ///< Whether or not this Target is in the process of being visited.
     bool outdated_; ///< Whether or not this Target is out of date.
     bool changed_; ///< Whether or not this Target's timestamp has changed since the last time it was bound to a file.
     bool bound_to_file_; ///< Whether or not this Target is bound to a file.
@@ -39,31 +49,45 @@ class Target
     bool referenced_by_script_; ///< Whether or not this Target is referenced by a scripting object.  
     bool cleanable_; ///< Whether or not this Target is able to be cleaned.
     bool built_; ///< Whether or not this Target has had `Target::clear_implicit_dependencies()` called on it.
-    Target* working_directory_; ///< The Target that relative paths expressed when this Target is visited are relative to.
+    bool dirty_; ///< Whether or not this Target has changed since the Graph was last saved.
+    Job* postorder_job_; ///< The Job for this Target in the current postorder traversal.
     Target* parent_; ///< The parent of this Target in the Target namespace or null if this Target has no parent.
-    std::vector<Target*> targets_; ///< The children of this Target in the Target namespace.
     std::vector<Target*> dependencies_; ///< The Targets that this Target depends on.
     std::vector<Target*> implicit_dependencies_; ///< The Targets that this Target implicitly depends on.
     std::vector<Target*> ordering_dependencies_; ///< The Targets that must build before this Target is built.
-    std::vector<std::string> filenames_; ///< The filenames of this Target.
-    bool visiting_; ///< Whether or not this Target is in the process of being visited.
-    int visited_revision_; ///< The visited revision the last time this Target was visited.
-    int successful_revision_; ///< The successful revision the last time this Target was successfully visited.
-    int postorder_height_; ///< The height of this Target in the current or most recent dependency graph traversal.
+    const std::string* id_; ///< The identifier of this Target (shared with other Targets with the same identifier).
+    mutable std::unique_ptr<std::string> path_; ///< The full path to this Target in the Target namespace or null if it hasn't been requested.
+    Graph* graph_; ///< The Graph that this Target is part of.
+    TargetPrototype* prototype_; ///< The TargetPrototype for this Target or null if this Target has no TargetPrototype.
+    int64_t last_write_time_; ///< The last write time of the file that this Target is bound to (in nanoseconds since the epoch).
+    uint64_t hash_; ///< The hash for this Target the last time that it was built.
+    uint64_t pending_hash_; ///< The hash for this Target when it was created in the current run.
+    uint64_t digest_; ///< The digest of the contents of the files that this Target is bound to or of its dependencies if it isn't bound to any files.
+    uint64_t inputs_digest_; ///< The digest of this Target's dependencies the last time that it was built.
+    int duration_; ///< The wall-clock time, in milliseconds, taken by the most recent visit that built this Target.
     int anonymous_; ///< The anonymous index for this Target that will generate the next anonymous identifier requested from this Target.
+    Target* working_directory_; ///< The Target that relative paths expressed when this Target is visited are relative to.
+    std::vector<Target*> targets_; ///< The children of this Target in the Target namespace.
+    mutable std::vector<Target*> targets_by_id_; ///< The children of this Target in an open addressing hash table indexed by identifier.
+    mutable size_t indexed_targets_; ///< The number of children that have been added to the hash table.
+    mutable std::unique_ptr<std::unordered_map<const Target*, int>> dependency_kinds_; ///< The kind of each explicit, implicit, and ordering dependency of this Target or null if they are searched linearly.
+    std::vector<std::string> filenames_; ///< The filenames of this Target.
 
     public:
         Target();
         Target( const std::string& id, Graph* graph );
         ~Target();
+        static void* operator new( size_t size );
+        static void operator delete( void* object );
         void recover( Graph* graph );
 
         const std::string& id() const;
         const std::string& path() const;
-        const std::string& branch() const;
+        std::string branch() const;
         Graph* graph() const;
         bool anonymous() const;
         uint64_t hash() const;
+        uint64_t digest() const;
 
         void set_prototype( TargetPrototype* target_prototype );
         TargetPrototype* prototype() const;
@@ -72,7 +96,10 @@ class Target
         void bind_to_file();
         void bind_to_dependencies();
         void bind_to_hash();
+        void unbind();
         void set_hash( uint64_t hash );
+        void update_digests();
+        void rebind_to_dependencies();
 
         void set_referenced_by_script( bool referenced_by_script );
         bool referenced_by_script() const;
@@ -83,9 +110,15 @@ class Target
         void set_built( bool built );
         bool built() const;
 
-        void set_timestamp( std::time_t timestamp );
-        std::time_t timestamp() const;
-        std::time_t last_write_time() const;
+        void set_duration( int duration );
+        int duration() const;
+
+        void set_dirty( bool dirty );
+        bool dirty() const;
+
+        void set_timestamp( int64_t timestamp );
+        int64_t timestamp() const;
+        int64_t last_write_time() const;
 
         void set_outdated( bool outdated );
         bool outdated() const;
@@ -108,6 +141,7 @@ class Target
         void add_target( Target* target, Target* this_target );
         void destroy_anonymous_targets();
         Target* find_target_by_id( const std::string& id ) const;
+        Target* find_target_by_id( const char* id, size_t length ) const;
         const std::vector<Target*>& targets() const;
 
         void add_explicit_dependency( Target* target );
@@ -143,13 +177,27 @@ class Target
 
         void set_postorder_height( int height );
         int postorder_height() const;
+
+        void set_postorder_job( Job* job );
+        Job* postorder_job() const;
         
         int next_anonymous_index();
 
         void write( GraphWriter& writer );
+        void write( GraphJournal& journal );
         void read( GraphReader& reader );
+        void read( const MappedGraph& mapped_graph, int index, const std::vector<Target*>& targets );
         void resolve( const GraphReader& reader );
+        void replay( int64_t last_write_time, uint64_t hash, uint64_t digest, uint64_t inputs_digest, int duration, bool built, const std::vector<std::string>& filenames, const std::vector<Target*>& implicit_dependencies );
         template <class Archive> void persist( Archive& archive );
+
+    private:
+        uint64_t content_digest() const;
+        uint64_t dependencies_digest() const;
+        void index_targets() const;
+        int dependency_kind( const Target* target ) const;
+        void index_dependency( const Target* target, int kind );
+        void reset_dependency_index();
 };
 
 }
@@ -0,0 +1,356 @@
+//
+// ThreadPool.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "ThreadPool.hpp"
+#include "Forge.hpp"
+#include "Trace.hpp"
+#include <assert/assert.hpp>
+#include <stdlib.h>
+#include <stdio.h>
+#include <memory>
+#include <algorithm>
+
+using std::max;
+using std::min;
+using std::vector;
+using std::unique_ptr;
+using namespace sweet;
+using namespace sweet::forge;
+
+namespace
+{
+
+// The ThreadPool and index of the Worker that the current thread belongs to
+// so that functions pushed from within a ThreadPool are queued locally.
+thread_local ThreadPool* current_thread_pool = nullptr;
+thread_local int current_index = -1;
+
+}
+
+/**
+// The shared state of a call to `ThreadPool::parallel()`.
+*/
+struct ThreadPool::Parallel
+{
+    std::atomic<int> next_; ///< The index of the start of the next range to process.
+    int size_; ///< The number of indices to process.
+    int grain_; ///< The number of indices in each range.
+    const std::function<void (int, int)>* function_; ///< The function to call for each range.
+    std::mutex mutex_; ///< The mutex that ensures exclusive access to `active_`.
+    std::condition_variable finished_condition_; ///< The condition that notifies that all threads have finished.
+    int active_; ///< The number of threads still processing ranges.
+};
+
+ThreadPool::Worker::Worker()
+: mutex_(),
+  ready_condition_(),
+  functions_(),
+  thread_( nullptr ),
+  sleeping_( false ),
+  woken_( false )
+{
+}
+
+ThreadPool::ThreadPool( Forge* forge, const char* name )
+: forge_( forge ),
+  name_( name ),
+  workers_(),
+  queued_( 0 ),
+  next_( 0 ),
+  threads_( 1 ),
+  done_( false )
+{
+    SWEET_ASSERT( forge_ );
+    SWEET_ASSERT( name_ );
+}
+
+ThreadPool::~ThreadPool()
+{
+    stop();
+}
+
+int ThreadPool::threads() const
+{
+    return threads_;
+}
+
+/**
+// Set the number of threads in this ThreadPool.
+//
+// Stops any threads that are already running, after they have finished
+// processing the functions queued for them, and starts the new number of 
+// threads the next time that a function is pushed.
+//
+// @param threads
+//  The number of threads to run (clamped to at least one).
+*/
+void ThreadPool::set_threads( int threads )
+{
+    stop();
+    threads_ = max( 1, threads );
+}
+
+/**
+// Push a function to be processed by a thread in this ThreadPool.
+//
+// @param function
+//  The function to process.
+*/
+void ThreadPool::push( const std::function<void ()>& function )
+{
+    start();
+
+    int index = current_thread_pool == this ? current_index : int(next_++ % workers_.size());
+    SWEET_ASSERT( index >= 0 && index < int(workers_.size()) );
+    Worker* worker = workers_[index];
+    {
+        std::unique_lock<std::mutex> lock( worker->mutex_ );
+        worker->functions_.push_back( function );
+        ++queued_;
+        if ( worker->sleeping_ )
+        {
+            worker->woken_ = true;
+            worker->ready_condition_.notify_one();
+            return;
+        }
+    }
+    wake( index );
+}
+
+/**
+// Call a function for ranges of indices in parallel.
+//
+// The indices [0, \e size) are split into ranges of \e grain indices that
+// are processed by the threads in this ThreadPool and the calling thread.
+// Returns once \e function has been called for every range.  Must not be
+// called from a thread in this ThreadPool.
+//
+// @param size
+//  The number of indices to process.
+//
+// @param grain
+//  The number of indices to pass to each call to \e function.
+//
+// @param function
+//  The function to call with the first and one past the last index of each
+//  range.
+*/
+void ThreadPool::parallel( int size, int grain, const std::function<void (int, int)>& function )
+{
+    SWEET_ASSERT( grain > 0 );
+    SWEET_ASSERT( current_thread_pool != this );
+
+    int ranges = (size + grain - 1) / grain;
+    if ( ranges <= 1 )
+    {
+        if ( size > 0 )
+        {
+            function( 0, size );
+        }
+        return;
+    }
+
+    Parallel parallel;
+    parallel.next_ = 0;
+    parallel.size_ = size;
+    parallel.grain_ = grain;
+    parallel.function_ = &function;
+    parallel.active_ = 1 + min( threads_, ranges - 1 );
+    for ( int i = 1; i < parallel.active_; ++i )
+    {
+        push( std::bind(&ThreadPool::parallel_process, &parallel) );
+    }
+    parallel_process( &parallel );
+
+    std::unique_lock<std::mutex> lock( parallel.mutex_ );
+    while ( parallel.active_ > 0 )
+    {
+        parallel.finished_condition_.wait( lock );
+    }
+}
+
+void ThreadPool::parallel_process( Parallel* parallel )
+{
+    SWEET_ASSERT( parallel );
+    int begin = parallel->next_.fetch_add( parallel->grain_ );
+    while ( begin < parallel->size_ )
+    {
+        (*parallel->function_)( begin, min(begin + parallel->grain_, parallel->size_) );
+        begin = parallel->next_.fetch_add( parallel->grain_ );
+    }
+
+    std::unique_lock<std::mutex> lock( parallel->mutex_ );
+    --parallel->active_;
+    if ( parallel->active_ == 0 )
+    {
+        parallel->finished_condition_.notify_one();
+    }
+}
+
+int ThreadPool::thread_main( ThreadPool* thread_pool, int index )
+{
+    SWEET_ASSERT( thread_pool );
+    char name [64];
+    snprintf( name, sizeof(name), "%s %d", thread_pool->name_, index );
+    thread_pool->forge_->trace()->set_thread_name( name );
+    current_thread_pool = thread_pool;
+    current_index = index;
+    thread_pool->thread_process( index );
+    return EXIT_SUCCESS;
+}
+
+void ThreadPool::thread_process( int index )
+{
+    SWEET_ASSERT( index >= 0 && index < int(workers_.size()) );
+
+    Worker* worker = workers_[index];
+    std::function<void ()> function;
+    for ( ;; )
+    {
+        if ( pop(index, &function) || steal(index, &function) )
+        {
+            function();
+            function = nullptr;
+            continue;
+        }
+
+        // Check for queued functions after marking this Worker as sleeping
+        // and with its mutex locked so that a function pushed onto another
+        // Worker's queue between the failed steal above and sleeping below 
+        // either is seen here or sees this Worker sleeping and wakes it.
+        std::unique_lock<std::mutex> lock( worker->mutex_ );
+        worker->sleeping_ = true;
+        while ( !done_ && !worker->woken_ && worker->functions_.empty() && queued_ == 0 )
+        {
+            worker->ready_condition_.wait( lock );
+        }
+        worker->sleeping_ = false;
+        worker->woken_ = false;
+        if ( done_ && worker->functions_.empty() && queued_ == 0 )
+        {
+            break;
+        }
+    }
+}
+
+/**
+// Pop the oldest function queued for a Worker.
+//
+// Functions are popped in the order that they are queued so that Jobs are
+// dispatched in the order that the Scheduler prioritizes them.
+*/
+bool ThreadPool::pop( int index, std::function<void ()>* function )
+{
+    SWEET_ASSERT( function );
+    Worker* worker = workers_[index];
+    std::unique_lock<std::mutex> lock( worker->mutex_ );
+    if ( !worker->functions_.empty() )
+    {
+        function->swap( worker->functions_.front() );
+        worker->functions_.pop_front();
+        --queued_;
+        return true;
+    }
+    return false;
+}
+
+/**
+// Steal the newest function queued for any other Worker.
+*/
+bool ThreadPool::steal( int index, std::function<void ()>* function )
+{
+    SWEET_ASSERT( function );
+    int workers = int(workers_.size());
+    for ( int i = 1; i < workers && queued_ > 0; ++i )
+    {
+        Worker* worker = workers_[(index + i) % workers];
+        std::unique_lock<std::mutex> lock( worker->mutex_ );
+        if ( !worker->functions_.empty() )
+        {
+            function->swap( worker->functions_.back() );
+            worker->functions_.pop_back();
+            --queued_;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+// Wake one sleeping Worker, other than the Worker at \e index, to steal 
+// a function queued on a busy Worker.
+*/
+void ThreadPool::wake( int index )
+{
+    int workers = int(workers_.size());
+    for ( int i = 1; i < workers; ++i )
+    {
+        Worker* worker = workers_[(index + i) % workers];
+        std::unique_lock<std::mutex> lock( worker->mutex_ );
+        if ( worker->sleeping_ && !worker->woken_ )
+        {
+            worker->woken_ = true;
+            worker->ready_condition_.notify_one();
+            return;
+        }
+    }
+}
+
+void ThreadPool::start()
+{
+    SWEET_ASSERT( threads_ > 0 );
+
+    if ( workers_.empty() )
+    {
+        done_ = false;
+        workers_.reserve( threads_ );
+        for ( int i = 0; i < threads_; ++i )
+        {
+            workers_.push_back( new Worker );
+        }
+        for ( int i = 0; i < threads_; ++i )
+        {
+            workers_[i]->thread_ = new std::thread( &ThreadPool::thread_main, this, i );
+        }
+    }
+}
+
+void ThreadPool::stop()
+{
+    if ( !workers_.empty() )
+    {
+        done_ = true;
+        for ( vector<Worker*>::iterator i = workers_.begin(); i != workers_.end(); ++i )
+        {
+            Worker* worker = *i;
+            SWEET_ASSERT( worker );
+            std::unique_lock<std::mutex> lock( worker->mutex_ );
+            worker->ready_condition_.notify_one();
+        }
+
+        for ( vector<Worker*>::iterator i = workers_.begin(); i != workers_.end(); ++i )
+        {
+            try
+            {
+                Worker* worker = *i;
+                SWEET_ASSERT( worker && worker->thread_ );
+                worker->thread_->join();
+            }
+
+            catch ( const std::exception& exception )
+            {
+                forge_->errorf( "Failed to join thread - %s", exception.what() );
+            }
+        }
+
+        while ( !workers_.empty() )
+        {
+            Worker* worker = workers_.back();
+            delete worker->thread_;
+            delete worker;
+            workers_.pop_back();
+        }
+    }
+}
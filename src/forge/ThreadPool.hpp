@@ -0,0 +1,78 @@
+#ifndef FORGE_THREADPOOL_HPP_INCLUDED
+#define FORGE_THREADPOOL_HPP_INCLUDED
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <atomic>
+
+namespace sweet
+{
+
+namespace forge
+{
+
+class Forge;
+
+/**
+// A fixed size pool of threads that process functions pushed from the main
+// thread and from the threads in the pool.
+//
+// Each thread has its own queue of functions.  Functions pushed from a 
+// thread in the pool are queued on that thread's queue and functions pushed
+// from other threads are distributed across the queues in turn.  Threads 
+// process the functions in their own queue first and then steal from the 
+// queues of the other threads.  Pushing a function wakes at most one 
+// sleeping thread.
+*/
+class ThreadPool
+{
+    struct Parallel;
+
+    struct Worker
+    {
+        std::mutex mutex_; ///< The mutex that ensures exclusive access to this Worker.
+        std::condition_variable ready_condition_; ///< The condition that wakes this Worker when there are functions to process.
+        std::deque<std::function<void ()> > functions_; ///< The functions queued for this Worker to process.
+        std::thread* thread_; ///< The thread for this Worker.
+        bool sleeping_; ///< Whether or not this Worker is waiting for functions to process.
+        bool woken_; ///< Whether or not this Worker has been woken to steal functions from another Worker.
+
+        Worker();
+    };
+
+    Forge* forge_; ///< The Forge that this ThreadPool is part of.
+    const char* name_; ///< The name given to the threads in this ThreadPool.
+    std::vector<Worker*> workers_; ///< The Workers in this ThreadPool.
+    std::atomic<int> queued_; ///< The number of functions queued and not yet started.
+    std::atomic<unsigned int> next_; ///< The index of the Worker to queue the next function pushed from outside this ThreadPool on.
+    int threads_; ///< The number of threads to start.
+    std::atomic<bool> done_; ///< Whether or not this ThreadPool has finished processing (indicates to the threads that they should return).
+
+    public:
+        ThreadPool( Forge* forge, const char* name );
+        ~ThreadPool();
+        int threads() const;
+        void set_threads( int threads );
+        void push( const std::function<void ()>& function );
+        void parallel( int size, int grain, const std::function<void (int, int)>& function );
+
+    private:
+        static void parallel_process( Parallel* parallel );
+        static int thread_main( ThreadPool* thread_pool, int index );
+        void thread_process( int index );
+        bool pop( int index, std::function<void ()>* function );
+        bool steal( int index, std::function<void ()>* function );
+        void wake( int index );
+        void start();
+        void stop();
+};
+
+}
+
+}
+
+#endif
@@ -0,0 +1,325 @@
+//
+// Throttle.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "Throttle.hpp"
+#include "Forge.hpp"
+#include "System.hpp"
+#include "Statistics.hpp"
+#include "Trace.hpp"
+#include <assert/assert.hpp>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using std::max;
+using std::min;
+using namespace sweet;
+using namespace sweet::forge;
+
+Throttle::Throttle( Forge* forge )
+: forge_( forge ),
+  mutex_(),
+  enabled_( false ),
+  cpu_pressure_( 20.0f ),
+  memory_pressure_( 10.0f ),
+  memory_available_( 1024 ),
+  interval_( 2000 ),
+  last_sample_time_(),
+  limit_( 0 )
+{
+    SWEET_ASSERT( forge_ );
+}
+
+/**
+// Set whether or not the number of processes run in parallel adapts to the
+// load on the machine.
+//
+// @param enabled
+//  True to adapt to the load on the machine or false to always allow the
+//  maximum number of parallel jobs.
+*/
+void Throttle::set_enabled( bool enabled )
+{
+    std::unique_lock<std::mutex> lock( mutex_ );
+    enabled_ = enabled;
+    limit_ = 0;
+}
+
+/**
+// Does the number of processes run in parallel adapt to the load on the
+// machine?
+//
+// @return
+//  True if the number of processes adapts otherwise false.
+*/
+bool Throttle::enabled() const
+{
+    std::unique_lock<std::mutex> lock( mutex_ );
+    return enabled_;
+}
+
+/**
+// Set the target CPU pressure.
+//
+// @param cpu_pressure
+//  The percentage of time that runnable tasks may be stalled waiting for a
+//  CPU before fewer processes are run in parallel.
+*/
+void Throttle::set_cpu_pressure( float cpu_pressure )
+{
+    std::unique_lock<std::mutex> lock( mutex_ );
+    cpu_pressure_ = cpu_pressure;
+}
+
+/**
+// Get the target CPU pressure.
+//
+// @return
+//  The target CPU pressure as a percentage.
+*/
+float Throttle::cpu_pressure() const
+{
+    std::unique_lock<std::mutex> lock( mutex_ );
+    return cpu_pressure_;
+}
+
+/**
+// Set the target memory pressure.
+//
+// @param memory_pressure
+//  The percentage of time that tasks may be stalled waiting for memory
+//  before fewer processes are run in parallel.
+*/
+void Throttle::set_memory_pressure( float memory_pressure )
+{
+    std::unique_lock<std::mutex> lock( mutex_ );
+    memory_pressure_ = memory_pressure;
+}
+
+/**
+// Get the target memory pressure.
+//
+// @return
+//  The target memory pressure as a percentage.
+*/
+float Throttle::memory_pressure() const
+{
+    std::unique_lock<std::mutex> lock( mutex_ );
+    return memory_pressure_;
+}
+
+/**
+// Set the minimum available memory.
+//
+// @param memory_available
+//  The number of megabytes of memory that must remain available before
+//  the number of processes run in parallel is halved or 0 to ignore
+//  available memory.
+*/
+void Throttle::set_memory_available( int64_t memory_available )
+{
+    std::unique_lock<std::mutex> lock( mutex_ );
+    memory_available_ = memory_available;
+}
+
+/**
+// Get the minimum available memory.
+//
+// @return
+//  The minimum available memory in megabytes.
+*/
+int64_t Throttle::memory_available() const
+{
+    std::unique_lock<std::mutex> lock( mutex_ );
+    return memory_available_;
+}
+
+/**
+// Set the minimum time between samples of the load on the machine.
+//
+// @param interval
+//  The minimum time between samples in milliseconds.
+*/
+void Throttle::set_interval( int interval )
+{
+    std::unique_lock<std::mutex> lock( mutex_ );
+    interval_ = max( 0, interval );
+}
+
+/**
+// Get the minimum time between samples of the load on the machine.
+//
+// @return
+//  The minimum time between samples in milliseconds.
+*/
+int Throttle::interval() const
+{
+    std::unique_lock<std::mutex> lock( mutex_ );
+    return interval_;
+}
+
+/**
+// Get the number of processes that may run in parallel.
+//
+// Samples the load on the machine and adjusts the limit if the interval
+// has passed since the last sample.  Called by the Executor each time that
+// it dispatches queued execute calls.
+//
+// @param active_jobs
+//  The number of processes currently running.
+//
+// @param jobs_waiting
+//  True if there are execute calls waiting to run otherwise false.
+//
+// @param maximum_parallel_jobs
+//  The maximum number of parallel jobs.
+//
+// @return
+//  The number of processes that may run in parallel.
+*/
+int Throttle::limit( int active_jobs, bool jobs_waiting, int maximum_parallel_jobs )
+{
+    std::unique_lock<std::mutex> lock( mutex_ );
+    if ( !enabled_ )
+    {
+        return maximum_parallel_jobs;
+    }
+
+    if ( limit_ <= 0 )
+    {
+        limit_ = maximum_parallel_jobs;
+    }
+    limit_ = min( limit_, maximum_parallel_jobs );
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if ( now - last_sample_time_ < std::chrono::milliseconds(interval_) )
+    {
+        return limit_;
+    }
+    last_sample_time_ = now;
+
+    Sample sample;
+    if ( !measure(&sample) )
+    {
+        return limit_;
+    }
+
+    int limit = limit_;
+    if ( memory_available_ > 0 && sample.memory_available >= 0 && sample.memory_available < memory_available_ )
+    {
+        limit = limit / 2;
+    }
+    else if ( sample.memory_pressure > memory_pressure_ )
+    {
+        limit -= max( 1, limit / 4 );
+    }
+    else if ( sample.cpu_pressure > cpu_pressure_ )
+    {
+        limit -= 1;
+    }
+    else if ( jobs_waiting && active_jobs >= limit && sample.cpu_pressure < cpu_pressure_ / 2.0f && sample.memory_pressure < memory_pressure_ / 2.0f )
+    {
+        limit += 1;
+    }
+    limit = max( 1, min(limit, maximum_parallel_jobs) );
+
+    Statistics* statistics = forge_->statistics();
+    if ( limit < limit_ )
+    {
+        statistics->add( Statistics::COUNTER_JOBS_DECREASED );
+    }
+    else if ( limit > limit_ )
+    {
+        statistics->add( Statistics::COUNTER_JOBS_INCREASED );
+    }
+
+    Trace* trace = forge_->trace();
+    trace->counter( "throttle", "jobs", limit );
+    trace->counter( "throttle", "cpu_pressure", int64_t(sample.cpu_pressure) );
+    trace->counter( "throttle", "memory_pressure", int64_t(sample.memory_pressure) );
+    trace->counter( "throttle", "memory_available", sample.memory_available );
+
+    limit_ = limit;
+    return limit_;
+}
+
+bool Throttle::measure( Sample* sample ) const
+{
+    SWEET_ASSERT( sample );
+
+#if defined(BUILD_OS_LINUX)
+    // Fall back to estimating CPU pressure from the one minute load average
+    // per logical processor on kernels without pressure stall information.
+    if ( !read_pressure("/proc/pressure/cpu", &sample->cpu_pressure) )
+    {
+        char buffer [256];
+        if ( !read_file("/proc/loadavg", buffer, sizeof(buffer)) )
+        {
+            return false;
+        }
+        float load = float( strtod(buffer, nullptr) );
+        float processors = float( max(1, forge_->system()->number_of_logical_processors()) );
+        sample->cpu_pressure = min( 100.0f, max(0.0f, (load / processors - 1.0f) * 100.0f) );
+    }
+
+    if ( !read_pressure("/proc/pressure/memory", &sample->memory_pressure) )
+    {
+        sample->memory_pressure = 0.0f;
+    }
+
+    sample->memory_available = -1;
+    char buffer [4096];
+    if ( read_file("/proc/meminfo", buffer, sizeof(buffer)) )
+    {
+        const char* memory_available = strstr( buffer, "MemAvailable:" );
+        if ( memory_available )
+        {
+            sample->memory_available = strtoll( memory_available + strlen("MemAvailable:"), nullptr, 10 ) / 1024;
+        }
+    }
+    return true;
+#else
+    (void) sample;
+    return false;
+#endif
+}
+
+bool Throttle::read_file( const char* filename, char* buffer, size_t length )
+{
+    SWEET_ASSERT( filename );
+    SWEET_ASSERT( buffer );
+    SWEET_ASSERT( length > 0 );
+    FILE* file = fopen( filename, "rb" );
+    if ( !file )
+    {
+        return false;
+    }
+    size_t read = fread( buffer, 1, length - 1, file );
+    fclose( file );
+    buffer[read] = 0;
+    return read > 0;
+}
+
+/**
+// Read the ten second average of the "some" line from a pressure stall
+// information file (e.g. "some avg10=1.53 avg60=0.87 avg300=0.21 total=...").
+*/
+bool Throttle::read_pressure( const char* filename, float* pressure )
+{
+    SWEET_ASSERT( pressure );
+    char buffer [256];
+    if ( !read_file(filename, buffer, sizeof(buffer)) )
+    {
+        return false;
+    }
+    const char* average = strstr( buffer, "some avg10=" );
+    if ( !average )
+    {
+        return false;
+    }
+    *pressure = float( strtod(average + strlen("some avg10="), nullptr) );
+    return true;
+}
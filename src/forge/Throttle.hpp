@@ -0,0 +1,78 @@
+#ifndef FORGE_THROTTLE_HPP_INCLUDED
+#define FORGE_THROTTLE_HPP_INCLUDED
+
+#include <mutex>
+#include <chrono>
+#include <stdint.h>
+
+namespace sweet
+{
+
+namespace forge
+{
+
+class Forge;
+
+/**
+// Adjust the number of processes run in parallel to the load on the
+// machine.
+//
+// When enabled the CPU and memory pressure stall information in
+// `/proc/pressure/cpu` and `/proc/pressure/memory` (or the load average in
+// `/proc/loadavg` on kernels without pressure stall information) and the
+// available memory in `/proc/meminfo` are sampled at most once per
+// interval as processes are started and finish.  The limit is halved when
+// available memory falls below its minimum, reduced by a quarter when
+// memory pressure exceeds its target, reduced by one when CPU pressure
+// exceeds its target, and raised by one when every slot is in use, more
+// processes are waiting, and both pressures are below half of their
+// targets.  The limit never exceeds the maximum number of parallel jobs
+// and never falls below one.
+//
+// Only Linux provides the information needed so on other platforms the
+// limit is always the maximum number of parallel jobs.
+*/
+class Throttle
+{
+    struct Sample
+    {
+        float cpu_pressure; ///< The percentage of time that runnable tasks were stalled waiting for a CPU.
+        float memory_pressure; ///< The percentage of time that tasks were stalled waiting for memory.
+        int64_t memory_available; ///< The memory available for starting new processes in megabytes.
+    };
+
+    Forge* forge_; ///< The Forge that this Throttle is part of.
+    mutable std::mutex mutex_; ///< The mutex that ensures exclusive access to this Throttle.
+    bool enabled_; ///< Whether or not the limit adapts to the load on the machine.
+    float cpu_pressure_; ///< The target CPU pressure as a percentage.
+    float memory_pressure_; ///< The target memory pressure as a percentage.
+    int64_t memory_available_; ///< The minimum available memory in megabytes.
+    int interval_; ///< The minimum time between samples in milliseconds.
+    std::chrono::steady_clock::time_point last_sample_time_; ///< The time that the load was last sampled.
+    int limit_; ///< The current limit on the number of processes run in parallel or 0 if not yet sampled.
+
+public:
+    Throttle( Forge* forge );
+    void set_enabled( bool enabled );
+    bool enabled() const;
+    void set_cpu_pressure( float cpu_pressure );
+    float cpu_pressure() const;
+    void set_memory_pressure( float memory_pressure );
+    float memory_pressure() const;
+    void set_memory_available( int64_t memory_available );
+    int64_t memory_available() const;
+    void set_interval( int interval );
+    int interval() const;
+    int limit( int active_jobs, bool jobs_waiting, int maximum_parallel_jobs );
+
+private:
+    bool measure( Sample* sample ) const;
+    static bool read_file( const char* filename, char* buffer, size_t length );
+    static bool read_pressure( const char* filename, float* pressure );
+};
+
+}
+
+}
+
+#endif
@@ -0,0 +1,325 @@
+//
+// Trace.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "Trace.hpp"
+#include <assert/assert.hpp>
+#include <stdio.h>
+
+using std::map;
+using std::string;
+using std::vector;
+using namespace sweet;
+using namespace sweet::forge;
+
+Trace::Trace()
+: enabled_( false ),
+  filename_(),
+  origin_( std::chrono::steady_clock::now() ),
+  mutex_(),
+  events_(),
+  threads_(),
+  thread_names_()
+{
+    set_thread_name( "main" );
+}
+
+/**
+// Set the file to write recorded events to.
+//
+// @param filename
+//  The file to write recorded events to or the empty string to disable
+//  recording.
+*/
+void Trace::set_filename( const std::string& filename )
+{
+    filename_ = filename;
+    enabled_ = !filename_.empty();
+}
+
+/**
+// Get the file that recorded events are written to.
+//
+// @return
+//  The filename or the empty string if recording is disabled.
+*/
+const std::string& Trace::filename() const
+{
+    return filename_;
+}
+
+/**
+// Are events being recorded?
+//
+// @return
+//  True if events are being recorded otherwise false.
+*/
+bool Trace::enabled() const
+{
+    return enabled_;
+}
+
+/**
+// Get the current time.
+//
+// @return
+//  The number of microseconds since this Trace was created measured with a
+//  monotonic clock.
+*/
+int64_t Trace::now() const
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>( steady_clock::now() - origin_ ).count();
+}
+
+/**
+// Name the track that the current thread's spans appear on.
+//
+// Threads are named whether or not recording is enabled so that threads
+// started before a filename is set are still named.
+//
+// @param name
+//  The name of the current thread.
+*/
+void Trace::set_thread_name( const std::string& name )
+{
+    std::unique_lock<std::mutex> lock( mutex_ );
+    int index = thread_index();
+    thread_names_[index] = name;
+}
+
+/**
+// Record a span that started at \e start and finishes now on the current
+// thread.
+//
+// @param category
+//  The category of the span (assumed to be a string literal).
+//
+// @param name
+//  The name of the span (assumed to be a string literal).
+//
+// @param detail
+//  The detail of the span or null for no detail.
+//
+// @param start
+//  The time that the span started as returned by `now()`.
+*/
+void Trace::complete( const char* category, const char* name, const char* detail, int64_t start )
+{
+    if ( enabled_ )
+    {
+        record( category, name, detail, 'X', start, now() - start, 0 );
+    }
+}
+
+/**
+// Record the start of an asynchronous span that may finish on another
+// thread.
+//
+// @param id
+//  The identifier that pairs this start with the call to `end()` that
+//  finishes the span.
+*/
+void Trace::begin( const char* category, const char* name, const char* detail, uint64_t id )
+{
+    if ( enabled_ )
+    {
+        record( category, name, detail, 'b', now(), 0, id );
+    }
+}
+
+/**
+// Record the finish of an asynchronous span.
+*/
+void Trace::end( const char* category, const char* name, uint64_t id )
+{
+    if ( enabled_ )
+    {
+        record( category, name, nullptr, 'e', now(), 0, id );
+    }
+}
+
+/**
+// Record the value of a counter that is graphed on its own track.
+//
+// @param value
+//  The value of the counter from now until its next recorded value.
+*/
+void Trace::counter( const char* category, const char* name, int64_t value )
+{
+    if ( enabled_ )
+    {
+        record( category, name, nullptr, 'C', now(), value, 0 );
+    }
+}
+
+/**
+// Write the recorded events to the file set with `set_filename()`.
+//
+// @return
+//  True if the events were written otherwise false.
+*/
+bool Trace::save()
+{
+    if ( filename_.empty() )
+    {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock( mutex_ );
+    string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    char buffer [256];
+    for ( int i = 0; i < int(thread_names_.size()); ++i )
+    {
+        snprintf( buffer, sizeof(buffer), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"", i );
+        json.append( buffer );
+        escape( thread_names_[i], &json );
+        json.append( "\"}},\n" );
+        snprintf( buffer, sizeof(buffer), "{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"sort_index\":%d}},\n", i, i );
+        json.append( buffer );
+    }
+
+    for ( vector<Event>::const_iterator event = events_.begin(); event != events_.end(); ++event )
+    {
+        json.append( "{\"name\":\"" );
+        escape( event->name, &json );
+        json.append( "\",\"cat\":\"" );
+        escape( event->category, &json );
+        snprintf( buffer, sizeof(buffer), "\",\"ph\":\"%c\",\"pid\":1,\"tid\":%d,\"ts\":%lld", event->phase, event->thread, (long long) event->start );
+        json.append( buffer );
+        if ( event->phase == 'X' )
+        {
+            snprintf( buffer, sizeof(buffer), ",\"dur\":%lld", (long long) event->duration );
+            json.append( buffer );
+        }
+        else if ( event->phase == 'C' )
+        {
+            json.append( ",\"args\":{\"" );
+            escape( event->name, &json );
+            snprintf( buffer, sizeof(buffer), "\":%lld}", (long long) event->duration );
+            json.append( buffer );
+        }
+        else
+        {
+            snprintf( buffer, sizeof(buffer), ",\"id\":\"0x%llx\"", (unsigned long long) event->id );
+            json.append( buffer );
+        }
+        if ( !event->detail.empty() )
+        {
+            json.append( ",\"args\":{\"detail\":\"" );
+            escape( event->detail, &json );
+            json.append( "\"}" );
+        }
+        json.append( "},\n" );
+    }
+    snprintf( buffer, sizeof(buffer), "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"forge\"}}\n]}\n" );
+    json.append( buffer );
+    lock.unlock();
+
+    FILE* file = fopen( filename_.c_str(), "wb" );
+    if ( !file )
+    {
+        return false;
+    }
+    bool written = fwrite( json.data(), 1, json.size(), file ) == json.size();
+    written = fclose( file ) == 0 && written;
+    return written;
+}
+
+void Trace::record( const char* category, const char* name, const char* detail, char phase, int64_t start, int64_t duration, uint64_t id )
+{
+    SWEET_ASSERT( category );
+    SWEET_ASSERT( name );
+    std::unique_lock<std::mutex> lock( mutex_ );
+    Event event;
+    event.category = category;
+    event.name = name;
+    event.detail = detail ? detail : "";
+    event.phase = phase;
+    event.thread = thread_index();
+    event.start = start;
+    event.duration = duration;
+    event.id = id;
+    events_.push_back( event );
+}
+
+int Trace::thread_index()
+{
+    std::thread::id id = std::this_thread::get_id();
+    map<std::thread::id, int>::const_iterator i = threads_.find( id );
+    if ( i != threads_.end() )
+    {
+        return i->second;
+    }
+    int index = int(thread_names_.size());
+    char name [64];
+    snprintf( name, sizeof(name), "thread %d", index );
+    thread_names_.push_back( name );
+    threads_.insert( std::make_pair(id, index) );
+    return index;
+}
+
+void Trace::escape( const std::string& value, std::string* output )
+{
+    SWEET_ASSERT( output );
+    for ( string::const_iterator i = value.begin(); i != value.end(); ++i )
+    {
+        unsigned char character = (unsigned char) *i;
+        if ( character == '"' || character == '\\' )
+        {
+            output->push_back( '\\' );
+            output->push_back( char(character) );
+        }
+        else if ( character < 0x20 )
+        {
+            char escaped [8];
+            snprintf( escaped, sizeof(escaped), "\\u%04x", character );
+            output->append( escaped );
+        }
+        else
+        {
+            output->push_back( char(character) );
+        }
+    }
+}
+
+/**
+// Constructor.
+//
+// @param trace
+//  The Trace to record the span to (assumed not null).
+//
+// @param category
+//  The category of the span (assumed to be a string literal).
+//
+// @param name
+//  The name of the span (assumed to be a string literal).
+//
+// @param detail
+//  The detail of the span or null for no detail (copied only when the
+//  Trace is enabled).
+*/
+ScopedTrace::ScopedTrace( Trace* trace, const char* category, const char* name, const char* detail )
+: trace_( nullptr ),
+  category_( category ),
+  name_( name ),
+  detail_(),
+  start_( 0 )
+{
+    SWEET_ASSERT( trace );
+    if ( trace->enabled() )
+    {
+        trace_ = trace;
+        detail_ = detail ? detail : "";
+        start_ = trace->now();
+    }
+}
+
+ScopedTrace::~ScopedTrace()
+{
+    if ( trace_ )
+    {
+        trace_->complete( category_, name_, detail_.empty() ? nullptr : detail_.c_str(), start_ );
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef FORGE_TRACE_HPP_INCLUDED
+#define FORGE_TRACE_HPP_INCLUDED
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+namespace sweet
+{
+
+namespace forge
+{
+
+/**
+// Record spans of time spent in each phase of a build and write them out
+// as a Chrome trace event file.
+//
+// Spans recorded on each thread appear on their own track when the file is
+// loaded into Perfetto (https://ui.perfetto.dev) or `chrome://tracing`.
+// Spans that start on one thread and finish on another, like the lifetime
+// of a child process, are recorded as asynchronous spans that appear on
+// their own tracks.
+//
+// Recording is disabled until a filename is set and, while disabled,
+// recording a span costs a single atomic load.
+*/
+class Trace
+{
+    struct Event
+    {
+        const char* category; ///< The category of the event.
+        const char* name; ///< The name of the event.
+        std::string detail; ///< The detail of the event (e.g. a path or command line) or empty.
+        char phase; ///< The Chrome trace event phase ('X' for complete, 'b' and 'e' for asynchronous begin and end, 'C' for counter).
+        int thread; ///< The index of the thread that recorded the event.
+        int64_t start; ///< The time that the event started in microseconds.
+        int64_t duration; ///< The duration of complete events in microseconds or the value of counter events.
+        uint64_t id; ///< The identifier that pairs asynchronous begin and end events.
+    };
+
+    std::atomic<bool> enabled_; ///< Whether or not events are being recorded.
+    std::string filename_; ///< The file to write recorded events to.
+    std::chrono::steady_clock::time_point origin_; ///< The time that event times are relative to.
+    std::mutex mutex_; ///< The mutex that ensures exclusive access to events and threads.
+    std::vector<Event> events_; ///< The recorded events.
+    std::map<std::thread::id, int> threads_; ///< The index of each thread that has recorded events or been named.
+    std::vector<std::string> thread_names_; ///< The name of each thread by index.
+
+public:
+    Trace();
+    void set_filename( const std::string& filename );
+    const std::string& filename() const;
+    bool enabled() const;
+    int64_t now() const;
+    void set_thread_name( const std::string& name );
+    void complete( const char* category, const char* name, const char* detail, int64_t start );
+    void begin( const char* category, const char* name, const char* detail, uint64_t id );
+    void end( const char* category, const char* name, uint64_t id );
+    void counter( const char* category, const char* name, int64_t value );
+    bool save();
+
+private:
+    void record( const char* category, const char* name, const char* detail, char phase, int64_t start, int64_t duration, uint64_t id );
+    int thread_index();
+    static void escape( const std::string& value, std::string* output );
+};
+
+/**
+// Record a complete span on the current thread for the lifetime of a
+// ScopedTrace.
+*/
+class ScopedTrace
+{
+    Trace* trace_; ///< The Trace to record to or null if the Trace is disabled.
+    const char* category_; ///< The category of the span.
+    const char* name_; ///< The name of the span.
+    std::string detail_; ///< The detail of the span or empty.
+    int64_t start_; ///< The time that the span started.
+
+public:
+    ScopedTrace( Trace* trace, const char* category, const char* name, const char* detail = nullptr );
+    ~ScopedTrace();
+};
+
+}
+
+}
+
+#endif
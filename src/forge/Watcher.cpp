@@ -0,0 +1,217 @@
+//
+// Watcher.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "Watcher.hpp"
+#include "Forge.hpp"
+#include <error/Error.hpp>
+#include <assert/assert.hpp>
+#include <algorithm>
+
+#if defined(BUILD_OS_LINUX)
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+using std::map;
+using std::set;
+using std::vector;
+using std::string;
+using namespace sweet;
+using namespace sweet::forge;
+
+Watcher::Watcher( Forge* forge )
+: forge_( forge ),
+  inotify_fd_( -1 ),
+  directory_by_watch_(),
+  watch_by_directory_(),
+  filenames_()
+{
+    SWEET_ASSERT( forge_ );
+}
+
+Watcher::~Watcher()
+{
+    stop();
+}
+
+/**
+// Start watching for changes.
+//
+// @return
+//  True if watching for changes is supported on this platform otherwise
+//  false.
+*/
+bool Watcher::start()
+{
+#if defined(BUILD_OS_LINUX)
+    if ( inotify_fd_ < 0 )
+    {
+        inotify_fd_ = inotify_init1( IN_CLOEXEC );
+    }
+    return inotify_fd_ >= 0;
+#else
+    return false;
+#endif
+}
+
+/**
+// Watch a file for changes.
+//
+// The directory containing the file is watched rather than the file itself
+// so that the file is picked up if it is created, deleted, or replaced.  If
+// the directory doesn't exist yet then it is watched the next time that one
+// of its files is watched after it has been created.
+//
+// @param filename
+//  The absolute path to the file to watch.
+*/
+void Watcher::watch( const std::string& filename )
+{
+#if defined(BUILD_OS_LINUX)
+    SWEET_ASSERT( inotify_fd_ >= 0 );
+    string::size_type position = filename.find_last_of( '/' );
+    if ( position == string::npos )
+    {
+        return;
+    }
+
+    string directory = position > 0 ? filename.substr( 0, position ) : string( "/" );
+    if ( watch_by_directory_.find(directory) == watch_by_directory_.end() )
+    {
+        const uint32_t EVENTS = IN_CLOSE_WRITE | IN_ATTRIB | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+        int watch = inotify_add_watch( inotify_fd_, directory.c_str(), EVENTS );
+        if ( watch < 0 )
+        {
+            return;
+        }
+        directory_by_watch_[watch] = directory;
+        watch_by_directory_[directory] = watch;
+    }
+    filenames_.insert( filename );
+#else
+    (void) filename;
+#endif
+}
+
+/**
+// Wait for one or more watched files to change.
+//
+// Once a change has been seen changes continue to be collected until no
+// further changes arrive for a short time so that a burst of changes, for
+// example from an editor saving several files or a version control checkout,
+// is reported together.
+//
+// @param filenames
+//  A vector to receive the absolute paths of the watched files that changed
+//  (cleared before any changes are added).
+//
+// @param block
+//  True to block until at least one watched file changes or false to only
+//  collect changes that have already happened.
+//
+// @return
+//  True if waiting succeeded otherwise false if waiting failed or isn't
+//  supported on this platform.
+*/
+bool Watcher::wait( std::vector<std::string>* filenames, bool block )
+{
+    SWEET_ASSERT( filenames );
+    filenames->clear();
+
+#if defined(BUILD_OS_LINUX)
+    SWEET_ASSERT( inotify_fd_ >= 0 );
+    const int SETTLE_MILLISECONDS = 50;
+    set<string> changed_filenames;
+    int timeout = block ? -1 : 0;
+    for ( ;; )
+    {
+        struct pollfd poll_fd;
+        poll_fd.fd = inotify_fd_;
+        poll_fd.events = POLLIN;
+        poll_fd.revents = 0;
+        int result = poll( &poll_fd, 1, timeout );
+        if ( result < 0 && errno == EINTR )
+        {
+            continue;
+        }
+        if ( result < 0 )
+        {
+            char message [1024];
+            forge_->errorf( "Waiting for changes failed - %s", error::Error::format(errno, message, sizeof(message)) );
+            return false;
+        }
+        if ( result == 0 )
+        {
+            break;
+        }
+
+        char buffer [16384] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+        ssize_t bytes = ::read( inotify_fd_, buffer, sizeof(buffer) );
+        if ( bytes < 0 && errno == EINTR )
+        {
+            continue;
+        }
+
+        const char* position = buffer;
+        const char* end = buffer + std::max( bytes, ssize_t(0) );
+        while ( position < end )
+        {
+            const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>( position );
+            if ( event->mask & IN_Q_OVERFLOW )
+            {
+                changed_filenames.insert( filenames_.begin(), filenames_.end() );
+            }
+            else if ( event->mask & IN_IGNORED )
+            {
+                map<int, string>::iterator directory = directory_by_watch_.find( event->wd );
+                if ( directory != directory_by_watch_.end() )
+                {
+                    watch_by_directory_.erase( directory->second );
+                    directory_by_watch_.erase( directory );
+                }
+            }
+            else if ( event->len > 0 )
+            {
+                map<int, string>::const_iterator directory = directory_by_watch_.find( event->wd );
+                if ( directory != directory_by_watch_.end() )
+                {
+                    string filename = directory->second == "/" ? string("/") + event->name : directory->second + "/" + event->name;
+                    if ( filenames_.find(filename) != filenames_.end() )
+                    {
+                        changed_filenames.insert( filename );
+                    }
+                }
+            }
+            position += sizeof(struct inotify_event) + event->len;
+        }
+
+        if ( !changed_filenames.empty() || !block )
+        {
+            timeout = SETTLE_MILLISECONDS;
+        }
+    }
+    filenames->assign( changed_filenames.begin(), changed_filenames.end() );
+    return true;
+#else
+    (void) block;
+    return false;
+#endif
+}
+
+void Watcher::stop()
+{
+#if defined(BUILD_OS_LINUX)
+    if ( inotify_fd_ >= 0 )
+    {
+        ::close( inotify_fd_ );
+        inotify_fd_ = -1;
+    }
+    directory_by_watch_.clear();
+    watch_by_directory_.clear();
+    filenames_.clear();
+#endif
+}
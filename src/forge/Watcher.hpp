@@ -0,0 +1,48 @@
+#ifndef FORGE_WATCHER_HPP_INCLUDED
+#define FORGE_WATCHER_HPP_INCLUDED
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace sweet
+{
+
+namespace forge
+{
+
+class Forge;
+
+/**
+// Wait for changes to files that Targets are bound to.
+//
+// On Linux the directories containing watched files are registered with an
+// inotify instance so that files replaced by renaming over them are picked
+// up as well as files written in place.  Watching isn't supported on other
+// platforms.
+*/
+class Watcher
+{
+    Forge* forge_; ///< The Forge that this Watcher is part of.
+    int inotify_fd_; ///< The inotify instance that directories are watched with.
+    std::map<int, std::string> directory_by_watch_; ///< The directories being watched by watch descriptor.
+    std::map<std::string, int> watch_by_directory_; ///< The watch descriptors by watched directory.
+    std::set<std::string> filenames_; ///< The files being watched.
+
+    public:
+        Watcher( Forge* forge );
+        ~Watcher();
+        bool start();
+        void watch( const std::string& filename );
+        bool wait( std::vector<std::string>* filenames, bool block );
+
+    private:
+        void stop();
+};
+
+}
+
+}
+
+#endif
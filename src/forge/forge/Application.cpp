@@ -7,6 +7,7 @@
 #include "Application.hpp"
 #include <forge/Forge.hpp>
 #include <forge/path_functions.hpp>
+#include <process/SpawnServer.hpp>
 #include <cmdline/Parser.hpp>
 #include <error/ErrorPolicy.hpp>
 #include <assert/assert.hpp>
@@ -39,6 +40,13 @@ Application::Application( int argc, char** argv )
     std::string root_directory;
     std::string filename = "forge.lua";
     bool stack_trace_enabled = false;    
+    bool rescan = false;
+    std::string trace;
+    bool stats = false;
+    int jobs = 0;
+    bool adaptive_jobs = false;
+    bool jobserver = false;
+    bool spawn_server_enabled = false;
     std::vector<std::string> assignments_and_commands;
 
     error::ErrorPolicy error_policy;
@@ -49,6 +57,13 @@ Application::Application( int argc, char** argv )
         ( "root", "r", "Set root directory", &root_directory )
         ( "file", "f", "Set root build script filename", &filename )
         ( "stack-trace", "s", "Stack traces on error", &stack_trace_enabled )
+        ( "jobs", "j", "Set the maximum number of parallel jobs", &jobs )
+        ( "adaptive-jobs", "", "Adapt parallel jobs to CPU and memory pressure", &adaptive_jobs )
+        ( "jobserver", "", "Share parallel jobs with child makes through a jobserver", &jobserver )
+        ( "spawn-server", "", "Spawn processes from a small helper process", &spawn_server_enabled )
+        ( "rescan", "", "Stat every file ignoring the stat cache", &rescan )
+        ( "trace", "", "Write a Chrome trace of the build to a file", &trace )
+        ( "stats", "", "Print build statistics when each command finishes", &stats )
         ( &assignments_and_commands )
     ;
     command_line_parser.parse( argc, argv );
@@ -95,11 +110,29 @@ Application::Application( int argc, char** argv )
         error_policy.error( root_directory.empty(), "The file '%s' could not be found to identify the root directory", filename.c_str() );
     }
 
+    // Start the spawn server before any Forge, and its threads, exist so 
+    // that the server is a copy of this process while it is still small.
+    process::SpawnServer spawn_server;
+    if ( spawn_server_enabled && error_policy.errors() == 0 )
+    {
+        spawn_server.start();
+    }
+
     vector<string>::const_iterator command = commands.begin(); 
     while ( error_policy.errors() == 0 && command != commands.end() )
     {
         Forge forge( directory, error_policy, this );
         forge.set_stack_trace_enabled( stack_trace_enabled );
+        forge.set_rescan( rescan );
+        if ( jobs > 0 )
+        {
+            forge.set_maximum_parallel_jobs( jobs );
+        }
+        forge.set_adaptive_jobs_enabled( adaptive_jobs );
+        forge.set_jobserver_enabled( jobserver );
+        forge.set_spawn_server( spawn_server.running() ? &spawn_server : NULL );
+        forge.set_statistics_enabled( stats );
+        forge.set_trace_filename( trace.empty() ? trace : boost::filesystem::absolute(trace, directory).generic_string() );
         forge.set_root_directory( root_directory );
         forge.assign_global_variables( assignments );
         forge.execute( filename, *command );
@@ -0,0 +1,344 @@
+//
+// main.cpp
+// Copyright (c) Charles Baker.  All rights reserved.
+//
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <exception>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+using std::string;
+
+/**
+// A reference remote action cache server for forge.
+//
+// Serves HTTP/1.1 GET, HEAD, and PUT requests for the files in a directory
+// so that builds can share a remote action cache without any other
+// infrastructure (see `set_action_cache_url()`).  Each connection is served
+// by its own thread and handles a single request.  Files are written to a
+// temporary file that is renamed into place so that concurrent requests
+// never see partially written files.
+//
+// The server doesn't authenticate or encrypt and is intended for use on a
+// local machine or a trusted network.
+*/
+
+static const size_t MAXIMUM_HEADERS_SIZE = 64 * 1024;
+static std::atomic<int> uploads( 0 );
+
+static bool send_all( int fd, const char* data, size_t size )
+{
+    while ( size > 0 )
+    {
+        ssize_t sent = ::send( fd, data, size, 0 );
+        if ( sent <= 0 )
+        {
+            return false;
+        }
+        data += sent;
+        size -= size_t(sent);
+    }
+    return true;
+}
+
+static void respond( int fd, int status, const char* reason, const string& body = string(), bool head = false )
+{
+    char headers [256];
+    snprintf( headers, sizeof(headers), "HTTP/1.1 %d %s\r\nContent-Length: %llu\r\nConnection: close\r\n\r\n", status, reason, (unsigned long long) body.size() );
+    if ( send_all(fd, headers, strlen(headers)) && !head )
+    {
+        send_all( fd, body.data(), body.size() );
+    }
+}
+
+/**
+// Check that each element of a request path is a plain file or directory
+// name so that requests can't escape the served directory.
+*/
+static bool valid_path( const string& path )
+{
+    if ( path.size() < 2 || path[0] != '/' )
+    {
+        return false;
+    }
+
+    bool start = true;
+    for ( string::const_iterator i = path.begin() + 1; i != path.end(); ++i )
+    {
+        char character = *i;
+        if ( character == '/' )
+        {
+            if ( start )
+            {
+                return false;
+            }
+            start = true;
+        }
+        else if ( (start && character == '.') || (!isalnum(character) && character != '.' && character != '_' && character != '-') )
+        {
+            return false;
+        }
+        else
+        {
+            start = false;
+        }
+    }
+    return !start;
+}
+
+static bool read_file( const string& filename, string* contents )
+{
+    FILE* file = fopen( filename.c_str(), "rb" );
+    if ( !file )
+    {
+        return false;
+    }
+    char buffer [64 * 1024];
+    size_t size = fread( buffer, 1, sizeof(buffer), file );
+    while ( size > 0 )
+    {
+        contents->append( buffer, size );
+        size = fread( buffer, 1, sizeof(buffer), file );
+    }
+    bool read = ferror( file ) == 0;
+    fclose( file );
+    return read;
+}
+
+static bool write_file( const string& filename, const string& contents )
+{
+    string::size_type slash = filename.find( '/', 1 );
+    while ( slash != string::npos )
+    {
+        ::mkdir( filename.substr(0, slash).c_str(), 0777 );
+        slash = filename.find( '/', slash + 1 );
+    }
+
+    char temporary [64];
+    snprintf( temporary, sizeof(temporary), ".upload-%d-%d", int(getpid()), uploads++ );
+    string::size_type directory = filename.rfind( '/' );
+    string temporary_filename = filename.substr( 0, directory + 1 ) + temporary;
+    FILE* file = fopen( temporary_filename.c_str(), "wb" );
+    if ( !file )
+    {
+        return false;
+    }
+    bool written = fwrite( contents.data(), 1, contents.size(), file ) == contents.size();
+    written = fclose( file ) == 0 && written;
+    written = written && ::rename( temporary_filename.c_str(), filename.c_str() ) == 0;
+    if ( !written )
+    {
+        ::unlink( temporary_filename.c_str() );
+    }
+    return written;
+}
+
+static void serve( int fd, string directory )
+{
+    string request;
+    string::size_type headers_end = string::npos;
+    char buffer [64 * 1024];
+    while ( headers_end == string::npos && request.size() < MAXIMUM_HEADERS_SIZE )
+    {
+        ssize_t size = ::recv( fd, buffer, sizeof(buffer), 0 );
+        if ( size <= 0 )
+        {
+            ::close( fd );
+            return;
+        }
+        request.append( buffer, size_t(size) );
+        headers_end = request.find( "\r\n\r\n" );
+    }
+
+    if ( headers_end == string::npos )
+    {
+        respond( fd, 431, "Request Header Fields Too Large" );
+        ::close( fd );
+        return;
+    }
+
+    string::size_type method_end = request.find( ' ' );
+    string::size_type path_end = method_end != string::npos ? request.find( ' ', method_end + 1 ) : string::npos;
+    if ( path_end == string::npos || path_end > headers_end )
+    {
+        respond( fd, 400, "Bad Request" );
+        ::close( fd );
+        return;
+    }
+
+    string method = request.substr( 0, method_end );
+    string path = request.substr( method_end + 1, path_end - method_end - 1 );
+    if ( !valid_path(path) )
+    {
+        respond( fd, 400, "Bad Request" );
+        ::close( fd );
+        return;
+    }
+
+    string filename = directory + path;
+    if ( method == "GET" || method == "HEAD" )
+    {
+        string contents;
+        struct stat status;
+        if ( ::stat(filename.c_str(), &status) == 0 && S_ISREG(status.st_mode) && read_file(filename, &contents) )
+        {
+            respond( fd, 200, "OK", contents, method == "HEAD" );
+        }
+        else
+        {
+            respond( fd, 404, "Not Found" );
+        }
+    }
+    else if ( method == "PUT" )
+    {
+        long long content_length = -1;
+        string::size_type line = request.find( "\r\n" );
+        while ( line < headers_end )
+        {
+            line += 2;
+            if ( strncasecmp(request.c_str() + line, "content-length:", 15) == 0 )
+            {
+                content_length = strtoll( request.c_str() + line + 15, nullptr, 10 );
+            }
+            line = request.find( "\r\n", line );
+        }
+
+        if ( content_length < 0 )
+        {
+            respond( fd, 411, "Length Required" );
+            ::close( fd );
+            return;
+        }
+
+        string body = request.substr( headers_end + 4 );
+        while ( (long long) body.size() < content_length )
+        {
+            ssize_t size = ::recv( fd, buffer, sizeof(buffer), 0 );
+            if ( size <= 0 )
+            {
+                ::close( fd );
+                return;
+            }
+            body.append( buffer, size_t(size) );
+        }
+        body.resize( size_t(content_length) );
+
+        if ( write_file(filename, body) )
+        {
+            respond( fd, 201, "Created" );
+        }
+        else
+        {
+            respond( fd, 500, "Internal Server Error" );
+        }
+    }
+    else
+    {
+        respond( fd, 405, "Method Not Allowed" );
+    }
+    ::close( fd );
+}
+
+static void usage()
+{
+    fprintf( stderr,
+        "Usage: forge_cache [--address ADDRESS] [--port PORT] DIRECTORY\n"
+        "Serve the files in DIRECTORY as a remote action cache for forge.\n"
+        "  --address ADDRESS  the IPv4 address to listen on (default 127.0.0.1)\n"
+        "  --port PORT        the port to listen on (default 8735)\n"
+    );
+}
+
+int main( int argc, char** argv )
+{
+    string address = "127.0.0.1";
+    int port = 8735;
+    string directory;
+    for ( int i = 1; i < argc; ++i )
+    {
+        if ( strcmp(argv[i], "--address") == 0 && i + 1 < argc )
+        {
+            address = argv[++i];
+        }
+        else if ( strcmp(argv[i], "--port") == 0 && i + 1 < argc )
+        {
+            port = atoi( argv[++i] );
+        }
+        else if ( argv[i][0] != '-' && directory.empty() )
+        {
+            directory = argv[i];
+        }
+        else
+        {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    while ( directory.size() > 1 && directory[directory.size() - 1] == '/' )
+    {
+        directory.erase( directory.size() - 1 );
+    }
+
+    struct stat status;
+    if ( directory.empty() || ::stat(directory.c_str(), &status) != 0 || !S_ISDIR(status.st_mode) )
+    {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    ::signal( SIGPIPE, SIG_IGN );
+
+    int listener = ::socket( AF_INET, SOCK_STREAM, 0 );
+    int reuse = 1;
+    ::setsockopt( listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse) );
+    struct sockaddr_in socket_address;
+    memset( &socket_address, 0, sizeof(socket_address) );
+    socket_address.sin_family = AF_INET;
+    socket_address.sin_port = htons( uint16_t(port) );
+    if ( listener < 0 ||
+        ::inet_pton(AF_INET, address.c_str(), &socket_address.sin_addr) != 1 ||
+        ::bind(listener, (struct sockaddr*) &socket_address, sizeof(socket_address)) != 0 ||
+        ::listen(listener, SOMAXCONN) != 0 )
+    {
+        fprintf( stderr, "forge_cache: Listening on %s:%d failed - %s.\n", address.c_str(), port, strerror(errno) );
+        return EXIT_FAILURE;
+    }
+
+    fprintf( stdout, "forge_cache: Serving '%s' at http://%s:%d\n", directory.c_str(), address.c_str(), port );
+    fflush( stdout );
+
+    while ( true )
+    {
+        int fd = ::accept( listener, nullptr, nullptr );
+        if ( fd >= 0 )
+        {
+            try
+            {
+                std::thread( &serve, fd, directory ).detach();
+            }
+
+            catch ( const std::exception& exception )
+            {
+                fprintf( stderr, "forge_cache: Starting a thread failed - %s.\n", exception.what() );
+                ::close( fd );
+            }
+        }
+    }
+    return EXIT_SUCCESS;
+}
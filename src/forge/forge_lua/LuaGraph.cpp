@@ -12,6 +12,7 @@
 #include <forge/Toolset.hpp>
 #include <forge/Target.hpp>
 #include <forge/TargetPrototype.hpp>
+#include <forge/Watcher.hpp>
 #include <luaxx/luaxx.hpp>
 #include <assert/assert.hpp>
 #include <lua.hpp>
@@ -52,6 +53,7 @@ void LuaGraph::create( Forge* forge, lua_State* lua_state )
         { "working_directory", &LuaGraph::working_directory },
         { "buildfile", &LuaGraph::buildfile },
         { "postorder", &LuaGraph::postorder },
+        { "wait_for_changes", &LuaGraph::wait_for_changes },
         { "print_dependencies", &LuaGraph::print_dependencies },
         { "print_namespace", &LuaGraph::print_namespace },
         { "wait", &LuaGraph::wait },
@@ -257,6 +259,34 @@ int LuaGraph::postorder( lua_State* lua_state )
     return 1;
 }
 
+int LuaGraph::wait_for_changes( lua_State* lua_state )
+{
+    const int FORGE = lua_upvalueindex( 1 );
+    const int TARGET = 1;
+
+    Forge* forge = (Forge*) lua_touserdata( lua_state, FORGE );
+    Graph* graph = forge->graph();
+    if ( graph->traversal_in_progress() )
+    {
+        return luaL_error( lua_state, "Wait for changes called from within another bind or postorder traversal" );
+    }
+
+    if ( !forge->watcher()->start() )
+    {
+        return luaL_error( lua_state, "Waiting for changes isn't supported on this platform" );
+    }
+
+    Target* target = nullptr;
+    if ( !lua_isnoneornil(lua_state, TARGET) )
+    {
+        target = (Target*) luaxx_to( lua_state, TARGET, TARGET_TYPE );
+    }
+
+    bool changed = graph->wait_for_changes( target );
+    lua_pushboolean( lua_state, changed ? 1 : 0 );
+    return 1;
+}
+
 int LuaGraph::print_dependencies( lua_State* lua_state )
 {
     const int FORGE = lua_upvalueindex( 1 );
@@ -31,6 +31,7 @@ private:
     static int working_directory( lua_State* lua_state );
     static int buildfile( lua_State* lua_state );
     static int postorder( lua_State* lua_state );
+    static int wait_for_changes( lua_State* lua_state );
     static int print_dependencies( lua_State* lua_state );
     static int print_namespace( lua_State* lua_state );
     static int wait( lua_State* lua_state );
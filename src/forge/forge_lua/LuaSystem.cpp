@@ -10,6 +10,12 @@
 #include <forge/Filter.hpp>
 #include <forge/Arguments.hpp>
 #include <forge/Scheduler.hpp>
+#include <forge/Executor.hpp>
+#include <forge/Throttle.hpp>
+#include <forge/Context.hpp>
+#include <forge/Job.hpp>
+#include <forge/Target.hpp>
+#include <forge/Statistics.hpp>
 #include <process/Environment.hpp>
 #include <luaxx/luaxx.hpp>
 #include <assert/assert.hpp>
@@ -19,6 +25,7 @@
 #include <lua.hpp>
 
 using std::string;
+using std::vector;
 using std::unique_ptr;
 using namespace sweet;
 using namespace sweet::luaxx;
@@ -43,12 +50,27 @@ void LuaSystem::create( Forge* forge, lua_State* lua_state )
     {
         { "set_forge_hooks_library", &LuaSystem::set_forge_hooks_library },
         { "forge_hooks_library", &LuaSystem::forge_hooks_library },
+        { "set_stat_cache_enabled", &LuaSystem::set_stat_cache_enabled },
+        { "stat_cache_enabled", &LuaSystem::stat_cache_enabled },
+        { "set_content_digests_enabled", &LuaSystem::set_content_digests_enabled },
+        { "content_digests_enabled", &LuaSystem::content_digests_enabled },
+        { "set_action_cache_directory", &LuaSystem::set_action_cache_directory },
+        { "action_cache_directory", &LuaSystem::action_cache_directory },
+        { "set_action_cache_url", &LuaSystem::set_action_cache_url },
+        { "action_cache_url", &LuaSystem::action_cache_url },
+        { "set_pool", &LuaSystem::set_pool },
+        { "pool", &LuaSystem::pool },
+        { "set_adaptive_jobs", &LuaSystem::set_adaptive_jobs },
+        { "adaptive_jobs", &LuaSystem::adaptive_jobs },
+        { "set_jobserver_enabled", &LuaSystem::set_jobserver_enabled },
+        { "jobserver_enabled", &LuaSystem::jobserver_enabled },
         { "hash", &LuaSystem::hash },
         { "execute", &LuaSystem::execute },
         { "print", &LuaSystem::print },
         { "getenv", &LuaSystem::getenv },
         { "sleep", &LuaSystem::sleep },
         { "ticks", &LuaSystem::ticks },
+        { "stats", &LuaSystem::stats },
         { "operating_system", &LuaSystem::operating_system },
         { NULL, NULL }
     };
@@ -81,6 +103,182 @@ int LuaSystem::forge_hooks_library( lua_State* lua_state )
     return 1;
 }
 
+int LuaSystem::set_stat_cache_enabled( lua_State* lua_state )
+{
+    const int FORGE = lua_upvalueindex( 1 );
+    const int STAT_CACHE_ENABLED = 1;
+    Forge* forge = (Forge*) lua_touserdata( lua_state, FORGE );
+    bool stat_cache_enabled = lua_toboolean( lua_state, STAT_CACHE_ENABLED ) != 0;
+    forge->set_stat_cache_enabled( stat_cache_enabled );
+    return 0;
+}
+
+int LuaSystem::stat_cache_enabled( lua_State* lua_state )
+{
+    const int FORGE = lua_upvalueindex( 1 );
+    Forge* forge = (Forge*) lua_touserdata( lua_state, FORGE );
+    lua_pushboolean( lua_state, forge->stat_cache_enabled() ? 1 : 0 );
+    return 1;
+}
+
+int LuaSystem::set_content_digests_enabled( lua_State* lua_state )
+{
+    const int FORGE = lua_upvalueindex( 1 );
+    const int CONTENT_DIGESTS_ENABLED = 1;
+    Forge* forge = (Forge*) lua_touserdata( lua_state, FORGE );
+    bool content_digests_enabled = lua_toboolean( lua_state, CONTENT_DIGESTS_ENABLED ) != 0;
+    forge->set_content_digests_enabled( content_digests_enabled );
+    return 0;
+}
+
+int LuaSystem::content_digests_enabled( lua_State* lua_state )
+{
+    const int FORGE = lua_upvalueindex( 1 );
+    Forge* forge = (Forge*) lua_touserdata( lua_state, FORGE );
+    lua_pushboolean( lua_state, forge->content_digests_enabled() ? 1 : 0 );
+    return 1;
+}
+
+int LuaSystem::set_action_cache_directory( lua_State* lua_state )
+{
+    const int FORGE = lua_upvalueindex( 1 );
+    const int ACTION_CACHE_DIRECTORY = 1;
+    Forge* forge = (Forge*) lua_touserdata( lua_state, FORGE );
+    const char* action_cache_directory = luaL_optstring( lua_state, ACTION_CACHE_DIRECTORY, "" );
+    forge->set_action_cache_directory( string(action_cache_directory) );
+    return 0;
+}
+
+int LuaSystem::action_cache_directory( lua_State* lua_state )
+{
+    const int FORGE = lua_upvalueindex( 1 );
+    Forge* forge = (Forge*) lua_touserdata( lua_state, FORGE );
+    const string& action_cache_directory = forge->action_cache_directory();
+    lua_pushlstring( lua_state, action_cache_directory.c_str(), action_cache_directory.size() );
+    return 1;
+}
+
+int LuaSystem::set_action_cache_url( lua_State* lua_state )
+{
+    const int FORGE = lua_upvalueindex( 1 );
+    const int ACTION_CACHE_URL = 1;
+    Forge* forge = (Forge*) lua_touserdata( lua_state, FORGE );
+    const char* action_cache_url = luaL_optstring( lua_state, ACTION_CACHE_URL, "" );
+    if ( !forge->set_action_cache_url(string(action_cache_url)) )
+    {
+        return luaL_argerror( lua_state, ACTION_CACHE_URL, "http://host[:port][/path] expected" );
+    }
+    return 0;
+}
+
+int LuaSystem::action_cache_url( lua_State* lua_state )
+{
+    const int FORGE = lua_upvalueindex( 1 );
+    Forge* forge = (Forge*) lua_touserdata( lua_state, FORGE );
+    const string& action_cache_url = forge->action_cache_url();
+    lua_pushlstring( lua_state, action_cache_url.c_str(), action_cache_url.size() );
+    return 1;
+}
+
+int LuaSystem::set_pool( lua_State* lua_state )
+{
+    const int FORGE = lua_upvalueindex( 1 );
+    const int NAME = 1;
+    const int CAPACITY = 2;
+    Forge* forge = (Forge*) lua_touserdata( lua_state, FORGE );
+    const char* name = luaL_checkstring( lua_state, NAME );
+    lua_Integer capacity = luaL_checkinteger( lua_state, CAPACITY );
+    luaL_argcheck( lua_state, capacity > 0, CAPACITY, "capacity must be positive" );
+    forge->set_pool( string(name), int(capacity) );
+    return 0;
+}
+
+int LuaSystem::pool( lua_State* lua_state )
+{
+    const int FORGE = lua_upvalueindex( 1 );
+    const int NAME = 1;
+    Forge* forge = (Forge*) lua_touserdata( lua_state, FORGE );
+    const char* name = luaL_checkstring( lua_state, NAME );
+    lua_pushinteger( lua_state, forge->pool(string(name)) );
+    return 1;
+}
+
+int LuaSystem::set_adaptive_jobs( lua_State* lua_state )
+{
+    const int FORGE = lua_upvalueindex( 1 );
+    const int SETTINGS = 1;
+    Forge* forge = (Forge*) lua_touserdata( lua_state, FORGE );
+    luaL_argcheck( lua_state, lua_isnoneornil(lua_state, SETTINGS) || lua_isboolean(lua_state, SETTINGS) || lua_istable(lua_state, SETTINGS), SETTINGS, "table, boolean, or nil expected" );
+
+    Throttle* throttle = forge->executor()->throttle();
+    if ( lua_istable(lua_state, SETTINGS) )
+    {
+        lua_getfield( lua_state, SETTINGS, "cpu_pressure" );
+        if ( lua_isnumber(lua_state, -1) )
+        {
+            throttle->set_cpu_pressure( float(lua_tonumber(lua_state, -1)) );
+        }
+        lua_getfield( lua_state, SETTINGS, "memory_pressure" );
+        if ( lua_isnumber(lua_state, -1) )
+        {
+            throttle->set_memory_pressure( float(lua_tonumber(lua_state, -1)) );
+        }
+        lua_getfield( lua_state, SETTINGS, "memory_available" );
+        if ( lua_isnumber(lua_state, -1) )
+        {
+            throttle->set_memory_available( int64_t(lua_tonumber(lua_state, -1)) );
+        }
+        lua_getfield( lua_state, SETTINGS, "interval" );
+        if ( lua_isnumber(lua_state, -1) )
+        {
+            throttle->set_interval( int(lua_tonumber(lua_state, -1)) );
+        }
+        lua_pop( lua_state, 4 );
+    }
+    forge->set_adaptive_jobs_enabled( lua_toboolean(lua_state, SETTINGS) != 0 );
+    return 0;
+}
+
+int LuaSystem::adaptive_jobs( lua_State* lua_state )
+{
+    const int FORGE = lua_upvalueindex( 1 );
+    Forge* forge = (Forge*) lua_touserdata( lua_state, FORGE );
+    if ( !forge->adaptive_jobs_enabled() )
+    {
+        lua_pushnil( lua_state );
+        return 1;
+    }
+
+    Throttle* throttle = forge->executor()->throttle();
+    lua_newtable( lua_state );
+    lua_pushnumber( lua_state, throttle->cpu_pressure() );
+    lua_setfield( lua_state, -2, "cpu_pressure" );
+    lua_pushnumber( lua_state, throttle->memory_pressure() );
+    lua_setfield( lua_state, -2, "memory_pressure" );
+    lua_pushinteger( lua_state, lua_Integer(throttle->memory_available()) );
+    lua_setfield( lua_state, -2, "memory_available" );
+    lua_pushinteger( lua_state, throttle->interval() );
+    lua_setfield( lua_state, -2, "interval" );
+    return 1;
+}
+
+int LuaSystem::set_jobserver_enabled( lua_State* lua_state )
+{
+    const int FORGE = lua_upvalueindex( 1 );
+    const int JOBSERVER_ENABLED = 1;
+    Forge* forge = (Forge*) lua_touserdata( lua_state, FORGE );
+    forge->set_jobserver_enabled( lua_toboolean(lua_state, JOBSERVER_ENABLED) != 0 );
+    return 0;
+}
+
+int LuaSystem::jobserver_enabled( lua_State* lua_state )
+{
+    const int FORGE = lua_upvalueindex( 1 );
+    Forge* forge = (Forge*) lua_touserdata( lua_state, FORGE );
+    lua_pushboolean( lua_state, forge->jobserver_enabled() ? 1 : 0 );
+    return 1;
+}
+
 int LuaSystem::hash( lua_State* lua_state )
 {
     const int TABLE = 1;
@@ -144,7 +342,7 @@ int LuaSystem::execute( lua_State* lua_state )
                 lua_pushstring( lua_state, "Expected a function or callable table as 4th parameter (dependencies filter)" );
                 return lua_error( lua_state );
             }
-            dependencies_filter.reset( new Filter(forge->lua_state(), lua_state, DEPENDENCIES_FILTER) );
+            dependencies_filter.reset( create_filter(forge, lua_state, DEPENDENCIES_FILTER) );
         }
 
         unique_ptr<Filter> stdout_filter;
@@ -155,7 +353,7 @@ int LuaSystem::execute( lua_State* lua_state )
                 lua_pushstring( lua_state, "Expected a function or callable table as 5th parameter (stdout filter)" );
                 return lua_error( lua_state );
             }
-            stdout_filter.reset( new Filter(forge->lua_state(), lua_state, STDOUT_FILTER) );
+            stdout_filter.reset( create_filter(forge, lua_state, STDOUT_FILTER) );
         }
 
         unique_ptr<Filter> stderr_filter;
@@ -166,7 +364,7 @@ int LuaSystem::execute( lua_State* lua_state )
                 lua_pushstring( lua_state, "Expected a function or callable table as 6th parameter (stderr filter)" );
                 return lua_error( lua_state );
             }
-            stderr_filter.reset( new Filter(forge->lua_state(), lua_state, STDERR_FILTER) );
+            stderr_filter.reset( create_filter(forge, lua_state, STDERR_FILTER) );
         }
 
         unique_ptr<Arguments> arguments;
@@ -190,6 +388,7 @@ int LuaSystem::execute( lua_State* lua_state )
         string command_string( command, command_length );
         string command_line_string( command_line, command_line_length );
 
+        claim_pools( forge, lua_state, forge->context() );
         forge->scheduler()->execute(
             command_string,
             command_line_string,
@@ -211,6 +410,94 @@ int LuaSystem::execute( lua_State* lua_state )
     }
 }
 
+/**
+// Set the pools claimed by the next execute call from \e context to the
+// pools named in the `pools` field of the target that \e context is
+// visiting.
+//
+// The field is looked up through the target so that it can be set on a
+// target prototype to apply to all of its targets (e.g. 
+// `Executable.pools = { link = 1, memory_gb = 12 }`) or on an individual 
+// target to override its prototype.  Contexts that aren't visiting a 
+// target claim no pools.
+*/
+void LuaSystem::claim_pools( Forge* forge, lua_State* lua_state, Context* context )
+{
+    SWEET_ASSERT( forge );
+    SWEET_ASSERT( lua_state );
+    SWEET_ASSERT( context );
+
+    vector<std::pair<int, int> > pool_weights;
+    Job* job = context->job();
+    if ( job && job->target() )
+    {
+        luaxx_push( lua_state, job->target() );
+        if ( lua_istable(lua_state, -1) )
+        {
+            lua_getfield( lua_state, -1, "pools" );
+            if ( lua_istable(lua_state, -1) )
+            {
+                Executor* executor = forge->executor();
+                lua_pushnil( lua_state );
+                while ( lua_next(lua_state, -2) )
+                {
+                    if ( lua_type(lua_state, -2) == LUA_TSTRING && lua_type(lua_state, -1) == LUA_TNUMBER )
+                    {
+                        const char* name = lua_tostring( lua_state, -2 );
+                        int index = executor->pool_index( string(name) );
+                        if ( index < 0 )
+                        {
+                            luaL_error( lua_state, "Unknown pool '%s' claimed by '%s'", name, job->target()->id().c_str() );
+                        }
+                        lua_Integer weight = lua_tointeger( lua_state, -1 );
+                        if ( weight > 0 )
+                        {
+                            pool_weights.push_back( std::make_pair(index, int(weight)) );
+                        }
+                    }
+                    lua_pop( lua_state, 1 );
+                }
+            }
+            lua_pop( lua_state, 1 );
+        }
+        lua_pop( lua_state, 1 );
+    }
+    context->set_pool_weights( pool_weights );
+}
+
+/**
+// Create a Filter for the filter function or callable table at \e position.
+//
+// Callable tables with a `target` field, as returned from 
+// `Toolset:dependencies_filter()` and `Toolset:filenames_filter()`, filter 
+// the lines written by the build hooks library natively.  Their `directory` 
+// field limits the files added to the target and their `filenames` field 
+// selects adding files written as filenames of the target.
+*/
+Filter* LuaSystem::create_filter( Forge* forge, lua_State* lua_state, int position )
+{
+    unique_ptr<Filter> filter( new Filter(forge->lua_state(), lua_state, position) );
+    if ( lua_istable(lua_state, position) )
+    {
+        lua_getfield( lua_state, position, "target" );
+        Target* target = (Target*) luaxx_to( lua_state, -1, TARGET_TYPE );
+        lua_pop( lua_state, 1 );
+        if ( target )
+        {
+            lua_getfield( lua_state, position, "directory" );
+            size_t length = 0;
+            const char* directory = lua_isstring( lua_state, -1 ) ? lua_tolstring( lua_state, -1, &length ) : "";
+            string directory_string( directory, length );
+            lua_pop( lua_state, 1 );
+            lua_getfield( lua_state, position, "filenames" );
+            bool filenames = lua_toboolean( lua_state, -1 ) != 0;
+            lua_pop( lua_state, 1 );
+            filter->set_target( target, directory_string, filenames );
+        }
+    }
+    return filter.release();
+}
+
 int LuaSystem::print( lua_State* lua_state )
 {
     const int FORGE = lua_upvalueindex( 1 );
@@ -254,6 +541,33 @@ int LuaSystem::ticks( lua_State* lua_state )
     return 1;
 }
 
+int LuaSystem::stats( lua_State* lua_state )
+{
+    const int FORGE = lua_upvalueindex( 1 );
+    Forge* forge = (Forge*) lua_touserdata( lua_state, FORGE );
+    Statistics* statistics = forge->statistics();
+    lua_newtable( lua_state );
+    for ( int i = 0; i < Statistics::COUNTER_COUNT; ++i )
+    {
+        Statistics::Counter counter = Statistics::Counter( i );
+        lua_pushinteger( lua_state, lua_Integer(statistics->counter(counter)) );
+        lua_setfield( lua_state, -2, Statistics::counter_name(counter) );
+    }
+    lua_pushinteger( lua_state, lua_Integer(statistics->stats()) );
+    lua_setfield( lua_state, -2, "stats" );
+    lua_newtable( lua_state );
+    for ( int i = 0; i < Statistics::PHASE_COUNT; ++i )
+    {
+        Statistics::Phase phase = Statistics::Phase( i );
+        lua_pushnumber( lua_state, lua_Number(statistics->phase(phase)) / 1000.0 );
+        lua_setfield( lua_state, -2, Statistics::phase_name(phase) );
+    }
+    lua_setfield( lua_state, -2, "phases" );
+    lua_pushnumber( lua_state, lua_Number(statistics->elapsed()) / 1000.0 );
+    lua_setfield( lua_state, -2, "elapsed" );
+    return 1;
+}
+
 int LuaSystem::operating_system( lua_State* lua_state )
 {
     const int FORGE = lua_upvalueindex( 1 );
@@ -11,6 +11,8 @@ namespace forge
 {
 
 class Forge;
+class Filter;
+class Context;
 
 class LuaSystem
 {
@@ -23,13 +25,30 @@ public:
 private:
     static int set_forge_hooks_library( lua_State* lua_state );
     static int forge_hooks_library( lua_State* lua_state );
+    static int set_stat_cache_enabled( lua_State* lua_state );
+    static int stat_cache_enabled( lua_State* lua_state );
+    static int set_content_digests_enabled( lua_State* lua_state );
+    static int content_digests_enabled( lua_State* lua_state );
+    static int set_action_cache_directory( lua_State* lua_state );
+    static int action_cache_directory( lua_State* lua_state );
+    static int set_action_cache_url( lua_State* lua_state );
+    static int action_cache_url( lua_State* lua_state );
+    static int set_pool( lua_State* lua_state );
+    static int pool( lua_State* lua_state );
+    static int set_adaptive_jobs( lua_State* lua_state );
+    static int adaptive_jobs( lua_State* lua_state );
+    static int set_jobserver_enabled( lua_State* lua_state );
+    static int jobserver_enabled( lua_State* lua_state );
     static int hash( lua_State* lua_state );
     static int execute( lua_State* lua_state );
     static int print( lua_State* lua_state );
     static int getenv( lua_State* lua_state );
     static int sleep( lua_State* lua_state );
     static int ticks( lua_State* lua_state );
+    static int stats( lua_State* lua_state );
     static int operating_system( lua_State* lua_state );
+    static Filter* create_filter( Forge* forge, lua_State* lua_state, int position );
+    static void claim_pools( Forge* forge, lua_State* lua_state, Context* context );
     static lua_Integer hash_recursively( lua_State* lua_state, int table, bool hash_integer_keys );
     static uint64_t fnv1a_start();
     static uint64_t fnv1a_append( uint64_t hash, const unsigned char* data, size_t length );
@@ -0,0 +1,226 @@
+//
+// TestActionCache.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "stdafx.hpp"
+#include "ErrorChecker.hpp"
+#include <forge/Forge.hpp>
+#include <forge/ActionCache.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <UnitTest++/UnitTest++.h>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <string>
+#include <string.h>
+
+using std::vector;
+using std::string;
+using namespace sweet;
+using namespace sweet::forge;
+
+namespace
+{
+
+const char* ENTRY_FILES [] =
+{
+    "filenames",
+    "0",
+    "1",
+    "dependencies",
+    "stdout",
+    "stderr"
+};
+
+const int ENTRY_FILES_COUNT = int(sizeof(ENTRY_FILES) / sizeof(ENTRY_FILES[0]));
+
+// Create an entry in `source` holding two files written by a command and
+// the output that it printed.
+struct ActionCacheChecker : public ErrorChecker
+{
+    string directory;
+    Forge forge;
+    ActionCache* action_cache;
+
+    ActionCacheChecker()
+    : ErrorChecker(),
+      directory( boost::filesystem::initial_path<boost::filesystem::path>().generic_string() + "/action_cache" ),
+      forge( boost::filesystem::initial_path<boost::filesystem::path>().generic_string(), *this, this ),
+      action_cache( forge.action_cache() )
+    {
+        boost::system::error_code error;
+        boost::filesystem::remove_all( directory, error );
+        boost::filesystem::create_directories( directory + "/source", error );
+        action_cache->set_directory( directory );
+
+        write( "source/filenames", "output/foo.o\noutput/foo.d\n" );
+        write( "source/0", string("\x7f" "ELF\0\n\r\n", 8) );
+        write( "source/1", "" );
+        write( "source/dependencies", "== read 'foo.cpp'\n== read 'foo.hpp'\n" );
+        write( "source/stdout", "" );
+        write( "source/stderr", "foo.cpp:1: warning: unused\n" );
+    }
+
+    ~ActionCacheChecker()
+    {
+        boost::system::error_code error;
+        boost::filesystem::remove_all( directory, error );
+    }
+
+    void write( const string& name, const string& contents ) const
+    {
+        std::ofstream ofstream( (directory + "/" + name).c_str(), std::ios::binary );
+        ofstream.write( contents.data(), contents.size() );
+    }
+
+    string read( const string& name ) const
+    {
+        std::ifstream ifstream( (directory + "/" + name).c_str(), std::ios::binary );
+        return string( (std::istreambuf_iterator<char>(ifstream)), std::istreambuf_iterator<char>() );
+    }
+
+    bool exists( const string& name ) const
+    {
+        return boost::filesystem::exists( directory + "/" + name );
+    }
+
+    // Count the files and directories in the cache directory to check that
+    // rejected blobs leave neither entries nor staging directories behind.
+    int entries() const
+    {
+        int entries = 0;
+        boost::filesystem::directory_iterator end;
+        for ( boost::filesystem::directory_iterator i(directory); i != end; ++i )
+        {
+            ++entries;
+        }
+        return entries;
+    }
+
+    string blob() const
+    {
+        string blob;
+        ActionCache::pack( directory + "/source", &blob );
+        return blob;
+    }
+};
+
+}
+
+SUITE( TestActionCache )
+{
+    TEST_FIXTURE( ActionCacheChecker, unpack_reads_back_what_pack_wrote )
+    {
+        string packed;
+        CHECK( ActionCache::pack(directory + "/source", &packed) );
+        CHECK( action_cache->unpack(packed, directory + "/entry") );
+        for ( int i = 0; i < ENTRY_FILES_COUNT; ++i )
+        {
+            CHECK( exists(string("entry/") + ENTRY_FILES[i]) );
+            CHECK( read(string("source/") + ENTRY_FILES[i]) == read(string("entry/") + ENTRY_FILES[i]) );
+        }
+
+        string repacked;
+        CHECK( ActionCache::pack(directory + "/entry", &repacked) );
+        CHECK( packed == repacked );
+        CHECK_EQUAL( 2, entries() );
+    }
+
+    TEST_FIXTURE( ActionCacheChecker, pack_fails_for_incomplete_entry )
+    {
+        boost::filesystem::remove( directory + "/source/stderr" );
+        string packed;
+        CHECK( !ActionCache::pack(directory + "/source", &packed) );
+    }
+
+    TEST_FIXTURE( ActionCacheChecker, truncated_blobs_are_rejected )
+    {
+        string packed = blob();
+        for ( size_t size = 0; size < packed.size(); ++size )
+        {
+            CHECK( !action_cache->unpack(packed.substr(0, size), directory + "/entry") );
+            CHECK( !exists("entry") );
+        }
+        CHECK_EQUAL( 1, entries() );
+    }
+
+    TEST_FIXTURE( ActionCacheChecker, blobs_with_bad_names_are_rejected )
+    {
+        string packed = blob();
+        const char* BAD_NAMES [][2] =
+        {
+            { "filenames\n", "manifest\n" },
+            { "stdout\n", "stdoux\n" },
+            { "stderr\n", "../stderr\n" },
+            { "\n1\n0\n", "\n2\n0\n" }
+        };
+        for ( size_t i = 0; i < sizeof(BAD_NAMES) / sizeof(BAD_NAMES[0]); ++i )
+        {
+            string bad = packed;
+            string::size_type position = bad.find( BAD_NAMES[i][0] );
+            CHECK( position != string::npos );
+            if ( position != string::npos )
+            {
+                bad.replace( position, strlen(BAD_NAMES[i][0]), BAD_NAMES[i][1] );
+            }
+            CHECK( !action_cache->unpack(bad, directory + "/entry") );
+            CHECK( !exists("entry") );
+        }
+
+        CHECK( !action_cache->unpack(packed + "extra\n0\n", directory + "/entry") );
+        CHECK( !exists("entry") );
+        CHECK_EQUAL( 1, entries() );
+    }
+
+    TEST_FIXTURE( ActionCacheChecker, blobs_with_bad_sizes_are_rejected )
+    {
+        string packed = blob();
+        string::size_type size = packed.find( "stderr\n" ) + strlen( "stderr\n" );
+        const char* BAD_SIZES [] = { "", "x", "-1", "27 ", "26", "28", "99999999999999999999" };
+        for ( size_t i = 0; i < sizeof(BAD_SIZES) / sizeof(BAD_SIZES[0]); ++i )
+        {
+            string bad = packed;
+            bad.replace( size, bad.find('\n', size) - size, BAD_SIZES[i] );
+            CHECK( !action_cache->unpack(bad, directory + "/entry") );
+            CHECK( !exists("entry") );
+        }
+        CHECK_EQUAL( 1, entries() );
+    }
+
+    TEST( parse_manifest_reads_back_what_format_manifest_wrote )
+    {
+        vector<vector<string>> sets( 3 );
+        sets[0].push_back( "foo.cpp" );
+        sets[0].push_back( "foo.hpp" );
+        sets[2].push_back( "bar.cpp" );
+        CHECK( ActionCache::parse_manifest(ActionCache::format_manifest(sets)) == sets );
+        CHECK( ActionCache::parse_manifest("").empty() );
+    }
+
+    TEST( truncated_manifests_return_complete_sets )
+    {
+        vector<vector<string>> sets( 3 );
+        sets[0].push_back( "foo.cpp" );
+        sets[0].push_back( "foo.hpp" );
+        sets[2].push_back( "bar.cpp" );
+        string contents = ActionCache::format_manifest( sets );
+        for ( size_t size = 0; size < contents.size(); ++size )
+        {
+            vector<vector<string>> parsed = ActionCache::parse_manifest( contents.substr(0, size) );
+            CHECK( parsed.size() < sets.size() );
+            CHECK( std::equal(parsed.begin(), parsed.end(), sets.begin()) );
+        }
+    }
+
+    TEST( manifests_with_bad_counts_return_complete_sets )
+    {
+        vector<vector<string>> sets( 1, vector<string>(1, "foo.cpp") );
+        CHECK( ActionCache::parse_manifest("x\nfoo.cpp\n").empty() );
+        CHECK( ActionCache::parse_manifest("\nfoo.cpp\n").empty() );
+        CHECK( ActionCache::parse_manifest("1\nfoo.cpp\n-1\nbar.cpp\n") == sets );
+        CHECK( ActionCache::parse_manifest("1\nfoo.cpp\n2 \nbar.cpp\nbaz.cpp\n") == sets );
+        CHECK( ActionCache::parse_manifest("1\nfoo.cpp\n3\nbar.cpp\nbaz.cpp\n") == sets );
+    }
+}
@@ -0,0 +1,92 @@
+//
+// TestContentHash.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "stdafx.hpp"
+#include <forge/ContentHash.hpp>
+#include <UnitTest++/UnitTest++.h>
+#include <vector>
+
+using std::vector;
+using namespace sweet::forge;
+
+// The known digests below were calculated with both the SSE2 and the scalar
+// implementations of ContentHash and are the same for each so these tests
+// check whichever implementation is built.
+
+static const size_t STRIPE_SIZE = 64;
+static const size_t BLOCK_SIZE = 16 * STRIPE_SIZE;
+
+static vector<unsigned char> content( size_t size )
+{
+    vector<unsigned char> content( size );
+    for ( size_t i = 0; i < size; ++i )
+    {
+        content[i] = (unsigned char)( i * 131 + 17 );
+    }
+    return content;
+}
+
+static uint64_t hash_in_pieces( const vector<unsigned char>& content, size_t piece )
+{
+    ContentHash content_hash;
+    for ( size_t i = 0; i < content.size(); i += piece )
+    {
+        content_hash.update( &content[i], i + piece < content.size() ? piece : content.size() - i );
+    }
+    return content_hash.finish();
+}
+
+SUITE( TestContentHash )
+{
+    TEST( empty_input_has_known_digest )
+    {
+        CHECK_EQUAL( 0x2e87fef1a54e675bULL, ContentHash::hash(nullptr, 0) );
+        CHECK_EQUAL( 0x2e87fef1a54e675bULL, ContentHash().finish() );
+    }
+
+    TEST( partial_stripe_has_known_digest )
+    {
+        vector<unsigned char> data = content( 17 );
+        CHECK_EQUAL( 0xf3caac4f068e53abULL, ContentHash::hash(&data[0], 1) );
+        CHECK_EQUAL( 0x8784e53c2fbda194ULL, ContentHash::hash(&data[0], 17) );
+    }
+
+    TEST( one_stripe_has_known_digest )
+    {
+        vector<unsigned char> data = content( STRIPE_SIZE + 1 );
+        CHECK_EQUAL( 0xf4a4edda512fac3aULL, ContentHash::hash(&data[0], STRIPE_SIZE - 1) );
+        CHECK_EQUAL( 0x283345f2318c8ee1ULL, ContentHash::hash(&data[0], STRIPE_SIZE) );
+        CHECK_EQUAL( 0x9bbf2df06a11118aULL, ContentHash::hash(&data[0], STRIPE_SIZE + 1) );
+    }
+
+    TEST( input_crossing_blocks_has_known_digest )
+    {
+        vector<unsigned char> data = content( 3 * BLOCK_SIZE + 200 );
+        CHECK_EQUAL( 0xd01dfd1060a9b7ffULL, ContentHash::hash(&data[0], BLOCK_SIZE) );
+        CHECK_EQUAL( 0x44c1305ad0c29755ULL, ContentHash::hash(&data[0], BLOCK_SIZE + 100) );
+        CHECK_EQUAL( 0x8d61631345456a9aULL, ContentHash::hash(&data[0], 3 * BLOCK_SIZE + 200) );
+    }
+
+    TEST( split_updates_match_single_update )
+    {
+        vector<unsigned char> data = content( 3 * BLOCK_SIZE + 200 );
+        uint64_t digest = ContentHash::hash( &data[0], data.size() );
+        const size_t PIECES [] = { 1, 7, STRIPE_SIZE - 1, STRIPE_SIZE, STRIPE_SIZE + 1, BLOCK_SIZE - 1, BLOCK_SIZE + 1 };
+        for ( size_t i = 0; i < sizeof(PIECES) / sizeof(PIECES[0]); ++i )
+        {
+            CHECK_EQUAL( digest, hash_in_pieces(data, PIECES[i]) );
+        }
+    }
+
+    TEST( empty_updates_do_not_change_digest )
+    {
+        vector<unsigned char> data = content( 17 );
+        ContentHash content_hash;
+        content_hash.update( nullptr, 0 );
+        content_hash.update( &data[0], data.size() );
+        content_hash.update( nullptr, 0 );
+        CHECK_EQUAL( ContentHash::hash(&data[0], data.size()), content_hash.finish() );
+    }
+}
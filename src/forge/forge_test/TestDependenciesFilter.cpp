@@ -0,0 +1,168 @@
+//
+// TestDependenciesFilter.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "stdafx.hpp"
+#include "ErrorChecker.hpp"
+#include <forge/Forge.hpp>
+#include <forge/Graph.hpp>
+#include <forge/Target.hpp>
+#include <forge/Filter.hpp>
+#include <forge/Scheduler.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <UnitTest++/UnitTest++.h>
+#include <vector>
+#include <string>
+
+using std::vector;
+using std::string;
+using namespace sweet;
+using namespace sweet::forge;
+
+namespace
+{
+
+// Pass the lines written by the build hooks library to 
+// `Scheduler::dependencies()` for `foo.obj` built from the working
+// directory `build` and capture the lines that are printed.
+struct DependenciesChecker : public ErrorChecker
+{
+    string directory;
+    Forge forge;
+    Graph* graph;
+    Target* working_directory;
+    Target* foo_obj;
+    Filter filter;
+    vector<string> outputs;
+
+    DependenciesChecker()
+    : ErrorChecker(),
+      directory( boost::filesystem::initial_path<boost::filesystem::path>().generic_string() ),
+      forge( directory, *this, this ),
+      graph( nullptr ),
+      working_directory( nullptr ),
+      foo_obj( nullptr ),
+      filter(),
+      outputs()
+    {
+        forge.set_root_directory( directory );
+        graph = forge.graph();
+        working_directory = graph->target( directory + "/build" );
+        foo_obj = graph->target( directory + "/build/foo.obj" );
+    }
+
+    void forge_output( Forge* /*forge*/, const char* message )
+    {
+        outputs.push_back( message );
+    }
+
+    void dependencies( const string& output, bool filenames )
+    {
+        filter.set_target( foo_obj, directory, filenames );
+        forge.scheduler()->dependencies( output, &filter, working_directory );
+    }
+
+    int implicit_dependencies() const
+    {
+        int dependencies = 0;
+        while ( foo_obj->implicit_dependency(dependencies) )
+        {
+            ++dependencies;
+        }
+        return dependencies;
+    }
+};
+
+}
+
+SUITE( TestDependenciesFilter )
+{
+    TEST_FIXTURE( DependenciesChecker, read_adds_implicit_dependency )
+    {
+        dependencies( "== read '" + directory + "/source/foo.hpp'", false );
+        CHECK_EQUAL( 1, implicit_dependencies() );
+        Target* foo_hpp = foo_obj->implicit_dependency( 0 );
+        CHECK( foo_hpp && foo_hpp == graph->find_target(directory + "/source/foo.hpp", nullptr) );
+        if ( foo_hpp )
+        {
+            CHECK_EQUAL( directory + "/source/foo.hpp", foo_hpp->filename(0) );
+            CHECK( !foo_hpp->cleanable() );
+        }
+        CHECK( outputs.empty() );
+        CHECK_EQUAL( 0, errors );
+    }
+
+    TEST_FIXTURE( DependenciesChecker, relative_read_resolves_against_working_directory )
+    {
+        dependencies( "== read 'foo.hpp'\n== read '../source/bar.hpp'", false );
+        CHECK_EQUAL( 2, implicit_dependencies() );
+        CHECK( foo_obj->implicit_dependency(0) == graph->find_target(directory + "/build/foo.hpp", nullptr) );
+        CHECK( foo_obj->implicit_dependency(1) == graph->find_target(directory + "/source/bar.hpp", nullptr) );
+        CHECK( outputs.empty() );
+    }
+
+    TEST_FIXTURE( DependenciesChecker, reads_outside_directory_are_ignored )
+    {
+        filter.set_target( foo_obj, directory + "/source", false );
+        forge.scheduler()->dependencies( "== read 'foo.hpp'\n== read '../source/../other/bar.hpp'\n== read '/usr/include/stdio.h'\n== read '../source/baz.hpp'", &filter, working_directory );
+        CHECK_EQUAL( 1, implicit_dependencies() );
+        CHECK( foo_obj->implicit_dependency(0) == graph->find_target(directory + "/source/baz.hpp", nullptr) );
+        CHECK( graph->find_target(directory + "/build/foo.hpp", nullptr) == nullptr );
+        CHECK( outputs.empty() );
+    }
+
+    TEST_FIXTURE( DependenciesChecker, malformed_lines_are_ignored )
+    {
+        dependencies( 
+            "==\n"
+            "==read 'foo.hpp'\n"
+            "== read\n"
+            "== read foo.hpp\n"
+            "== read 'foo.hpp\n"
+            "== 'foo.hpp'\n"
+            "== 1read 'foo.hpp'\n"
+            "== stat 'foo.hpp'", 
+            false 
+        );
+        CHECK_EQUAL( 0, implicit_dependencies() );
+        CHECK( foo_obj->filenames().empty() );
+        CHECK( outputs.empty() );
+        CHECK_EQUAL( 0, errors );
+    }
+
+    TEST_FIXTURE( DependenciesChecker, other_lines_are_printed )
+    {
+        dependencies( "foo.cpp\n== read 'foo.hpp'\n= warning\n=\nnote: bar", false );
+        CHECK_EQUAL( 1, implicit_dependencies() );
+        CHECK_EQUAL( 4, int(outputs.size()) );
+        if ( outputs.size() == 4 )
+        {
+            CHECK_EQUAL( "foo.cpp", outputs[0] );
+            CHECK_EQUAL( "= warning", outputs[1] );
+            CHECK_EQUAL( "=", outputs[2] );
+            CHECK_EQUAL( "note: bar", outputs[3] );
+        }
+    }
+
+    TEST_FIXTURE( DependenciesChecker, writes_are_ignored_without_filenames )
+    {
+        dependencies( "== write 'foo.obj'\n== read 'foo.hpp'", false );
+        CHECK( foo_obj->filenames().empty() );
+        CHECK_EQUAL( 1, implicit_dependencies() );
+        CHECK( foo_obj->implicit_dependency(0) == graph->find_target(directory + "/build/foo.hpp", nullptr) );
+    }
+
+    TEST_FIXTURE( DependenciesChecker, writes_add_filenames_with_filenames )
+    {
+        dependencies( "== write 'foo.obj'\n== read 'foo.hpp'\n== write '/usr/tmp/foo.o'", true );
+        CHECK_EQUAL( 1, int(foo_obj->filenames().size()) );
+        if ( !foo_obj->filenames().empty() )
+        {
+            CHECK_EQUAL( "foo.obj", foo_obj->filename(0) );
+        }
+        CHECK_EQUAL( 1, implicit_dependencies() );
+        CHECK( foo_obj->implicit_dependency(0) == graph->find_target(directory + "/build/foo.hpp", nullptr) );
+    }
+}
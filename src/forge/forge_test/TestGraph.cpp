@@ -6,10 +6,84 @@
 #include "stdafx.hpp"
 #include "ErrorChecker.hpp"
 #include "FileChecker.hpp"
+#include <forge/Forge.hpp>
+#include <forge/Graph.hpp>
+#include <forge/Target.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
 #include <UnitTest++/UnitTest++.h>
+#include <algorithm>
+#include <string>
+#include <ctype.h>
 
+using std::string;
+using namespace sweet;
 using namespace sweet::forge;
 
+namespace
+{
+
+struct PathChecker : public ErrorChecker
+{
+    string directory;
+    Forge forge;
+    Graph* graph;
+    Target* work_directory;
+
+    PathChecker()
+    : ErrorChecker(),
+      directory( boost::filesystem::initial_path<boost::filesystem::path>().generic_string() ),
+      forge( directory, *this, this ),
+      graph( forge.graph() ),
+      work_directory( graph->add_or_find_target("work/directory", nullptr) )
+    {
+    }
+
+    // Find or create a Target by iterating over a `boost::filesystem::path`
+    // as `Graph::add_or_find_target()` and `Graph::find_target()` did 
+    // before they split paths in place.
+    Target* boost_find_target( const string& id, Target* working_directory, bool create ) const
+    {
+        boost::filesystem::path path( id );
+        Target* target = working_directory && path.is_relative() ? working_directory : graph->root_target();
+        boost::filesystem::path::const_iterator i = path.begin();
+        if ( path.has_root_name() )
+        {
+            string element = i->generic_string();
+            std::transform( element.begin(), element.end(), element.begin(), toupper );
+            target = create ? graph->find_or_create_target_by_element( target, element ) : graph->find_target_by_element( target, element );
+            ++i;
+        }
+        if ( path.is_absolute() )
+        {
+            ++i;
+        }
+        while ( i != path.end() && (target || create) )
+        {
+            target = create ? graph->find_or_create_target_by_element( target, i->generic_string() ) : graph->find_target_by_element( target, i->generic_string() );
+            ++i;
+        }
+        return target;
+    }
+
+    // Check that adding and then finding \e id relative to the work 
+    // directory resolves to the same Target as the lookups through 
+    // `boost::filesystem::path` do.
+    bool agrees( const char* id ) const
+    {
+        Target* target = graph->add_or_find_target( id, work_directory );
+        return
+            target &&
+            boost_find_target( id, work_directory, true ) == target &&
+            graph->find_target( id, work_directory ) == target &&
+            boost_find_target( id, work_directory, false ) == target &&
+            graph->find_target( id, work_directory ) == target
+        ;
+    }
+};
+
+}
+
 SUITE( TestGraph )
 {
     TEST_FIXTURE( FileChecker, files_are_outdated_if_they_do_not_exist )
@@ -94,4 +168,108 @@ SUITE( TestGraph )
         test( script );
         CHECK( errors == 0 );
     }
+
+    TEST_FIXTURE( PathChecker, dot_and_dot_dot_elements_agree_with_boost_path )
+    {
+        CHECK( agrees(".") );
+        CHECK( agrees("./foo") );
+        CHECK( agrees("foo/.") );
+        CHECK( agrees("foo/./bar") );
+        CHECK( agrees("..") );
+        CHECK( agrees("../sibling") );
+        CHECK( agrees("foo/..") );
+        CHECK( agrees("foo/bar/../baz") );
+        CHECK( agrees("foo/bar/..") );
+    }
+
+    TEST_FIXTURE( PathChecker, repeated_and_trailing_separators_agree_with_boost_path )
+    {
+        CHECK( agrees("foo//bar") );
+        CHECK( agrees("foo/bar/") );
+        CHECK( agrees("foo///bar//") );
+        CHECK( agrees("a/./") );
+#if !defined(BUILD_OS_WINDOWS)
+        CHECK( agrees("/absolute//path/") );
+        CHECK( agrees("///absolute") );
+#endif
+    }
+
+    TEST_FIXTURE( PathChecker, network_paths_agree_with_boost_path )
+    {
+        CHECK( agrees("//server/share") );
+        CHECK( agrees("//server/share/file") );
+        CHECK( agrees("//server/share/../other") );
+        CHECK( agrees("//server") );
+        CHECK( graph->find_target("//server/share", nullptr) == graph->find_target("//SERVER/share", nullptr) );
+    }
+
+#if defined(BUILD_OS_WINDOWS)
+    TEST_FIXTURE( PathChecker, drive_paths_agree_with_boost_path )
+    {
+        CHECK( agrees("C:") );
+        CHECK( agrees("C:foo") );
+        CHECK( agrees("C:foo\\..\\bar") );
+        CHECK( agrees("C:/foo") );
+        CHECK( agrees("c:\\foo\\bar") );
+        CHECK( graph->find_target("c:/foo", nullptr) == graph->find_target("C:/foo", nullptr) );
+        CHECK( graph->find_target("C:foo", work_directory) != graph->find_target("C:/foo", nullptr) );
+    }
+#endif
+
+    TEST_FIXTURE( PathChecker, missing_paths_agree_with_boost_path )
+    {
+        CHECK( graph->find_target("missing/file", work_directory) == nullptr );
+        CHECK( boost_find_target("missing/file", work_directory, false) == nullptr );
+        CHECK( graph->find_target("", work_directory) == nullptr );
+    }
+
+    TEST_FIXTURE( PathChecker, found_paths_are_forgotten_when_graph_is_cleared )
+    {
+        Target* anonymous = graph->add_or_find_target( "$$anonymous", nullptr );
+        CHECK( graph->find_target("$$anonymous", nullptr) == anonymous );
+        graph->clear();
+        CHECK( graph->find_target("$$anonymous", nullptr) == nullptr );
+    }
+
+    TEST_FIXTURE( PathChecker, found_paths_are_forgotten_when_graphs_are_swapped )
+    {
+        Target* foo = graph->add_or_find_target( "foo", nullptr );
+        Target* bar = graph->add_or_find_target( "bar", nullptr );
+        CHECK( graph->find_target("foo", nullptr) == foo );
+        CHECK( graph->find_target("bar", nullptr) == bar );
+
+        Graph other( &forge );
+        Target* other_foo = other.add_or_find_target( "foo", nullptr );
+        CHECK( other.find_target("foo", nullptr) == other_foo );
+        graph->swap( other );
+
+        CHECK( graph->find_target("foo", nullptr) == other_foo );
+        CHECK( graph->find_target("bar", nullptr) == nullptr );
+        CHECK( other.find_target("foo", nullptr) == foo );
+        CHECK( other.find_target("bar", nullptr) == bar );
+        graph->swap( other );
+    }
+
+    TEST_FIXTURE( PathChecker, found_paths_are_forgotten_when_graph_is_loaded )
+    {
+        string filename = directory + "/graph_path_lookups.cache";
+        boost::system::error_code error;
+        boost::filesystem::remove( filename, error );
+        boost::filesystem::remove( filename + ".journal", error );
+
+        graph->load_binary( filename );
+        Target* foo = graph->add_or_find_target( "lookups/foo", nullptr );
+        CHECK( graph->find_target("lookups/foo", nullptr) == foo );
+        graph->save_binary();
+
+        graph->load_binary( filename );
+        Target* lookups = graph->root_target()->find_target_by_id( "lookups" );
+        Target* loaded_foo = lookups ? lookups->find_target_by_id( "foo" ) : nullptr;
+        CHECK( loaded_foo != nullptr );
+        CHECK( graph->find_target("lookups/foo", nullptr) == loaded_foo );
+        CHECK( graph->find_target("lookups/bar", nullptr) == nullptr );
+
+        boost::filesystem::remove( filename, error );
+        boost::filesystem::remove( filename + ".journal", error );
+    }
 }
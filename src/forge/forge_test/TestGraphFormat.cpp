@@ -0,0 +1,380 @@
+//
+// TestGraphFormat.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "stdafx.hpp"
+#include "ErrorChecker.hpp"
+#include <forge/Forge.hpp>
+#include <forge/Graph.hpp>
+#include <forge/Target.hpp>
+#include <forge/MappedGraph.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <UnitTest++/UnitTest++.h>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <string>
+#include <ctime>
+#include <stddef.h>
+#include <stdio.h>
+
+using std::vector;
+using std::string;
+using namespace sweet;
+using namespace sweet::forge;
+
+namespace
+{
+
+const int64_t LAST_WRITE_TIME = 1500000000LL * 1000000000LL + 123456789LL;
+
+struct GraphChecker : public ErrorChecker
+{
+    string directory;
+    string filename;
+
+    GraphChecker()
+    : ErrorChecker(),
+      directory( boost::filesystem::initial_path<boost::filesystem::path>().generic_string() ),
+      filename( directory + "/graph_format.cache" )
+    {
+        remove();
+    }
+
+    ~GraphChecker()
+    {
+        remove();
+    }
+
+    void remove()
+    {
+        boost::system::error_code error;
+        boost::filesystem::remove( filename, error );
+        boost::filesystem::remove( filename + ".journal", error );
+    }
+
+    string path( const char* id ) const
+    {
+        return directory + "/graph_format/" + id;
+    }
+
+    // Create `foo.obj` with `foo.cpp` and `foo.hpp` as implicit dependencies
+    // alongside enough other Targets that a journal holding a few Targets is
+    // appended rather than the graph file being compacted.
+    void create( Graph* graph )
+    {
+        Target* foo_cpp = graph->target( path("foo.cpp") );
+        foo_cpp->replay( LAST_WRITE_TIME, 0, 0x1111, 0, 0, false, vector<string>(1, path("foo.cpp")), vector<Target*>() );
+        Target* foo_hpp = graph->target( path("foo.hpp") );
+        foo_hpp->replay( LAST_WRITE_TIME, 0, 0x2222, 0, 0, false, vector<string>(1, path("foo.hpp")), vector<Target*>() );
+
+        vector<Target*> dependencies;
+        dependencies.push_back( foo_cpp );
+        dependencies.push_back( foo_hpp );
+        Target* foo_obj = graph->target( path("foo.obj") );
+        foo_obj->replay( LAST_WRITE_TIME, 0x1234, 0x5678, 0x9abc, 250, true, vector<string>(1, path("foo.obj")), dependencies );
+
+        for ( int i = 0; i < 64; ++i )
+        {
+            char id [64];
+            snprintf( id, sizeof(id), "file_%d.cpp", i );
+            Target* target = graph->target( path(id) );
+            target->replay( LAST_WRITE_TIME, 0, 0, 0, 0, false, vector<string>(1, path(id)), vector<Target*>() );
+        }
+    }
+
+    string contents() const
+    {
+        std::ifstream ifstream( filename.c_str(), std::ios::binary );
+        return string( (std::istreambuf_iterator<char>(ifstream)), std::istreambuf_iterator<char>() );
+    }
+
+    void replace( const string& contents ) const
+    {
+        std::ofstream ofstream( filename.c_str(), std::ios::binary );
+        ofstream.write( contents.data(), contents.size() );
+    }
+};
+
+// Write values in the stream format that version 32 dependency graph files
+// were written in.
+struct StreamWriter
+{
+    string data;
+
+    template <class Type> void value( const Type& value )
+    {
+        data.append( reinterpret_cast<const char*>(&value), sizeof(value) );
+    }
+
+    void string_value( const string& value )
+    {
+        StreamWriter::value( size_t(value.size()) );
+        data.append( value );
+    }
+
+    void target( const void* address, const string& id, std::time_t last_write_time, uint64_t hash, bool built, const vector<string>& filenames )
+    {
+        value( address );
+        string_value( id );
+        value( last_write_time );
+        value( hash );
+        value( built );
+        value( size_t(filenames.size()) );
+        for ( vector<string>::const_iterator filename = filenames.begin(); filename != filenames.end(); ++filename )
+        {
+            string_value( *filename );
+        }
+    }
+};
+
+}
+
+SUITE( TestGraphFormat )
+{
+    TEST_FIXTURE( GraphChecker, graph_reads_back_what_it_saved )
+    {
+        {
+            Forge forge( directory, *this, this );
+            forge.set_root_directory( directory );
+            Graph* graph = forge.graph();
+            graph->load_binary( filename );
+            create( graph );
+            graph->save_binary();
+        }
+
+        Forge forge( directory, *this, this );
+        forge.set_root_directory( directory );
+        Graph* graph = forge.graph();
+        CHECK( graph->load_binary(filename) != nullptr );
+
+        Target* foo_obj = graph->find_target( path("foo.obj"), nullptr );
+        Target* foo_cpp = graph->find_target( path("foo.cpp"), nullptr );
+        Target* foo_hpp = graph->find_target( path("foo.hpp"), nullptr );
+        CHECK( foo_obj && foo_cpp && foo_hpp );
+        if ( foo_obj && foo_cpp && foo_hpp )
+        {
+            CHECK_EQUAL( "foo.obj", foo_obj->id() );
+            CHECK_EQUAL( 3 + 64, int(foo_obj->parent()->targets().size()) );
+            CHECK( foo_obj->parent()->find_target_by_id("foo.obj") == foo_obj );
+            CHECK( foo_cpp->parent() == foo_obj->parent() );
+            CHECK_EQUAL( 1, int(foo_obj->filenames().size()) );
+            CHECK_EQUAL( path("foo.obj"), foo_obj->filename(0) );
+            CHECK( foo_obj->implicit_dependency(0) == foo_cpp );
+            CHECK( foo_obj->implicit_dependency(1) == foo_hpp );
+            CHECK( foo_obj->implicit_dependency(2) == nullptr );
+            CHECK_EQUAL( LAST_WRITE_TIME, foo_obj->last_write_time() );
+            CHECK_EQUAL( 0x1234ULL, foo_obj->hash() );
+            CHECK_EQUAL( 0x5678ULL, foo_obj->digest() );
+            CHECK_EQUAL( 0x1111ULL, foo_cpp->digest() );
+            CHECK_EQUAL( 250, foo_obj->duration() );
+            CHECK( foo_obj->built() );
+            CHECK( !foo_cpp->built() );
+        }
+    }
+
+    TEST_FIXTURE( GraphChecker, truncated_graph_is_rejected )
+    {
+        {
+            Forge forge( directory, *this, this );
+            forge.set_root_directory( directory );
+            Graph* graph = forge.graph();
+            graph->load_binary( filename );
+            create( graph );
+            graph->save_binary();
+        }
+
+        string graph_contents = contents();
+        replace( graph_contents.substr(0, graph_contents.size() / 2) );
+
+        Forge forge( directory, *this, this );
+        forge.set_root_directory( directory );
+        Graph* graph = forge.graph();
+        graph->load_binary( filename );
+        CHECK( graph->find_target(path("foo.obj"), nullptr) == nullptr );
+    }
+
+    TEST_FIXTURE( GraphChecker, corrupted_graph_is_rejected )
+    {
+        {
+            Forge forge( directory, *this, this );
+            forge.set_root_directory( directory );
+            Graph* graph = forge.graph();
+            graph->load_binary( filename );
+            create( graph );
+            graph->save_binary();
+        }
+
+        // Claim far more target records than the file holds.
+        string graph_contents = contents();
+        uint32_t targets = 0xffffffffU;
+        CHECK( graph_contents.size() > sizeof(MappedGraph::Header) );
+        graph_contents.replace( offsetof(MappedGraph::Header, targets), sizeof(targets), reinterpret_cast<const char*>(&targets), sizeof(targets) );
+        replace( graph_contents );
+
+        Forge forge( directory, *this, this );
+        forge.set_root_directory( directory );
+        Graph* graph = forge.graph();
+        graph->load_binary( filename );
+        CHECK( graph->find_target(path("foo.obj"), nullptr) == nullptr );
+    }
+
+    TEST_FIXTURE( GraphChecker, journal_replayed_over_graph_restores_dirty_targets )
+    {
+        {
+            Forge forge( directory, *this, this );
+            forge.set_root_directory( directory );
+            Graph* graph = forge.graph();
+            graph->load_binary( filename );
+            create( graph );
+            graph->save_binary();
+        }
+
+        {
+            Forge forge( directory, *this, this );
+            forge.set_root_directory( directory );
+            Graph* graph = forge.graph();
+            graph->load_binary( filename );
+            Target* foo_cpp = graph->find_target( path("foo.cpp"), nullptr );
+            Target* foo_obj = graph->find_target( path("foo.obj"), nullptr );
+            CHECK( foo_cpp && foo_obj );
+            if ( foo_cpp && foo_obj )
+            {
+                foo_obj->replay( LAST_WRITE_TIME + 1, 0x4321, 0x8765, 0xcba9, 500, true, vector<string>(1, path("foo.obj")), vector<Target*>(1, foo_cpp) );
+                foo_obj->set_dirty( true );
+            }
+            Target* bar_obj = graph->target( path("bar.obj") );
+            bar_obj->replay( LAST_WRITE_TIME, 0x1, 0x2, 0x3, 125, true, vector<string>(1, path("bar.obj")), vector<Target*>() );
+            bar_obj->set_dirty( true );
+            graph->save_binary();
+        }
+        CHECK( boost::filesystem::exists(filename + ".journal") );
+
+        Forge forge( directory, *this, this );
+        forge.set_root_directory( directory );
+        Graph* graph = forge.graph();
+        graph->load_binary( filename );
+        Target* foo_cpp = graph->find_target( path("foo.cpp"), nullptr );
+        Target* foo_obj = graph->find_target( path("foo.obj"), nullptr );
+        Target* bar_obj = graph->find_target( path("bar.obj"), nullptr );
+        CHECK( foo_cpp && foo_obj && bar_obj );
+        if ( foo_cpp && foo_obj && bar_obj )
+        {
+            CHECK_EQUAL( LAST_WRITE_TIME + 1, foo_obj->last_write_time() );
+            CHECK_EQUAL( 0x4321ULL, foo_obj->hash() );
+            CHECK_EQUAL( 0x8765ULL, foo_obj->digest() );
+            CHECK_EQUAL( 500, foo_obj->duration() );
+            CHECK( foo_obj->implicit_dependency(0) == foo_cpp );
+            CHECK( foo_obj->implicit_dependency(1) == nullptr );
+            CHECK_EQUAL( 0x1ULL, bar_obj->hash() );
+            CHECK_EQUAL( 125, bar_obj->duration() );
+            CHECK_EQUAL( path("bar.obj"), bar_obj->filename(0) );
+            CHECK_EQUAL( 0x1111ULL, foo_cpp->digest() );
+        }
+        CHECK_EQUAL( 0, errors );
+    }
+
+    TEST_FIXTURE( GraphChecker, torn_journal_segment_is_discarded )
+    {
+        {
+            Forge forge( directory, *this, this );
+            forge.set_root_directory( directory );
+            Graph* graph = forge.graph();
+            graph->load_binary( filename );
+            create( graph );
+            graph->save_binary();
+        }
+
+        {
+            Forge forge( directory, *this, this );
+            forge.set_root_directory( directory );
+            Graph* graph = forge.graph();
+            graph->load_binary( filename );
+            Target* bar_obj = graph->target( path("bar.obj") );
+            bar_obj->replay( LAST_WRITE_TIME, 0x1, 0x2, 0x3, 125, true, vector<string>(1, path("bar.obj")), vector<Target*>() );
+            bar_obj->set_dirty( true );
+            graph->save_binary();
+        }
+
+        // Append the start of a segment that claims more bytes than follow
+        // it as if saving crashed part way through appending it.
+        {
+            std::ofstream journal( (filename + ".journal").c_str(), std::ios::binary | std::ios::app );
+            uint32_t length = 1024;
+            uint64_t checksum = 0;
+            journal.write( reinterpret_cast<const char*>(&length), sizeof(length) );
+            journal.write( reinterpret_cast<const char*>(&checksum), sizeof(checksum) );
+            journal.write( "torn", 4 );
+        }
+
+        {
+            Forge forge( directory, *this, this );
+            forge.set_root_directory( directory );
+            Graph* graph = forge.graph();
+            graph->load_binary( filename );
+            Target* bar_obj = graph->find_target( path("bar.obj"), nullptr );
+            CHECK( bar_obj != nullptr );
+            Target* baz_obj = graph->target( path("baz.obj") );
+            baz_obj->replay( LAST_WRITE_TIME, 0x4, 0x5, 0x6, 625, true, vector<string>(1, path("baz.obj")), vector<Target*>() );
+            baz_obj->set_dirty( true );
+            graph->save_binary();
+        }
+
+        Forge forge( directory, *this, this );
+        forge.set_root_directory( directory );
+        Graph* graph = forge.graph();
+        graph->load_binary( filename );
+        Target* bar_obj = graph->find_target( path("bar.obj"), nullptr );
+        Target* baz_obj = graph->find_target( path("baz.obj"), nullptr );
+        CHECK( bar_obj && baz_obj );
+        if ( bar_obj && baz_obj )
+        {
+            CHECK_EQUAL( 125, bar_obj->duration() );
+            CHECK_EQUAL( 625, baz_obj->duration() );
+        }
+        CHECK_EQUAL( 0, errors );
+    }
+
+    TEST_FIXTURE( GraphChecker, version_32_graph_is_migrated )
+    {
+        // The root Target with `foo.obj` and `foo.cpp` as children and
+        // `foo.cpp` as an implicit dependency of `foo.obj`.
+        const int FOO_OBJ = 2;
+        const int FOO_CPP = 3;
+        StreamWriter writer;
+        const char FORMAT [] = "Sweet Build Graph";
+        writer.data.append( FORMAT, sizeof(FORMAT) );
+        writer.value( int(32) );
+        writer.target( &writer, "$$root", 0, 0, false, vector<string>() );
+        writer.value( size_t(2) );
+        writer.target( &FOO_OBJ, "foo.obj", std::time_t(1500000000), 0x1234, true, vector<string>(1, path("foo.obj")) );
+        writer.value( size_t(0) );
+        writer.value( size_t(1) );
+        writer.value( static_cast<const void*>(&FOO_CPP) );
+        writer.target( &FOO_CPP, "foo.cpp", std::time_t(1500000001), 0, false, vector<string>(1, path("foo.cpp")) );
+        writer.value( size_t(0) );
+        writer.value( size_t(0) );
+        writer.value( size_t(0) );
+        replace( writer.data );
+
+        Forge forge( directory, *this, this );
+        forge.set_root_directory( directory );
+        Graph* graph = forge.graph();
+        graph->load_binary( filename );
+        Target* foo_obj = graph->root_target()->find_target_by_id( "foo.obj" );
+        Target* foo_cpp = graph->root_target()->find_target_by_id( "foo.cpp" );
+        CHECK( foo_obj && foo_cpp );
+        if ( foo_obj && foo_cpp )
+        {
+            CHECK_EQUAL( 1500000000LL * 1000000000LL, foo_obj->last_write_time() );
+            CHECK_EQUAL( 1500000001LL * 1000000000LL, foo_cpp->last_write_time() );
+            CHECK_EQUAL( 0x1234ULL, foo_obj->hash() );
+            CHECK_EQUAL( 0, foo_obj->duration() );
+            CHECK( foo_obj->built() );
+            CHECK_EQUAL( path("foo.obj"), foo_obj->filename(0) );
+            CHECK( foo_obj->implicit_dependency(0) == foo_cpp );
+        }
+    }
+}
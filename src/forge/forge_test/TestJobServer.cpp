@@ -0,0 +1,250 @@
+//
+// TestJobServer.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "stdafx.hpp"
+#include <forge/JobServer.hpp>
+#include <process/Environment.hpp>
+#include <UnitTest++/UnitTest++.h>
+#include <string>
+#include <stdio.h>
+
+#if !defined(BUILD_OS_WINDOWS)
+#include <unistd.h>
+#endif
+
+using std::string;
+using namespace sweet;
+using namespace sweet::forge;
+
+#if !defined(BUILD_OS_WINDOWS)
+
+namespace
+{
+
+struct Pipe
+{
+    int fds [2];
+
+    Pipe( int tokens )
+    {
+        fds[0] = -1;
+        fds[1] = -1;
+        if ( ::pipe(fds) == 0 )
+        {
+            for ( int i = 0; i < tokens; ++i )
+            {
+                char token = '+';
+                (void) ::write( fds[1], &token, 1 );
+            }
+        }
+    }
+
+    ~Pipe()
+    {
+        ::close( fds[0] );
+        ::close( fds[1] );
+    }
+
+    string auth( const char* option ) const
+    {
+        char auth [64];
+        snprintf( auth, sizeof(auth), "%s%d,%d", option, fds[0], fds[1] );
+        return string( auth );
+    }
+};
+
+int acquire_all( JobServer& jobserver )
+{
+    int tokens = 0;
+    while ( jobserver.acquire() )
+    {
+        ++tokens;
+    }
+    return tokens;
+}
+
+}
+
+SUITE( TestJobServer )
+{
+    TEST( connect_without_jobserver_flags_is_disabled )
+    {
+        JobServer jobserver;
+        CHECK( !jobserver.connect(NULL) );
+        CHECK( !jobserver.connect("") );
+        CHECK( !jobserver.connect("k -j4") );
+        CHECK( !jobserver.enabled() );
+        CHECK( jobserver.makeflags().empty() );
+    }
+
+    TEST( connect_to_malformed_jobserver_flags_is_disabled )
+    {
+        JobServer jobserver;
+        CHECK( !jobserver.connect("--jobserver-auth=") );
+        CHECK( !jobserver.connect("--jobserver-auth=3") );
+        CHECK( !jobserver.connect("--jobserver-auth=-1,-1") );
+        CHECK( !jobserver.connect("--jobserver-auth=fifo:/nonexistent/forge-jobserver") );
+        CHECK( !jobserver.enabled() );
+    }
+
+    TEST( connect_to_closed_pipe_is_disabled )
+    {
+        string auth;
+        {
+            Pipe pipe( 0 );
+            auth = pipe.auth( "--jobserver-auth=" );
+        }
+        JobServer jobserver;
+        CHECK( !jobserver.connect(auth.c_str()) );
+        CHECK( !jobserver.enabled() );
+    }
+
+    TEST( connect_to_fifo )
+    {
+        JobServer server;
+        CHECK( server.serve(3) );
+        CHECK( server.serving() );
+        CHECK( server.makeflags().find("--jobserver-auth=fifo:") != string::npos );
+
+        JobServer client;
+        CHECK( client.connect(server.makeflags().c_str()) );
+        CHECK( client.enabled() );
+        CHECK( !client.serving() );
+        CHECK_EQUAL( server.makeflags(), client.makeflags() );
+        CHECK_EQUAL( 2, acquire_all(client) );
+    }
+
+    TEST( connect_to_pipe )
+    {
+        Pipe pipe( 2 );
+        string makeflags = "k -j3 " + pipe.auth( "--jobserver-auth=" );
+        JobServer jobserver;
+        CHECK( jobserver.connect(makeflags.c_str()) );
+        CHECK( jobserver.enabled() );
+        CHECK_EQUAL( makeflags, jobserver.makeflags() );
+        CHECK_EQUAL( 2, acquire_all(jobserver) );
+        jobserver.release();
+        CHECK_EQUAL( 1, acquire_all(jobserver) );
+    }
+
+    TEST( connect_to_legacy_pipe )
+    {
+        Pipe pipe( 1 );
+        string makeflags = " -j2 " + pipe.auth( "--jobserver-fds=" );
+        JobServer jobserver;
+        CHECK( jobserver.connect(makeflags.c_str()) );
+        CHECK( jobserver.enabled() );
+        CHECK_EQUAL( 1, acquire_all(jobserver) );
+    }
+
+    TEST( connect_uses_last_jobserver_auth )
+    {
+        Pipe pipe( 1 );
+        string makeflags = "--jobserver-auth=fifo:/nonexistent/forge-jobserver " + pipe.auth( "--jobserver-auth=" );
+        JobServer jobserver;
+        CHECK( jobserver.connect(makeflags.c_str()) );
+        CHECK_EQUAL( 1, acquire_all(jobserver) );
+    }
+
+    TEST( disconnect_returns_tokens )
+    {
+        Pipe pipe( 2 );
+        string makeflags = pipe.auth( "--jobserver-auth=" );
+        JobServer jobserver;
+        CHECK( jobserver.connect(makeflags.c_str()) );
+        CHECK_EQUAL( 2, acquire_all(jobserver) );
+        jobserver.disconnect();
+        CHECK( !jobserver.enabled() );
+        CHECK( jobserver.connect(makeflags.c_str()) );
+        CHECK_EQUAL( 2, acquire_all(jobserver) );
+    }
+
+    TEST( jobs_beyond_the_first_hold_one_token_each )
+    {
+        JobServer jobserver;
+        CHECK( jobserver.serve(3) );
+
+        // The first job is free and the next two take the fifo's two 
+        // tokens so a fourth job can't start.
+        CHECK( jobserver.acquire_for_job(0) );
+        CHECK_EQUAL( 0, jobserver.tokens() );
+        CHECK( jobserver.acquire_for_job(1) );
+        CHECK( jobserver.acquire_for_job(2) );
+        CHECK_EQUAL( 2, jobserver.tokens() );
+        CHECK( !jobserver.acquire_for_job(3) );
+
+        // Finishing one job returns one token that the next job takes.
+        jobserver.release_for_jobs( 2 );
+        CHECK_EQUAL( 1, jobserver.tokens() );
+        CHECK( jobserver.acquire_for_job(2) );
+        CHECK( !jobserver.acquire_for_job(3) );
+
+        // The last running job keeps no token.
+        jobserver.release_for_jobs( 1 );
+        CHECK_EQUAL( 0, jobserver.tokens() );
+        jobserver.release_for_jobs( 0 );
+        CHECK_EQUAL( 0, jobserver.tokens() );
+        CHECK_EQUAL( 2, acquire_all(jobserver) );
+    }
+
+    TEST( merge_makeflags_without_makeflags )
+    {
+        Pipe pipe( 0 );
+        JobServer jobserver;
+        CHECK( jobserver.connect(("k -j3 " + pipe.auth("--jobserver-auth=")).c_str()) );
+        CHECK_EQUAL( "-j3 " + pipe.auth("--jobserver-auth="), jobserver.merge_makeflags(NULL) );
+    }
+
+    TEST( merge_makeflags_replaces_jobserver_flags )
+    {
+        Pipe pipe( 0 );
+        JobServer jobserver;
+        CHECK( jobserver.connect((" -j3 " + pipe.auth("--jobserver-auth=")).c_str()) );
+        string auth = pipe.auth( "--jobserver-auth=" );
+        CHECK_EQUAL( "ks -j3 " + auth, jobserver.merge_makeflags("ks -j8 --jobserver-auth=fifo:/tmp/other") );
+        CHECK_EQUAL( "ks --no-print-directory -j3 " + auth, jobserver.merge_makeflags("ks --jobserver-fds=5,6 -j --no-print-directory") );
+        CHECK_EQUAL( "ks -j3 " + auth + " -- CC=gcc -j8", jobserver.merge_makeflags("ks -- CC=gcc -j8") );
+    }
+
+    TEST( merged_makeflags_replace_makeflags_in_environment )
+    {
+        Pipe pipe( 0 );
+        JobServer jobserver;
+        CHECK( jobserver.connect(pipe.auth("--jobserver-auth=").c_str()) );
+        process::Environment environment;
+        environment.append( "PATH", "/bin" );
+        environment.append( "MAKEFLAGS", "k -j8" );
+        environment.append( "HOME", "/home" );
+        string makeflags = jobserver.merge_makeflags( environment.find("MAKEFLAGS") );
+        environment.set( "MAKEFLAGS", makeflags.c_str() );
+        environment.prepare();
+
+        int found = 0;
+        for ( char* const* value = environment.values(); *value; ++value )
+        {
+            if ( string(*value).compare(0, 10, "MAKEFLAGS=") == 0 )
+            {
+                CHECK_EQUAL( "MAKEFLAGS=k " + pipe.auth("--jobserver-auth="), string(*value) );
+                ++found;
+            }
+        }
+        CHECK_EQUAL( 1, found );
+    }
+}
+
+#else
+
+SUITE( TestJobServer )
+{
+    TEST( jobserver_is_disabled_on_windows )
+    {
+        JobServer jobserver;
+        CHECK( !jobserver.connect("-j3 --jobserver-auth=fifo:/tmp/forge-jobserver") );
+        CHECK( !jobserver.serve(3) );
+        CHECK( !jobserver.enabled() );
+    }
+}
+
+#endif
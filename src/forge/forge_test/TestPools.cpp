@@ -0,0 +1,104 @@
+//
+// TestPools.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "stdafx.hpp"
+#include <forge/Pools.hpp>
+#include <UnitTest++/UnitTest++.h>
+#include <vector>
+#include <utility>
+
+using std::vector;
+using std::pair;
+using std::make_pair;
+using namespace sweet::forge;
+
+static vector<pair<int, int> > weights( int index, int weight )
+{
+    vector<pair<int, int> > weights;
+    weights.push_back( make_pair(index, weight) );
+    return weights;
+}
+
+SUITE( TestPools )
+{
+    TEST( unknown_pools_have_no_index_or_capacity )
+    {
+        Pools pools;
+        CHECK_EQUAL( -1, pools.index("link") );
+        CHECK_EQUAL( 0, pools.capacity("link") );
+    }
+
+    TEST( set_declares_pool_and_updates_capacity )
+    {
+        Pools pools;
+        pools.set( "link", 2 );
+        pools.set( "compile", 8 );
+        CHECK_EQUAL( 0, pools.index("link") );
+        CHECK_EQUAL( 1, pools.index("compile") );
+        CHECK_EQUAL( 2, pools.capacity("link") );
+        pools.set( "link", 0 );
+        CHECK_EQUAL( 0, pools.index("link") );
+        CHECK_EQUAL( 1, pools.capacity("link") );
+    }
+
+    TEST( calls_are_admitted_up_to_capacity )
+    {
+        Pools pools;
+        pools.set( "link", 3 );
+        pools.begin_dispatch();
+        CHECK( pools.available(weights(0, 2)) );
+        pools.claim( weights(0, 2) );
+        CHECK( pools.available(weights(0, 1)) );
+        pools.claim( weights(0, 1) );
+        CHECK_EQUAL( 3, pools.used(0) );
+        CHECK( !pools.available(weights(0, 1)) );
+        pools.release( weights(0, 2) );
+        CHECK_EQUAL( 1, pools.used(0) );
+        CHECK( pools.available(weights(0, 2)) );
+    }
+
+    TEST( oversize_weight_runs_alone )
+    {
+        Pools pools;
+        pools.set( "link", 2 );
+        pools.begin_dispatch();
+        CHECK( pools.available(weights(0, 5)) );
+        pools.claim( weights(0, 5) );
+        CHECK( !pools.available(weights(0, 1)) );
+        pools.release( weights(0, 5) );
+        pools.claim( weights(0, 1) );
+        CHECK( !pools.available(weights(0, 5)) );
+    }
+
+    TEST( skipped_call_keeps_later_calls_on_same_pool_waiting )
+    {
+        Pools pools;
+        pools.set( "link", 4 );
+        pools.set( "compile", 4 );
+        pools.begin_dispatch();
+        pools.claim( weights(0, 2) );
+
+        // A heavy link doesn't fit and blocks the link pool for the rest of
+        // the pass so a light link queued behind it can't overtake it, but
+        // calls on other pools and calls without pools still run.
+        CHECK( !pools.available(weights(0, 4)) );
+        pools.block( weights(0, 4) );
+        CHECK( !pools.available(weights(0, 1)) );
+        CHECK( pools.available(weights(1, 1)) );
+        CHECK( pools.available(vector<pair<int, int> >()) );
+
+        vector<pair<int, int> > link_and_compile = weights( 0, 1 );
+        link_and_compile.push_back( make_pair(1, 1) );
+        CHECK( !pools.available(link_and_compile) );
+
+        // Once the running link finishes the next pass runs the heavy link
+        // first.
+        pools.release( weights(0, 2) );
+        pools.begin_dispatch();
+        CHECK( pools.available(weights(0, 4)) );
+        pools.claim( weights(0, 4) );
+        CHECK( !pools.available(weights(0, 1)) );
+    }
+}
@@ -69,4 +69,54 @@ SUITE( TestPostorder )
         }
         CHECK( errors == 2 );
     }
+
+    TEST_FIXTURE( ErrorChecker, dependencies_are_visited_before_dependents )
+    {
+        const char* script = 
+            "local Ordered = TargetPrototype( 'Ordered' ); \n"
+            "local a = Target( forge, 'a', Ordered ); \n"
+            "local b = Target( forge, 'b', Ordered ); \n"
+            "local c = Target( forge, 'c', Ordered ); \n"
+            "local d = Target( forge, 'd', Ordered ); \n"
+            "a:add_dependency( b ); \n"
+            "a:add_dependency( d ); \n"
+            "b:add_dependency( c ); \n"
+            "d:add_dependency( c ); \n"
+            "local visited = {}; \n"
+            "postorder( a, function(target) \n"
+            "    for _, dependency in target:dependencies() do \n"
+            "        assert( visited[dependency], 'Dependency visited after dependent' ); \n"
+            "    end \n"
+            "    visited[target] = true; \n"
+            "end ); \n"
+            "assert( visited[a] and visited[b] and visited[c] and visited[d], 'Target not visited' ); \n"
+        ;
+        test( script );
+        CHECK( errors == 0 );
+    }
+
+    TEST_FIXTURE( ErrorChecker, targets_depending_on_chains_of_unvisited_targets_are_visited_once )
+    {
+        const char* script = 
+            "local Ordered = TargetPrototype( 'Ordered' ); \n"
+            "local header = Target( forge, 'header' ); \n"
+            "local generated_header = Target( forge, 'generated_header' ); \n"
+            "local object = Target( forge, 'object', Ordered ); \n"
+            "local executable = Target( forge, 'executable', Ordered ); \n"
+            "header:set_working_directory( nil ); \n"
+            "generated_header:set_working_directory( nil ); \n"
+            "generated_header:add_dependency( header ); \n"
+            "object:add_dependency( generated_header ); \n"
+            "executable:add_dependency( object ); \n"
+            "local visits = {}; \n"
+            "postorder( executable, function(target) \n"
+            "    visits[target] = (visits[target] or 0) + 1; \n"
+            "end ); \n"
+            "assert( visits[header] == nil and visits[generated_header] == nil, 'Unvisited target visited' ); \n"
+            "assert( visits[object] == 1, 'Target visited more than once' ); \n"
+            "assert( visits[executable] == 1, 'Target visited more than once' ); \n"
+        ;
+        test( script );
+        CHECK( errors == 0 );
+    }
 }
@@ -127,21 +127,28 @@ end
 -- target /target/.
 function Toolset:dependencies_filter( target )
     target:clear_implicit_dependencies();
-    return function( line )
-        if line:match('^==') then 
-            local READ_PATTERN = "^== read '([^']*)'";
-            local filename = line:match( READ_PATTERN );
-            if filename then
-                local within_source_tree = relative( absolute(filename), root() ):find( '..', 1, true ) == nil;
-                if within_source_tree then 
-                    local header = self:SourceFile( filename );
-                    target:add_implicit_dependency( header );
+    local filter = batch_filter( function( lines )
+        for _, line in ipairs(lines) do
+            if line:match('^==') then 
+                local READ_PATTERN = "^== read '([^']*)'";
+                local filename = line:match( READ_PATTERN );
+                if filename then
+                    local within_source_tree = relative( absolute(filename), root() ):find( '..', 1, true ) == nil;
+                    if within_source_tree then 
+                        local header = self:SourceFile( filename );
+                        target:add_implicit_dependency( header );
+                    end
                 end
+            else
+                print( line );
             end
-        else
-            print( line );
         end
-    end
+    end );
+
+    -- Set the target and directory so that `execute()` filters natively.
+    filter.target = target;
+    filter.directory = root();
+    return filter;
 end
 
 -- Add dependencies detected by the injected build hooks library to the 
@@ -150,25 +157,34 @@ function Toolset:filenames_filter( target )
     target:clear_filenames();
     target:clear_implicit_dependencies();
     local output_directory = target:ordering_dependency():filename();
-    return function( line )
-        if line:match('^==') then
-            local READ_WRITE_PATTERN = "^== (%a+) '([^']*)'";
-            local read_write, filename = line:match( READ_WRITE_PATTERN );
-            if read_write and filename then
-                local within_source_tree = relative( absolute(filename), output_directory ):find( '..', 1, true ) == nil;
-                if within_source_tree then 
-                    if read_write == 'write' then
-                        target:add_filename( filename );
-                    else
-                        local source_file = self:SourceFile( filename );
-                        target:add_implicit_dependency( source_file );
+    local filter = batch_filter( function( lines )
+        for _, line in ipairs(lines) do
+            if line:match('^==') then
+                local READ_WRITE_PATTERN = "^== (%a+) '([^']*)'";
+                local read_write, filename = line:match( READ_WRITE_PATTERN );
+                if read_write and filename then
+                    local within_source_tree = relative( absolute(filename), output_directory ):find( '..', 1, true ) == nil;
+                    if within_source_tree then 
+                        if read_write == 'write' then
+                            target:add_filename( filename );
+                        else
+                            local source_file = self:SourceFile( filename );
+                            target:add_implicit_dependency( source_file );
+                        end
                     end
                 end
+            else
+                print( line );
             end
-        else
-            print( line );
         end
-    end
+    end );
+
+    -- Set the target, directory, and filenames flag so that `execute()` 
+    -- filters natively.
+    filter.target = target;
+    filter.directory = output_directory;
+    filter.filenames = true;
+    return filter;
 end
 
 -- Return true if this toolset's platform matches any passed in pattern.
@@ -63,6 +63,18 @@ function build()
     return failures;
 end
 
+-- Provide global watch command that builds and then waits for files to 
+-- change and builds again until a buildfile changes.
+function watch()
+    local goal_target = find_initial_target( goal );
+    local failures = build();
+    while wait_for_changes(goal_target) do
+        failures = build();
+    end
+    printf( "forge: buildfiles changed, run watch again to reload them" );
+    return failures;
+end
+
 -- Provide global clean command.
 function clean()
     local failures = postorder( find_initial_target(goal), clean_visit );
@@ -98,6 +110,7 @@ Variables:
 Commands:
   build              Build outdated targets.
   clean              Clean all targets.
+  watch              Build and rebuild when files change.
   reconfigure        Re-run auto-detected configuration.
   dependencies       Print dependency hierarchy.
   namespace          Print namespace hierarchy.
@@ -132,6 +145,16 @@ function toolsets( ... )
     return toolsets_iterator;
 end
 
+-- Wrap /filter/ in a callable table that is called with a table of lines 
+-- for each batch of output rather than once per line.
+function batch_filter( filter )
+    return setmetatable( {batch = true}, {
+        __call = function( _, lines, ... )
+            return filter( lines, ... );
+        end
+    } );
+end
+
 -- Execute command raising an error if it doesn't return 0.
 function system( command, arguments, environment, dependencies_filter, stdout_filter, stderr_filter, ... )
     if type(arguments) == 'table' then
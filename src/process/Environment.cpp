@@ -52,6 +52,51 @@ void Environment::append( const char* key, const char* value )
     values_.push_back( (char*) key_start );
 }
 
+void Environment::set( const char* key, const char* value )
+{
+    SWEET_ASSERT( key );
+    SWEET_ASSERT( value );
+
+    size_t key_length = strlen( key );
+    vector<char*>::iterator i = values_.begin();
+    while ( i != values_.end() )
+    {
+        uintptr_t start = (uintptr_t) *i;
+        if ( strncmp(&buffer_[start], key, key_length) == 0 && buffer_[start + key_length] == '=' )
+        {
+            size_t length = strlen( &buffer_[start] ) + 1;
+            buffer_.erase( buffer_.begin() + start, buffer_.begin() + start + length );
+            i = values_.erase( i );
+            for ( vector<char*>::iterator j = i; j != values_.end(); ++j )
+            {
+                *j = (char*) ((uintptr_t) *j - length);
+            }
+        }
+        else
+        {
+            ++i;
+        }
+    }
+    append( key, value );
+}
+
+const char* Environment::find( const char* key ) const
+{
+    SWEET_ASSERT( key );
+
+    const char* value = NULL;
+    size_t key_length = strlen( key );
+    for ( vector<char*>::const_iterator i = values_.begin(); i != values_.end(); ++i )
+    {
+        uintptr_t start = (uintptr_t) *i;
+        if ( strncmp(&buffer_[start], key, key_length) == 0 && buffer_[start + key_length] == '=' )
+        {
+            value = &buffer_[start + key_length + 1];
+        }
+    }
+    return value;
+}
+
 void Environment::prepare()
 {
     for ( vector<char*>::iterator value = values_.begin(); value != values_.end(); ++value )
@@ -12,6 +12,8 @@ namespace process
 /**
 // An array of key value pairs to store the environment passed to spawn a new
 // process.
+//
+// Values may only be set and found before prepare() is called.
 */
 class Environment
 {
@@ -23,6 +25,8 @@ public:
     char* const* values() const;
     const char* buffer() const;
     void append( const char* key, const char* value );
+    void set( const char* key, const char* value );
+    const char* find( const char* key ) const;
     void prepare();
 };
     
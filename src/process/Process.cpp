@@ -7,6 +7,7 @@
 #include "stdafx.hpp"
 #include "Process.hpp"
 #include "Environment.hpp"
+#include "SpawnServer.hpp"
 #include "Error.hpp"
 #include <assert/assert.hpp>
 
@@ -40,6 +41,7 @@ Process::Process()
 : executable_( NULL ),
   directory_( NULL ),
   environment_( NULL ),
+  spawn_server_( NULL ),
   start_suspended_( false ),
   inherit_environment_( false ),
   pipes_(),
@@ -52,7 +54,8 @@ Process::Process()
   suspended_( false )
 #elif defined(BUILD_OS_LINUX)
   process_( 0 ),
-  exit_code_( 0 )
+  exit_code_( 0 ),
+  exit_fd_( -1 )
 #endif
 {
 }
@@ -87,6 +90,16 @@ Process::~Process()
     }
 
 #elif defined(BUILD_OS_MACOS) || defined(BUILD_OS_LINUX)
+#if defined(BUILD_OS_LINUX)
+    // The SpawnServer reaps processes that it spawned.
+    if ( exit_fd_ != -1 )
+    {
+        close( exit_fd_ );
+        exit_fd_ = -1;
+        process_ = 0;
+    }
+#endif
+
     if ( process_ != 0 )
     {
         process_ = 0;
@@ -134,6 +147,21 @@ void Process::inherit_environment( bool inherit_environment )
     inherit_environment_ = inherit_environment;
 }
 
+/**
+// Spawn this Process through a SpawnServer rather than forking the calling
+// process.
+//
+// Only used on Linux and ignored elsewhere.
+//
+// @param spawn_server
+//  The running SpawnServer to spawn this Process through or null to fork
+//  the calling process.
+*/
+void Process::spawn_server( SpawnServer* spawn_server )
+{
+    spawn_server_ = spawn_server;
+}
+
 /**
 // Create a pipe to communicate with the spawned process.
 //
@@ -357,6 +385,51 @@ void Process::run( const char* arguments )
 
     process_ = pid;
 #elif defined(BUILD_OS_LINUX)
+    if ( spawn_server_ && spawn_server_->running() )
+    {
+        vector<int> fds;
+        vector<int> child_fds;
+        for ( vector<Pipe>::iterator pipe = pipes_.begin(); pipe != pipes_.end(); ++pipe )
+        {
+            fds.push_back( int(pipe->write_fd) );
+            child_fds.push_back( pipe->child_fd );
+        }
+
+        char* const* envp = NULL;
+        if ( inherit_environment_ )
+        {
+            envp = environ;
+        }
+        else if ( environment_ )
+        {
+            envp = environment_->values();
+        }
+
+        int exit_fd = -1;
+        int pid = spawn_server_->spawn( executable_, directory_, arguments, envp, fds.empty() ? NULL : &fds[0], child_fds.empty() ? NULL : &child_fds[0], int(fds.size()), &exit_fd );
+        for ( vector<Pipe>::iterator pipe = pipes_.begin(); pipe != pipes_.end(); ++pipe )
+        {
+            close( pipe->write_fd );
+            pipe->write_fd = -1;
+        }
+
+        if ( pid <= 0 )
+        {
+            for ( vector<Pipe>::iterator pipe = pipes_.begin(); pipe != pipes_.end(); ++pipe )
+            {
+                close( pipe->read_fd );
+                pipe->read_fd = -1;
+            }
+
+            char message [256];
+            SWEET_ERROR( ExecutingProcessFailedError("Executing '%s' failed - %s", executable_, Error::format(-pid, message, sizeof(message))) );
+        }
+
+        process_ = pid;
+        exit_fd_ = exit_fd;
+        return;
+    }
+
     process_ = fork();
     if ( process_ == -1 )
     {
@@ -449,6 +522,22 @@ void* Process::thread() const
 #endif
 }
 
+/**
+// Get the file descriptor that becomes readable when this Process exits.
+//
+// @return
+//  The file descriptor to pass to `SpawnServer::exit_code()` when this
+//  Process was spawned through a SpawnServer otherwise -1.
+*/
+intptr_t Process::exit_fd() const
+{
+#if defined(BUILD_OS_LINUX)
+    return exit_fd_;
+#else
+    return -1;
+#endif
+}
+
 void* Process::write_pipe( int index ) const
 {
 #if defined(BUILD_OS_WINDOWS)
@@ -502,6 +591,21 @@ void Process::wait()
 #elif defined(BUILD_OS_MACOS) || defined(BUILD_OS_LINUX)
     SWEET_ASSERT( process_ != 0 );
 
+#if defined(BUILD_OS_LINUX)
+    if ( exit_fd_ != -1 )
+    {
+        bool exited = SpawnServer::exit_code( exit_fd_, &exit_code_ );
+        close( exit_fd_ );
+        exit_fd_ = -1;
+        process_ = 0;
+        if ( !exited )
+        {
+            SWEET_ERROR( WaitForProcessFailedError("Waiting for a process failed - the spawn server exited") );
+        }
+        return;
+    }
+#endif
+
     pid_t result = waitpid( process_, &exit_code_, 0 );
     while ( result < 0 && errno == EINTR )
     {
@@ -516,6 +620,30 @@ void Process::wait()
 #endif
 }
 
+/**
+// Detach this Process so that it isn't waited for when it is destroyed.
+//
+// The caller takes responsibility for waiting for the process to exit, for
+// example by passing its identifier to `waitpid()` from another thread, or
+// for reading its exit code from and closing its `exit_fd()` when it was
+// spawned through a SpawnServer.
+*/
+void Process::detach()
+{
+#if defined(BUILD_OS_WINDOWS)
+    if ( process_ != INVALID_HANDLE_VALUE )
+    {
+        ::CloseHandle( process_ );
+        process_ = INVALID_HANDLE_VALUE;
+    }
+#elif defined(BUILD_OS_MACOS)
+    process_ = 0;
+#elif defined(BUILD_OS_LINUX)
+    process_ = 0;
+    exit_fd_ = -1;
+#endif
+}
+
 /**
 // Get the exit code returned by this Process when it exited.
 //
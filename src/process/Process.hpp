@@ -25,6 +25,7 @@ enum Pipes
 };
 
 class Environment;
+class SpawnServer;
 
 /**
 // An operating system process.
@@ -41,6 +42,7 @@ class Process
     const char* executable_;
     const char* directory_;
     const Environment* environment_;
+    SpawnServer* spawn_server_;
     bool start_suspended_;
     bool inherit_environment_;
     std::vector<Pipe> pipes_;
@@ -59,6 +61,7 @@ class Process
 #if defined(BUILD_OS_LINUX)
     pid_t process_;
     int exit_code_;
+    int exit_fd_; ///< The file descriptor to read the exit code from when spawned by a SpawnServer or -1.
 #endif
 
     public:
@@ -68,17 +71,20 @@ class Process
         void* process() const;
         void* thread() const;
         void* write_pipe( int index ) const;
+        intptr_t exit_fd() const;
 
         void executable( const char* executable );
         void directory( const char* directory );
         void environment( const Environment* environment );
         void start_suspended( bool start_suspended );
         void inherit_environment( bool inherit_environment );
+        void spawn_server( SpawnServer* spawn_server );
         intptr_t pipe( int child_fd );
         void run( const char* arguments );
 
         void resume();
         void wait();
+        void detach();
         int exit_code();
 };
 
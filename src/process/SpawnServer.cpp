@@ -0,0 +1,695 @@
+//
+// SpawnServer.cpp
+// Copyright (c) Charles Baker.  All rights reserved
+//
+
+#include "stdafx.hpp"
+#include "SpawnServer.hpp"
+#include <assert/assert.hpp>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(BUILD_OS_LINUX)
+#include <cmdline/Splitter.hpp>
+#include <map>
+#include <spawn.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/signalfd.h>
+#endif
+
+using std::vector;
+using namespace sweet;
+using namespace sweet::process;
+
+#if defined(BUILD_OS_LINUX)
+
+namespace
+{
+
+/**
+// The maximum number of pipes that can be connected to a spawned process.
+*/
+const int MAXIMUM_FDS = 8;
+
+/**
+// The lowest file descriptor that pipes are moved to in the server so that
+// they don't collide with the file descriptors that they are duplicated
+// into in the child.
+*/
+const int FIRST_FD = 16;
+
+/**
+// The fixed size part of a request to spawn a process.
+//
+// Followed by the executable, directory, and arguments as null terminated
+// strings and then the environment as a sequence of null terminated
+// "key=value" strings.  The socket to reply on and the pipes to connect to
+// the child are passed, in that order, as `SCM_RIGHTS` ancillary data with
+// the first byte of the request.
+*/
+struct Request
+{
+    uint32_t executable_length; ///< The length of the executable including its terminator.
+    uint32_t directory_length; ///< The length of the directory including its terminator or 0 for none.
+    uint32_t arguments_length; ///< The length of the arguments including their terminator.
+    uint32_t environment_length; ///< The length of the environment strings including their terminators.
+    int32_t environment; ///< Non-zero if an environment is passed otherwise zero for an empty environment.
+    int32_t count; ///< The number of pipes to connect to the child.
+    int32_t child_fds [MAXIMUM_FDS]; ///< The file descriptors to duplicate each pipe into in the child.
+};
+
+bool read_fully( int fd, void* data, size_t length )
+{
+    char* position = (char*) data;
+    while ( length > 0 )
+    {
+        ssize_t bytes = ::read( fd, position, length );
+        if ( bytes < 0 && errno == EINTR )
+        {
+            continue;
+        }
+        if ( bytes <= 0 )
+        {
+            return false;
+        }
+        position += bytes;
+        length -= size_t(bytes);
+    }
+    return true;
+}
+
+bool write_fully( int fd, const void* data, size_t length )
+{
+    const char* position = (const char*) data;
+    while ( length > 0 )
+    {
+        ssize_t bytes = ::send( fd, position, length, MSG_NOSIGNAL );
+        if ( bytes < 0 && errno == EINTR )
+        {
+            continue;
+        }
+        if ( bytes <= 0 )
+        {
+            return false;
+        }
+        position += bytes;
+        length -= size_t(bytes);
+    }
+    return true;
+}
+
+bool send_request( int fd, const Request& request, const int* fds, int count )
+{
+    SWEET_ASSERT( count > 0 && count <= MAXIMUM_FDS + 1 );
+
+    union
+    {
+        struct cmsghdr header;
+        char buffer [CMSG_SPACE(sizeof(int) * (MAXIMUM_FDS + 1))];
+    } control;
+    memset( &control, 0, sizeof(control) );
+
+    struct iovec iov;
+    iov.iov_base = (void*) &request;
+    iov.iov_len = sizeof(request);
+
+    struct msghdr message;
+    memset( &message, 0, sizeof(message) );
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.buffer;
+    message.msg_controllen = CMSG_SPACE( sizeof(int) * count );
+
+    struct cmsghdr* header = CMSG_FIRSTHDR( &message );
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN( sizeof(int) * count );
+    memcpy( CMSG_DATA(header), fds, sizeof(int) * count );
+
+    ssize_t bytes = ::sendmsg( fd, &message, MSG_NOSIGNAL );
+    while ( bytes < 0 && errno == EINTR )
+    {
+        bytes = ::sendmsg( fd, &message, MSG_NOSIGNAL );
+    }
+    if ( bytes < 0 )
+    {
+        return false;
+    }
+    return write_fully( fd, (const char*) &request + bytes, sizeof(request) - size_t(bytes) );
+}
+
+/**
+// Receive the fixed size part of a request and the file descriptors passed
+// with it.
+*/
+bool receive_request( int fd, Request* request, int* fds, int* count )
+{
+    SWEET_ASSERT( request );
+    SWEET_ASSERT( fds );
+    SWEET_ASSERT( count );
+
+    union
+    {
+        struct cmsghdr header;
+        char buffer [CMSG_SPACE(sizeof(int) * (MAXIMUM_FDS + 1))];
+    } control;
+
+    *count = 0;
+    size_t received = 0;
+    while ( received < sizeof(*request) )
+    {
+        struct iovec iov;
+        iov.iov_base = (char*) request + received;
+        iov.iov_len = sizeof(*request) - received;
+
+        struct msghdr message;
+        memset( &message, 0, sizeof(message) );
+        message.msg_iov = &iov;
+        message.msg_iovlen = 1;
+        message.msg_control = control.buffer;
+        message.msg_controllen = sizeof(control.buffer);
+
+        ssize_t bytes = ::recvmsg( fd, &message, MSG_CMSG_CLOEXEC );
+        if ( bytes < 0 && errno == EINTR )
+        {
+            continue;
+        }
+        if ( bytes <= 0 )
+        {
+            return false;
+        }
+
+        for ( struct cmsghdr* header = CMSG_FIRSTHDR(&message); header; header = CMSG_NXTHDR(&message, header) )
+        {
+            if ( header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS )
+            {
+                const int* received_fds = (const int*) CMSG_DATA( header );
+                int received_count = int( (header->cmsg_len - CMSG_LEN(0)) / sizeof(int) );
+                for ( int i = 0; i < received_count; ++i )
+                {
+                    if ( *count < MAXIMUM_FDS + 1 )
+                    {
+                        fds[(*count)++] = received_fds[i];
+                    }
+                    else
+                    {
+                        ::close( received_fds[i] );
+                    }
+                }
+            }
+        }
+        received += size_t(bytes);
+    }
+    return true;
+}
+
+/**
+// Spawn the process described by a request.
+//
+// @return
+//  The identifier of the spawned process or a negative error number if
+//  spawning the process failed.
+*/
+int spawn_process( const Request& request, const vector<char>& payload, const int* fds, const sigset_t& signal_mask )
+{
+    const char* executable = &payload[0];
+    const char* directory = request.directory_length > 0 ? executable + request.executable_length : NULL;
+    const char* arguments = executable + request.executable_length + request.directory_length;
+    if ( executable[request.executable_length - 1] != 0 || (directory && directory[request.directory_length - 1] != 0) || arguments[request.arguments_length - 1] != 0 )
+    {
+        return -EINVAL;
+    }
+
+    vector<char*> environment;
+    const char* environment_begin = arguments + request.arguments_length;
+    const char* environment_end = environment_begin + request.environment_length;
+    for ( const char* value = environment_begin; value < environment_end; value += strlen(value) + 1 )
+    {
+        environment.push_back( (char*) value );
+    }
+    environment.push_back( NULL );
+
+    // The server is single threaded so changing its working directory is
+    // safe and avoids relying on `posix_spawn_file_actions_addchdir_np()`.
+    if ( directory && ::chdir(directory) != 0 )
+    {
+        return -errno;
+    }
+
+    posix_spawn_file_actions_t file_actions;
+    posix_spawn_file_actions_init( &file_actions );
+    for ( int i = 0; i < request.count; ++i )
+    {
+        posix_spawn_file_actions_adddup2( &file_actions, fds[i], request.child_fds[i] );
+    }
+
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init( &attributes );
+    posix_spawnattr_setflags( &attributes, POSIX_SPAWN_SETSIGMASK );
+    posix_spawnattr_setsigmask( &attributes, &signal_mask );
+
+    cmdline::Splitter splitter( arguments );
+    pid_t pid = 0;
+    int result = posix_spawn( &pid, executable, &file_actions, &attributes, &splitter.arguments()[0], request.environment ? &environment[0] : NULL );
+    posix_spawnattr_destroy( &attributes );
+    posix_spawn_file_actions_destroy( &file_actions );
+    return result == 0 ? int(pid) : -result;
+}
+
+/**
+// Receive one request and spawn the process that it describes.
+//
+// @return
+//  False if the client has closed its socket or sent a malformed request
+//  otherwise true.
+*/
+bool receive( int fd, const sigset_t& signal_mask, std::map<pid_t, int>* children )
+{
+    SWEET_ASSERT( children );
+
+    Request request;
+    int fds [MAXIMUM_FDS + 1];
+    int count = 0;
+    if ( !receive_request(fd, &request, fds, &count) )
+    {
+        for ( int i = 0; i < count; ++i )
+        {
+            ::close( fds[i] );
+        }
+        return false;
+    }
+
+    vector<char> payload;
+    size_t length = size_t(request.executable_length) + size_t(request.directory_length) + size_t(request.arguments_length) + size_t(request.environment_length);
+    bool valid =
+        request.count >= 0 && request.count <= MAXIMUM_FDS && count == request.count + 1 &&
+        request.executable_length > 0 && request.arguments_length > 0
+    ;
+    if ( valid )
+    {
+        payload.resize( length );
+        valid = read_fully( fd, &payload[0], length );
+    }
+    if ( !valid )
+    {
+        for ( int i = 0; i < count; ++i )
+        {
+            ::close( fds[i] );
+        }
+        return false;
+    }
+
+    // Move the pipes above the file descriptors that they are duplicated
+    // into so that duplicating one pipe can't overwrite another.
+    int reply_fd = fds[0];
+    int* pipe_fds = &fds[1];
+    for ( int i = 0; i < request.count; ++i )
+    {
+        int moved_fd = ::fcntl( pipe_fds[i], F_DUPFD_CLOEXEC, FIRST_FD );
+        ::close( pipe_fds[i] );
+        pipe_fds[i] = moved_fd;
+    }
+
+    int32_t pid = spawn_process( request, payload, pipe_fds, signal_mask );
+    for ( int i = 0; i < request.count; ++i )
+    {
+        ::close( pipe_fds[i] );
+    }
+
+    bool replied = write_fully( reply_fd, &pid, sizeof(pid) );
+    if ( pid > 0 )
+    {
+        (*children)[pid] = replied ? reply_fd : -1;
+    }
+    if ( pid <= 0 || !replied )
+    {
+        ::close( reply_fd );
+    }
+    return true;
+}
+
+/**
+// Reap exited children and reply with their exit status.
+*/
+void reap( std::map<pid_t, int>* children )
+{
+    SWEET_ASSERT( children );
+    int status = 0;
+    pid_t pid = ::waitpid( -1, &status, WNOHANG );
+    while ( pid > 0 || (pid < 0 && errno == EINTR) )
+    {
+        std::map<pid_t, int>::iterator child = children->find( pid );
+        if ( child != children->end() )
+        {
+            if ( child->second >= 0 )
+            {
+                int32_t exit_status = status;
+                write_fully( child->second, &exit_status, sizeof(exit_status) );
+                ::close( child->second );
+            }
+            children->erase( child );
+        }
+        pid = ::waitpid( -1, &status, WNOHANG );
+    }
+}
+
+/**
+// Serve requests to spawn processes until the client closes its socket and
+// all of the processes spawned have exited.
+*/
+void serve( int fd )
+{
+    sigset_t child_signal;
+    sigemptyset( &child_signal );
+    sigaddset( &child_signal, SIGCHLD );
+    sigset_t signal_mask;
+    sigprocmask( SIG_BLOCK, &child_signal, &signal_mask );
+    int signal_fd = ::signalfd( -1, &child_signal, SFD_NONBLOCK | SFD_CLOEXEC );
+    if ( signal_fd < 0 )
+    {
+        return;
+    }
+
+    std::map<pid_t, int> children;
+    bool accepting = true;
+    while ( accepting || !children.empty() )
+    {
+        struct pollfd fds [2];
+        fds[0].fd = signal_fd;
+        fds[0].events = POLLIN;
+        fds[0].revents = 0;
+        fds[1].fd = accepting ? fd : -1;
+        fds[1].events = POLLIN;
+        fds[1].revents = 0;
+        int result = ::poll( fds, 2, -1 );
+        if ( result < 0 )
+        {
+            if ( errno == EINTR )
+            {
+                continue;
+            }
+            break;
+        }
+
+        if ( fds[0].revents != 0 )
+        {
+            struct signalfd_siginfo information;
+            while ( ::read(signal_fd, &information, sizeof(information)) == sizeof(information) )
+            {
+            }
+            reap( &children );
+        }
+
+        if ( fds[1].revents != 0 )
+        {
+            accepting = receive( fd, signal_mask, &children );
+            if ( !accepting )
+            {
+                ::close( fd );
+                reap( &children );
+            }
+        }
+    }
+    ::close( signal_fd );
+}
+
+}
+
+#endif
+
+/**
+// Constructor.
+*/
+SpawnServer::SpawnServer()
+:
+#if defined(BUILD_OS_MACOS) || defined(BUILD_OS_LINUX)
+  server_( 0 ),
+#endif
+  socket_( -1 ),
+  mutex_()
+{
+}
+
+/**
+// Destructor.
+//
+// Stops the server and waits for it to exit.
+*/
+SpawnServer::~SpawnServer()
+{
+    stop();
+}
+
+/**
+// Fork the server process.
+//
+// Call this while the calling process is small and before it starts any
+// other threads; the server is a copy of the calling process at the time
+// that it is started.
+//
+// @return
+//  True if the server was started otherwise false in which case processes
+//  should be spawned directly.
+*/
+bool SpawnServer::start()
+{
+    stop();
+
+#if defined(BUILD_OS_LINUX)
+    int sockets [2] = { -1, -1 };
+    if ( ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) != 0 )
+    {
+        return false;
+    }
+
+    pid_t pid = ::fork();
+    if ( pid < 0 )
+    {
+        ::close( sockets[0] );
+        ::close( sockets[1] );
+        return false;
+    }
+    else if ( pid == 0 )
+    {
+        ::close( sockets[0] );
+        serve( sockets[1] );
+        _exit( EXIT_SUCCESS );
+    }
+
+    ::close( sockets[1] );
+    server_ = pid;
+    socket_ = sockets[0];
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+// Stop the server.
+//
+// The server exits once the processes that it has spawned have exited.
+*/
+void SpawnServer::stop()
+{
+#if defined(BUILD_OS_LINUX)
+    if ( socket_ >= 0 )
+    {
+        ::close( socket_ );
+        socket_ = -1;
+    }
+    if ( server_ != 0 )
+    {
+        int status = 0;
+        pid_t result = ::waitpid( server_, &status, 0 );
+        while ( result < 0 && errno == EINTR )
+        {
+            result = ::waitpid( server_, &status, 0 );
+        }
+        server_ = 0;
+    }
+#endif
+}
+
+/**
+// Is the server running?
+//
+// @return
+//  True if the server is running otherwise false.
+*/
+bool SpawnServer::running() const
+{
+    return socket_ >= 0;
+}
+
+/**
+// Spawn a process through the server.
+//
+// May be called from any thread.
+//
+// @param executable
+//  The path to the executable to run (assumed not null).
+//
+// @param directory
+//  The working directory to run the process in or null to run it in the
+//  working directory of the server.
+//
+// @param arguments
+//  The command line to split into arguments to pass to the process
+//  (assumed not null).
+//
+// @param environment
+//  The null terminated array of "key=value" strings to pass as the
+//  environment of the process or null to pass an empty environment.
+//
+// @param fds
+//  The write ends of the pipes to connect to the process.
+//
+// @param child_fds
+//  The file descriptors to duplicate each pipe into in the process.
+//
+// @param count
+//  The number of pipes to connect to the process.
+//
+// @param exit_fd
+//  A variable to receive the file descriptor that becomes readable when
+//  the process exits (assumed not null).  The caller passes it to
+//  `exit_code()` and then closes it.
+//
+// @return
+//  The identifier of the process or a negative error number if spawning
+//  the process failed.
+*/
+int SpawnServer::spawn( const char* executable, const char* directory, const char* arguments, char* const* environment, const int* fds, const int* child_fds, int count, int* exit_fd )
+{
+    SWEET_ASSERT( executable );
+    SWEET_ASSERT( arguments );
+    SWEET_ASSERT( count >= 0 );
+    SWEET_ASSERT( exit_fd );
+
+#if defined(BUILD_OS_LINUX)
+    if ( count > MAXIMUM_FDS )
+    {
+        return -EMFILE;
+    }
+
+    Request request;
+    memset( &request, 0, sizeof(request) );
+    request.executable_length = uint32_t(strlen(executable) + 1);
+    request.directory_length = directory ? uint32_t(strlen(directory) + 1) : 0;
+    request.arguments_length = uint32_t(strlen(arguments) + 1);
+    request.environment = environment ? 1 : 0;
+    request.count = count;
+
+    vector<char> payload;
+    payload.insert( payload.end(), executable, executable + request.executable_length );
+    payload.insert( payload.end(), directory, directory + request.directory_length );
+    payload.insert( payload.end(), arguments, arguments + request.arguments_length );
+    for ( char* const* value = environment; value && *value; ++value )
+    {
+        payload.insert( payload.end(), *value, *value + strlen(*value) + 1 );
+    }
+    request.environment_length = uint32_t(payload.size() - request.executable_length - request.directory_length - request.arguments_length);
+
+    int sockets [2] = { -1, -1 };
+    if ( ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) != 0 )
+    {
+        return -errno;
+    }
+
+    int sent_fds [MAXIMUM_FDS + 1];
+    sent_fds[0] = sockets[1];
+    for ( int i = 0; i < count; ++i )
+    {
+        sent_fds[i + 1] = fds[i];
+        request.child_fds[i] = child_fds[i];
+    }
+
+    bool sent = false;
+    {
+        std::unique_lock<std::mutex> lock( mutex_ );
+        if ( socket_ >= 0 )
+        {
+            sent = send_request( socket_, request, sent_fds, count + 1 ) && write_fully( socket_, &payload[0], payload.size() );
+
+            // A partially sent request leaves the stream in an unknown
+            // state so stop sending requests to the server.
+            if ( !sent )
+            {
+                ::shutdown( socket_, SHUT_WR );
+            }
+        }
+    }
+    ::close( sockets[1] );
+
+    int32_t pid = 0;
+    if ( !sent || !read_fully(sockets[0], &pid, sizeof(pid)) )
+    {
+        ::close( sockets[0] );
+        return -EPIPE;
+    }
+    if ( pid <= 0 )
+    {
+        ::close( sockets[0] );
+        return pid;
+    }
+    *exit_fd = sockets[0];
+    return pid;
+#else
+    (void) executable;
+    (void) directory;
+    (void) arguments;
+    (void) environment;
+    (void) fds;
+    (void) child_fds;
+    (void) count;
+    (void) exit_fd;
+    return -1;
+#endif
+}
+
+/**
+// Read the exit status of a process spawned through a server.
+//
+// Blocks until the process has exited unless \e exit_fd is already
+// readable.
+//
+// @param exit_fd
+//  The file descriptor returned from `spawn()` for the process.
+//
+// @param exit_code
+//  A variable to receive the exit status of the process as returned by
+//  `waitpid()` (assumed not null).
+//
+// @return
+//  True if the exit status was read or false if the server exited before
+//  the process did.
+*/
+bool SpawnServer::exit_code( int exit_fd, int* exit_code )
+{
+    SWEET_ASSERT( exit_fd >= 0 );
+    SWEET_ASSERT( exit_code );
+
+#if defined(BUILD_OS_LINUX)
+    int32_t status = 0;
+    if ( !read_fully(exit_fd, &status, sizeof(status)) )
+    {
+        return false;
+    }
+    *exit_code = status;
+    return true;
+#else
+    (void) exit_fd;
+    (void) exit_code;
+    return false;
+#endif
+}
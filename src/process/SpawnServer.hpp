@@ -0,0 +1,58 @@
+#ifndef SWEET_PROCESS_SPAWNSERVER_HPP_INCLUDED
+#define SWEET_PROCESS_SPAWNSERVER_HPP_INCLUDED
+
+#include <build.hpp>
+#include <mutex>
+
+#if defined(BUILD_OS_MACOS) || defined(BUILD_OS_LINUX)
+#include <sys/types.h>
+#endif
+
+namespace sweet
+{
+
+namespace process
+{
+
+/**
+// A small helper process that spawns processes on behalf of the process
+// that started it.
+//
+// Spawning a process from a process with a large address space spends time
+// copying page tables in `fork()` even when the child immediately calls
+// `execve()`.  A SpawnServer is forked while its parent is still small and
+// then receives requests to spawn processes over a unix domain socket and
+// starts them with `posix_spawn()` from its own small address space.
+//
+// Each request carries the executable, working directory, command line,
+// and environment along with the write ends of the pipes to connect to the
+// child and one end of a socket pair, passed with `SCM_RIGHTS`.  The server
+// replies on that socket with the identifier of the new process and, once
+// the process has exited and been reaped by the server, its exit status.
+//
+// Only supported on Linux; on other platforms `start()` always fails and
+// processes are spawned directly.
+*/
+class SpawnServer
+{
+#if defined(BUILD_OS_MACOS) || defined(BUILD_OS_LINUX)
+    pid_t server_; ///< The identifier of the server process or 0 if not running.
+#endif
+    int socket_; ///< The socket that requests are sent to the server on or -1 if not running.
+    std::mutex mutex_; ///< Serializes requests sent from different threads.
+
+public:
+    SpawnServer();
+    ~SpawnServer();
+    bool start();
+    void stop();
+    bool running() const;
+    int spawn( const char* executable, const char* directory, const char* arguments, char* const* environment, const int* fds, const int* child_fds, int count, int* exit_fd );
+    static bool exit_code( int exit_fd, int* exit_code );
+};
+
+}
+
+}
+
+#endif